@@ -22,13 +22,34 @@
 // =============================================================================
 
 #define SERIAL_BAUD_RATE        1000000
-#define CMD_BUFFER_SIZE         96      // Max command line length
 #define RESPONSE_BUFFER_SIZE    96      // Max response line length
 
 // Serial RX buffering (for SerialTransport)
-#define SERIAL_RX_BUFFER_SIZE   128     // Per-line buffer capacity
-#define SERIAL_CMD_QUEUE_SIZE   4       // Number of commands to queue
-#define MAX_CMDS_PER_LOOP       4       // Max commands processed per loop iteration
+#define SERIAL_RX_RING_SIZE     512     // Inbound byte buffer; commands are parsed in place
+
+// Serial TX staging (for SerialTransport): two lanes, responses go first
+#define SERIAL_TX_BATCH_SIZE    512     // RX frame lane (8 x 64-byte CDC packets)
+#define SERIAL_TX_RESPONSE_SIZE 256     // Command response lane, sent ahead of queued frames
+#define SERIAL_TX_FRAME_SLOTS   64      // Frame records tracked in the frame lane
+
+// =============================================================================
+// Network Transport (ENABLE_WIFI_TRANSPORT)
+// =============================================================================
+
+// Credentials are normally passed as build flags, e.g.
+//   build_flags = -DWIFI_SSID=\"shop-floor\" -DWIFI_PASSWORD=\"...\"
+#ifndef WIFI_SSID
+#define WIFI_SSID               ""
+#endif
+#ifndef WIFI_PASSWORD
+#define WIFI_PASSWORD           ""
+#endif
+#define WIFI_CONNECT_TIMEOUT_MS 15000   // Give up joining the network after this long (boot only)
+
+#define NET_UDP_PORT            3333    // Local UDP port for commands and RX records
+#define NET_RX_BUFFER_SIZE      512     // Largest command datagram accepted
+#define NET_TX_RESPONSE_SIZE    256     // Response bytes per datagram (sent first)
+#define NET_TX_DATAGRAM_SIZE    1024    // RX record bytes per datagram
 
 // =============================================================================
 // CAN Configuration
@@ -43,12 +64,62 @@
 // Options: BR_125K, BR_250K, BR_500K, BR_1000K
 #define DEFAULT_CAN_BITRATE     6       // S6 = 500 Kbps
 
-// CAN RX buffering (protocol layer - in SLCAN)
-#define CAN_RX_QUEUE_SIZE       128      // Ring buffer capacity
-#define MAX_FRAMES_PER_POLL     6       // Max frames forwarded per loop iteration
+// CAN RX buffering (protocol layer - shared FrameBus in ProtocolDispatcher)
+#define CAN_RX_QUEUE_SIZE       256     // Ring buffer capacity (power of two, 20 B per frame)
+#define FRAME_BUS_PRIORITY_SIZE 16      // Priority lane capacity (power of two, o+ rules)
+#define FRAME_BUS_PRIORITY_RULES 4      // Priority lane rules
+
+// RX decimation ahead of the frame bus (protocol layer - d command in SLCAN)
+#define DECIMATE_MAX_RULES      8       // Decimation rules (first match wins)
+#define DECIMATE_BUCKET_BURST   2       // Frames a d+H rule lets through back to back after a pause
+
+// Triggered burst capture (protocol layer - G command in SLCAN, on the frame bus)
+#define CAPTURE_BUFFER_FRAMES   256     // Capture buffer capacity (16 B per frame)
 
 // CAN TX buffering (backend layer - in RA4M1CAN)
-#define CAN_TX_QUEUE_SIZE       16      // Software TX queue capacity
+#define CAN_TX_QUEUE_SIZE       16      // Software TX queue capacity (priority heap)
+#define CAN_TX_FIFO             0       // 1 = strict FIFO TX order, one frame in flight
+
+// CAN bus-off handling (backend layer - in RA4M1CAN)
+#define CAN_BUSOFF_AUTO_RECOVER 1       // Force the controller back on the bus after bus-off
+#define CAN_BUSOFF_RECOVERY_MS  50      // Wait this long in bus-off before each recovery attempt
+
+// Traffic generator (protocol layer - g command in SLCAN)
+#define TRAFFIC_GEN_MAX_PER_POLL 16     // Frames offered to the TX queue per loop iteration
+
+// Cyclic transmit table (protocol layer - c command in SLCAN)
+#define CYCLIC_TX_MAX_ENTRIES   16      // Periodic frames (36 B each)
+#define CYCLIC_TX_WHEEL_SLOTS   64      // Timer wheel slots, 1 ms each (power of two)
+
+// Change-only forwarding cache (protocol layer - u command in SLCAN)
+// 2 KB direct index over all 11-bit IDs plus 16 B per payload slot
+#define CHANGE_CACHE_STD_SLOTS  64      // Distinct standard IDs tracked (max 254)
+#define CHANGE_CACHE_EXT_SLOTS  16      // Extended IDs tracked (power of two)
+
+// CAN acceptance filter table (backend layer - in RA4M1CAN)
+#define FILTER_MAX_EXT_RULES    16      // Extended ID range/mask rules
+
+// CAN RX capture (backend layer - in RA4M1CAN)
+#define CAN_ISR_RX_RING_SIZE    64      // ISR-filled RX ring capacity (power of two)
+#define CAN_TX_ECHO_RING_SIZE   32      // TX-complete echo ring capacity (power of two)
+
+// Static RAM budget for the objects in main.cpp (RA4M1 has 32 KB SRAM; the
+// rest is left for the Arduino core, USB stack, heap and stack).
+// Checked at build time; printed at boot when DEBUG_SERIAL is enabled.
+// The frame bus, the capture buffer and the ISO-TP PDU buffers
+// (2 x ISOTP_MAX_PDU_SIZE) are the largest shares.
+#define RAM_BUDGET_BYTES        24576
+
+// =============================================================================
+// Main Loop Scheduler (LoopScheduler in lib/Protocol)
+// =============================================================================
+
+// Each loop iteration (tick) splits a time budget between commands and RX
+// forwarding. Time the command side doesn't use goes to RX forwarding.
+#define SCHED_TICK_BUDGET_US    1000    // Target loop iteration time (us)
+#define SCHED_RX_MIN_SHARE_PCT  25      // RX forwarding share with an empty frame bus
+#define SCHED_RX_MAX_SHARE_PCT  90      // RX forwarding share with a full frame bus
+#define SCHED_TX_PRIORITY_PCT   75      // TX queue fill that services TX before each command
 
 // =============================================================================
 // Feature Flags
@@ -56,8 +127,14 @@
 
 #define ENABLE_TIMESTAMPS       0       // Support Z0/Z1 timestamp commands
 #define ENABLE_STATUS_LED       1       // Blink LED_BUILTIN on TX/RX activity
-#define ENABLE_HW_FILTERS       0       // Hardware acceptance filtering (M/m commands)
+#define ENABLE_HW_FILTERS       1       // Hardware acceptance filtering (M/m commands)
 #define AUTO_FORWARD_RX         1       // Auto-forward received CAN frames to host
+#define ENABLE_ISR_RX           1       // Capture RX mailboxes in our own ISR (bypass Arduino_CAN)
+#define ENABLE_ISR_TX           1       // Take TX-complete interrupts in our own ISR (TX echo timestamps)
+#define ENABLE_PROFILER         0       // DWT cycle profiling of the main loop stages (y command)
+#ifndef ENABLE_WIFI_TRANSPORT
+#define ENABLE_WIFI_TRANSPORT   0       // Talk SLCAN over WiFi UDP (ESP32-S3) instead of USB CDC
+#endif
 
 // =============================================================================
 // LED Configuration
@@ -74,7 +151,25 @@
 // =============================================================================
 
 // Maximum number of protocol handlers that can be registered
-#define MAX_PROTOCOL_HANDLERS   4
+#define MAX_PROTOCOL_HANDLERS   5
+
+// =============================================================================
+// Persisted Configuration (ConfigStore in lib/Settings)
+// =============================================================================
+
+// One record in the emulated EEPROM (data flash), written by QW/Q0-Q2
+#define CONFIG_STORE_OFFSET     0       // Byte offset of the record
+#define SLCAN_SETTINGS_MAX_FILTER_OPS 8 // f+/f- edits kept for saving (16 B each)
+
+// =============================================================================
+// ISO-TP (IsoTpHandler in lib/IsoTp)
+// =============================================================================
+
+// One TX and one RX buffer of ISOTP_MAX_PDU_SIZE each
+#define ISOTP_MAX_PDU_SIZE      1024    // Largest PDU sent or received (max 4095)
+#define ISOTP_TIMEOUT_MS        1000    // N_Bs / N_Cr: wait for flow control / next frame
+#define ISOTP_MAX_WAIT_FRAMES   10      // FC WAIT frames accepted per transfer
+#define ISOTP_RX_CHUNK          64      // PDU bytes per Id record line
 
 // =============================================================================
 // Debug Configuration
@@ -32,7 +32,8 @@ enum class CANBitrate : uint8_t {
  */
 enum class CANMode : uint8_t {
     Normal,         // Normal transmit/receive operation
-    ListenOnly      // Listen-only mode (no ACK, no transmit)
+    ListenOnly,     // Listen-only mode (no ACK, no transmit)
+    Loopback        // Internal loopback self-test (own frames received, bus untouched)
 };
 
 /**
@@ -48,25 +49,56 @@ struct CANStatus {
     bool errorPassive;      // Bit 5: Error passive (TEC/REC > 127)
     bool arbitrationLost;   // Bit 6: Arbitration lost
     bool busError;          // Bit 7: Bus error
+
+    // Beyond the SLCAN flag byte
+    bool busOff;            // Controller is (or went) bus-off
+    uint8_t txErrorCount;   // Transmit error counter (TEC)
+    uint8_t rxErrorCount;   // Receive error counter (REC)
 };
 
 /**
  * CAN frame structure.
  * Represents a single CAN message.
+ *
+ * This is also the storage record for every frame ring (ISR RX ring,
+ * FrameBus, TX queue), so DLC and the flags share one bit-packed byte
+ * and the frame is 20 bytes.
  */
 struct CANFrame {
     uint32_t id;            // CAN identifier (11-bit or 29-bit)
-    uint8_t dlc;            // Data length code (0-8)
+    uint32_t timestamp;     // Reception (or TX completion) time in microseconds, wraps after ~71.6 min
     uint8_t data[8];        // Message data
-    bool extended;          // true = 29-bit extended ID, false = 11-bit standard
-    bool rtr;               // true = Remote Transmission Request frame
-    uint16_t timestamp;     // Timestamp in milliseconds (optional)
+    uint8_t dlc : 4;        // Data length code (0-8)
+    bool extended : 1;      // true = 29-bit extended ID, false = 11-bit standard
+    bool rtr : 1;           // true = Remote Transmission Request frame
+    bool echo : 1;          // true = TX echo of a frame we sent (see ICANBackend::setTxEcho)
 
-    CANFrame() : id(0), dlc(0), extended(false), rtr(false), timestamp(0) {
+    CANFrame() : id(0), timestamp(0), dlc(0), extended(false), rtr(false), echo(false) {
         for (int i = 0; i < 8; i++) data[i] = 0;
     }
 };
 
+static_assert(sizeof(CANFrame) == 20, "CANFrame must stay a 20-byte record");
+
+/**
+ * Acceptance filter rule for the multi-rule filter table.
+ *
+ * Once any rule is installed, only frames matching at least one rule are
+ * received. Standard IDs are matched against StdRange rules, extended IDs
+ * against ExtRange and ExtMask rules.
+ */
+struct CANFilterRule {
+    enum class Kind : uint8_t {
+        StdRange,       // Standard IDs first..second (inclusive)
+        ExtRange,       // Extended IDs first..second (inclusive)
+        ExtMask         // Extended IDs where (id & second) == (first & second)
+    };
+
+    Kind kind;
+    uint32_t first;     // Range start, or mask-rule code
+    uint32_t second;    // Range end, or mask-rule mask
+};
+
 /**
  * Abstract CAN backend interface.
  *
@@ -114,6 +146,16 @@ public:
      */
     virtual bool write(const CANFrame& frame) = 0;
 
+    /**
+     * Queue several frames for transmission in one call.
+     * Frames are accepted in order until the TX queue is full.
+     *
+     * @param frames Frames to transmit
+     * @param count Number of frames
+     * @return Number of frames accepted (a prefix of frames)
+     */
+    virtual uint8_t writeBatch(const CANFrame* frames, uint8_t count) = 0;
+
     /**
      * Check if a received frame is available.
      * @return true if a frame is waiting in the receive buffer
@@ -127,12 +169,36 @@ public:
      */
     virtual bool read(CANFrame& frame) = 0;
 
+    /**
+     * Enable or disable TX echo.
+     * While enabled, every frame that completes transmission on the bus is
+     * also returned by read(), with echo set and timestamp holding the
+     * transmit completion time, in time order with received frames.
+     *
+     * @param enable true to report transmitted frames
+     * @return true on success, false if the backend cannot report TX completion
+     */
+    virtual bool setTxEcho(bool enable) = 0;
+
     /**
      * Get the current CAN bus status.
+     * Event flags (overrun, bus error, ...) are latched until read, so a
+     * condition that came and went since the last call is still reported;
+     * this call clears them. Error counters are current values.
+     *
      * @return CANStatus structure with current flags
      */
     virtual CANStatus getStatus() = 0;
 
+    /**
+     * Get the number of error events seen (bus errors, error-passive or
+     * bus-off entries, overruns). Unlike getStatus() this clears nothing,
+     * so it can be watched without taking the F flags away from the host.
+     *
+     * @return Running event count (compare with an earlier value)
+     */
+    virtual uint32_t getErrorEventCount() const = 0;
+
     /**
      * Set hardware acceptance filter.
      * Filters are applied as: (received_id & mask) == (filter & mask)
@@ -149,6 +215,44 @@ public:
      */
     virtual bool clearFilter() = 0;
 
+    /**
+     * Add a rule to the multi-rule filter table.
+     * Applied in addition to the setFilter() mask/code pair.
+     *
+     * @param rule Rule to add
+     * @return true on success, false if invalid or the table is full
+     */
+    virtual bool addFilterRule(const CANFilterRule& rule) = 0;
+
+    /**
+     * Remove a rule from the multi-rule filter table.
+     * StdRange removal clears every ID in the range; extended rules must
+     * match an installed rule exactly.
+     *
+     * @param rule Rule to remove
+     * @return true if removed, false if not found or invalid
+     */
+    virtual bool removeFilterRule(const CANFilterRule& rule) = 0;
+
+    /**
+     * Remove all multi-rule filter entries (accept all frames again).
+     */
+    virtual void clearFilterRules() = 0;
+
+    /**
+     * Get the size of the multi-rule filter table.
+     * @param stdIds Output: number of standard IDs accepted
+     * @param extRules Output: number of extended range/mask rules
+     */
+    virtual void getFilterRuleCounts(uint16_t* stdIds, uint8_t* extRules) const = 0;
+
+    /**
+     * Get the fill level of the software TX queue.
+     * @param pending Output: frames waiting for a TX mailbox
+     * @param capacity Output: queue capacity (0 if the backend doesn't queue)
+     */
+    virtual void getTxQueueLevel(uint8_t* pending, uint8_t* capacity) const = 0;
+
     /**
      * Service the TX queue (drain pending frames to hardware).
      * Called periodically from protocol handler poll() to ensure
@@ -0,0 +1,146 @@
+/**
+ * CAN Filter Table Implementation
+ */
+
+#include "CANFilter.h"
+#include <string.h>
+
+CANFilterTable::CANFilterTable() {
+    clear();
+}
+
+void CANFilterTable::clear() {
+    memset(_stdBitmap, 0, sizeof(_stdBitmap));
+    _stdIdCount = 0;
+    _extRuleCount = 0;
+}
+
+bool CANFilterTable::isEmpty() const {
+    return _stdIdCount == 0 && _extRuleCount == 0;
+}
+
+uint16_t CANFilterTable::getStdIdCount() const {
+    return _stdIdCount;
+}
+
+uint8_t CANFilterTable::getExtRuleCount() const {
+    return _extRuleCount;
+}
+
+bool CANFilterTable::isValid(const CANFilterRule& rule) const {
+    switch (rule.kind) {
+        case CANFilterRule::Kind::StdRange:
+            return rule.first <= rule.second && rule.second <= 0x7FF;
+        case CANFilterRule::Kind::ExtRange:
+            return rule.first <= rule.second && rule.second <= 0x1FFFFFFF;
+        case CANFilterRule::Kind::ExtMask:
+            return rule.first <= 0x1FFFFFFF && rule.second <= 0x1FFFFFFF;
+        default:
+            return false;
+    }
+}
+
+// Sort order for extended rules: ranges (by start) before mask rules
+static bool ruleLess(const CANFilterRule& a, const CANFilterRule& b) {
+    if (a.kind != b.kind) return a.kind < b.kind;
+    if (a.first != b.first) return a.first < b.first;
+    return a.second < b.second;
+}
+
+static bool ruleEqual(const CANFilterRule& a, const CANFilterRule& b) {
+    return a.kind == b.kind && a.first == b.first && a.second == b.second;
+}
+
+bool CANFilterTable::add(const CANFilterRule& rule) {
+    if (!isValid(rule)) {
+        return false;
+    }
+
+    if (rule.kind == CANFilterRule::Kind::StdRange) {
+        setStdRange((uint16_t)rule.first, (uint16_t)rule.second, true);
+        return true;
+    }
+
+    // Find sorted insert position; identical rule is already present
+    uint8_t pos = 0;
+    while (pos < _extRuleCount && ruleLess(_extRules[pos], rule)) {
+        pos++;
+    }
+    if (pos < _extRuleCount && ruleEqual(_extRules[pos], rule)) {
+        return true;
+    }
+    if (_extRuleCount >= FILTER_MAX_EXT_RULES) {
+        return false;
+    }
+
+    for (uint8_t i = _extRuleCount; i > pos; i--) {
+        _extRules[i] = _extRules[i - 1];
+    }
+    _extRules[pos] = rule;
+    _extRuleCount++;
+    return true;
+}
+
+bool CANFilterTable::remove(const CANFilterRule& rule) {
+    if (!isValid(rule)) {
+        return false;
+    }
+
+    if (rule.kind == CANFilterRule::Kind::StdRange) {
+        uint16_t before = _stdIdCount;
+        setStdRange((uint16_t)rule.first, (uint16_t)rule.second, false);
+        return _stdIdCount != before;
+    }
+
+    for (uint8_t i = 0; i < _extRuleCount; i++) {
+        if (ruleEqual(_extRules[i], rule)) {
+            for (uint8_t j = i; j + 1 < _extRuleCount; j++) {
+                _extRules[j] = _extRules[j + 1];
+            }
+            _extRuleCount--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void CANFilterTable::setStdRange(uint16_t first, uint16_t last, bool accept) {
+    for (uint16_t id = first; id <= last; id++) {
+        uint32_t bit = 1UL << (id & 0x1F);
+        uint32_t& word = _stdBitmap[id >> 5];
+        if (accept && !(word & bit)) {
+            word |= bit;
+            _stdIdCount++;
+        } else if (!accept && (word & bit)) {
+            word &= ~bit;
+            _stdIdCount--;
+        }
+    }
+}
+
+bool CANFilterTable::acceptsExtended(uint32_t id) const {
+    uint8_t i = 0;
+
+    // Ranges: sorted by start, stop once a range starts above the ID
+    for (; i < _extRuleCount && _extRules[i].kind == CANFilterRule::Kind::ExtRange; i++) {
+        if (_extRules[i].first > id) {
+            // Skip the remaining ranges
+            while (i < _extRuleCount && _extRules[i].kind == CANFilterRule::Kind::ExtRange) {
+                i++;
+            }
+            break;
+        }
+        if (id <= _extRules[i].second) {
+            return true;
+        }
+    }
+
+    // Mask rules
+    for (; i < _extRuleCount; i++) {
+        const CANFilterRule& r = _extRules[i];
+        if ((id & r.second) == (r.first & r.second)) {
+            return true;
+        }
+    }
+    return false;
+}
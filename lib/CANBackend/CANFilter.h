@@ -0,0 +1,92 @@
+/**
+ * CAN Filter Table
+ *
+ * Multi-rule acceptance filter: a 2048-bit bitmap for 11-bit IDs and a
+ * small sorted rule list for 29-bit IDs.
+ */
+
+#ifndef CAN_FILTER_H
+#define CAN_FILTER_H
+
+#include "CANBackend.h"
+#include "config.h"
+#include <stdint.h>
+
+#ifndef FILTER_MAX_EXT_RULES
+#define FILTER_MAX_EXT_RULES 16
+#endif
+
+/**
+ * Acceptance filter table.
+ *
+ * Standard IDs are looked up in constant time in a bitmap. Extended rules
+ * are kept sorted (ranges by start ID, then mask rules) so a lookup can
+ * stop at the first range starting above the ID.
+ *
+ * An empty table accepts every frame. Otherwise a frame is accepted only
+ * if it matches a rule of its ID type.
+ */
+class CANFilterTable {
+public:
+    CANFilterTable();
+
+    /**
+     * Add a rule.
+     * @param rule Rule to add
+     * @return true on success, false if invalid or no room
+     */
+    bool add(const CANFilterRule& rule);
+
+    /**
+     * Remove a rule.
+     * @param rule Rule to remove (see ICANBackend::removeFilterRule)
+     * @return true if removed, false if not found or invalid
+     */
+    bool remove(const CANFilterRule& rule);
+
+    /**
+     * Remove all rules.
+     */
+    void clear();
+
+    /**
+     * Check a received ID against the table.
+     * @param id CAN identifier
+     * @param extended true for a 29-bit ID
+     * @return true if the frame should be received
+     */
+    bool accepts(uint32_t id, bool extended) const {
+        if (_stdIdCount == 0 && _extRuleCount == 0) {
+            return true;
+        }
+        if (!extended) {
+            return (_stdBitmap[(id & 0x7FF) >> 5] >> (id & 0x1F)) & 1;
+        }
+        return acceptsExtended(id);
+    }
+
+    bool isEmpty() const;
+
+    /**
+     * Get the number of standard IDs accepted by the bitmap.
+     */
+    uint16_t getStdIdCount() const;
+
+    /**
+     * Get the number of extended range/mask rules.
+     */
+    uint8_t getExtRuleCount() const;
+
+private:
+    uint32_t _stdBitmap[2048 / 32];
+    uint16_t _stdIdCount;
+
+    CANFilterRule _extRules[FILTER_MAX_EXT_RULES];
+    uint8_t _extRuleCount;
+
+    bool acceptsExtended(uint32_t id) const;
+    bool isValid(const CANFilterRule& rule) const;
+    void setStdRange(uint16_t first, uint16_t last, bool accept);
+};
+
+#endif // CAN_FILTER_H
@@ -0,0 +1,108 @@
+/**
+ * Frame Ring Buffer
+ *
+ * Single-producer/single-consumer lock-free ring buffer.
+ * Used to hand received CAN frames from interrupt context to the main loop.
+ */
+
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Lock-free SPSC ring buffer.
+ *
+ * Exactly one context may call push() (producer, e.g. an ISR) and exactly
+ * one context may call peek()/pop()/clear() (consumer, e.g. the main loop).
+ * Head and tail are free-running 16-bit counters, so the capacity must be
+ * a power of two no larger than 32768.
+ *
+ * @tparam T Element type (copied by value)
+ * @tparam N Capacity in elements (power of two)
+ */
+template <typename T, uint16_t N>
+class FrameRing {
+    static_assert(N >= 2 && N <= 32768 && (N & (N - 1)) == 0,
+                  "FrameRing capacity must be a power of two (2..32768)");
+
+public:
+    FrameRing() : _head(0), _tail(0) {}
+
+    /**
+     * Append an element (producer side).
+     * @param item Element to copy into the ring
+     * @return true if stored, false if the ring is full
+     */
+    bool push(const T& item) {
+        uint16_t head = _head.load(std::memory_order_relaxed);
+        uint16_t tail = _tail.load(std::memory_order_acquire);
+        if ((uint16_t)(head - tail) >= N) {
+            return false;
+        }
+        _slots[head & (N - 1)] = item;
+        _head.store((uint16_t)(head + 1), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Remove the oldest element (consumer side).
+     * @param item Output: the removed element
+     * @return true if an element was removed, false if the ring is empty
+     */
+    bool pop(T& item) {
+        uint16_t tail = _tail.load(std::memory_order_relaxed);
+        uint16_t head = _head.load(std::memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+        item = _slots[tail & (N - 1)];
+        _tail.store((uint16_t)(tail + 1), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Get the oldest element without removing it (consumer side).
+     * @return Pointer to the element, or nullptr if the ring is empty
+     */
+    const T* peek() const {
+        uint16_t tail = _tail.load(std::memory_order_relaxed);
+        uint16_t head = _head.load(std::memory_order_acquire);
+        if (head == tail) {
+            return nullptr;
+        }
+        return &_slots[tail & (N - 1)];
+    }
+
+    /**
+     * Discard all pending elements (consumer side).
+     */
+    void clear() {
+        _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    /**
+     * Get the number of pending elements.
+     * Safe to call from either side; the result may be stale immediately.
+     */
+    uint16_t size() const {
+        return (uint16_t)(_head.load(std::memory_order_acquire) -
+                          _tail.load(std::memory_order_acquire));
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    static constexpr uint16_t capacity() {
+        return N;
+    }
+
+private:
+    T _slots[N];
+    std::atomic<uint16_t> _head;  // push() writes here (producer)
+    std::atomic<uint16_t> _tail;  // pop() reads here (consumer)
+};
+
+#endif // FRAME_RING_H
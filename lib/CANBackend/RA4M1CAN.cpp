@@ -3,6 +3,9 @@
  */
 
 #include "RA4M1CAN.h"
+#include "RA4M1CANRegs.h"
+
+RA4M1CAN* RA4M1CAN::s_isrInstance = nullptr;
 
 RA4M1CAN::RA4M1CAN()
     : _isOpen(false)
@@ -11,10 +14,36 @@ RA4M1CAN::RA4M1CAN()
     , _filterMask(0)
     , _filterValue(0)
     , _filterEnabled(false)
-    , _txQueueHead(0)
-    , _txQueueTail(0)
-    , _txQueueCount(0)
+    , _rxMailboxMask(0)
+    , _extMailboxMask(0)
+    , _txMailboxMask(0)
+    , _txBusyMask(0)
+    , _txInFlight(0)
+    , _txMaxInFlight(1)
+    , _isrRxActive(false)
+    , _rxIrq(-1)
+    , _savedRxVector(0)
+    , _txEchoEnabled(false)
+    , _isrTxActive(false)
+    , _txIrq(-1)
+    , _savedTxVector(0)
+    , _latchedEifr(0)
+    , _busOff(false)
+    , _busOffSince(0)
+    , _busOffAutoRecover(CAN_BUSOFF_AUTO_RECOVER)
+    , _busOffRecoveryMs(CAN_BUSOFF_RECOVERY_MS)
+    , _statusTxFullMark(0)
+    , _statusRxOverflowMark(0)
+    , _errorEventCount(0)
+    , _busOffCount(0)
+    , _busOffRecoveryCount(0)
     , _txQueueFullCount(0)
+    , _rxRingOverflowCount(0)
+    , _txEchoOverflowCount(0)
+    , _rxFrameCount(0)
+    , _txFrameCount(0)
+    , _rxRingHighWater(0)
+    , _txQueueHighWater(0)
 {
 }
 
@@ -67,15 +96,48 @@ bool RA4M1CAN::begin(CANBitrate bitrate, CANMode mode) {
     _mode = mode;
     _bitrate = bitrate;
 
-    // Note: Arduino_CAN library doesn't have a direct listen-only mode setting.
-    // For listen-only mode, we simply won't transmit (checked in write()).
-    // True hardware listen-only would require direct register access.
+    scanMailboxes();
+    setupTxMailboxes();
+
+    // Loopback self-test: the controller receives its own frames and the
+    // transceiver only ever sees recessive. Listen-only: no ACK, no error
+    // frames, no transmission
+    if (!applyTestMode(mode)) {
+        end();
+        return false;
+    }
+
+    // Start from a clean error state; stale EIFR events belong to the last session
+    R_CAN0->EIFR = 0;
+    _latchedEifr = 0;
+    _busOff = false;
+    _statusTxFullMark = _txQueueFullCount;
+    _statusRxOverflowMark = _rxRingOverflowCount;
+
+    // Take over mailbox reception from Arduino_CAN's polled buffer
+    _rxRing.clear();
+#if ENABLE_ISR_RX
+    _isrRxActive = installRxIsr();
+#else
+    _isrRxActive = false;
+#endif
+
+    // Take over TX completion so echoes carry the interrupt time
+    _txEchoRing.clear();
+#if ENABLE_ISR_TX
+    _isrTxActive = (_txMailboxMask != 0) && installTxIsr();
+#else
+    _isrTxActive = false;
+#endif
 
     return true;
 }
 
 void RA4M1CAN::end() {
     if (_isOpen) {
+        removeTxIsr();
+        removeRxIsr();
+        s_isrInstance = nullptr;
         CAN.end();
         _isOpen = false;
     }
@@ -100,46 +162,47 @@ bool RA4M1CAN::write(const CANFrame& frame) {
         return false;
     }
 
-    // Try to send immediately if hardware can accept
-    // Note: Arduino_CAN library may not expose availableForWrite()
-    // Check if we have space in TX hardware FIFO by attempting write
+    if (!_txQueue.push(frame, CAN_TX_FIFO)) {
+        // Queue full - reject frame
+        _txQueueFullCount++;
+        return false;
+    }
+    if (_txQueue.size() > _txQueueHighWater) {
+        _txQueueHighWater = _txQueue.size();
+    }
 
-    // If queue is empty, try immediate send
-    if (_txQueueCount == 0) {
-        // Create Arduino_CAN message
-        CanMsg msg;
-        if (frame.extended) {
-            msg = CanMsg(CanExtendedId(frame.id), frame.dlc, frame.data);
-        } else {
-            msg = CanMsg(CanStandardId(frame.id), frame.dlc, frame.data);
-        }
+    // Goes straight into a mailbox if one is free
+    serviceTxQueue();
+    return true;
+}
 
-        int rc = CAN.write(msg);
-        if (rc >= 0) {
-            // Successfully sent immediately
-            return true;
-        }
-        // Hardware FIFO likely full, fall through to queueing
+uint8_t RA4M1CAN::writeBatch(const CANFrame* frames, uint8_t count) {
+    if (!_isOpen || _mode == CANMode::ListenOnly || frames == nullptr) {
+        return 0;
     }
 
-    // Queue for later if space available
-    if (_txQueueCount < CAN_TX_QUEUE_SIZE) {
-        _txQueue[_txQueueHead] = frame;
-        _txQueueHead = (_txQueueHead + 1) % CAN_TX_QUEUE_SIZE;
-        _txQueueCount++;
-        return true;
+    // Enqueue everything that fits, then hand the queue to the hardware once
+    uint8_t accepted = 0;
+    while (accepted < count && _txQueue.push(frames[accepted], CAN_TX_FIFO)) {
+        accepted++;
+    }
+    _txQueueFullCount += count - accepted;
+    if (_txQueue.size() > _txQueueHighWater) {
+        _txQueueHighWater = _txQueue.size();
     }
 
-    // Queue full - reject frame
-    _txQueueFullCount++;
-    return false;
+    serviceTxQueue();
+    return accepted;
 }
 
 bool RA4M1CAN::available() {
     if (!_isOpen) {
         return false;
     }
-    return CAN.available() > 0;
+    if (!_isrRxActive) {
+        pollArduinoCan();
+    }
+    return !_rxRing.empty() || !_txEchoRing.empty();
 }
 
 bool RA4M1CAN::read(CANFrame& frame) {
@@ -147,81 +210,196 @@ bool RA4M1CAN::read(CANFrame& frame) {
         return false;
     }
 
-    if (!CAN.available()) {
-        return false;
-    }
-
-    CanMsg msg = CAN.read();
-
-    // Extract frame data
-    frame.id = msg.id;
-    frame.dlc = msg.data_length;
-    frame.extended = msg.isExtendedId();
-    // Note: Arduino_CAN library doesn't expose RTR flag directly
-    // RTR frames are rare in practice; set to false
-    frame.rtr = false;
-
-    // Copy data bytes
-    for (uint8_t i = 0; i < frame.dlc && i < 8; i++) {
-        frame.data[i] = msg.data[i];
-    }
-    // Zero remaining bytes
-    for (uint8_t i = frame.dlc; i < 8; i++) {
-        frame.data[i] = 0;
+    if (!_isrRxActive) {
+        pollArduinoCan();
     }
 
-    // Set timestamp (milliseconds since boot, wrapped to 16-bit)
-    frame.timestamp = (uint16_t)(millis() & 0xFFFF);
-
-    // Apply software filter if enabled
-    if (_filterEnabled && !passesFilter(frame.id)) {
-        // Frame rejected by filter - read next frame recursively
-        // or return false to let caller try again
-        return false;
+    // Hand out echoes and received frames in the order they hit the bus
+    const CANFrame* echo = _txEchoRing.peek();
+    if (echo != nullptr) {
+        const CANFrame* rx = _rxRing.peek();
+        if (rx == nullptr || (int32_t)(echo->timestamp - rx->timestamp) <= 0) {
+            return _txEchoRing.pop(frame);
+        }
     }
 
-    return true;
+    // Frames were filtered at capture time, so an empty ring is the only
+    // reason to return false here
+    return _rxRing.pop(frame);
 }
 
 CANStatus RA4M1CAN::getStatus() {
     CANStatus status = {};
 
-    // The Arduino_CAN library doesn't provide detailed error status access.
-    // We return a basic status structure.
-    // For more detailed status, direct register access would be needed.
-
     if (!_isOpen) {
         return status;
     }
 
-    // Check if CAN is available (basic operational check)
-    // Advanced error flags would require direct RA4M1 register access
-
-    // For now, return a clean status if we're open
-    status.rxFifoFull = false;
-    status.txFifoFull = false;
-    status.errorWarning = false;
-    status.dataOverrun = false;
-    status.errorPassive = false;
+    updateBusState();
+
+    uint16_t str = R_CAN0->STR;
+    uint8_t tec = R_CAN0->TECR;
+    uint8_t rec = R_CAN0->RECR;
+    uint32_t rxOverflows = _rxRingOverflowCount;
+    bool rxLost = rxOverflows != _statusRxOverflowMark;
+
+    status.txErrorCount = tec;
+    status.rxErrorCount = rec;
+    status.busOff = _busOff || (_latchedEifr & RA4M1_CAN_EIFR_BOEIF);
+    status.errorWarning = (_latchedEifr & RA4M1_CAN_EIFR_EWIF)
+                       || tec >= RA4M1_CAN_ERROR_WARNING_LIMIT
+                       || rec >= RA4M1_CAN_ERROR_WARNING_LIMIT;
+    status.errorPassive = (_latchedEifr & RA4M1_CAN_EIFR_EPIF) || (str & RA4M1_CAN_STR_EPST);
+    status.busError = (_latchedEifr & (RA4M1_CAN_EIFR_BEIF | RA4M1_CAN_EIFR_BLIF)) || status.busOff;
+
+    // Overrun in a hardware mailbox or in our RX ring
+    status.dataOverrun = (_latchedEifr & RA4M1_CAN_EIFR_ORIF) || rxLost;
+    status.rxFifoFull = rxLost || _rxRing.size() >= _rxRing.capacity();
+    status.txFifoFull = _txQueue.full() || _txQueueFullCount != _statusTxFullMark;
+
+    // The controller has no arbitration-lost flag in mailbox mode
     status.arbitrationLost = false;
-    status.busError = false;
+
+    // Reading the status clears the latched events
+    _latchedEifr = 0;
+    _statusTxFullMark = _txQueueFullCount;
+    _statusRxOverflowMark = rxOverflows;
 
     return status;
 }
 
+uint32_t RA4M1CAN::getErrorEventCount() const {
+    // Counted by updateBusState(), which serviceTxQueue() runs every loop
+    return _errorEventCount;
+}
+
+void RA4M1CAN::updateBusState() {
+    // Latch and clear the events seen so far (writing 1 leaves a flag alone,
+    // so an event raised after the read is not lost)
+    uint8_t eifr = R_CAN0->EIFR;
+    if (eifr) {
+        R_CAN0->EIFR = (uint8_t)~eifr;
+        _latchedEifr |= eifr;
+        if (eifr & (RA4M1_CAN_EIFR_BEIF | RA4M1_CAN_EIFR_EPIF | RA4M1_CAN_EIFR_BOEIF |
+                    RA4M1_CAN_EIFR_ORIF | RA4M1_CAN_EIFR_BLIF)) {
+            _errorEventCount++;
+        }
+    }
+
+    uint16_t str = R_CAN0->STR;
+    uint32_t now = millis();
+
+    // Depending on its bus-off mode the controller either stays bus-off
+    // or halts itself; we never leave it halted between calls
+    bool off = (str & (RA4M1_CAN_STR_BOST | RA4M1_CAN_STR_HLTST)) != 0;
+
+    if (off && !_busOff) {
+        _busOff = true;
+        _busOffSince = now;
+        _busOffCount++;
+    } else if (!off && _busOff) {
+        _busOff = false;
+        _busOffRecoveryCount++;
+    }
+
+    if (!_busOff || !_busOffAutoRecover || (now - _busOffSince) < _busOffRecoveryMs) {
+        return;
+    }
+
+    _busOffSince = now;  // Next attempt one delay later
+    if (str & RA4M1_CAN_STR_HLTST) {
+        setOperatingMode(RA4M1_CAN_CTLR_CANM_OPER);
+    } else {
+        R_CAN0->CTLR |= RA4M1_CAN_CTLR_RBOC;  // Back to error-active, TEC/REC cleared
+    }
+}
+
+void RA4M1CAN::getFrameCounts(uint32_t* rxFrames, uint32_t* txFrames) const {
+    if (rxFrames) *rxFrames = _rxFrameCount;
+    if (txFrames) *txFrames = _txFrameCount;
+}
+
+void RA4M1CAN::getHighWaterMarks(uint16_t* rxRing, uint8_t* txQueue) const {
+    if (rxRing) *rxRing = _rxRingHighWater;
+    if (txQueue) *txQueue = _txQueueHighWater;
+}
+
+void RA4M1CAN::getBusOffCounters(uint32_t* busOffs, uint32_t* recoveries) const {
+    if (busOffs) *busOffs = _busOffCount;
+    if (recoveries) *recoveries = _busOffRecoveryCount;
+}
+
+void RA4M1CAN::setBusOffRecovery(bool enable, uint16_t delayMs) {
+    _busOffAutoRecover = enable;
+    _busOffRecoveryMs = delayMs;
+}
+
 bool RA4M1CAN::setFilter(uint32_t mask, uint32_t filter) {
-    // Arduino_CAN library has limited filter support.
-    // We implement software filtering.
+    // Software filter is always applied; hardware filtering (if enabled)
+    // rejects most traffic before it ever reaches the RX interrupt.
+    noInterrupts();
     _filterMask = mask;
     _filterValue = filter;
     _filterEnabled = true;
+    interrupts();
+#if ENABLE_HW_FILTERS
+    if (_isOpen) {
+        applyHardwareFilter(mask, filter);
+    }
+#endif
     return true;
 }
 
 bool RA4M1CAN::clearFilter() {
+    noInterrupts();
     _filterMask = 0;
     _filterValue = 0;
     _filterEnabled = false;
+    interrupts();
+#if ENABLE_HW_FILTERS
+    if (_isOpen) {
+        applyHardwareFilter(0, 0);
+    }
+#endif
+    return true;
+}
+
+bool RA4M1CAN::addFilterRule(const CANFilterRule& rule) {
+    // The RX ISR reads the table; keep it consistent while it changes
+    noInterrupts();
+    bool ok = _filterTable.add(rule);
+    interrupts();
+    return ok;
+}
+
+bool RA4M1CAN::removeFilterRule(const CANFilterRule& rule) {
+    noInterrupts();
+    bool ok = _filterTable.remove(rule);
+    interrupts();
+    return ok;
+}
+
+void RA4M1CAN::clearFilterRules() {
+    noInterrupts();
+    _filterTable.clear();
+    interrupts();
+}
+
+void RA4M1CAN::getFilterRuleCounts(uint16_t* stdIds, uint8_t* extRules) const {
+    if (stdIds) *stdIds = _filterTable.getStdIdCount();
+    if (extRules) *extRules = _filterTable.getExtRuleCount();
+}
+
+void RA4M1CAN::getTxQueueLevel(uint8_t* pending, uint8_t* capacity) const {
+    if (pending) *pending = _txQueue.size();
+    if (capacity) *capacity = _txQueue.capacity();
+}
+
+bool RA4M1CAN::setTxEcho(bool enable) {
+    _txEchoEnabled = enable;
+    if (!enable) {
+        _txEchoRing.clear();
+    }
     return true;
 }
 
@@ -239,10 +417,27 @@ void RA4M1CAN::serviceTxQueue() {
         return;
     }
 
-    // Attempt to drain queued TX frames
-    while (_txQueueCount > 0) {
-        // Get next queued frame
-        CANFrame& frame = _txQueue[_txQueueTail];
+    updateBusState();
+
+    if (_txMailboxMask == 0) {
+        drainTxToArduinoCan();
+        return;
+    }
+
+    releaseTxMailboxes();
+
+    // Keep every free mailbox loaded, highest priority first
+    while (!_txQueue.empty() && _txInFlight < _txMaxInFlight) {
+        if (!loadTxMailbox(*_txQueue.peek(), _txQueue.peekKey())) {
+            break;
+        }
+        _txQueue.pop();
+    }
+}
+
+void RA4M1CAN::drainTxToArduinoCan() {
+    while (!_txQueue.empty()) {
+        const CANFrame& frame = *_txQueue.peek();
 
         // Create Arduino_CAN message
         CanMsg msg;
@@ -252,29 +447,451 @@ void RA4M1CAN::serviceTxQueue() {
             msg = CanMsg(CanStandardId(frame.id), frame.dlc, frame.data);
         }
 
-        // Try to send
-        int rc = CAN.write(msg);
-        if (rc >= 0) {
-            // Successfully sent, dequeue
-            _txQueueTail = (_txQueueTail + 1) % CAN_TX_QUEUE_SIZE;
-            _txQueueCount--;
-        } else {
-            // Hardware FIFO full, stop trying
-            break;
+        if (CAN.write(msg) < 0) {
+            break;  // Hardware FIFO full, stop trying
         }
+        _txQueue.pop();
+        _txFrameCount++;
     }
 }
 
-void RA4M1CAN::getCounters(uint32_t* txQueueFull) const {
+void RA4M1CAN::getCounters(uint32_t* txQueueFull, uint32_t* rxRingOverflows,
+                           uint32_t* txEchoOverflows) const {
     if (txQueueFull) *txQueueFull = _txQueueFullCount;
+    if (rxRingOverflows) *rxRingOverflows = _rxRingOverflowCount;
+    if (txEchoOverflows) *txEchoOverflows = _txEchoOverflowCount;
 }
 
 void RA4M1CAN::resetCounters() {
     _txQueueFullCount = 0;
+    _rxRingOverflowCount = 0;
+    _txEchoOverflowCount = 0;
+    _rxFrameCount = 0;
+    _txFrameCount = 0;
+    _rxRingHighWater = 0;
+    _txQueueHighWater = 0;
+    _busOffCount = 0;
+    _busOffRecoveryCount = 0;
+    _statusTxFullMark = 0;
+    _statusRxOverflowMark = 0;
+}
+
+bool RA4M1CAN::isIsrRxActive() const {
+    return _isrRxActive;
+}
+
+bool RA4M1CAN::isIsrTxActive() const {
+    return _isrTxActive;
 }
 
 void RA4M1CAN::clearTxQueue() {
-    _txQueueHead = 0;
-    _txQueueTail = 0;
-    _txQueueCount = 0;
+    _txQueue.clear();
+    _txBusyMask = 0;
+    _txInFlight = 0;
+}
+
+// =============================================================================
+// Interrupt-driven RX path
+// =============================================================================
+
+int RA4M1CAN::findEventIrq(uint32_t event) {
+    // Arduino_CAN registers the mailbox events through the core's
+    // IRQManager, so their NVIC slots are only known at runtime.
+    // Find the slot the ICU links to the event.
+    for (int irq = 0; irq < BSP_ICU_VECTOR_MAX_ENTRIES; irq++) {
+        if ((R_ICU->IELSR[irq] & 0x1FF) == event) {
+            return irq;
+        }
+    }
+    return -1;
+}
+
+bool RA4M1CAN::installRxIsr() {
+    int irq = findEventIrq(ELC_EVENT_CAN0_MAILBOX_RX);
+    if (irq < 0) {
+        return false;
+    }
+    s_isrInstance = this;
+    _rxIrq = irq;
+    _savedRxVector = NVIC_GetVector((IRQn_Type)irq);
+    NVIC_SetVector((IRQn_Type)irq, (uint32_t)(uintptr_t)&RA4M1CAN::rxIsr);
+    return true;
+}
+
+void RA4M1CAN::removeRxIsr() {
+    if (_rxIrq >= 0) {
+        NVIC_SetVector((IRQn_Type)_rxIrq, _savedRxVector);
+        _rxIrq = -1;
+        _savedRxVector = 0;
+    }
+    _isrRxActive = false;
+}
+
+void RA4M1CAN::rxIsr() {
+    // Clear the ICU request first so a frame arriving while we copy
+    // re-pends the interrupt instead of being missed
+    R_BSP_IrqStatusClear(R_FSP_CurrentIrqGet());
+
+    if (s_isrInstance) {
+        s_isrInstance->captureMailboxes();
+    }
+}
+
+void RA4M1CAN::captureMailboxes() {
+    // One reception timestamp per interrupt: every mailbox found in this
+    // pass completed before the interrupt was taken
+    uint32_t now = micros();
+
+    R_CAN0->MSMR = RA4M1_CAN_MSMR_RX_SEARCH;
+
+    while (true) {
+        uint8_t mssr = R_CAN0->MSSR;
+        if (mssr & RA4M1_CAN_MSSR_SEST) {
+            break;  // No receive mailbox holds new data
+        }
+        uint8_t mb = mssr & RA4M1_CAN_MSSR_MBNST_MASK;
+
+        // Clear NEWDATA before copying; if the controller stores another
+        // frame meanwhile, NEWDATA/INVALDATA come back set and we re-read.
+        CANFrame frame;
+        uint8_t mctl;
+        do {
+            R_CAN0->MCTL_RX[mb] = RA4M1_CAN_MCTL_RECREQ;
+            readMailbox(mb, frame);
+            mctl = R_CAN0->MCTL_RX[mb];
+        } while (mctl & (RA4M1_CAN_MCTL_RX_NEWDATA | RA4M1_CAN_MCTL_RX_INVALDATA));
+
+        if (!acceptsFrame(frame)) {
+            continue;  // Rejected by software filter, mailbox already released
+        }
+
+        frame.timestamp = now;
+        queueRxFrame(frame);
+    }
+}
+
+void RA4M1CAN::queueRxFrame(const CANFrame& frame) {
+    if (!_rxRing.push(frame)) {
+        _rxRingOverflowCount++;
+        return;
+    }
+    _rxFrameCount++;
+
+    uint16_t used = _rxRing.size();
+    if (used > _rxRingHighWater) {
+        _rxRingHighWater = used;
+    }
+}
+
+void RA4M1CAN::readMailbox(uint8_t mb, CANFrame& frame) {
+    uint32_t rawId = R_CAN0->MB[mb].ID;
+    frame.extended = (rawId & RA4M1_CAN_ID_IDE) != 0;
+    frame.rtr = (rawId & RA4M1_CAN_ID_RTR) != 0;
+    frame.id = frame.extended
+        ? (rawId & RA4M1_CAN_ID_EID_MASK)
+        : ((rawId >> RA4M1_CAN_ID_SID_SHIFT) & RA4M1_CAN_ID_SID_MASK);
+
+    uint8_t dlc = R_CAN0->MB[mb].DL & 0x0F;
+    frame.dlc = dlc > 8 ? 8 : dlc;  // DLC 9-15 still carries 8 bytes
+    for (uint8_t i = 0; i < 8; i++) {
+        frame.data[i] = (i < frame.dlc && !frame.rtr) ? R_CAN0->MB[mb].D[i] : 0;
+    }
+}
+
+void RA4M1CAN::pollArduinoCan() {
+    while (CAN.available()) {
+        CanMsg msg = CAN.read();
+
+        CANFrame frame;
+        frame.id = msg.id;
+        frame.dlc = msg.data_length > 8 ? 8 : msg.data_length;
+        frame.extended = msg.isExtendedId();
+        // Arduino_CAN doesn't expose the RTR flag on this path
+        frame.rtr = false;
+        for (uint8_t i = 0; i < frame.dlc; i++) {
+            frame.data[i] = msg.data[i];
+        }
+        frame.timestamp = micros();
+
+        if (!acceptsFrame(frame)) {
+            continue;
+        }
+
+        queueRxFrame(frame);
+    }
+}
+
+// =============================================================================
+// Mailbox TX path
+// =============================================================================
+
+void RA4M1CAN::setupTxMailboxes() {
+    _txBusyMask = 0;
+    _txInFlight = 0;
+    _txMaxInFlight = 1;
+
+    // Every mailbox Arduino_CAN didn't set up for reception is free for TX
+    _txMailboxMask = _rxMailboxMask ? ~_rxMailboxMask : 0;
+    if (_txMailboxMask == 0) {
+        return;
+    }
+
+    if (setOperatingMode(RA4M1_CAN_CTLR_CANM_HALT)) {
+        for (uint8_t mb = 0; mb < RA4M1_CAN_MAILBOX_COUNT; mb++) {
+            if (_txMailboxMask & (1UL << mb)) {
+                R_CAN0->MCTL_TX[mb] = 0;
+            }
+        }
+#if ENABLE_ISR_TX
+        R_CAN0->MIER |= _txMailboxMask;  // Transmit-complete interrupt per mailbox
+#endif
+        if (CAN_TX_FIFO) {
+            R_CAN0->CTLR |= RA4M1_CAN_CTLR_TPM;
+        } else {
+            R_CAN0->CTLR &= ~RA4M1_CAN_CTLR_TPM;
+        }
+    }
+    setOperatingMode(RA4M1_CAN_CTLR_CANM_OPER);
+
+    // Several frames in flight are only reordered correctly by the
+    // controller itself in ID-priority mode
+    if (!CAN_TX_FIFO && !(R_CAN0->CTLR & RA4M1_CAN_CTLR_TPM)) {
+        _txMaxInFlight = (uint8_t)__builtin_popcount(_txMailboxMask);
+    }
+}
+
+void RA4M1CAN::releaseTxMailboxes() {
+    uint32_t busy = _txBusyMask;
+    while (busy) {
+        uint8_t mb = (uint8_t)__builtin_ctz(busy);
+        busy &= busy - 1;
+
+        uint8_t mctl = R_CAN0->MCTL_TX[mb];
+        if (_isrTxActive) {
+            // txIsr() clears the mailbox once sent; leave SENTDATA to it
+            // so no echo is lost to a race
+            if (mctl & RA4M1_CAN_MCTL_TRMREQ) {
+                continue;
+            }
+        } else {
+            // Sent, or already released by the Arduino_CAN TX interrupt
+            if (!(mctl & RA4M1_CAN_MCTL_TX_SENTDATA) && (mctl & RA4M1_CAN_MCTL_TRMREQ)) {
+                continue;
+            }
+            if ((mctl & RA4M1_CAN_MCTL_TX_SENTDATA) && _txEchoEnabled) {
+                queueTxEcho(mb, micros());
+            }
+            R_CAN0->MCTL_TX[mb] = 0;  // Clear SENTDATA and TRMREQ together
+        }
+        _txBusyMask &= ~(1UL << mb);
+        _txInFlight--;
+    }
+}
+
+void RA4M1CAN::queueTxEcho(uint8_t mb, uint32_t now) {
+    // The mailbox still holds the frame it just sent
+    CANFrame frame;
+    readMailbox(mb, frame);
+    frame.timestamp = now;
+    frame.echo = true;
+    if (!_txEchoRing.push(frame)) {
+        _txEchoOverflowCount++;
+    }
+}
+
+bool RA4M1CAN::loadTxMailbox(const CANFrame& frame, uint32_t key) {
+    uint32_t candidates = _txMailboxMask & ~_txBusyMask;
+
+    // On equal IDs the controller sends the lower mailbox first, so a frame
+    // must go above every busy mailbox holding the same ID to keep order
+    uint32_t busy = _txBusyMask;
+    while (busy) {
+        uint8_t mb = (uint8_t)__builtin_ctz(busy);
+        busy &= busy - 1;
+        if (_txMailboxKey[mb] == key) {
+            candidates &= ~((2UL << mb) - 1);
+        }
+    }
+    if (candidates == 0) {
+        return false;
+    }
+
+    uint8_t mb = (uint8_t)__builtin_ctz(candidates);
+
+    uint32_t rawId = frame.extended
+        ? (RA4M1_CAN_ID_IDE | (frame.id & RA4M1_CAN_ID_EID_MASK))
+        : ((frame.id & RA4M1_CAN_ID_SID_MASK) << RA4M1_CAN_ID_SID_SHIFT);
+    if (frame.rtr) {
+        rawId |= RA4M1_CAN_ID_RTR;
+    }
+
+    R_CAN0->MB[mb].ID = rawId;
+    R_CAN0->MB[mb].DL = frame.dlc;
+    for (uint8_t i = 0; i < 8; i++) {
+        R_CAN0->MB[mb].D[i] = frame.data[i];
+    }
+    R_CAN0->MCTL_TX[mb] = RA4M1_CAN_MCTL_TRMREQ;
+
+    _txMailboxKey[mb] = key;
+    _txBusyMask |= (1UL << mb);
+    _txInFlight++;
+    _txFrameCount++;
+    return true;
+}
+
+// =============================================================================
+// Interrupt-driven TX completion
+// =============================================================================
+
+bool RA4M1CAN::installTxIsr() {
+    int irq = findEventIrq(ELC_EVENT_CAN0_MAILBOX_TX);
+    if (irq < 0) {
+        return false;
+    }
+    s_isrInstance = this;
+    _txIrq = irq;
+    _savedTxVector = NVIC_GetVector((IRQn_Type)irq);
+    NVIC_SetVector((IRQn_Type)irq, (uint32_t)(uintptr_t)&RA4M1CAN::txIsr);
+    return true;
+}
+
+void RA4M1CAN::removeTxIsr() {
+    if (_txIrq >= 0) {
+        NVIC_SetVector((IRQn_Type)_txIrq, _savedTxVector);
+        _txIrq = -1;
+        _savedTxVector = 0;
+    }
+    _isrTxActive = false;
+}
+
+void RA4M1CAN::txIsr() {
+    R_BSP_IrqStatusClear(R_FSP_CurrentIrqGet());
+
+    if (s_isrInstance) {
+        s_isrInstance->completeTxMailboxes();
+    }
+}
+
+void RA4M1CAN::completeTxMailboxes() {
+    // Taken as close to the end of frame as the interrupt allows
+    uint32_t now = micros();
+
+    // Scan the TX mailboxes directly rather than through MSMR, which the RX
+    // handler also programs
+    uint32_t pending = _txMailboxMask;
+    while (pending) {
+        uint8_t mb = (uint8_t)__builtin_ctz(pending);
+        pending &= pending - 1;
+
+        if (!(R_CAN0->MCTL_TX[mb] & RA4M1_CAN_MCTL_TX_SENTDATA)) {
+            continue;
+        }
+        if (_txEchoEnabled) {
+            queueTxEcho(mb, now);
+        }
+        // Clear SENTDATA and TRMREQ; releaseTxMailboxes() then sees it free
+        R_CAN0->MCTL_TX[mb] = 0;
+    }
+}
+
+// =============================================================================
+// Hardware acceptance filtering
+// =============================================================================
+
+void RA4M1CAN::scanMailboxes() {
+    _rxMailboxMask = 0;
+    _extMailboxMask = 0;
+    for (uint8_t mb = 0; mb < RA4M1_CAN_MAILBOX_COUNT; mb++) {
+        if (R_CAN0->MCTL_RX[mb] & RA4M1_CAN_MCTL_RECREQ) {
+            _rxMailboxMask |= (1UL << mb);
+            if (R_CAN0->MB[mb].ID & RA4M1_CAN_ID_IDE) {
+                _extMailboxMask |= (1UL << mb);
+            }
+        }
+    }
+}
+
+bool RA4M1CAN::applyTestMode(CANMode mode) {
+    uint8_t tcr = 0;
+    if (mode == CANMode::Loopback) {
+        tcr = RA4M1_CAN_TCR_TSTE | RA4M1_CAN_TCR_TSTM_INT_LOOP;
+    } else if (mode == CANMode::ListenOnly) {
+        tcr = RA4M1_CAN_TCR_TSTE | RA4M1_CAN_TCR_TSTM_LISTEN;
+    }
+    if (R_CAN0->TCR == tcr) {
+        return true;
+    }
+
+    if (!setOperatingMode(RA4M1_CAN_CTLR_CANM_HALT)) {
+        return false;
+    }
+    R_CAN0->TCR = tcr;
+    return setOperatingMode(RA4M1_CAN_CTLR_CANM_OPER) && R_CAN0->TCR == tcr;
+}
+
+bool RA4M1CAN::setOperatingMode(uint16_t mode) {
+    R_CAN0->CTLR = (uint16_t)((R_CAN0->CTLR & ~RA4M1_CAN_CTLR_CANM_MASK) | mode);
+
+    uint16_t want = (mode == RA4M1_CAN_CTLR_CANM_HALT) ? RA4M1_CAN_STR_HLTST : 0;
+    for (uint32_t i = 0; i < RA4M1_CAN_MODE_WAIT_LOOPS; i++) {
+        if ((R_CAN0->STR & RA4M1_CAN_STR_HLTST) == want) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RA4M1CAN::applyHardwareFilter(uint32_t mask, uint32_t filter) {
+    if (_rxMailboxMask == 0) {
+        return false;  // Layout unknown, software filter only
+    }
+
+    // Mask and mailbox ID registers may only change in halt mode.
+    // The controller finishes the frame in progress before halting.
+    if (!setOperatingMode(RA4M1_CAN_CTLR_CANM_HALT)) {
+        setOperatingMode(RA4M1_CAN_CTLR_CANM_OPER);
+        return false;
+    }
+
+    uint32_t stdMask = (mask & RA4M1_CAN_ID_SID_MASK) << RA4M1_CAN_ID_SID_SHIFT;
+    uint32_t stdId   = (filter & RA4M1_CAN_ID_SID_MASK) << RA4M1_CAN_ID_SID_SHIFT;
+    uint32_t extMask = mask & RA4M1_CAN_ID_EID_MASK;
+    uint32_t extId   = filter & RA4M1_CAN_ID_EID_MASK;
+    bool allProgrammed = true;
+
+    for (uint8_t group = 0; group < RA4M1_CAN_MASK_COUNT; group++) {
+        uint32_t groupBits = 0xFUL << (group * RA4M1_CAN_MAILBOXES_PER_MASK);
+        uint32_t rxBits = _rxMailboxMask & groupBits;
+        if (rxBits == 0) {
+            continue;
+        }
+
+        // One mask serves all four mailboxes; a group mixing standard and
+        // extended mailboxes is left open and filtered in software.
+        uint32_t extBits = _extMailboxMask & rxBits;
+        bool mixed = (extBits != 0) && (extBits != rxBits);
+        if (mask != 0 && mixed) {
+            allProgrammed = false;
+        }
+        R_CAN0->MKR[group] = mixed ? 0 : (extBits ? extMask : stdMask);
+
+        for (uint8_t mb = group * RA4M1_CAN_MAILBOXES_PER_MASK;
+             mb < (group + 1) * RA4M1_CAN_MAILBOXES_PER_MASK; mb++) {
+            if (!(rxBits & (1UL << mb))) {
+                continue;
+            }
+            // Disable the mailbox while its ID changes; keep its IDE/RTR type
+            R_CAN0->MCTL_RX[mb] = 0;
+            uint32_t typeBits = R_CAN0->MB[mb].ID & (RA4M1_CAN_ID_IDE | RA4M1_CAN_ID_RTR);
+            uint32_t id = mixed ? 0 : ((_extMailboxMask & (1UL << mb)) ? extId : stdId);
+            R_CAN0->MB[mb].ID = typeBits | id;
+            R_CAN0->MCTL_RX[mb] = RA4M1_CAN_MCTL_RECREQ;
+        }
+    }
+
+    // Masks valid for all receive mailboxes
+    R_CAN0->MKIVLR &= ~_rxMailboxMask;
+
+    setOperatingMode(RA4M1_CAN_CTLR_CANM_OPER);
+    return allProgrammed;
 }
@@ -9,14 +9,89 @@
 #define RA4M1_CAN_H
 
 #include "CANBackend.h"
+#include "CANFilter.h"
+#include "FrameRing.h"
+#include "TxPriorityQueue.h"
+#include "RA4M1CANRegs.h"
 #include "config.h"
 #include <Arduino_CAN.h>
 
+#ifndef CAN_ISR_RX_RING_SIZE
+#define CAN_ISR_RX_RING_SIZE 64
+#endif
+
+#ifndef ENABLE_ISR_RX
+#define ENABLE_ISR_RX 1
+#endif
+
+#ifndef CAN_TX_ECHO_RING_SIZE
+#define CAN_TX_ECHO_RING_SIZE 32
+#endif
+
+#ifndef ENABLE_ISR_TX
+#define ENABLE_ISR_TX 1
+#endif
+
+#ifndef CAN_BUSOFF_AUTO_RECOVER
+#define CAN_BUSOFF_AUTO_RECOVER 1
+#endif
+
+#ifndef CAN_BUSOFF_RECOVERY_MS
+#define CAN_BUSOFF_RECOVERY_MS 50
+#endif
+
+#ifndef ENABLE_HW_FILTERS
+#define ENABLE_HW_FILTERS 0
+#endif
+
+#ifndef CAN_TX_FIFO
+#define CAN_TX_FIFO 0
+#endif
+
 /**
  * RA4M1 CAN controller backend.
  *
  * Wraps the Arduino_CAN library to provide the ICANBackend interface.
  * Supports bitrates: 125k, 250k, 500k, 1000k (S4, S5, S6, S8).
+ *
+ * RX path: when ENABLE_ISR_RX is set, the CAN0 mailbox-receive interrupt
+ * is redirected to our own handler after Arduino_CAN has configured the
+ * controller. The handler copies each frame out of its mailbox as it
+ * arrives into a lock-free SPSC ring, so main-loop stalls no longer
+ * overflow the hardware mailboxes. available()/read() consume that ring.
+ * If the interrupt cannot be located, the ring is filled by polling
+ * Arduino_CAN from available() instead.
+ *
+ * TX path: frames wait in a priority heap ordered like bus arbitration
+ * (CAN_TX_FIFO selects plain FIFO order). serviceTxQueue() loads them
+ * straight into every mailbox Arduino_CAN left free for transmission, with
+ * the controller in ID-priority transmit mode, so several frames are ready
+ * back to back and the bus, not the queue head, decides who goes first.
+ * Frames with the same ID always leave in the order they were written.
+ *
+ * TX echo: when ENABLE_ISR_TX is set, the mailbox transmit-complete
+ * interrupt is redirected too. It releases each sent mailbox and, while
+ * setTxEcho(true) is in effect, copies the frame back out of the mailbox
+ * with the completion time into a second SPSC ring. read() merges that
+ * ring with the RX ring in timestamp order. Without the interrupt, sent
+ * mailboxes are noticed (and echoed) from serviceTxQueue() instead, so
+ * the timestamp is only as fine as the main loop period. Frames sent
+ * through the Arduino_CAN fallback are never echoed.
+ *
+ * Bus status: getStatus() reads TEC/REC and the error state straight from
+ * the controller and reports error events latched from EIFR since the last
+ * call. If the controller goes bus-off (or halts itself on bus-off) and
+ * auto recovery is enabled, it is forced back onto the bus every
+ * CAN_BUSOFF_RECOVERY_MS instead of waiting for the host to close and
+ * reopen the channel. Queued TX frames are kept across the recovery.
+ *
+ * Filtering: when ENABLE_HW_FILTERS is set, setFilter() also programs the
+ * acceptance masks and IDs of the receive mailboxes, so rejected frames
+ * never raise an interrupt. The software filter stays in place as a
+ * backstop for mailbox groups that could not be programmed.
+ * Both the mask/code pair and the multi-rule CANFilterTable are checked
+ * when a frame is captured, before it is queued in the RX ring, so
+ * read() only ever returns accepted frames.
  */
 class RA4M1CAN : public ICANBackend {
 public:
@@ -28,11 +103,19 @@ public:
     bool isOpen() const override;
     CANMode getMode() const override;
     bool write(const CANFrame& frame) override;
+    uint8_t writeBatch(const CANFrame* frames, uint8_t count) override;
     bool available() override;
     bool read(CANFrame& frame) override;
     CANStatus getStatus() override;
+    uint32_t getErrorEventCount() const override;
     bool setFilter(uint32_t mask, uint32_t filter) override;
     bool clearFilter() override;
+    bool addFilterRule(const CANFilterRule& rule) override;
+    bool removeFilterRule(const CANFilterRule& rule) override;
+    void clearFilterRules() override;
+    void getFilterRuleCounts(uint16_t* stdIds, uint8_t* extRules) const override;
+    void getTxQueueLevel(uint8_t* pending, uint8_t* capacity) const override;
+    bool setTxEcho(bool enable) override;
 
     /**
      * Service the TX queue - call from poll() to drain queued frames.
@@ -43,8 +126,51 @@ public:
     /**
      * Get diagnostic counters.
      * @param txQueueFull Output: TX queue full count (frames rejected)
+     * @param rxRingOverflows Output: frames dropped because the RX ring was full
+     * @param txEchoOverflows Output: TX echoes dropped because the echo ring was full
      */
-    void getCounters(uint32_t* txQueueFull) const;
+    void getCounters(uint32_t* txQueueFull, uint32_t* rxRingOverflows = nullptr,
+                     uint32_t* txEchoOverflows = nullptr) const;
+
+    /**
+     * Check whether the interrupt-driven RX path is active.
+     * @return true if frames are captured in our ISR, false if polled
+     */
+    bool isIsrRxActive() const;
+
+    /**
+     * Check whether TX completion is taken in our own interrupt handler.
+     * @return true if TX echo timestamps come from the interrupt
+     */
+    bool isIsrTxActive() const;
+
+    /**
+     * Get frame throughput counters.
+     * @param rxFrames Output: frames accepted into the RX ring
+     * @param txFrames Output: frames handed to the controller for transmission
+     */
+    void getFrameCounts(uint32_t* rxFrames, uint32_t* txFrames) const;
+
+    /**
+     * Get peak queue occupancy since the last resetCounters().
+     * @param rxRing Output: most frames held in the RX ring
+     * @param txQueue Output: most frames waiting in the TX queue
+     */
+    void getHighWaterMarks(uint16_t* rxRing, uint8_t* txQueue) const;
+
+    /**
+     * Get bus-off diagnostic counters.
+     * @param busOffs Output: bus-off events seen
+     * @param recoveries Output: returns to error-active after bus-off
+     */
+    void getBusOffCounters(uint32_t* busOffs, uint32_t* recoveries) const;
+
+    /**
+     * Configure automatic bus-off recovery.
+     * @param enable true to force recovery, false to leave the controller alone
+     * @param delayMs Time spent bus-off before each recovery attempt
+     */
+    void setBusOffRecovery(bool enable, uint16_t delayMs);
 
     /**
      * Reset diagnostic counters.
@@ -61,14 +187,126 @@ private:
     uint32_t _filterValue;
     bool _filterEnabled;
 
-    // TX queue (ring buffer)
-    CANFrame _txQueue[CAN_TX_QUEUE_SIZE];
-    uint8_t _txQueueHead;   // write() enqueues here
-    uint8_t _txQueueTail;   // serviceTxQueue() dequeues here
-    uint8_t _txQueueCount;  // Number of frames in queue
+    // Multi-rule filter table (modified with interrupts masked)
+    CANFilterTable _filterTable;
+
+    // Receive mailbox layout as configured by Arduino_CAN (read in begin())
+    uint32_t _rxMailboxMask;     // Bit n set: mailbox n receives
+    uint32_t _extMailboxMask;    // Bit n set: mailbox n receives extended IDs
+
+    // TX queue and mailboxes
+    TxPriorityQueue<CAN_TX_QUEUE_SIZE> _txQueue;
+    uint32_t _txMailboxMask;     // Bit n set: mailbox n is ours for TX (0 = use Arduino_CAN)
+    uint32_t _txBusyMask;        // Bit n set: mailbox n holds a frame not yet sent
+    uint32_t _txMailboxKey[RA4M1_CAN_MAILBOX_COUNT];  // Arbitration key per busy mailbox
+    uint8_t _txInFlight;         // Number of busy TX mailboxes
+    uint8_t _txMaxInFlight;      // Mailboxes loaded at once (1 in FIFO mode)
+
+    // RX ring (filled by rxIsr() or pollArduinoCan(), drained by read())
+    FrameRing<CANFrame, CAN_ISR_RX_RING_SIZE> _rxRing;
+    bool _isrRxActive;
+    int _rxIrq;                  // NVIC IRQ number of the mailbox RX event (-1 = none)
+    uint32_t _savedRxVector;     // Arduino_CAN handler, restored in end()
+
+    // TX echo ring (filled by txIsr() or releaseTxMailboxes(), drained by read())
+    FrameRing<CANFrame, CAN_TX_ECHO_RING_SIZE> _txEchoRing;
+    volatile bool _txEchoEnabled;
+    bool _isrTxActive;
+    int _txIrq;                  // NVIC IRQ number of the mailbox TX event (-1 = none)
+    uint32_t _savedTxVector;     // Arduino_CAN handler, restored in end()
+
+    // Bus state (updated from the main loop by updateBusState())
+    uint8_t _latchedEifr;        // EIFR events since the last getStatus()
+    bool _busOff;                // Bus-off and not yet recovered
+    uint32_t _busOffSince;       // millis() at bus-off entry or last recovery attempt
+    bool _busOffAutoRecover;
+    uint16_t _busOffRecoveryMs;
+    uint32_t _statusTxFullMark;  // _txQueueFullCount at the last getStatus()
+    uint32_t _statusRxOverflowMark;  // _rxRingOverflowCount at the last getStatus()
+    uint32_t _errorEventCount;   // updateBusState() calls that latched an error event
 
     // Diagnostic counters
+    uint32_t _busOffCount;       // Bus-off events
+    uint32_t _busOffRecoveryCount;  // Returns from bus-off
     uint32_t _txQueueFullCount;  // Frames rejected due to queue full
+    volatile uint32_t _rxRingOverflowCount;  // Frames dropped (RX ring full)
+    volatile uint32_t _txEchoOverflowCount;  // TX echoes dropped (echo ring full)
+    volatile uint32_t _rxFrameCount;         // Frames queued in the RX ring
+    uint32_t _txFrameCount;                  // Frames loaded for transmission
+    volatile uint16_t _rxRingHighWater;      // Peak RX ring occupancy
+    uint8_t _txQueueHighWater;               // Peak TX queue occupancy
+
+    // Instance serviced by rxIsr()/txIsr() (only one CAN0 controller exists)
+    static RA4M1CAN* s_isrInstance;
+
+    /**
+     * CAN0 mailbox RX interrupt handler.
+     */
+    static void rxIsr();
+
+    /**
+     * CAN0 mailbox TX-complete interrupt handler.
+     */
+    static void txIsr();
+
+    /**
+     * Copy every receive mailbox holding new data into the RX ring.
+     * Runs in interrupt context.
+     */
+    void captureMailboxes();
+
+    /**
+     * Release every transmit mailbox whose frame has been sent, queueing
+     * a TX echo for each while echo is enabled. Runs in interrupt context.
+     */
+    void completeTxMailboxes();
+
+    /**
+     * Copy the frame held in a mailbox (ID, flags, DLC, data).
+     * @param mb Mailbox number
+     * @param frame Output frame (timestamp and echo untouched)
+     */
+    static void readMailbox(uint8_t mb, CANFrame& frame);
+
+    /**
+     * Find the NVIC slot the ICU links to an ELC event.
+     * @param event ELC event number
+     * @return IRQ number, or -1 if the event is not linked
+     */
+    static int findEventIrq(uint32_t event);
+
+    /**
+     * Redirect the mailbox RX interrupt to rxIsr().
+     * @return true if the interrupt was found and redirected
+     */
+    bool installRxIsr();
+
+    /**
+     * Restore the Arduino_CAN mailbox RX interrupt handler.
+     */
+    void removeRxIsr();
+
+    /**
+     * Redirect the mailbox TX-complete interrupt to txIsr().
+     * @return true if the interrupt was found and redirected
+     */
+    bool installTxIsr();
+
+    /**
+     * Restore the Arduino_CAN mailbox TX interrupt handler.
+     */
+    void removeTxIsr();
+
+    /**
+     * Queue an accepted frame in the RX ring and update the RX counters.
+     * Called from rxIsr() or, on the fallback path, the main loop.
+     */
+    void queueRxFrame(const CANFrame& frame);
+
+    /**
+     * Fallback RX path: move frames from Arduino_CAN into the RX ring.
+     */
+    void pollArduinoCan();
 
     /**
      * Convert CANBitrate enum to Arduino_CAN CanBitRate.
@@ -84,10 +322,86 @@ private:
      */
     bool passesFilter(uint32_t id) const;
 
+    /**
+     * Apply both software filter stages to a captured frame.
+     * @param frame The captured frame
+     * @return true if the frame should be queued
+     */
+    bool acceptsFrame(const CANFrame& frame) const {
+        return passesFilter(frame.id) && _filterTable.accepts(frame.id, frame.extended);
+    }
+
     /**
      * Clear queued TX frames to avoid sending stale traffic on reopen.
      */
     void clearTxQueue();
+
+    /**
+     * Record which mailboxes Arduino_CAN configured for reception.
+     */
+    void scanMailboxes();
+
+    /**
+     * Claim the non-receive mailboxes for TX and select ID-priority
+     * transmit mode (falls back to one frame in flight if unavailable).
+     */
+    void setupTxMailboxes();
+
+    /**
+     * Free TX mailboxes whose frame has been sent (echoing them here when
+     * the TX interrupt is not ours).
+     */
+    void releaseTxMailboxes();
+
+    /**
+     * Load a frame into a free TX mailbox and request transmission.
+     * @param frame Frame to send
+     * @param key Its arbitration key (see TxPriorityQueue)
+     * @return true if a mailbox was available
+     */
+    bool loadTxMailbox(const CANFrame& frame, uint32_t key);
+
+    /**
+     * Copy a sent mailbox into the TX echo ring.
+     * Called from txIsr() when installed, otherwise from the main loop.
+     * @param mb Mailbox that completed transmission
+     * @param now Completion timestamp (us)
+     */
+    void queueTxEcho(uint8_t mb, uint32_t now);
+
+    /**
+     * Fallback TX path: hand queued frames to Arduino_CAN.
+     */
+    void drainTxToArduinoCan();
+
+    /**
+     * Program receive mailbox masks/IDs for (id & mask) == (filter & mask).
+     * A mask of 0 accepts every frame.
+     * @return true if every receive mailbox group was programmed
+     */
+    bool applyHardwareFilter(uint32_t mask, uint32_t filter);
+
+    /**
+     * Latch new error events from EIFR, track bus-off and run the
+     * recovery policy. Called once per loop from serviceTxQueue().
+     */
+    void updateBusState();
+
+    /**
+     * Switch the controller between operation and halt mode.
+     * @param mode RA4M1_CAN_CTLR_CANM_OPER or RA4M1_CAN_CTLR_CANM_HALT
+     * @return true if the mode was reached before the spin limit
+     */
+    bool setOperatingMode(uint16_t mode);
+
+    /**
+     * Select the controller test mode for a CAN mode (internal loopback
+     * for CANMode::Loopback, listen-only for CANMode::ListenOnly, none
+     * otherwise). Passes through halt mode if TCR has to change.
+     * @param mode Mode the channel is being opened in
+     * @return true if TCR holds the wanted value
+     */
+    bool applyTestMode(CANMode mode);
 };
 
 #endif // RA4M1_CAN_H
@@ -0,0 +1,96 @@
+/**
+ * RA4M1 CAN Register Definitions
+ *
+ * Bit definitions for the RA4M1 CAN0 peripheral registers that the
+ * Arduino_CAN library does not expose. Register structures come from
+ * the FSP device header (R_CAN0), pulled in through Arduino.h.
+ *
+ * Reference: RA4M1 User's Manual, section "Controller Area Network (CAN) Module".
+ */
+
+#ifndef RA4M1_CAN_REGS_H
+#define RA4M1_CAN_REGS_H
+
+#include <stdint.h>
+
+// Number of hardware mailboxes on CAN0
+#define RA4M1_CAN_MAILBOX_COUNT     32
+
+// Mailboxes per acceptance mask register (MKRk covers mailboxes 4k..4k+3)
+#define RA4M1_CAN_MAILBOXES_PER_MASK 4
+#define RA4M1_CAN_MASK_COUNT        (RA4M1_CAN_MAILBOX_COUNT / RA4M1_CAN_MAILBOXES_PER_MASK)
+
+// -----------------------------------------------------------------------------
+// Control and status registers (CTLR / STR)
+// -----------------------------------------------------------------------------
+
+#define RA4M1_CAN_CTLR_TPM          (1U << 4)       // 1 = mailbox order, 0 = ID priority TX
+#define RA4M1_CAN_CTLR_CANM_MASK    (3U << 8)       // CAN operating mode
+#define RA4M1_CAN_CTLR_CANM_OPER    (0U << 8)       // Operation mode
+#define RA4M1_CAN_CTLR_CANM_RESET   (1U << 8)       // Reset mode
+#define RA4M1_CAN_CTLR_CANM_HALT    (2U << 8)       // Halt mode
+#define RA4M1_CAN_CTLR_RBOC         (1U << 13)      // Forcible return from bus-off
+
+#define RA4M1_CAN_STR_RSTST         (1U << 8)       // In reset mode
+#define RA4M1_CAN_STR_HLTST         (1U << 9)       // In halt mode
+#define RA4M1_CAN_STR_EPST          (1U << 11)      // Error-passive
+#define RA4M1_CAN_STR_BOST          (1U << 12)      // Bus-off
+
+// -----------------------------------------------------------------------------
+// Error interrupt factor register (EIFR, write 0 to clear a flag)
+// -----------------------------------------------------------------------------
+
+#define RA4M1_CAN_EIFR_BEIF         0x01            // Bus error detected
+#define RA4M1_CAN_EIFR_EWIF         0x02            // Error-warning entered
+#define RA4M1_CAN_EIFR_EPIF         0x04            // Error-passive entered
+#define RA4M1_CAN_EIFR_BOEIF        0x08            // Bus-off entered
+#define RA4M1_CAN_EIFR_BORIF        0x10            // Bus-off recovered
+#define RA4M1_CAN_EIFR_ORIF         0x20            // Receive overrun
+#define RA4M1_CAN_EIFR_OLIF         0x40            // Overload frame sent
+#define RA4M1_CAN_EIFR_BLIF         0x80            // Bus lock (dominant stuck)
+
+// -----------------------------------------------------------------------------
+// Test control register (TCR, writable in halt mode only)
+// -----------------------------------------------------------------------------
+
+#define RA4M1_CAN_TCR_TSTE          0x01            // Test mode enable
+#define RA4M1_CAN_TCR_TSTM_LISTEN   (1U << 1)       // Listen-only mode
+#define RA4M1_CAN_TCR_TSTM_EXT_LOOP (2U << 1)       // External loopback (frames go out on CTX)
+#define RA4M1_CAN_TCR_TSTM_INT_LOOP (3U << 1)       // Internal loopback (CTX held recessive)
+
+// TEC/REC level at which the controller reports error warning
+#define RA4M1_CAN_ERROR_WARNING_LIMIT 96
+
+// Spin limit for operating mode transitions (a frame at 125k lasts ~1 ms)
+#define RA4M1_CAN_MODE_WAIT_LOOPS   100000UL
+
+// -----------------------------------------------------------------------------
+// Mailbox ID register (MBj_ID)
+// -----------------------------------------------------------------------------
+
+#define RA4M1_CAN_ID_IDE            (1UL << 31)     // Extended ID frame
+#define RA4M1_CAN_ID_RTR            (1UL << 30)     // Remote frame
+#define RA4M1_CAN_ID_SID_SHIFT      18              // Standard ID in bits 28..18
+#define RA4M1_CAN_ID_SID_MASK       0x7FFUL
+#define RA4M1_CAN_ID_EID_MASK       0x1FFFFFFFUL    // Full 29-bit extended ID
+
+// -----------------------------------------------------------------------------
+// Message control register (MCTL_RXj / MCTL_TXj)
+// -----------------------------------------------------------------------------
+
+#define RA4M1_CAN_MCTL_RX_NEWDATA   0x01            // New message stored
+#define RA4M1_CAN_MCTL_RX_INVALDATA 0x02            // Mailbox being updated
+#define RA4M1_CAN_MCTL_RX_MSGLOST   0x04            // Message overwritten
+#define RA4M1_CAN_MCTL_TX_SENTDATA  0x01            // Transmission complete
+#define RA4M1_CAN_MCTL_RECREQ       0x40            // Receive mailbox
+#define RA4M1_CAN_MCTL_TRMREQ       0x80            // Transmit mailbox
+
+// -----------------------------------------------------------------------------
+// Mailbox search registers (MSMR / MSSR)
+// -----------------------------------------------------------------------------
+
+#define RA4M1_CAN_MSMR_RX_SEARCH    0x00            // Search receive mailboxes with NEWDATA
+#define RA4M1_CAN_MSSR_MBNST_MASK   0x1F            // Search result mailbox number
+#define RA4M1_CAN_MSSR_SEST         0x80            // No mailbox matched the search
+
+#endif // RA4M1_CAN_REGS_H
@@ -0,0 +1,164 @@
+/**
+ * TX Priority Queue
+ *
+ * Bounded binary min-heap of CAN frames waiting for a TX mailbox,
+ * ordered the way the bus would arbitrate them.
+ */
+
+#ifndef TX_PRIORITY_QUEUE_H
+#define TX_PRIORITY_QUEUE_H
+
+#include "CANBackend.h"
+#include <stdint.h>
+
+/**
+ * Software TX queue ordered by CAN arbitration priority.
+ *
+ * Frames with a lower arbitration key leave first. Frames with equal keys
+ * (same ID and type) leave in the order they were pushed, so a stream on
+ * one ID is never reordered. With fifo = true every frame gets the same
+ * key and the queue is a plain FIFO.
+ *
+ * Template parameter N is the capacity (at most 255).
+ */
+template<uint8_t N>
+class TxPriorityQueue {
+public:
+    TxPriorityQueue() : _count(0), _nextSeq(0) {}
+
+    /**
+     * Compute the arbitration key of a frame (lower wins on the bus).
+     *
+     * Bit layout mirrors the arbitration field: base ID (bits 30..20),
+     * IDE (bit 19), extended ID low 18 bits (bits 18..1), RTR (bit 0).
+     * A standard frame therefore beats an extended frame with the same
+     * base ID, and a data frame beats a remote frame with the same ID.
+     */
+    static uint32_t arbitrationKey(const CANFrame& frame) {
+        uint32_t key;
+        if (frame.extended) {
+            key = ((frame.id >> 18) & 0x7FFUL) << 20;
+            key |= 1UL << 19;
+            key |= (frame.id & 0x3FFFFUL) << 1;
+        } else {
+            key = (frame.id & 0x7FFUL) << 20;
+        }
+        return key | (frame.rtr ? 1UL : 0UL);
+    }
+
+    /**
+     * Add a frame.
+     * @param frame Frame to queue
+     * @param fifo true to ignore the ID (plain FIFO order)
+     * @return true if queued, false if the queue is full
+     */
+    bool push(const CANFrame& frame, bool fifo) {
+        if (_count >= N) {
+            return false;
+        }
+
+        Entry e;
+        e.key = fifo ? 0 : arbitrationKey(frame);
+        e.seq = _nextSeq++;
+        e.frame = frame;
+
+        // Sift up (indices are 16-bit: 2 * i + 1 overflows a byte past 127)
+        uint16_t i = _count++;
+        while (i > 0) {
+            uint16_t parent = (uint16_t)((i - 1) / 2);
+            if (!less(e, _heap[parent])) {
+                break;
+            }
+            _heap[i] = _heap[parent];
+            i = parent;
+        }
+        _heap[i] = e;
+        return true;
+    }
+
+    /**
+     * Get the highest-priority frame without removing it.
+     * @return Pointer to the frame, or nullptr if empty
+     */
+    const CANFrame* peek() const {
+        return _count ? &_heap[0].frame : nullptr;
+    }
+
+    /**
+     * Get the key of the frame returned by peek().
+     */
+    uint32_t peekKey() const {
+        return _heap[0].key;
+    }
+
+    /**
+     * Remove the highest-priority frame.
+     */
+    void pop() {
+        if (_count == 0) {
+            return;
+        }
+
+        Entry last = _heap[--_count];
+
+        // Sift down
+        uint16_t i = 0;
+        while (true) {
+            uint16_t child = (uint16_t)(2 * i + 1);
+            if (child >= _count) {
+                break;
+            }
+            if (child + 1 < _count && less(_heap[child + 1], _heap[child])) {
+                child++;
+            }
+            if (!less(_heap[child], last)) {
+                break;
+            }
+            _heap[i] = _heap[child];
+            i = child;
+        }
+        _heap[i] = last;
+    }
+
+    void clear() {
+        _count = 0;
+    }
+
+    uint8_t size() const {
+        return _count;
+    }
+
+    bool empty() const {
+        return _count == 0;
+    }
+
+    bool full() const {
+        return _count >= N;
+    }
+
+    static constexpr uint8_t capacity() {
+        return N;
+    }
+
+private:
+    static_assert(N > 0 && N <= 255, "TxPriorityQueue capacity must be 1..255");
+
+    struct Entry {
+        uint32_t key;       // Arbitration key (0 for every frame in FIFO mode)
+        uint32_t seq;       // Push order, breaks ties between equal keys
+        CANFrame frame;
+    };
+
+    static bool less(const Entry& a, const Entry& b) {
+        if (a.key != b.key) {
+            return a.key < b.key;
+        }
+        return (int32_t)(a.seq - b.seq) < 0;  // Wrap-safe
+    }
+
+    Entry _heap[N];
+    uint8_t _count;
+    uint32_t _nextSeq;
+};
+
+#endif // TX_PRIORITY_QUEUE_H
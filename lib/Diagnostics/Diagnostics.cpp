@@ -0,0 +1,244 @@
+/**
+ * Diagnostics Protocol Handler Implementation
+ */
+
+#include "Diagnostics.h"
+#include "BinaryStreamFormat.h"
+#include "SLCANHex.h"
+#include "Transport.h"
+#include <Arduino.h>
+
+// Largest record: header + count + 4 bytes per value
+static const size_t DIAG_RECORD_LEN = BINSTREAM_HEADER_LEN + 1 + 4 * DIAG_VALUE_COUNT;
+
+static_assert(DIAG_RECORD_LEN - 2 <= 255, "Diagnostics record exceeds the LEN field");
+static_assert(RESPONSE_BUFFER_SIZE >= 2 + 8 * DIAG_VALUES_PER_PAGE + 2,
+              "RESPONSE_BUFFER_SIZE too small for a D page");
+static_assert(DIAG_PAGE_COUNT <= 16, "D pages are numbered with one hex digit");
+
+Diagnostics::Diagnostics(HostTransport& transport, RA4M1CAN& can, FrameBus& bus, SLCAN& slcan,
+                         BinaryStream& binaryStream, IsoTpHandler& isotp, LoopScheduler& scheduler)
+    : _transport(transport)
+    , _can(can)
+    , _bus(bus)
+    , _slcan(slcan)
+    , _binaryStream(binaryStream)
+    , _isotp(isotp)
+    , _scheduler(scheduler)
+    , _resetTime(0)
+    , _windowStart(0)
+    , _windowLoops(0)
+    , _windowRxMark(0)
+    , _windowTxMark(0)
+    , _loopRate(0)
+    , _rxRate(0)
+    , _txRate(0)
+    , _binaryPending(false)
+{
+}
+
+const char* Diagnostics::getName() const {
+    return "DIAG";
+}
+
+bool Diagnostics::canHandle(const char* cmd) const {
+    return cmd != nullptr && cmd[0] == 'D';
+}
+
+bool Diagnostics::processCommand(const char* cmd, char* response, size_t maxLen) {
+    if (cmd == nullptr || response == nullptr || maxLen < 3) {
+        return false;
+    }
+
+    if (cmd[1] == '\0') {
+        // Query: Dpnn
+        response[0] = 'D';
+        slcanHexNibble(response + 1, DIAG_PAGE_COUNT);
+        slcanHexByte(response + 2, DIAG_VALUE_COUNT);
+        response[4] = '\0';
+        return true;
+    }
+
+    if (cmd[2] == '\0') {
+        if (cmd[1] == 'R') {
+            reset();
+            response[0] = '\0';
+            return true;
+        }
+        if (cmd[1] == 'B') {
+            _binaryPending = true;  // Written by poll(); the record is the reply
+            return false;
+        }
+
+        uint8_t page = SLCAN_HEX_DECODE[(uint8_t)cmd[1]];
+        if (page < DIAG_PAGE_COUNT) {
+            uint32_t values[DIAG_VALUE_COUNT];
+            snapshot(values);
+
+            uint8_t first = page * DIAG_VALUES_PER_PAGE;
+            uint8_t last = first + DIAG_VALUES_PER_PAGE;
+            if (last > DIAG_VALUE_COUNT) {
+                last = DIAG_VALUE_COUNT;
+            }
+
+            char* p = response;
+            *p++ = 'D';
+            *p++ = cmd[1];
+            for (uint8_t i = first; i < last; i++) {
+                slcanHexByte(p,     (uint8_t)(values[i] >> 24));
+                slcanHexByte(p + 2, (uint8_t)(values[i] >> 16));
+                slcanHexByte(p + 4, (uint8_t)(values[i] >> 8));
+                slcanHexByte(p + 6, (uint8_t)values[i]);
+                p += 8;
+            }
+            *p = '\0';
+            return true;
+        }
+    }
+
+    response[0] = '\x07';  // BELL - error
+    response[1] = '\0';
+    return true;
+}
+
+void Diagnostics::poll(ITransport* transport) {
+    _windowLoops++;
+
+    uint32_t now = millis();
+    uint32_t elapsed = now - _windowStart;
+    if (elapsed >= DIAG_RATE_WINDOW_MS) {
+        uint32_t rx, tx;
+        _can.getFrameCounts(&rx, &tx);
+        _loopRate = (uint32_t)((uint64_t)_windowLoops * 1000 / elapsed);
+        _rxRate = (uint32_t)((uint64_t)(rx - _windowRxMark) * 1000 / elapsed);
+        _txRate = (uint32_t)((uint64_t)(tx - _windowTxMark) * 1000 / elapsed);
+        _windowStart = now;
+        _windowLoops = 0;
+        _windowRxMark = rx;
+        _windowTxMark = tx;
+    }
+
+    if (_binaryPending && transport != nullptr) {
+        uint32_t values[DIAG_VALUE_COUNT];
+        uint8_t record[DIAG_RECORD_LEN];
+        snapshot(values);
+        size_t len = encodeRecord(values, record, sizeof(record));
+        if (transport->writeWithPriority((const char*)record, len, WritePriority::COMMAND_RESPONSE)) {
+            _binaryPending = false;
+        }
+    }
+}
+
+bool Diagnostics::isActive() const {
+    return true;
+}
+
+void Diagnostics::snapshot(uint32_t* values) const {
+    uint32_t* v = values;
+
+    // Read the ISR-updated backend counters as one consistent set
+    noInterrupts();
+    _can.getCounters(&v[(uint8_t)DiagValue::CanTxQueueFull],
+                     &v[(uint8_t)DiagValue::CanRxRingOverflows],
+                     &v[(uint8_t)DiagValue::CanTxEchoOverflows]);
+    _can.getFrameCounts(&v[(uint8_t)DiagValue::RxFrames], &v[(uint8_t)DiagValue::TxFrames]);
+    uint16_t peakRx;
+    uint8_t peakTx;
+    _can.getHighWaterMarks(&peakRx, &peakTx);
+    interrupts();
+
+    _can.getBusOffCounters(&v[(uint8_t)DiagValue::CanBusOffs],
+                           &v[(uint8_t)DiagValue::CanBusOffRecoveries]);
+    _bus.getCounters(&v[(uint8_t)DiagValue::FrameBusOverflows]);
+    _bus.getDecimator().getCounters(&v[(uint8_t)DiagValue::FramesDecimated]);
+    _bus.getLaneCounters(&v[(uint8_t)DiagValue::FrameBusMainDrops],
+                         &v[(uint8_t)DiagValue::FrameBusPriorityDrops]);
+    _bus.getCapture().getCounters(&v[(uint8_t)DiagValue::CaptureTriggers],
+                                  &v[(uint8_t)DiagValue::CaptureFrames]);
+    _slcan.getCounters(nullptr, &v[(uint8_t)DiagValue::SlcanRxDrops]);
+    _slcan.getGeneratorCounters(&v[(uint8_t)DiagValue::GenFramesQueued],
+                                &v[(uint8_t)DiagValue::GenTxRejects]);
+    _slcan.getCyclicCounters(&v[(uint8_t)DiagValue::CyclicFramesSent],
+                             &v[(uint8_t)DiagValue::CyclicTxRejects]);
+    _slcan.getChangeFilterCounters(&v[(uint8_t)DiagValue::ChangeSuppressed],
+                                   &v[(uint8_t)DiagValue::ChangeUntracked]);
+    _binaryStream.getCounters(&v[(uint8_t)DiagValue::BinaryFramesSent],
+                              &v[(uint8_t)DiagValue::BinaryRxDrops]);
+    _isotp.getCounters(&v[(uint8_t)DiagValue::IsoTpPdusSent],
+                       &v[(uint8_t)DiagValue::IsoTpPdusReceived],
+                       &v[(uint8_t)DiagValue::IsoTpErrors]);
+    _transport.getCounters(&v[(uint8_t)DiagValue::SerialResponseDrops],
+                           &v[(uint8_t)DiagValue::SerialFrameDrops],
+                           &v[(uint8_t)DiagValue::SerialCmdOverflows]);
+
+    v[(uint8_t)DiagValue::UptimeMs] = millis() - _resetTime;
+    v[(uint8_t)DiagValue::LoopsPerSec] = _loopRate;
+    v[(uint8_t)DiagValue::RxFramesPerSec] = _rxRate;
+    v[(uint8_t)DiagValue::TxFramesPerSec] = _txRate;
+    v[(uint8_t)DiagValue::PeakCanRxRing] = peakRx;
+    v[(uint8_t)DiagValue::PeakFrameBus] = _bus.getHighWaterMark();
+    v[(uint8_t)DiagValue::PeakCanTxQueue] = peakTx;
+    v[(uint8_t)DiagValue::PeakSerialRx] = _transport.getRxHighWaterMark();
+    v[(uint8_t)DiagValue::PeakSerialTx] = _transport.getTxHighWaterMark();
+#if ENABLE_WIFI_TRANSPORT
+    _transport.getDatagramCounters(&v[(uint8_t)DiagValue::NetDatagramsSent],
+                                   &v[(uint8_t)DiagValue::NetDatagramsLost],
+                                   &v[(uint8_t)DiagValue::NetDatagramsReceived]);
+#else
+    v[(uint8_t)DiagValue::NetDatagramsSent] = 0;
+    v[(uint8_t)DiagValue::NetDatagramsLost] = 0;
+    v[(uint8_t)DiagValue::NetDatagramsReceived] = 0;
+#endif
+
+    const SchedulerPolicy& policy = _scheduler.getPolicy();
+    v[(uint8_t)DiagValue::SchedCmdBudgetUs] = policy.cmdBudgetUs;
+    v[(uint8_t)DiagValue::SchedRxBudgetUs] = policy.rxBudgetUs;
+    v[(uint8_t)DiagValue::SchedTxPriority] = policy.txPriority ? 1 : 0;
+    _scheduler.getCounters(&v[(uint8_t)DiagValue::SchedRxBoostTicks],
+                           &v[(uint8_t)DiagValue::SchedTxPriorityTicks],
+                           &v[(uint8_t)DiagValue::SchedOverruns]);
+}
+
+void Diagnostics::reset() {
+    // Clear everything in one step so no counter is reset against a stale other
+    noInterrupts();
+    _can.resetCounters();
+    _bus.resetCounters();
+    _slcan.resetCounters();
+    _binaryStream.resetCounters();
+    _isotp.resetCounters();
+    _transport.resetCounters();
+    _scheduler.resetCounters();
+    interrupts();
+
+    uint32_t now = millis();
+    _resetTime = now;
+    _windowStart = now;
+    _windowLoops = 0;
+    _windowRxMark = 0;
+    _windowTxMark = 0;
+    _loopRate = 0;
+    _rxRate = 0;
+    _txRate = 0;
+}
+
+size_t Diagnostics::encodeRecord(const uint32_t* values, uint8_t* buffer, size_t maxLen) {
+    if (values == nullptr || buffer == nullptr || maxLen < DIAG_RECORD_LEN) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    buffer[pos++] = BINSTREAM_SYNC;
+    buffer[pos++] = (uint8_t)(DIAG_RECORD_LEN - 2);   // Bytes after LEN
+    buffer[pos++] = BINSTREAM_TYPE_DIAGNOSTICS;
+    buffer[pos++] = DIAG_VALUE_COUNT;
+
+    for (uint8_t i = 0; i < DIAG_VALUE_COUNT; i++) {
+        uint32_t value = values[i];
+        for (uint8_t b = 0; b < 4; b++) {
+            buffer[pos++] = (uint8_t)(value & 0xFF);
+            value >>= 8;
+        }
+    }
+    return pos;
+}
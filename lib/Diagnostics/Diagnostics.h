@@ -0,0 +1,161 @@
+/**
+ * Diagnostics Protocol Handler
+ *
+ * Collects the diagnostic counters of every layer (transport, CAN backend,
+ * frame bus, protocol handlers) into one table that the host can poll as
+ * ASCII (D command) or as a binary record.
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include "config.h"
+#include "ProtocolHandler.h"
+#include "FrameBus.h"
+#include "BinaryStream.h"
+#include "LoopScheduler.h"
+#include "HostTransport.h"
+#include "RA4M1CAN.h"
+#include "SLCAN.h"
+#include "IsoTpHandler.h"
+#include <stdint.h>
+
+#ifndef DIAG_RATE_WINDOW_MS
+#define DIAG_RATE_WINDOW_MS 1000
+#endif
+
+/**
+ * Diagnostic values, in the order they are reported. The numeric value is
+ * the position in the D pages and the binary record, so only append.
+ */
+enum class DiagValue : uint8_t {
+    UptimeMs = 0,           // ms since the last reset (DR) or boot
+    LoopsPerSec,            // loop() iterations per second (last window)
+    RxFramesPerSec,         // CAN frames received per second (last window)
+    TxFramesPerSec,         // CAN frames transmitted per second (last window)
+    RxFrames,               // CAN frames received
+    TxFrames,               // CAN frames handed to the controller
+    CanRxRingOverflows,     // Backend RX ring full (frames lost)
+    CanTxQueueFull,         // Frames rejected, TX queue full
+    CanTxEchoOverflows,     // TX echoes lost, echo ring full
+    CanBusOffs,             // Bus-off events
+    CanBusOffRecoveries,    // Returns from bus-off
+    FrameBusOverflows,      // Shared frame bus full (frames left in the backend)
+    SlcanRxDrops,           // SLCAN RX lines refused by the transport
+    BinaryRxDrops,          // Binary RX records refused by the transport
+    BinaryFramesSent,       // Binary RX records sent
+    SerialResponseDrops,    // Command responses dropped (response lane full)
+    SerialFrameDrops,       // RX frame writes dropped (frame lane full)
+    SerialCmdOverflows,     // Over-long command lines discarded
+    PeakCanRxRing,          // Most frames held in the backend RX ring
+    PeakFrameBus,           // Most frames held in the shared frame bus
+    PeakCanTxQueue,         // Most frames waiting in the TX queue
+    PeakSerialRx,           // Most command bytes waiting in the RX buffer
+    GenFramesQueued,        // Traffic generator frames accepted (g command)
+    GenTxRejects,           // Traffic generator frames refused, TX queue full
+    SchedCmdBudgetUs,       // Current command budget per loop iteration (us)
+    SchedRxBudgetUs,        // Current RX forward budget per loop iteration (us)
+    SchedTxPriority,        // 1 while the TX queue is serviced before each command
+    SchedRxBoostTicks,      // Loop iterations with more than the minimum RX share
+    SchedTxPriorityTicks,   // Loop iterations run with TX priority
+    SchedOverruns,          // Loop iterations longer than SCHED_TICK_BUDGET_US
+    PeakSerialTx,           // Most output bytes staged (response + frame lanes)
+    NetDatagramsSent,       // UDP datagrams sent (ENABLE_WIFI_TRANSPORT)
+    NetDatagramsLost,       // UDP datagrams the network refused
+    NetDatagramsReceived,   // UDP command datagrams received
+    ChangeSuppressed,       // RX frames not forwarded, payload unchanged (u1)
+    ChangeUntracked,        // RX frames forwarded unfiltered, ID cache full
+    FramesDecimated,        // RX frames dropped by d rules before the frame bus
+    CyclicFramesSent,       // Cyclic table frames queued (c command)
+    CyclicTxRejects,        // Cyclic sends refused, TX queue full
+    IsoTpPdusSent,          // ISO-TP PDUs sent (I commands)
+    IsoTpPdusReceived,      // ISO-TP PDUs received
+    IsoTpErrors,            // ISO-TP transfers failed (timeouts, sequence, overflow)
+    FrameBusMainDrops,      // Frames dropped from the main ring by the o1/o2 policy
+    FrameBusPriorityDrops,  // Priority frames dropped with both lanes full (o1)
+    CaptureTriggers,        // Captures triggered (G command)
+    CaptureFrames,          // Frames recorded into the capture buffer
+    Count
+};
+
+#define DIAG_VALUE_COUNT        ((uint8_t)DiagValue::Count)
+#define DIAG_VALUES_PER_PAGE    8
+#define DIAG_PAGE_COUNT         ((DIAG_VALUE_COUNT + DIAG_VALUES_PER_PAGE - 1) / DIAG_VALUES_PER_PAGE)
+
+/**
+ * Diagnostics protocol handler.
+ *
+ * Commands:
+ *   D      : Responds Dpnn (p = page count, nn = value count; hex)
+ *   Dp     : Page p: Dp + up to 8 values, 8 hex digits each, in DiagValue order
+ *   DR     : Reset every counter and high-water mark at once
+ *   DB     : Send all values as one binary record (BINSTREAM_TYPE_DIAGNOSTICS)
+ *
+ * poll() must run once per loop iteration: it counts loop iterations and
+ * updates the per-second rates.
+ */
+class Diagnostics : public IProtocolHandler {
+public:
+    /**
+     * Constructor.
+     * @param transport Host transport (USB serial or UDP)
+     * @param can CAN backend
+     * @param bus Shared frame bus (ProtocolDispatcher::getFrameBus())
+     * @param slcan SLCAN handler
+     * @param binaryStream Binary stream handler
+     * @param isotp ISO-TP handler
+     * @param scheduler Main loop scheduler
+     */
+    Diagnostics(HostTransport& transport, RA4M1CAN& can, FrameBus& bus, SLCAN& slcan,
+                BinaryStream& binaryStream, IsoTpHandler& isotp, LoopScheduler& scheduler);
+
+    // IProtocolHandler interface
+    const char* getName() const override;
+    bool canHandle(const char* cmd) const override;
+    bool processCommand(const char* cmd, char* response, size_t maxLen) override;
+    void poll(ITransport* transport) override;
+    bool isActive() const override;
+
+    /**
+     * Read every diagnostic value.
+     * @param values Output: DIAG_VALUE_COUNT values in DiagValue order
+     */
+    void snapshot(uint32_t* values) const;
+
+    /**
+     * Reset all counters, high-water marks and rates together.
+     */
+    void reset();
+
+    /**
+     * Encode diagnostic values as a binary record.
+     * @param values DIAG_VALUE_COUNT values in DiagValue order
+     * @param buffer Output buffer
+     * @param maxLen Maximum buffer size
+     * @return Number of bytes written, or 0 if the buffer is too small
+     */
+    static size_t encodeRecord(const uint32_t* values, uint8_t* buffer, size_t maxLen);
+
+private:
+    HostTransport& _transport;
+    RA4M1CAN& _can;
+    FrameBus& _bus;
+    SLCAN& _slcan;
+    BinaryStream& _binaryStream;
+    IsoTpHandler& _isotp;
+    LoopScheduler& _scheduler;
+
+    // Rate window
+    uint32_t _resetTime;            // millis() of the last reset
+    uint32_t _windowStart;          // millis() when the current window began
+    uint32_t _windowLoops;          // Loop iterations in the current window
+    uint32_t _windowRxMark;         // RX frame count at the window start
+    uint32_t _windowTxMark;         // TX frame count at the window start
+    uint32_t _loopRate;
+    uint32_t _rxRate;
+    uint32_t _txRate;
+
+    bool _binaryPending;            // DB received, record not yet written
+};
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,299 @@
+/**
+ * ISO-TP Protocol Handler Implementation
+ */
+
+#include "IsoTpHandler.h"
+#include "Transport.h"
+#include "SLCANHex.h"
+#include <Arduino.h>
+#include <string.h>
+
+static bool setOk(char* response) {
+    response[0] = '\0';
+    return true;
+}
+
+static bool setError(char* response) {
+    response[0] = '\x07';  // BELL - error
+    response[1] = '\0';
+    return true;
+}
+
+IsoTpHandler::IsoTpHandler(ICANBackend& can)
+    : _can(can)
+    , _bus(nullptr)
+    , _busReader(FRAME_BUS_NO_READER)
+    , _rxHeaderSent(false)
+    , _rxOutOffset(0)
+    , _txEventPending(false)
+    , _txEventCode(0)
+    , _rxEventPending(false)
+    , _rxEventCode(0)
+{
+}
+
+const char* IsoTpHandler::getName() const {
+    return "ISOTP";
+}
+
+bool IsoTpHandler::canHandle(const char* cmd) const {
+    return cmd != nullptr && cmd[0] == 'I';
+}
+
+bool IsoTpHandler::processCommand(const char* cmd, char* response, size_t maxLen) {
+    if (cmd == nullptr || response == nullptr || maxLen < 8) {
+        return false;
+    }
+
+    switch (cmd[1]) {
+        case '\0': {
+            // Query: I<t><r><llll>
+            uint16_t staged = _link.getStagedLength();
+            response[0] = 'I';
+            slcanHexNibble(response + 1, (uint8_t)_link.getTxState());
+            slcanHexNibble(response + 2, (uint8_t)_link.getRxState());
+            slcanHexByte(response + 3, (uint8_t)(staged >> 8));
+            slcanHexByte(response + 5, (uint8_t)staged);
+            response[7] = '\0';
+            return true;
+        }
+
+        case 'A':
+            return handleAddress(cmd + 2) ? setOk(response) : setError(response);
+
+        case 'F': {
+            uint8_t bs, stMin;
+            if (strlen(cmd) != 6 || !slcanHexDecodeByte(cmd + 2, &bs)
+                || !slcanHexDecodeByte(cmd + 4, &stMin)) {
+                return setError(response);
+            }
+            _link.setFlowControl(bs, stMin);
+            return setOk(response);
+        }
+
+        case 'P': {
+            uint8_t pad;
+            if (cmd[2] == '\0') {
+                _link.setPadding(false, 0);
+                return setOk(response);
+            }
+            if (strlen(cmd) != 4 || !slcanHexDecodeByte(cmd + 2, &pad)) {
+                return setError(response);
+            }
+            _link.setPadding(true, pad);
+            return setOk(response);
+        }
+
+        case 'W':
+            return cmd[2] != '\0' && appendHex(cmd + 2) ? setOk(response) : setError(response);
+
+        case 'S':
+            // The link must be able to transmit: open, not listen-only
+            if (!_link.isConfigured() || !_can.isOpen() || _can.getMode() == CANMode::ListenOnly
+                || _link.getTxState() != IsoTpTxState::Idle || !appendHex(cmd + 2)
+                || !_link.startSend(_can, micros())) {
+                return setError(response);
+            }
+            return setOk(response);
+
+        case 'X':
+            if (cmd[2] != '\0') {
+                break;
+            }
+            _link.abort();
+            return setOk(response);
+
+        default:
+            break;
+    }
+
+    return setError(response);
+}
+
+void IsoTpHandler::poll(ITransport* transport) {
+    if (!_link.isConfigured()) {
+        return;
+    }
+
+    uint32_t now = micros();
+    if (_bus != nullptr && _can.isOpen()) {
+        // Frames for other IDs are skipped; a frame the link can't take
+        // yet stays on the bus until the held PDU is written out
+        uint16_t framesProcessed = 0;
+        while (framesProcessed == 0 || _bus->forwardTimeLeft()) {
+            const CANFrame* frame = _bus->peek(_busReader);
+            if (frame == nullptr) {
+                break;
+            }
+            if (_link.accepts(*frame) && !_link.handleFrame(*frame, _can, now)) {
+                break;
+            }
+            _bus->consume(_busReader);
+            framesProcessed++;
+        }
+        _link.poll(_can, now);
+    }
+
+    if (transport != nullptr) {
+        writeRecords(transport);
+    }
+}
+
+bool IsoTpHandler::isActive() const {
+    return _link.isConfigured();
+}
+
+void IsoTpHandler::attachFrameBus(FrameBus* bus, uint8_t reader) {
+    _bus = bus;
+    _busReader = reader;
+    updateBusReader();
+}
+
+IsoTpLink& IsoTpHandler::getLink() {
+    return _link;
+}
+
+void IsoTpHandler::getCounters(uint32_t* pdusSent, uint32_t* pdusReceived, uint32_t* errors) const {
+    _link.getCounters(pdusSent, pdusReceived, errors);
+}
+
+void IsoTpHandler::resetCounters() {
+    _link.resetCounters();
+}
+
+bool IsoTpHandler::handleAddress(const char* args) {
+    size_t len = strlen(args);
+    uint32_t txId, rxId;
+
+    if (len == 0) {
+        _link.clearAddress();
+    } else if (args[0] == 't' && len == 7 && slcanHexDecode(args + 1, 3, &txId)
+               && slcanHexDecode(args + 4, 3, &rxId)) {
+        if (!_link.setAddress(txId, rxId, false)) {
+            return false;
+        }
+    } else if (args[0] == 'T' && len == 17 && slcanHexDecode(args + 1, 8, &txId)
+               && slcanHexDecode(args + 9, 8, &rxId)) {
+        if (!_link.setAddress(txId, rxId, true)) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    // Any held PDU went with the old address
+    resetOutput();
+    updateBusReader();
+    return true;
+}
+
+bool IsoTpHandler::appendHex(const char* hex) {
+    size_t digits = strlen(hex);
+    if (digits % 2 != 0) {
+        return false;
+    }
+
+    // Check up front so a failed append leaves nothing behind
+    uint16_t count = (uint16_t)(digits / 2);
+    if (count > ISOTP_MAX_PDU_SIZE - _link.getStagedLength()) {
+        return false;
+    }
+    for (size_t i = 0; i < digits; i++) {
+        if (SLCAN_HEX_DECODE[(uint8_t)hex[i]] == SLCAN_HEX_INVALID) {
+            return false;
+        }
+    }
+
+    uint8_t bytes[32];
+    while (count > 0) {
+        uint16_t n = count < sizeof(bytes) ? count : (uint16_t)sizeof(bytes);
+        for (uint16_t i = 0; i < n; i++) {
+            slcanHexDecodeByte(hex + i * 2, &bytes[i]);
+        }
+        if (!_link.append(bytes, n)) {
+            return false;
+        }
+        hex += n * 2;
+        count -= n;
+    }
+    return true;
+}
+
+void IsoTpHandler::updateBusReader() {
+    if (_bus != nullptr) {
+        _bus->setReaderEnabled(_busReader, _link.isConfigured());
+    }
+}
+
+void IsoTpHandler::resetOutput() {
+    _rxHeaderSent = false;
+    _rxOutOffset = 0;
+    _txEventPending = false;
+    _rxEventPending = false;
+}
+
+void IsoTpHandler::writeRecords(ITransport* transport) {
+    // Latch events so a refused write is retried, not lost
+    if (!_txEventPending && _link.takeTxResult(&_txEventCode)) {
+        _txEventPending = true;
+    }
+    if (_txEventPending && writeEvent(transport, 't', _txEventCode)) {
+        _txEventPending = false;
+    }
+    if (!_rxEventPending && _link.takeRxError(&_rxEventCode)) {
+        _rxEventPending = true;
+    }
+    if (_rxEventPending && writeEvent(transport, 'e', _rxEventCode)) {
+        _rxEventPending = false;
+    }
+
+    uint16_t pduLen;
+    const uint8_t* pdu = _link.getRxPdu(&pduLen);
+    if (pdu == nullptr) {
+        return;
+    }
+
+    char line[ISOTP_MAX_RECORD_LEN];
+    if (!_rxHeaderSent) {
+        line[0] = 'I';
+        line[1] = 'r';
+        slcanHexByte(line + 2, (uint8_t)(pduLen >> 8));
+        slcanHexByte(line + 4, (uint8_t)pduLen);
+        line[6] = '\r';
+        if (transport->writeRoom(WritePriority::CAN_RX_FRAME) < 7) {
+            return;
+        }
+        transport->writeWithPriority(line, 7, WritePriority::CAN_RX_FRAME);
+        _rxHeaderSent = true;
+    }
+
+    while (_rxOutOffset < pduLen) {
+        uint16_t n = pduLen - _rxOutOffset;
+        if (n > ISOTP_RX_CHUNK) n = ISOTP_RX_CHUNK;
+        size_t len = 2 + (size_t)n * 2 + 1;
+        if (transport->writeRoom(WritePriority::CAN_RX_FRAME) < len) {
+            return;  // Rest goes out on a later poll
+        }
+        line[0] = 'I';
+        line[1] = 'd';
+        for (uint16_t i = 0; i < n; i++) {
+            slcanHexByte(line + 2 + i * 2, pdu[_rxOutOffset + i]);
+        }
+        line[len - 1] = '\r';
+        transport->writeWithPriority(line, len, WritePriority::CAN_RX_FRAME);
+        _rxOutOffset += n;
+    }
+
+    _link.releaseRx();
+    _rxHeaderSent = false;
+    _rxOutOffset = 0;
+}
+
+bool IsoTpHandler::writeEvent(ITransport* transport, char type, uint8_t code) {
+    char line[5] = { 'I', type, 0, 0, '\r' };
+    slcanHexByte(line + 2, code);
+    if (transport->writeRoom(WritePriority::CAN_RX_FRAME) < sizeof(line)) {
+        return false;
+    }
+    return transport->writeWithPriority(line, sizeof(line), WritePriority::CAN_RX_FRAME);
+}
@@ -0,0 +1,116 @@
+/**
+ * ISO-TP Protocol Handler
+ *
+ * Offloads ISO 15765-2 segmentation and flow control to the adapter:
+ * the host sends and receives whole PDUs (UDS/KWP requests and
+ * responses) instead of timing every frame over USB.
+ */
+
+#ifndef ISOTP_HANDLER_H
+#define ISOTP_HANDLER_H
+
+#include "config.h"
+#include "ProtocolHandler.h"
+#include "FrameBus.h"
+#include "CANBackend.h"
+#include "IsoTpLink.h"
+#include <stdint.h>
+
+#ifndef ISOTP_RX_CHUNK
+#define ISOTP_RX_CHUNK 64
+#endif
+
+// Longest record line: "Id" + ISOTP_RX_CHUNK bytes as hex + CR
+#define ISOTP_MAX_RECORD_LEN (2 + ISOTP_RX_CHUNK * 2 + 1)
+
+/**
+ * ISO-TP protocol handler.
+ *
+ * Registered next to SLCAN, which keeps channel control (S, O, C, ...)
+ * and still streams the raw frames. One address pair at a time:
+ *
+ *   IAt<iii><jjj>   : Standard TX ID iii, RX ID jjj (enables the link)
+ *   IAT<8><8>       : Extended TX and RX IDs
+ *   IA              : Disable the link
+ *   IF<bb><ss>      : Block size and STmin we ask the sender for
+ *   IP<xx>          : Pad frames to 8 bytes with xx (IP alone: no padding)
+ *   IW<hex>         : Append bytes to the PDU to send
+ *   IS[<hex>]       : Append bytes (optional) and send the PDU
+ *   IX              : Abort transfers, drop staged bytes
+ *   I               : Query: I<t><r><llll> (TX state, RX state, length of the
+ *                     PDU staged or being sent)
+ *
+ * Asynchronous records, one CR-terminated line each:
+ *
+ *   Ir<llll>        : Received PDU of llll bytes follows
+ *   Id<hex>         : Next up to ISOTP_RX_CHUNK bytes of that PDU
+ *   It<cc>          : Send finished (00 = OK, else an ISOTP_ERROR_ code)
+ *   Ie<cc>          : Reception failed (ISOTP_ERROR_ code)
+ *
+ * Records go to the RX frame lane, so they stay in order with the raw
+ * frames and are held back (never dropped) while the host link is busy.
+ * A received PDU is kept until all of its records are written.
+ */
+class IsoTpHandler : public IProtocolHandler {
+public:
+    /**
+     * Constructor.
+     * @param can Reference to the CAN backend
+     */
+    explicit IsoTpHandler(ICANBackend& can);
+
+    // IProtocolHandler interface
+    const char* getName() const override;
+    bool canHandle(const char* cmd) const override;
+    bool processCommand(const char* cmd, char* response, size_t maxLen) override;
+    void poll(ITransport* transport) override;
+    bool isActive() const override;
+    void attachFrameBus(FrameBus* bus, uint8_t reader) override;
+
+    /**
+     * Get the protocol engine (tests and diagnostics).
+     */
+    IsoTpLink& getLink();
+
+    /**
+     * Get diagnostic counters.
+     * @param pdusSent Output: PDUs sent
+     * @param pdusReceived Output: PDUs received
+     * @param errors Output: failed transfers (either direction)
+     */
+    void getCounters(uint32_t* pdusSent, uint32_t* pdusReceived, uint32_t* errors) const;
+
+    /**
+     * Reset diagnostic counters.
+     */
+    void resetCounters();
+
+private:
+    ICANBackend& _can;
+    IsoTpLink _link;
+
+    // Cursor on the dispatcher's shared RX frame bus (enabled while addressed)
+    FrameBus* _bus;
+    uint8_t _busReader;
+
+    // Output of the held PDU and events, resumed on the next poll when refused
+    bool _rxHeaderSent;
+    uint16_t _rxOutOffset;
+    bool _txEventPending;
+    uint8_t _txEventCode;
+    bool _rxEventPending;
+    uint8_t _rxEventCode;
+
+    bool handleAddress(const char* args);
+    bool appendHex(const char* hex);
+    void updateBusReader();
+    void resetOutput();
+
+    /**
+     * Write the pending records, as many as the transport takes.
+     */
+    void writeRecords(ITransport* transport);
+    bool writeEvent(ITransport* transport, char type, uint8_t code);
+};
+
+#endif // ISOTP_HANDLER_H
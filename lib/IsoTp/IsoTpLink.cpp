@@ -0,0 +1,450 @@
+/**
+ * ISO-TP Link Implementation
+ */
+
+#include "IsoTpLink.h"
+#include <string.h>
+
+// Protocol control information (high nibble of the first byte)
+#define ISOTP_PCI_SINGLE        0x0
+#define ISOTP_PCI_FIRST         0x1
+#define ISOTP_PCI_CONSECUTIVE   0x2
+#define ISOTP_PCI_FLOW_CONTROL  0x3
+
+// Flow status (low nibble of a flow control frame)
+#define ISOTP_FS_CTS            0x0
+#define ISOTP_FS_WAIT           0x1
+#define ISOTP_FS_OVERFLOW       0x2
+
+#define ISOTP_SF_MAX_DATA       7
+#define ISOTP_FF_DATA           6
+#define ISOTP_CF_MAX_DATA       7
+
+static constexpr uint32_t ISOTP_TIMEOUT_US = (uint32_t)ISOTP_TIMEOUT_MS * 1000UL;
+
+IsoTpLink::IsoTpLink()
+    : _configured(false)
+    , _extended(false)
+    , _txId(0)
+    , _rxId(0)
+    , _padding(false)
+    , _padValue(0xCC)
+    , _fcBlockSize(0)
+    , _fcStMin(0)
+    , _txState(IsoTpTxState::Idle)
+    , _txLen(0)
+    , _txOffset(0)
+    , _txSn(0)
+    , _txBlockLeft(0)
+    , _txWaitCount(0)
+    , _txStMinUs(0)
+    , _txLastUs(0)
+    , _txResultPending(false)
+    , _txResult(ISOTP_RESULT_OK)
+    , _rxState(IsoTpRxState::Idle)
+    , _rxLen(0)
+    , _rxOffset(0)
+    , _rxSn(0)
+    , _rxBlockLeft(0)
+    , _rxLastUs(0)
+    , _fcPending(false)
+    , _rxErrorPending(false)
+    , _rxError(0)
+    , _pdusSentCount(0)
+    , _pdusReceivedCount(0)
+    , _errorCount(0)
+{
+}
+
+bool IsoTpLink::setAddress(uint32_t txId, uint32_t rxId, bool extended) {
+    uint32_t maxId = extended ? 0x1FFFFFFFUL : 0x7FFUL;
+    if (txId > maxId || rxId > maxId) {
+        return false;
+    }
+
+    clearAddress();
+    _txId = txId;
+    _rxId = rxId;
+    _extended = extended;
+    _configured = true;
+    return true;
+}
+
+void IsoTpLink::clearAddress() {
+    abort();
+    _rxState = IsoTpRxState::Idle;
+    _txResultPending = false;
+    _rxErrorPending = false;
+    _configured = false;
+}
+
+bool IsoTpLink::isConfigured() const {
+    return _configured;
+}
+
+uint32_t IsoTpLink::getTxId() const {
+    return _txId;
+}
+
+uint32_t IsoTpLink::getRxId() const {
+    return _rxId;
+}
+
+bool IsoTpLink::isExtended() const {
+    return _extended;
+}
+
+void IsoTpLink::setFlowControl(uint8_t blockSize, uint8_t stMin) {
+    _fcBlockSize = blockSize;
+    _fcStMin = stMin;
+}
+
+void IsoTpLink::setPadding(bool enabled, uint8_t value) {
+    _padding = enabled;
+    _padValue = value;
+}
+
+bool IsoTpLink::append(const uint8_t* data, uint16_t len) {
+    if (_txState != IsoTpTxState::Idle || len > ISOTP_MAX_PDU_SIZE - _txLen) {
+        return false;
+    }
+    memcpy(_txBuf + _txLen, data, len);
+    _txLen += len;
+    return true;
+}
+
+uint16_t IsoTpLink::getStagedLength() const {
+    return _txLen;
+}
+
+bool IsoTpLink::startSend(ICANBackend& can, uint32_t nowUs) {
+    if (!_configured || _txState != IsoTpTxState::Idle || _txLen == 0) {
+        return false;
+    }
+
+    _txOffset = 0;
+    _txSn = 1;
+    _txWaitCount = 0;
+    _txResultPending = false;
+    _txState = IsoTpTxState::SendFirst;
+    serviceTx(can, nowUs);
+    return true;
+}
+
+bool IsoTpLink::handleFrame(const CANFrame& frame, ICANBackend& can, uint32_t nowUs) {
+    const uint8_t* d = frame.data;
+    uint8_t dlc = frame.dlc > 8 ? 8 : frame.dlc;
+
+    switch (d[0] >> 4) {
+        case ISOTP_PCI_SINGLE: {
+            uint8_t len = d[0] & 0x0F;
+            if (len == 0 || len >= dlc) {
+                return true;  // Malformed, ignored
+            }
+            if (_rxState == IsoTpRxState::Complete) {
+                return false;  // Previous PDU still held
+            }
+            if (_rxState == IsoTpRxState::Receiving) {
+                failRx(ISOTP_ERROR_UNEXPECTED);
+            }
+            memcpy(_rxBuf, d + 1, len);
+            _rxLen = len;
+            _rxState = IsoTpRxState::Complete;
+            _pdusReceivedCount++;
+            return true;
+        }
+
+        case ISOTP_PCI_FIRST: {
+            uint16_t len = (uint16_t)(((d[0] & 0x0F) << 8) | d[1]);
+            if (dlc < 8 || len <= ISOTP_SF_MAX_DATA) {
+                return true;  // A short PDU must be a single frame, ignored
+            }
+            if (_rxState == IsoTpRxState::Complete) {
+                return false;
+            }
+            if (_rxState == IsoTpRxState::Receiving) {
+                failRx(ISOTP_ERROR_UNEXPECTED);
+            }
+            if (len > ISOTP_MAX_PDU_SIZE) {
+                // Refuse it; no retry if the TX queue is full, the sender times out
+                sendFlowControl(can, ISOTP_FS_OVERFLOW);
+                failRx(ISOTP_ERROR_RX_OVERFLOW);
+                return true;
+            }
+            memcpy(_rxBuf, d + 2, ISOTP_FF_DATA);
+            _rxLen = len;
+            _rxOffset = ISOTP_FF_DATA;
+            _rxSn = 1;
+            _rxBlockLeft = _fcBlockSize;
+            _rxLastUs = nowUs;
+            _rxState = IsoTpRxState::Receiving;
+            _fcPending = !sendFlowControl(can, ISOTP_FS_CTS);
+            return true;
+        }
+
+        case ISOTP_PCI_CONSECUTIVE: {
+            if (_rxState != IsoTpRxState::Receiving) {
+                return true;  // Not expecting one, ignored
+            }
+            if ((d[0] & 0x0F) != _rxSn) {
+                failRx(ISOTP_ERROR_WRONG_SN);
+                return true;
+            }
+            uint16_t n = _rxLen - _rxOffset;
+            if (n > ISOTP_CF_MAX_DATA) n = ISOTP_CF_MAX_DATA;
+            if (n > (uint16_t)(dlc - 1)) n = dlc - 1;
+            memcpy(_rxBuf + _rxOffset, d + 1, n);
+            _rxOffset += n;
+            _rxSn = (_rxSn + 1) & 0x0F;
+            _rxLastUs = nowUs;
+
+            if (_rxOffset >= _rxLen) {
+                _rxState = IsoTpRxState::Complete;
+                _fcPending = false;
+                _pdusReceivedCount++;
+            } else if (_fcBlockSize > 0 && --_rxBlockLeft == 0) {
+                // Block done: let the sender continue
+                _rxBlockLeft = _fcBlockSize;
+                _fcPending = !sendFlowControl(can, ISOTP_FS_CTS);
+            }
+            return true;
+        }
+
+        case ISOTP_PCI_FLOW_CONTROL:
+            handleFlowControl(frame, nowUs);
+            if (_txState == IsoTpTxState::SendConsecutive) {
+                serviceTx(can, nowUs);
+            }
+            return true;
+
+        default:
+            return true;  // Reserved PCI, ignored
+    }
+}
+
+void IsoTpLink::poll(ICANBackend& can, uint32_t nowUs) {
+    if (_rxState == IsoTpRxState::Receiving) {
+        if (_fcPending && sendFlowControl(can, ISOTP_FS_CTS)) {
+            _fcPending = false;
+            _rxLastUs = nowUs;  // N_Cr runs from the flow control frame
+        }
+        if (nowUs - _rxLastUs >= ISOTP_TIMEOUT_US) {
+            failRx(ISOTP_ERROR_CF_TIMEOUT);
+        }
+    }
+
+    if (_txState != IsoTpTxState::Idle) {
+        serviceTx(can, nowUs);
+    }
+}
+
+void IsoTpLink::abort() {
+    if (_txState != IsoTpTxState::Idle) {
+        finishTx(ISOTP_ERROR_ABORTED);
+    }
+    _txLen = 0;
+    if (_rxState == IsoTpRxState::Receiving) {
+        _rxState = IsoTpRxState::Idle;
+    }
+    _fcPending = false;
+}
+
+IsoTpTxState IsoTpLink::getTxState() const {
+    return _txState;
+}
+
+IsoTpRxState IsoTpLink::getRxState() const {
+    return _rxState;
+}
+
+bool IsoTpLink::takeTxResult(uint8_t* code) {
+    if (!_txResultPending) {
+        return false;
+    }
+    _txResultPending = false;
+    if (code) *code = _txResult;
+    return true;
+}
+
+bool IsoTpLink::takeRxError(uint8_t* code) {
+    if (!_rxErrorPending) {
+        return false;
+    }
+    _rxErrorPending = false;
+    if (code) *code = _rxError;
+    return true;
+}
+
+const uint8_t* IsoTpLink::getRxPdu(uint16_t* len) const {
+    if (_rxState != IsoTpRxState::Complete) {
+        return nullptr;
+    }
+    if (len) *len = _rxLen;
+    return _rxBuf;
+}
+
+void IsoTpLink::releaseRx() {
+    if (_rxState == IsoTpRxState::Complete) {
+        _rxState = IsoTpRxState::Idle;
+    }
+}
+
+void IsoTpLink::getCounters(uint32_t* pdusSent, uint32_t* pdusReceived, uint32_t* errors) const {
+    if (pdusSent) *pdusSent = _pdusSentCount;
+    if (pdusReceived) *pdusReceived = _pdusReceivedCount;
+    if (errors) *errors = _errorCount;
+}
+
+void IsoTpLink::resetCounters() {
+    _pdusSentCount = 0;
+    _pdusReceivedCount = 0;
+    _errorCount = 0;
+}
+
+uint32_t IsoTpLink::stMinToUs(uint8_t stMin) {
+    if (stMin <= 0x7F) {
+        return (uint32_t)stMin * 1000UL;
+    }
+    if (stMin >= 0xF1 && stMin <= 0xF9) {
+        return (uint32_t)(stMin - 0xF0) * 100UL;
+    }
+    return 127000UL;  // Reserved values: use the longest separation
+}
+
+void IsoTpLink::serviceTx(ICANBackend& can, uint32_t nowUs) {
+    uint8_t payload[8];
+
+    switch (_txState) {
+        case IsoTpTxState::SendFirst:
+            if (_txLen <= ISOTP_SF_MAX_DATA) {
+                payload[0] = (uint8_t)_txLen;
+                memcpy(payload + 1, _txBuf, _txLen);
+                if (writeFrame(can, payload, (uint8_t)(_txLen + 1))) {
+                    finishTx(ISOTP_RESULT_OK);
+                }
+            } else {
+                payload[0] = (uint8_t)((ISOTP_PCI_FIRST << 4) | (_txLen >> 8));
+                payload[1] = (uint8_t)(_txLen & 0xFF);
+                memcpy(payload + 2, _txBuf, ISOTP_FF_DATA);
+                if (writeFrame(can, payload, 8)) {
+                    _txOffset = ISOTP_FF_DATA;
+                    _txLastUs = nowUs;
+                    _txState = IsoTpTxState::WaitFlowControl;
+                }
+            }
+            break;  // TX queue full: retried on the next poll
+
+        case IsoTpTxState::WaitFlowControl:
+            if (nowUs - _txLastUs >= ISOTP_TIMEOUT_US) {
+                finishTx(ISOTP_ERROR_FC_TIMEOUT);
+            }
+            break;
+
+        case IsoTpTxState::SendConsecutive:
+            // As many frames as STmin and the TX queue allow
+            while (nowUs - _txLastUs >= _txStMinUs) {
+                uint16_t n = _txLen - _txOffset;
+                if (n > ISOTP_CF_MAX_DATA) n = ISOTP_CF_MAX_DATA;
+                payload[0] = (uint8_t)((ISOTP_PCI_CONSECUTIVE << 4) | _txSn);
+                memcpy(payload + 1, _txBuf + _txOffset, n);
+                if (!writeFrame(can, payload, (uint8_t)(n + 1))) {
+                    break;
+                }
+                _txOffset += n;
+                _txSn = (_txSn + 1) & 0x0F;
+                _txLastUs = nowUs;
+
+                if (_txOffset >= _txLen) {
+                    finishTx(ISOTP_RESULT_OK);
+                    break;
+                }
+                if (_txBlockLeft > 0 && --_txBlockLeft == 0) {
+                    _txState = IsoTpTxState::WaitFlowControl;
+                    break;
+                }
+                if (_txStMinUs > 0) {
+                    break;  // Next frame after STmin
+                }
+            }
+            break;
+
+        case IsoTpTxState::Idle:
+            break;
+    }
+}
+
+void IsoTpLink::finishTx(uint8_t result) {
+    _txState = IsoTpTxState::Idle;
+    _txLen = 0;
+    _txResult = result;
+    _txResultPending = true;
+    if (result == ISOTP_RESULT_OK) {
+        _pdusSentCount++;
+    } else {
+        _errorCount++;
+    }
+}
+
+void IsoTpLink::failRx(uint8_t error) {
+    _rxState = IsoTpRxState::Idle;
+    _fcPending = false;
+    _rxError = error;
+    _rxErrorPending = true;
+    _errorCount++;
+}
+
+void IsoTpLink::handleFlowControl(const CANFrame& frame, uint32_t nowUs) {
+    if (_txState != IsoTpTxState::WaitFlowControl) {
+        return;  // Not waiting for one, ignored
+    }
+    if (frame.dlc < 3) {
+        finishTx(ISOTP_ERROR_FC_INVALID);
+        return;
+    }
+
+    switch (frame.data[0] & 0x0F) {
+        case ISOTP_FS_CTS:
+            _txBlockLeft = frame.data[1];
+            _txStMinUs = stMinToUs(frame.data[2]);
+            _txWaitCount = 0;
+            _txLastUs = nowUs - _txStMinUs;  // First frame of the block goes now
+            _txState = IsoTpTxState::SendConsecutive;
+            break;
+
+        case ISOTP_FS_WAIT:
+            if (++_txWaitCount > ISOTP_MAX_WAIT_FRAMES) {
+                finishTx(ISOTP_ERROR_FC_WAIT);
+            } else {
+                _txLastUs = nowUs;  // N_Bs restarts
+            }
+            break;
+
+        case ISOTP_FS_OVERFLOW:
+            finishTx(ISOTP_ERROR_FC_OVERFLOW);
+            break;
+
+        default:
+            finishTx(ISOTP_ERROR_FC_INVALID);
+            break;
+    }
+}
+
+bool IsoTpLink::sendFlowControl(ICANBackend& can, uint8_t status) {
+    uint8_t payload[3] = {
+        (uint8_t)((ISOTP_PCI_FLOW_CONTROL << 4) | status), _fcBlockSize, _fcStMin
+    };
+    return writeFrame(can, payload, sizeof(payload));
+}
+
+bool IsoTpLink::writeFrame(ICANBackend& can, const uint8_t* payload, uint8_t len) {
+    CANFrame frame;
+    frame.id = _txId;
+    frame.extended = _extended;
+    memcpy(frame.data, payload, len);
+    if (_padding) {
+        memset(frame.data + len, _padValue, 8 - len);
+        len = 8;
+    }
+    frame.dlc = len;
+    return can.write(frame);
+}
@@ -0,0 +1,252 @@
+/**
+ * ISO-TP Link
+ *
+ * ISO 15765-2 transport protocol engine for one address pair, normal
+ * addressing on classical CAN: segmentation into single/first/
+ * consecutive frames, flow control and the timing between them, and
+ * reassembly of received PDUs.
+ */
+
+#ifndef ISOTP_LINK_H
+#define ISOTP_LINK_H
+
+#include "config.h"
+#include "CANBackend.h"
+#include <stdint.h>
+
+#ifndef ISOTP_MAX_PDU_SIZE
+#define ISOTP_MAX_PDU_SIZE      1024
+#endif
+
+#ifndef ISOTP_TIMEOUT_MS
+#define ISOTP_TIMEOUT_MS        1000
+#endif
+
+#ifndef ISOTP_MAX_WAIT_FRAMES
+#define ISOTP_MAX_WAIT_FRAMES   10
+#endif
+
+static_assert(ISOTP_MAX_PDU_SIZE >= 8 && ISOTP_MAX_PDU_SIZE <= 4095,
+              "ISOTP_MAX_PDU_SIZE must be 8..4095 (12-bit first frame length)");
+
+// Result / error codes (It and Ie events, see IsoTpHandler.h)
+#define ISOTP_RESULT_OK             0x00
+#define ISOTP_ERROR_FC_TIMEOUT      0x01    // N_Bs: no flow control frame in time
+#define ISOTP_ERROR_FC_OVERFLOW     0x02    // Receiver refused the PDU (FS = overflow)
+#define ISOTP_ERROR_FC_WAIT         0x03    // More than ISOTP_MAX_WAIT_FRAMES FC WAIT frames
+#define ISOTP_ERROR_FC_INVALID      0x04    // Flow control frame with a reserved status
+#define ISOTP_ERROR_CF_TIMEOUT      0x05    // N_Cr: no consecutive frame in time
+#define ISOTP_ERROR_WRONG_SN        0x06    // Consecutive frame out of sequence
+#define ISOTP_ERROR_RX_OVERFLOW     0x07    // Incoming PDU larger than ISOTP_MAX_PDU_SIZE
+#define ISOTP_ERROR_UNEXPECTED      0x08    // New PDU started before the last one finished
+#define ISOTP_ERROR_ABORTED         0x09    // Cancelled by the host
+
+enum class IsoTpTxState : uint8_t {
+    Idle,               // Nothing in flight (data may be staged)
+    SendFirst,          // Single or first frame waiting for the TX queue
+    WaitFlowControl,    // First frame or block sent, waiting for FC
+    SendConsecutive     // Sending consecutive frames
+};
+
+enum class IsoTpRxState : uint8_t {
+    Idle,               // Waiting for a single or first frame
+    Receiving,          // First frame seen, collecting consecutive frames
+    Complete            // Reassembled PDU waiting for releaseRx()
+};
+
+/**
+ * ISO-TP protocol engine.
+ *
+ * Transmit: the PDU is staged with append() and sent with startSend().
+ * Frames go to the backend's TX queue from startSend() and poll(); a
+ * frame the queue refuses is retried on the next poll(). Consecutive
+ * frames honour the receiver's block size and STmin (measured between
+ * the frames handed to the TX queue).
+ *
+ * Receive: frames on the RX ID are passed to handleFrame(). A complete
+ * PDU is held until releaseRx(); while it is held, frames that start a
+ * new PDU are refused (left for a later call) so nothing is lost.
+ *
+ * Frames are padded to 8 bytes when padding is on; without it they are
+ * as short as the payload allows.
+ */
+class IsoTpLink {
+public:
+    IsoTpLink();
+
+    /**
+     * Set the address pair. Aborts any transfer and clears staged data.
+     * @param txId ID we send on (requests, flow control)
+     * @param rxId ID we receive on
+     * @param extended true for 29-bit IDs
+     * @return true if both IDs are valid for the ID type
+     */
+    bool setAddress(uint32_t txId, uint32_t rxId, bool extended);
+
+    /**
+     * Forget the address pair (link disabled). Aborts any transfer.
+     */
+    void clearAddress();
+
+    bool isConfigured() const;
+    uint32_t getTxId() const;
+    uint32_t getRxId() const;
+    bool isExtended() const;
+
+    /**
+     * Set the flow control we send when receiving.
+     * @param blockSize Consecutive frames per block (0 = no further FC)
+     * @param stMin Minimum separation time byte (ISO 15765-2 encoding)
+     */
+    void setFlowControl(uint8_t blockSize, uint8_t stMin);
+
+    /**
+     * Pad every frame to 8 bytes.
+     * @param enabled true to pad
+     * @param value Fill byte
+     */
+    void setPadding(bool enabled, uint8_t value);
+
+    /**
+     * Append bytes to the PDU to be sent (only while TX is idle).
+     * @return false if TX is busy or the PDU would exceed ISOTP_MAX_PDU_SIZE
+     */
+    bool append(const uint8_t* data, uint16_t len);
+
+    uint16_t getStagedLength() const;
+
+    /**
+     * Start sending the staged PDU.
+     * @param can Backend to write to
+     * @param nowUs Current time (micros())
+     * @return false if not configured, TX busy or nothing staged
+     */
+    bool startSend(ICANBackend& can, uint32_t nowUs);
+
+    /**
+     * Check whether a received frame belongs to this link.
+     */
+    bool accepts(const CANFrame& frame) const {
+        return _configured && frame.id == _rxId && frame.extended == _extended
+            && !frame.rtr && !frame.echo && frame.dlc > 0;
+    }
+
+    /**
+     * Process a frame from the RX ID (see accepts()).
+     * @param frame Received frame
+     * @param can Backend for flow control frames
+     * @param nowUs Current time (micros())
+     * @return false if the frame must be offered again later (a complete
+     *         PDU is still held)
+     */
+    bool handleFrame(const CANFrame& frame, ICANBackend& can, uint32_t nowUs);
+
+    /**
+     * Send due frames and check timeouts. Call once per main loop iteration.
+     */
+    void poll(ICANBackend& can, uint32_t nowUs);
+
+    /**
+     * Cancel both directions and clear staged data.
+     * A transmission in flight reports ISOTP_ERROR_ABORTED; a PDU that is
+     * already complete is kept until releaseRx().
+     */
+    void abort();
+
+    IsoTpTxState getTxState() const;
+    IsoTpRxState getRxState() const;
+
+    /**
+     * Take the result of the last finished transmission.
+     * @param code Output: ISOTP_RESULT_OK or an ISOTP_ERROR_ code
+     * @return true if a result was pending
+     */
+    bool takeTxResult(uint8_t* code);
+
+    /**
+     * Take the last reception error.
+     * @param code Output: ISOTP_ERROR_ code
+     * @return true if an error was pending
+     */
+    bool takeRxError(uint8_t* code);
+
+    /**
+     * Get the reassembled PDU (RX state Complete).
+     * @param len Output: PDU length
+     * @return PDU bytes, or nullptr if none is complete
+     */
+    const uint8_t* getRxPdu(uint16_t* len) const;
+
+    /**
+     * Drop the complete PDU so the next one can be received.
+     */
+    void releaseRx();
+
+    /**
+     * Get diagnostic counters.
+     * @param pdusSent Output: PDUs fully handed to the TX queue
+     * @param pdusReceived Output: PDUs reassembled
+     * @param errors Output: transfers that failed (either direction)
+     */
+    void getCounters(uint32_t* pdusSent, uint32_t* pdusReceived, uint32_t* errors) const;
+
+    /**
+     * Reset diagnostic counters.
+     */
+    void resetCounters();
+
+    /**
+     * Convert an STmin byte to microseconds (reserved values mean 127 ms).
+     */
+    static uint32_t stMinToUs(uint8_t stMin);
+
+private:
+    bool _configured;
+    bool _extended;
+    uint32_t _txId;
+    uint32_t _rxId;
+    bool _padding;
+    uint8_t _padValue;
+    uint8_t _fcBlockSize;       // Sent in our flow control frames
+    uint8_t _fcStMin;
+
+    // Transmit
+    IsoTpTxState _txState;
+    uint8_t _txBuf[ISOTP_MAX_PDU_SIZE];
+    uint16_t _txLen;
+    uint16_t _txOffset;         // Next byte to send
+    uint8_t _txSn;              // Next sequence number
+    uint8_t _txBlockLeft;       // CFs left in this block (0 = unlimited)
+    uint8_t _txWaitCount;       // FC WAIT frames in this transfer
+    uint32_t _txStMinUs;        // Receiver's separation time
+    uint32_t _txLastUs;         // FC wait start, or last CF queued
+    bool _txResultPending;
+    uint8_t _txResult;
+
+    // Receive
+    IsoTpRxState _rxState;
+    uint8_t _rxBuf[ISOTP_MAX_PDU_SIZE];
+    uint16_t _rxLen;            // PDU length (from SF/FF)
+    uint16_t _rxOffset;         // Bytes received
+    uint8_t _rxSn;              // Expected sequence number
+    uint8_t _rxBlockLeft;       // CFs left before our next FC
+    uint32_t _rxLastUs;         // Last frame of this PDU
+    bool _fcPending;            // FC refused by the TX queue, retry in poll()
+    uint8_t _fcStatus;
+    bool _rxErrorPending;
+    uint8_t _rxError;
+
+    // Diagnostic counters
+    uint32_t _pdusSentCount;
+    uint32_t _pdusReceivedCount;
+    uint32_t _errorCount;
+
+    void serviceTx(ICANBackend& can, uint32_t nowUs);
+    void finishTx(uint8_t result);
+    void failRx(uint8_t error);
+    void handleFlowControl(const CANFrame& frame, uint32_t nowUs);
+    bool sendFlowControl(ICANBackend& can, uint8_t status);
+    bool writeFrame(ICANBackend& can, const uint8_t* payload, uint8_t len);
+};
+
+#endif // ISOTP_LINK_H
@@ -0,0 +1,57 @@
+/**
+ * Hot-Path Profiler Implementation
+ */
+
+#include "Profiler.h"
+
+#if ENABLE_PROFILER
+
+#include <string.h>
+
+ProfileStats Profiler::s_stats[(uint8_t)ProfileProbe::Count];
+
+void Profiler::begin() {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    reset();
+}
+
+void Profiler::record(ProfileProbe probe, uint32_t elapsed) {
+    ProfileStats& s = s_stats[(uint8_t)probe];
+    s.count++;
+    s.totalCycles += elapsed;
+    if (elapsed < s.minCycles) s.minCycles = elapsed;
+    if (elapsed > s.maxCycles) s.maxCycles = elapsed;
+
+    uint16_t& bucket = s.histogram[bucketFor(elapsed)];
+    if (bucket != UINT16_MAX) {
+        bucket++;
+    }
+}
+
+uint8_t Profiler::bucketFor(uint32_t elapsed) {
+    // Bit width 1-6 (< 64) is bucket 0, then two bits per bucket
+    uint8_t width = elapsed ? (uint8_t)(32 - __builtin_clz(elapsed)) : 0;
+    if (width <= 6) {
+        return 0;
+    }
+    uint8_t bucket = (uint8_t)((width - 5) / 2);
+    return bucket < PROFILE_HISTOGRAM_BUCKETS ? bucket : PROFILE_HISTOGRAM_BUCKETS - 1;
+}
+
+const ProfileStats* Profiler::getStats(uint8_t index) {
+    if (index >= (uint8_t)ProfileProbe::Count) {
+        return nullptr;
+    }
+    return &s_stats[index];
+}
+
+void Profiler::reset() {
+    memset(s_stats, 0, sizeof(s_stats));
+    for (uint8_t i = 0; i < (uint8_t)ProfileProbe::Count; i++) {
+        s_stats[i].minCycles = UINT32_MAX;
+    }
+}
+
+#endif // ENABLE_PROFILER
@@ -0,0 +1,132 @@
+/**
+ * Hot-Path Profiler
+ *
+ * Cycle-accurate timing of the main loop stages using the Cortex-M4 DWT
+ * cycle counter. Compiled in only when ENABLE_PROFILER is set; otherwise
+ * PROFILE_SCOPE() expands to nothing and the probes cost no code.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "config.h"
+#include <stdint.h>
+
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER 0
+#endif
+
+/**
+ * Profiled stages. The numeric value is the index used by the SLCAN
+ * y command, so only append new probes.
+ */
+enum class ProfileProbe : uint8_t {
+    Loop = 0,       // One whole loop() iteration
+    SerialIngest,   // SerialTransport::readLine() (USB read + line scan)
+    Dispatch,       // ProtocolDispatcher::dispatch() of one command
+    FrameBusFill,   // Backend RX rings -> shared frame bus
+    Format,         // SLCAN::formatFrame() of one RX frame
+    SerialWrite,    // writeWithPriority() of one response or RX line
+    Flush,          // transport.flushBatch()
+    Count
+};
+
+// Histogram buckets: < 64 cycles, then powers of 4 up to >= 256k cycles
+#define PROFILE_HISTOGRAM_BUCKETS 8
+
+/**
+ * Accumulated timing of one probe (all times in CPU cycles).
+ */
+struct ProfileStats {
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint16_t histogram[PROFILE_HISTOGRAM_BUCKETS];  // Saturating counts
+};
+
+#if ENABLE_PROFILER
+
+#include <Arduino.h>
+
+/**
+ * Profiler state (one set of statistics per ProfileProbe).
+ *
+ * Probes may only run in the main loop; statistics are not protected
+ * against interrupts.
+ */
+class Profiler {
+public:
+    /**
+     * Start the DWT cycle counter and clear all statistics.
+     */
+    static void begin();
+
+    /**
+     * Current cycle count (wraps every 2^32 cycles, ~89 s at 48 MHz).
+     */
+    static uint32_t cycles() {
+        return DWT->CYCCNT;
+    }
+
+    /**
+     * Add one measurement to a probe.
+     * @param probe Probe to update
+     * @param elapsed Cycles spent
+     */
+    static void record(ProfileProbe probe, uint32_t elapsed);
+
+    /**
+     * Get the statistics of a probe.
+     * @param index Probe index (ProfileProbe value)
+     * @return Pointer to the statistics, or nullptr if index is out of range
+     */
+    static const ProfileStats* getStats(uint8_t index);
+
+    /**
+     * Clear all statistics.
+     */
+    static void reset();
+
+    /**
+     * Map a duration to its histogram bucket.
+     * @param elapsed Cycles spent
+     * @return Bucket index (0..PROFILE_HISTOGRAM_BUCKETS-1)
+     */
+    static uint8_t bucketFor(uint32_t elapsed);
+
+private:
+    static ProfileStats s_stats[(uint8_t)ProfileProbe::Count];
+};
+
+/**
+ * Records the cycles between construction and destruction.
+ */
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileProbe probe)
+        : _probe(probe)
+        , _start(Profiler::cycles())
+    {
+    }
+
+    ~ProfileScope() {
+        Profiler::record(_probe, Profiler::cycles() - _start);
+    }
+
+private:
+    ProfileProbe _probe;
+    uint32_t _start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b)  PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(probe)  ProfileScope PROFILE_CONCAT(_profileScope, __LINE__)(probe)
+
+#else
+
+#define PROFILE_SCOPE(probe)  ((void)0)
+
+#endif // ENABLE_PROFILER
+
+#endif // PROFILER_H
@@ -0,0 +1,168 @@
+/**
+ * Binary Stream Protocol Handler Implementation
+ */
+
+#include "BinaryStream.h"
+#include "Transport.h"
+#include <string.h>
+
+BinaryStream::BinaryStream(ICANBackend& can, ProtocolDispatcher& dispatcher)
+    : _can(can)
+    , _dispatcher(dispatcher)
+    , _previousOwner(nullptr)
+    , _streaming(false)
+    , _bus(nullptr)
+    , _busReader(FRAME_BUS_NO_READER)
+    , _framesSentCount(0)
+    , _frameDropCount(0)
+{
+}
+
+const char* BinaryStream::getName() const {
+    return "BINARY";
+}
+
+bool BinaryStream::canHandle(const char* cmd) const {
+    return cmd != nullptr && cmd[0] == 'B';
+}
+
+bool BinaryStream::processCommand(const char* cmd, char* response, size_t maxLen) {
+    if (cmd == nullptr || response == nullptr || maxLen < 3) {
+        return false;
+    }
+
+    switch (cmd[1]) {
+        case '\0':
+            // Query: B0 or B1
+            response[0] = 'B';
+            response[1] = _streaming ? '1' : '0';
+            response[2] = '\0';
+            return true;
+
+        case '1':
+            if (cmd[2] != '\0') {
+                break;
+            }
+            if (!_streaming) {
+                _previousOwner = _dispatcher.getStreamOwner();
+                _dispatcher.setStreamOwner(this);
+            }
+            response[0] = '\0';
+            return true;
+
+        case '0':
+            if (cmd[2] != '\0') {
+                break;
+            }
+            if (_streaming) {
+                _dispatcher.setStreamOwner(_previousOwner);
+                _previousOwner = nullptr;
+            }
+            response[0] = '\0';
+            return true;
+
+        default:
+            break;
+    }
+
+    response[0] = '\x07';  // BELL - error
+    response[1] = '\0';
+    return true;
+}
+
+void BinaryStream::poll(ITransport* transport) {
+    if (transport == nullptr || !_streaming || _bus == nullptr || !_can.isOpen()) {
+        return;
+    }
+    if (!transport->isConnected()) {
+        return;  // No host yet: frames wait on the bus
+    }
+
+    // Forward within the scheduler's time budget, at least one frame per poll
+    uint16_t framesProcessed = 0;
+    while (framesProcessed == 0 || _bus->forwardTimeLeft()) {
+        const CANFrame* frame = _bus->peek(_busReader);
+        if (frame == nullptr) {
+            break;  // Nothing pending for us
+        }
+
+        uint8_t record[BINSTREAM_MAX_FRAME_RECORD_LEN];
+        size_t len = encodeFrame(*frame, record, sizeof(record));
+        if (len > 0 &&
+            !transport->writeWithPriority((const char*)record, len, WritePriority::CAN_RX_FRAME)) {
+            _frameDropCount++;
+            break;  // USB blocked, frame stays on the bus for the next poll
+        }
+
+        _bus->consume(_busReader);
+        _framesSentCount++;
+        framesProcessed++;
+    }
+}
+
+bool BinaryStream::isActive() const {
+    return _streaming;
+}
+
+void BinaryStream::onStreamOwnership(bool owner) {
+    _streaming = owner;
+    if (_bus != nullptr) {
+        _bus->setReaderEnabled(_busReader, owner);
+    }
+}
+
+void BinaryStream::attachFrameBus(FrameBus* bus, uint8_t reader) {
+    _bus = bus;
+    _busReader = reader;
+    if (_bus != nullptr) {
+        _bus->setReaderEnabled(_busReader, _streaming);
+    }
+}
+
+size_t BinaryStream::encodeFrame(const CANFrame& frame, uint8_t* buffer, size_t maxLen) {
+    uint8_t dlc = frame.dlc > 8 ? 8 : frame.dlc;
+    uint8_t dataLen = frame.rtr ? 0 : dlc;
+    uint8_t idLen = frame.extended ? 4 : 2;
+    size_t total = BINSTREAM_HEADER_LEN + 1 + idLen + 4 + dataLen;
+
+    if (buffer == nullptr || total > maxLen) {
+        return 0;
+    }
+
+    uint8_t flags = dlc | (BINSTREAM_TS_32 << BINSTREAM_FLAG_TS_SHIFT);
+    if (frame.extended) flags |= BINSTREAM_FLAG_EXT;
+    if (frame.rtr)      flags |= BINSTREAM_FLAG_RTR;
+
+    size_t pos = 0;
+    buffer[pos++] = BINSTREAM_SYNC;
+    buffer[pos++] = (uint8_t)(total - 2);   // Bytes after LEN
+    buffer[pos++] = frame.echo ? BINSTREAM_TYPE_TX_ECHO : BINSTREAM_TYPE_CAN_FRAME;
+    buffer[pos++] = flags;
+
+    uint32_t id = frame.id;
+    for (uint8_t i = 0; i < idLen; i++) {
+        buffer[pos++] = (uint8_t)(id & 0xFF);
+        id >>= 8;
+    }
+
+    uint32_t ts = frame.timestamp;
+    for (uint8_t i = 0; i < 4; i++) {
+        buffer[pos++] = (uint8_t)(ts & 0xFF);
+        ts >>= 8;
+    }
+
+    memcpy(buffer + pos, frame.data, dataLen);
+    pos += dataLen;
+
+    return pos;
+}
+
+void BinaryStream::getCounters(uint32_t* framesSent, uint32_t* frameDrops) const {
+    if (framesSent) *framesSent = _framesSentCount;
+    if (frameDrops) *frameDrops = _frameDropCount;
+}
+
+void BinaryStream::resetCounters() {
+    _framesSentCount = 0;
+    _frameDropCount = 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * Binary Stream Protocol Handler
+ *
+ * Forwards received CAN frames as compact binary records (see
+ * BinaryStreamFormat.h) instead of SLCAN ASCII lines.
+ */
+
+#ifndef BINARY_STREAM_H
+#define BINARY_STREAM_H
+
+#include "config.h"
+#include "ProtocolHandler.h"
+#include "ProtocolDispatcher.h"
+#include "FrameBus.h"
+#include "CANBackend.h"
+#include "BinaryStreamFormat.h"
+#include <stdint.h>
+
+/**
+ * Binary streaming protocol handler.
+ *
+ * Registered next to SLCAN. SLCAN keeps channel control (S, O, C, t, ...);
+ * this handler only takes over the RX frame stream while selected:
+ *
+ *   B1 : Stream received frames as binary records
+ *   B0 : Return the stream to the previous owner (SLCAN ASCII)
+ *   B  : Query current mode (responds B0 or B1)
+ *
+ * Frames are read in place from the dispatcher's shared frame bus, the
+ * same frames SLCAN sees. Only the dispatcher's stream owner writes them
+ * to the transport, so ASCII and binary output never interleave.
+ */
+class BinaryStream : public IProtocolHandler {
+public:
+    /**
+     * Constructor.
+     * @param can Reference to the CAN backend
+     * @param dispatcher Dispatcher used to take over the RX stream
+     */
+    BinaryStream(ICANBackend& can, ProtocolDispatcher& dispatcher);
+
+    // IProtocolHandler interface
+    const char* getName() const override;
+    bool canHandle(const char* cmd) const override;
+    bool processCommand(const char* cmd, char* response, size_t maxLen) override;
+    void poll(ITransport* transport) override;
+    bool isActive() const override;
+    void onStreamOwnership(bool owner) override;
+    void attachFrameBus(FrameBus* bus, uint8_t reader) override;
+
+    /**
+     * Encode a CAN frame as a binary record.
+     * @param frame The CAN frame to encode
+     * @param buffer Output buffer
+     * @param maxLen Maximum buffer size
+     * @return Number of bytes written, or 0 if the buffer is too small
+     */
+    static size_t encodeFrame(const CANFrame& frame, uint8_t* buffer, size_t maxLen);
+
+    /**
+     * Get diagnostic counters.
+     * @param framesSent Output: frame records written to the transport
+     * @param frameDrops Output: record writes refused by the transport (frame stays on the bus)
+     */
+    void getCounters(uint32_t* framesSent, uint32_t* frameDrops) const;
+
+    /**
+     * Reset diagnostic counters.
+     */
+    void resetCounters();
+
+private:
+    ICANBackend& _can;
+    ProtocolDispatcher& _dispatcher;
+    IProtocolHandler* _previousOwner;   // Restored by B0
+    bool _streaming;                    // We currently own the RX stream
+
+    // Cursor on the dispatcher's shared RX frame bus
+    FrameBus* _bus;
+    uint8_t _busReader;
+
+    // Diagnostic counters
+    uint32_t _framesSentCount;
+    uint32_t _frameDropCount;
+};
+
+#endif // BINARY_STREAM_H
@@ -0,0 +1,86 @@
+/**
+ * Binary Stream Record Format
+ *
+ * Compact length-prefixed records used by the BinaryStream handler to
+ * forward received CAN frames without ASCII hex encoding.
+ */
+
+#ifndef BINARY_STREAM_FORMAT_H
+#define BINARY_STREAM_FORMAT_H
+
+// =============================================================================
+// Record Framing
+// =============================================================================
+
+/*
+ * Every record on the wire:
+ *   [SYNC][LEN][TYPE][payload...]
+ *   SYNC    = 0xA5
+ *   LEN     = number of bytes following LEN (TYPE + payload), 1..255
+ *   TYPE    = record type (see below)
+ *
+ * Command responses are still sent as SLCAN ASCII lines (7-bit, CR
+ * terminated) between records. They never contain 0xA5, so a host parser
+ * treats any byte outside a record as ASCII and 0xA5 as the start of the
+ * next record, skipping exactly LEN bytes.
+ *
+ * All multi-byte fields are little-endian.
+ */
+
+#define BINSTREAM_SYNC              0xA5
+#define BINSTREAM_HEADER_LEN        3       // SYNC + LEN + TYPE
+
+// Record types
+#define BINSTREAM_TYPE_CAN_FRAME    0x01    // Received CAN frame
+#define BINSTREAM_TYPE_TX_ECHO      0x02    // Transmitted CAN frame (TX echo, same payload)
+#define BINSTREAM_TYPE_DIAGNOSTICS  0x03    // Diagnostic counters (DB command)
+
+// =============================================================================
+// CAN Frame Record (TYPE 0x01, TX echo TYPE 0x02)
+// =============================================================================
+
+/*
+ * Payload:
+ *   [FLAGS][ID][TIMESTAMP][DATA]
+ *   FLAGS     bits 0-3 = DLC (0-8)
+ *             bit  4   = extended (29-bit) ID
+ *             bit  5   = RTR frame (no DATA)
+ *             bits 6-7 = timestamp size (0 = none, 1 = 16-bit ms, 2 = 32-bit us)
+ *   ID        2 bytes (standard) or 4 bytes (extended)
+ *   TIMESTAMP 0, 2 or 4 bytes, per FLAGS
+ *   DATA      DLC bytes
+ *
+ * The firmware sends 32-bit microsecond reception timestamps. TX echo
+ * records (SLCAN e1) carry the transmit completion time instead.
+ *
+ * Example: standard ID 0x123, DLC 2, data 11 22, timestamp 0x00012345 us:
+ *   A5 0A 01 82 23 01 45 23 01 00 11 22
+ */
+
+#define BINSTREAM_FLAG_DLC_MASK     0x0F
+#define BINSTREAM_FLAG_EXT          0x10
+#define BINSTREAM_FLAG_RTR          0x20
+#define BINSTREAM_FLAG_TS_SHIFT     6
+
+#define BINSTREAM_TS_NONE           0
+#define BINSTREAM_TS_16             1
+#define BINSTREAM_TS_32             2
+
+// Largest CAN frame record: header + flags + 4-byte ID + 4-byte timestamp + 8 data
+#define BINSTREAM_MAX_FRAME_RECORD_LEN  (BINSTREAM_HEADER_LEN + 1 + 4 + 4 + 8)
+
+// =============================================================================
+// Diagnostics Record (TYPE 0x03)
+// =============================================================================
+
+/*
+ * Payload:
+ *   [COUNT][VALUE 0]...[VALUE COUNT-1]
+ *   COUNT     number of values (1 byte)
+ *   VALUE     4 bytes each, in DiagValue order (lib/Diagnostics/Diagnostics.h)
+ *
+ * Sent once per DB command. Hosts should accept a larger COUNT than they
+ * know about and ignore the extra values.
+ */
+
+#endif // BINARY_STREAM_FORMAT_H
@@ -0,0 +1,85 @@
+/**
+ * Command Route Table
+ *
+ * 256-entry table mapping the first byte of a command line to the
+ * handler and function that serve it.
+ */
+
+#ifndef COMMAND_ROUTE_TABLE_H
+#define COMMAND_ROUTE_TABLE_H
+
+#include "ProtocolHandler.h"
+#include <stdint.h>
+
+// Slot value of an unrouted byte
+#define COMMAND_ROUTE_NO_SLOT 0xFF
+
+/**
+ * Command route table.
+ *
+ * Routes are added for one handler slot at a time: setSlot() selects the
+ * owner, then the handler's registerRoutes() fills in its prefixes. The
+ * first slot to claim a byte keeps it. A lookup is a single index.
+ */
+class CommandRouteTable : public ICommandRoutes {
+public:
+    CommandRouteTable() : _slot(COMMAND_ROUTE_NO_SLOT), _count(0) {
+        clear();
+    }
+
+    /**
+     * Remove every route.
+     */
+    void clear() {
+        for (unsigned i = 0; i < 256; i++) {
+            _fns[i] = nullptr;
+            _slots[i] = COMMAND_ROUTE_NO_SLOT;
+        }
+        _count = 0;
+    }
+
+    /**
+     * Select the handler slot that owns routes added from now on.
+     * @param slot Handler slot (COMMAND_ROUTE_NO_SLOT = reject adds)
+     */
+    void setSlot(uint8_t slot) {
+        _slot = slot;
+    }
+
+    bool addRoute(uint8_t prefix, CommandRouteFn fn) override {
+        if (prefix == 0 || fn == nullptr || _slot == COMMAND_ROUTE_NO_SLOT
+            || _fns[prefix] != nullptr) {
+            return false;
+        }
+        _fns[prefix] = fn;
+        _slots[prefix] = _slot;
+        _count++;
+        return true;
+    }
+
+    /**
+     * Look up the route for a command byte.
+     * @param prefix First command byte
+     * @param slot Output: handler slot that owns the route
+     * @return Route function, or nullptr if the byte is not routed
+     */
+    CommandRouteFn lookup(uint8_t prefix, uint8_t* slot) const {
+        *slot = _slots[prefix];
+        return _fns[prefix];
+    }
+
+    /**
+     * Get the number of routed bytes.
+     */
+    uint16_t size() const {
+        return _count;
+    }
+
+private:
+    CommandRouteFn _fns[256];
+    uint8_t _slots[256];
+    uint8_t _slot;          // Owner of routes being added
+    uint16_t _count;
+};
+
+#endif // COMMAND_ROUTE_TABLE_H
@@ -0,0 +1,307 @@
+/**
+ * Frame Bus Implementation
+ */
+
+#include "FrameBus.h"
+#include <Arduino.h>
+
+FrameBus::FrameBus()
+    : _head(0)
+    , _attachedMask(0)
+    , _enabledMask(0)
+    , _prioHead(0)
+    , _prioRuleCount(0)
+    , _policy(OverflowPolicy::BlockBackend)
+    , _forwardStart(0)
+    , _forwardBudget(0)
+    , _overflowCount(0)
+    , _mainDropCount(0)
+    , _prioDropCount(0)
+    , _highWater(0)
+{
+    for (uint8_t i = 0; i < FRAME_BUS_MAX_READERS; i++) {
+        _cursor[i] = 0;
+        _prioCursor[i] = 0;
+    }
+}
+
+uint8_t FrameBus::attachReader() {
+    for (uint8_t i = 0; i < FRAME_BUS_MAX_READERS; i++) {
+        if (!(_attachedMask & (1U << i))) {
+            _attachedMask |= (1U << i);
+            _enabledMask &= ~(1U << i);
+            _cursor[i] = _head;
+            _prioCursor[i] = _prioHead;
+            return i;
+        }
+    }
+    return FRAME_BUS_NO_READER;
+}
+
+void FrameBus::detachReader(uint8_t reader) {
+    if (reader >= FRAME_BUS_MAX_READERS) {
+        return;
+    }
+    _attachedMask &= ~(1U << reader);
+    _enabledMask &= ~(1U << reader);
+}
+
+void FrameBus::setReaderEnabled(uint8_t reader, bool enabled) {
+    if (reader >= FRAME_BUS_MAX_READERS || !(_attachedMask & (1U << reader))) {
+        return;
+    }
+    if (enabled) {
+        if (!(_enabledMask & (1U << reader))) {
+            _cursor[reader] = _head;  // Start with the next new frame
+            _prioCursor[reader] = _prioHead;
+            _enabledMask |= (1U << reader);
+        }
+    } else {
+        _enabledMask &= ~(1U << reader);
+    }
+}
+
+bool FrameBus::isReaderEnabled(uint8_t reader) const {
+    return reader < FRAME_BUS_MAX_READERS && (_enabledMask & (1U << reader));
+}
+
+uint16_t FrameBus::maxPending() const {
+    uint16_t worst = 0;
+    for (uint8_t i = 0; i < FRAME_BUS_MAX_READERS; i++) {
+        if (_enabledMask & (1U << i)) {
+            uint16_t n = (uint16_t)(_head - _cursor[i]);
+            if (n > worst) worst = n;
+        }
+    }
+    return worst;
+}
+
+uint16_t FrameBus::maxPriorityPending() const {
+    uint16_t worst = 0;
+    for (uint8_t i = 0; i < FRAME_BUS_MAX_READERS; i++) {
+        if (_enabledMask & (1U << i)) {
+            uint16_t n = (uint16_t)(_prioHead - _prioCursor[i]);
+            if (n > worst) worst = n;
+        }
+    }
+    return worst;
+}
+
+uint16_t FrameBus::level() const {
+    return maxPending();
+}
+
+void FrameBus::setForwardBudget(uint32_t budgetUs) {
+    _forwardStart = micros();
+    _forwardBudget = budgetUs;
+}
+
+bool FrameBus::forwardTimeLeft() const {
+    return _forwardBudget == 0 || (uint32_t)(micros() - _forwardStart) < _forwardBudget;
+}
+
+uint16_t FrameBus::fill(ICANBackend& can) {
+    bool capturing = _capture.isRecording();
+    if (capturing) {
+        _capture.checkErrors(can.getErrorEventCount());
+        capturing = _capture.isRecording();
+    }
+    if (_enabledMask == 0 && !capturing) {
+        return 0;
+    }
+
+    uint16_t added = 0;
+    uint16_t used = maxPending();
+    uint16_t prioUsed = _prioRuleCount > 0 ? maxPriorityPending() : 0;
+    bool overflowed = false;
+    CANFrame spare;
+
+    while (true) {
+        bool full = used >= CAN_RX_QUEUE_SIZE;
+        if (full && _policy == OverflowPolicy::BlockBackend && !capturing) {
+            // Frames stay in the backend until the slowest reader catches up
+            overflowed = can.available();
+            break;
+        }
+
+        // Read straight into the free slot; it becomes visible when _head moves
+        CANFrame& slot = full ? spare : _slots[_head & (CAN_RX_QUEUE_SIZE - 1)];
+        if (!can.read(slot)) {
+            break;
+        }
+        if (capturing) {
+            capturing = _capture.record(slot);
+        }
+        if (_enabledMask == 0) {
+            if (!capturing) {
+                break;  // Window complete: the rest stays in the backend
+            }
+            continue;   // Read for the capture only
+        }
+        if (!_decimator.admit(slot)) {
+            continue;   // Slot is reused by the next frame
+        }
+
+        bool priority = _prioRuleCount > 0 && !slot.echo && isPriority(slot);
+        if (priority && prioUsed < FRAME_BUS_PRIORITY_SIZE) {
+            _prioSlots[_prioHead & (FRAME_BUS_PRIORITY_SIZE - 1)] = slot;
+            _prioHead++;
+            prioUsed++;
+            added++;
+            continue;
+        }
+
+        if (full) {
+            overflowed = true;
+            if (_policy == OverflowPolicy::DropOldest) {
+                dropOldest();
+                _slots[_head & (CAN_RX_QUEUE_SIZE - 1)] = spare;
+                _head++;
+                added++;
+                _mainDropCount++;
+            } else if (priority) {
+                _prioDropCount++;
+            } else {
+                _mainDropCount++;
+            }
+            continue;
+        }
+
+        _head++;
+        used++;
+        added++;
+    }
+
+    if (used > _highWater) {
+        _highWater = used;
+    }
+    if (overflowed) {
+        _overflowCount++;
+    }
+    return added;
+}
+
+void FrameBus::dropOldest() {
+    // The slot about to be reused holds the frame CAN_RX_QUEUE_SIZE behind _head
+    uint16_t oldest = (uint16_t)(_head - CAN_RX_QUEUE_SIZE);
+    for (uint8_t i = 0; i < FRAME_BUS_MAX_READERS; i++) {
+        if ((_enabledMask & (1U << i)) && _cursor[i] == oldest) {
+            _cursor[i]++;
+        }
+    }
+}
+
+bool FrameBus::isPriority(const CANFrame& frame) const {
+    for (uint8_t i = 0; i < _prioRuleCount; i++) {
+        if (FrameDecimator::matches(_prioRules[i], frame)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+FrameDecimator& FrameBus::getDecimator() {
+    return _decimator;
+}
+
+FrameCapture& FrameBus::getCapture() {
+    return _capture;
+}
+
+void FrameBus::setOverflowPolicy(OverflowPolicy policy) {
+    _policy = policy;
+}
+
+OverflowPolicy FrameBus::getOverflowPolicy() const {
+    return _policy;
+}
+
+bool FrameBus::addPriorityRule(const CANFilterRule& rule) {
+    if (!FrameDecimator::isValid(rule)) {
+        return false;
+    }
+    for (uint8_t i = 0; i < _prioRuleCount; i++) {
+        const CANFilterRule& r = _prioRules[i];
+        if (r.kind == rule.kind && r.first == rule.first && r.second == rule.second) {
+            return true;
+        }
+    }
+    if (_prioRuleCount >= FRAME_BUS_PRIORITY_RULES) {
+        return false;
+    }
+    _prioRules[_prioRuleCount++] = rule;
+    return true;
+}
+
+bool FrameBus::removePriorityRule(const CANFilterRule& rule) {
+    for (uint8_t i = 0; i < _prioRuleCount; i++) {
+        const CANFilterRule& r = _prioRules[i];
+        if (r.kind == rule.kind && r.first == rule.first && r.second == rule.second) {
+            _prioRules[i] = _prioRules[--_prioRuleCount];
+            return true;
+        }
+    }
+    return false;
+}
+
+void FrameBus::clearPriorityRules() {
+    // Frames already in the lane are still delivered
+    _prioRuleCount = 0;
+}
+
+uint8_t FrameBus::getPriorityRuleCount() const {
+    return _prioRuleCount;
+}
+
+const CANFrame* FrameBus::peek(uint8_t reader) const {
+    if (!isReaderEnabled(reader)) {
+        return nullptr;
+    }
+    if (_prioCursor[reader] != _prioHead) {
+        return &_prioSlots[_prioCursor[reader] & (FRAME_BUS_PRIORITY_SIZE - 1)];
+    }
+    if (_cursor[reader] == _head) {
+        return nullptr;
+    }
+    return &_slots[_cursor[reader] & (CAN_RX_QUEUE_SIZE - 1)];
+}
+
+void FrameBus::consume(uint8_t reader) {
+    if (!isReaderEnabled(reader)) {
+        return;
+    }
+    if (_prioCursor[reader] != _prioHead) {
+        _prioCursor[reader]++;
+    } else if (_cursor[reader] != _head) {
+        _cursor[reader]++;
+    }
+}
+
+uint16_t FrameBus::pending(uint8_t reader) const {
+    if (!isReaderEnabled(reader)) {
+        return 0;
+    }
+    return (uint16_t)(_head - _cursor[reader]) + (uint16_t)(_prioHead - _prioCursor[reader]);
+}
+
+void FrameBus::getCounters(uint32_t* overflows) const {
+    if (overflows) *overflows = _overflowCount;
+}
+
+void FrameBus::getLaneCounters(uint32_t* mainDrops, uint32_t* priorityDrops) const {
+    if (mainDrops) *mainDrops = _mainDropCount;
+    if (priorityDrops) *priorityDrops = _prioDropCount;
+}
+
+uint16_t FrameBus::getHighWaterMark() const {
+    return _highWater;
+}
+
+void FrameBus::resetCounters() {
+    _overflowCount = 0;
+    _mainDropCount = 0;
+    _prioDropCount = 0;
+    _highWater = 0;
+    _decimator.resetCounters();
+    _capture.resetCounters();
+}
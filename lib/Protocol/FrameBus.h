@@ -0,0 +1,264 @@
+/**
+ * Frame Bus
+ *
+ * Shared RX frame ring with one read cursor per protocol handler.
+ * Filled once from the CAN backend; every handler reads the same frames.
+ */
+
+#ifndef FRAME_BUS_H
+#define FRAME_BUS_H
+
+#include "config.h"
+#include "CANBackend.h"
+#include "FrameDecimator.h"
+#include "FrameCapture.h"
+#include <stdint.h>
+
+#ifndef CAN_RX_QUEUE_SIZE
+#define CAN_RX_QUEUE_SIZE 128
+#endif
+
+#ifndef MAX_PROTOCOL_HANDLERS
+#define MAX_PROTOCOL_HANDLERS 5
+#endif
+
+#ifndef FRAME_BUS_PRIORITY_SIZE
+#define FRAME_BUS_PRIORITY_SIZE 16
+#endif
+
+#ifndef FRAME_BUS_PRIORITY_RULES
+#define FRAME_BUS_PRIORITY_RULES 4
+#endif
+
+#define FRAME_BUS_MAX_READERS   MAX_PROTOCOL_HANDLERS
+#define FRAME_BUS_NO_READER     0xFF
+
+/**
+ * What fill() does with new frames while the ring is full for the
+ * slowest enabled reader.
+ */
+enum class OverflowPolicy : uint8_t {
+    BlockBackend,   // Leave them in the backend (its own ring drops newest when full)
+    DropNewest,     // Read and discard them, so the backend stays drained
+    DropOldest      // Overwrite the oldest frame the slowest readers haven't consumed
+};
+
+/**
+ * Shared frame ring (single writer, multiple readers).
+ *
+ * The dispatcher calls fill() once per loop to move frames from the
+ * backend into the ring. Each handler owns a reader cursor and consumes
+ * frames in place with peek()/consume(), so frames are never copied per
+ * handler and handlers never race for ICANBackend::read().
+ *
+ * When the slowest enabled reader falls behind and the ring is full, the
+ * overflow policy decides: by default new frames stay in the backend
+ * ring; they can also be discarded, or replace the oldest unread frame.
+ * Disabled readers don't hold the ring back and restart at the newest
+ * frame when re-enabled.
+ *
+ * Frames matching a priority rule go to a small separate lane that
+ * readers drain before the main ring, so they get through a burst of
+ * bulk traffic ahead of it. A priority frame that finds its lane full
+ * falls back to the main ring. TX echoes always use the main ring.
+ *
+ * Frames that the decimator thins out are dropped in fill() and never
+ * take a ring slot.
+ *
+ * While a capture records (see FrameCapture), fill() sees every frame
+ * first and always drains the backend: frames the readers have no room
+ * for are dropped from the live stream (counted as main-ring drops)
+ * instead of being left in the backend, where they would be lost to the
+ * capture too.
+ */
+class FrameBus {
+    static_assert((CAN_RX_QUEUE_SIZE & (CAN_RX_QUEUE_SIZE - 1)) == 0,
+                  "CAN_RX_QUEUE_SIZE must be a power of two");
+    static_assert((FRAME_BUS_PRIORITY_SIZE & (FRAME_BUS_PRIORITY_SIZE - 1)) == 0,
+                  "FRAME_BUS_PRIORITY_SIZE must be a power of two");
+    static_assert(FRAME_BUS_MAX_READERS <= 8, "Reader masks are 8 bits wide");
+
+public:
+    FrameBus();
+
+    /**
+     * Allocate a reader cursor (initially disabled).
+     * @return Reader id, or FRAME_BUS_NO_READER if all are in use
+     */
+    uint8_t attachReader();
+
+    /**
+     * Release a reader cursor.
+     * @param reader Reader id from attachReader()
+     */
+    void detachReader(uint8_t reader);
+
+    /**
+     * Enable or disable a reader. Enabling skips to the newest frame.
+     * @param reader Reader id
+     * @param enabled true to receive frames
+     */
+    void setReaderEnabled(uint8_t reader, bool enabled);
+
+    bool isReaderEnabled(uint8_t reader) const;
+
+    /**
+     * Move frames from the backend into the ring, minus the ones the
+     * decimator drops.
+     * No-op while no reader is enabled and no capture records (frames
+     * stay in the backend).
+     *
+     * @param can Backend to read from
+     * @return Number of frames added
+     */
+    uint16_t fill(ICANBackend& can);
+
+    /**
+     * Get the decimation rules applied by fill().
+     */
+    FrameDecimator& getDecimator();
+
+    /**
+     * Get the triggered capture fed by fill().
+     */
+    FrameCapture& getCapture();
+
+    /**
+     * Set what fill() does while the ring is full.
+     */
+    void setOverflowPolicy(OverflowPolicy policy);
+
+    OverflowPolicy getOverflowPolicy() const;
+
+    /**
+     * Send frames matching a rule through the priority lane.
+     * @param rule IDs to prioritize (acceptance filter rule semantics)
+     * @return true on success (or already present), false if invalid or the table is full
+     */
+    bool addPriorityRule(const CANFilterRule& rule);
+
+    /**
+     * Remove the priority rule with exactly this match.
+     * @return true if removed, false if not found
+     */
+    bool removePriorityRule(const CANFilterRule& rule);
+
+    /**
+     * Remove all priority rules (every frame uses the main ring).
+     */
+    void clearPriorityRules();
+
+    uint8_t getPriorityRuleCount() const;
+
+    /**
+     * Get the reader's next frame without consuming it: the oldest
+     * priority frame if there is one, else the oldest main ring frame.
+     * @param reader Reader id
+     * @return Pointer into the ring (valid until consume()), or nullptr if none
+     */
+    const CANFrame* peek(uint8_t reader) const;
+
+    /**
+     * Consume the frame returned by peek().
+     * @param reader Reader id
+     */
+    void consume(uint8_t reader);
+
+    /**
+     * Get the number of frames the reader has not consumed yet (both lanes).
+     */
+    uint16_t pending(uint8_t reader) const;
+
+    static constexpr uint16_t capacity() {
+        return CAN_RX_QUEUE_SIZE;
+    }
+
+    /**
+     * Get the number of main ring frames held for the slowest enabled reader.
+     */
+    uint16_t level() const;
+
+    /**
+     * Limit how long readers forward frames in this loop iteration.
+     * Set by the main loop scheduler before the handlers are polled.
+     * @param budgetUs Microseconds from now, 0 for no limit
+     */
+    void setForwardBudget(uint32_t budgetUs);
+
+    /**
+     * Check the forward budget. Readers should still forward at least one
+     * frame per poll so the stream always makes progress.
+     * @return true while the budget set by setForwardBudget() has time left
+     */
+    bool forwardTimeLeft() const;
+
+    /**
+     * Get diagnostic counters.
+     * @param overflows Output: fill() calls that found the ring full with frames waiting
+     */
+    void getCounters(uint32_t* overflows) const;
+
+    /**
+     * Get the frames dropped by the overflow policy, per lane.
+     * Always zero with OverflowPolicy::BlockBackend (the backend drops instead).
+     * @param mainDrops Output: frames discarded or overwritten in the main ring
+     * @param priorityDrops Output: priority frames discarded with both lanes full
+     */
+    void getLaneCounters(uint32_t* mainDrops, uint32_t* priorityDrops) const;
+
+    /**
+     * Get the peak number of frames held for the slowest enabled reader.
+     * @return High-water mark of the ring (frames)
+     */
+    uint16_t getHighWaterMark() const;
+
+    /**
+     * Reset diagnostic counters (and the high-water mark, and the
+     * decimator's and the capture's counters).
+     */
+    void resetCounters();
+
+private:
+    CANFrame _slots[CAN_RX_QUEUE_SIZE];
+    uint16_t _head;                                 // fill() writes here (free-running)
+    uint16_t _cursor[FRAME_BUS_MAX_READERS];        // Per-reader read position
+    uint8_t _attachedMask;                          // Bit n: reader n allocated
+    uint8_t _enabledMask;                           // Bit n: reader n receiving
+
+    CANFrame _prioSlots[FRAME_BUS_PRIORITY_SIZE];   // Priority lane
+    uint16_t _prioHead;
+    uint16_t _prioCursor[FRAME_BUS_MAX_READERS];
+    CANFilterRule _prioRules[FRAME_BUS_PRIORITY_RULES];
+    uint8_t _prioRuleCount;
+
+    FrameDecimator _decimator;                      // Applied to every frame in fill()
+    FrameCapture _capture;                          // Sees every frame before the decimator
+    OverflowPolicy _policy;
+
+    uint32_t _forwardStart;                         // micros() at setForwardBudget()
+    uint32_t _forwardBudget;                        // 0 = unlimited
+
+    uint32_t _overflowCount;
+    uint32_t _mainDropCount;
+    uint32_t _prioDropCount;
+    uint16_t _highWater;                            // Peak maxPending() after fill()
+
+    /**
+     * Count of main ring frames still unread by the slowest enabled reader.
+     */
+    uint16_t maxPending() const;
+
+    /**
+     * Count of priority lane frames still unread by the slowest enabled reader.
+     */
+    uint16_t maxPriorityPending() const;
+
+    bool isPriority(const CANFrame& frame) const;
+
+    /**
+     * Step readers that still hold the oldest main ring frame past it.
+     */
+    void dropOldest();
+};
+
+#endif // FRAME_BUS_H
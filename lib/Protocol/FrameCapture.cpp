@@ -0,0 +1,239 @@
+/**
+ * Triggered Frame Capture Implementation
+ */
+
+#include "FrameCapture.h"
+#include "FrameDecimator.h"
+#include <string.h>
+
+#define CAPTURE_FLAG_EXT        (1UL << 29)
+#define CAPTURE_FLAG_RTR        (1UL << 30)
+#define CAPTURE_FLAG_ECHO       (1UL << 31)
+#define CAPTURE_ID_MASK         0x1FFFFFFFUL
+#define CAPTURE_TIME_MASK       0x0FFFFFFFUL
+#define CAPTURE_DLC_SHIFT       28
+
+FrameCapture::FrameCapture()
+    : _start(0)
+    , _count(0)
+    , _pre(CAPTURE_BUFFER_FRAMES / 2)
+    , _post(CAPTURE_BUFFER_FRAMES - CAPTURE_BUFFER_FRAMES / 2 - 1)
+    , _armedPre(0)
+    , _postLeft(0)
+    , _triggerIndex(0)
+    , _state(CaptureState::Idle)
+    , _idTrigger(false)
+    , _dataTrigger(false)
+    , _errorTrigger(false)
+    , _errorMarkValid(false)
+    , _errorMark(0)
+    , _triggerCount(0)
+    , _frameCount(0)
+{
+    _idRule.kind = CANFilterRule::Kind::StdRange;
+    _idRule.first = 0;
+    _idRule.second = 0;
+    memset(_dataValue, 0, sizeof(_dataValue));
+    memset(_dataMask, 0, sizeof(_dataMask));
+}
+
+bool FrameCapture::setWindow(uint16_t pre, uint16_t post) {
+    if ((uint32_t)pre + 1 + post > CAPTURE_BUFFER_FRAMES) {
+        return false;
+    }
+    _pre = pre;
+    _post = post;
+    return true;
+}
+
+void FrameCapture::getWindow(uint16_t* pre, uint16_t* post) const {
+    if (pre) *pre = _pre;
+    if (post) *post = _post;
+}
+
+bool FrameCapture::setIdTrigger(const CANFilterRule& rule) {
+    if (!FrameDecimator::isValid(rule)) {
+        return false;
+    }
+    _idRule = rule;
+    _idTrigger = true;
+    return true;
+}
+
+void FrameCapture::clearIdTrigger() {
+    _idTrigger = false;
+}
+
+void FrameCapture::setDataTrigger(const uint8_t value[8], const uint8_t mask[8]) {
+    _dataTrigger = false;
+    for (uint8_t i = 0; i < 8; i++) {
+        _dataValue[i] = value[i] & mask[i];
+        _dataMask[i] = mask[i];
+        if (mask[i]) {
+            _dataTrigger = true;
+        }
+    }
+}
+
+void FrameCapture::clearDataTrigger() {
+    memset(_dataMask, 0, sizeof(_dataMask));
+    _dataTrigger = false;
+}
+
+void FrameCapture::setErrorTrigger(bool enable) {
+    _errorTrigger = enable;
+}
+
+bool FrameCapture::hasIdTrigger() const {
+    return _idTrigger;
+}
+
+bool FrameCapture::hasDataTrigger() const {
+    return _dataTrigger;
+}
+
+bool FrameCapture::hasErrorTrigger() const {
+    return _errorTrigger;
+}
+
+void FrameCapture::arm() {
+    _start = 0;
+    _count = 0;
+    _armedPre = _pre;
+    _postLeft = _post;
+    _triggerIndex = 0;
+    _errorMarkValid = false;
+    _state = CaptureState::Armed;
+}
+
+void FrameCapture::trigger() {
+    if (_state == CaptureState::Armed) {
+        _triggerIndex = _count;
+        fire();
+    }
+}
+
+void FrameCapture::stop() {
+    _start = 0;
+    _count = 0;
+    _state = CaptureState::Idle;
+}
+
+bool FrameCapture::record(const CANFrame& frame) {
+    if (_state == CaptureState::Armed) {
+        if (!frame.echo && (_idTrigger || _dataTrigger) && triggers(frame)) {
+            _triggerIndex = _count;
+            store(frame);
+            fire();
+            return isRecording();
+        }
+
+        // Pre-trigger ring: the oldest frame makes room
+        if (_armedPre == 0) {
+            return true;
+        }
+        if (_count == _armedPre) {
+            _start = (uint16_t)((_start + 1) % CAPTURE_BUFFER_FRAMES);
+            _count--;
+        }
+        store(frame);
+        return true;
+    }
+
+    if (_state == CaptureState::Triggered) {
+        store(frame);
+        if (--_postLeft == 0) {
+            _state = CaptureState::Done;
+        }
+        return isRecording();
+    }
+    return false;
+}
+
+void FrameCapture::checkErrors(uint32_t errorEvents) {
+    if (_state != CaptureState::Armed || !_errorTrigger) {
+        return;
+    }
+    if (!_errorMarkValid) {
+        // Only events after arm() count
+        _errorMark = errorEvents;
+        _errorMarkValid = true;
+        return;
+    }
+    if (errorEvents != _errorMark) {
+        _triggerIndex = _count;
+        fire();
+    }
+}
+
+CaptureState FrameCapture::getState() const {
+    return _state;
+}
+
+uint16_t FrameCapture::getCount() const {
+    return _count;
+}
+
+uint16_t FrameCapture::getTriggerIndex() const {
+    return _triggerIndex;
+}
+
+bool FrameCapture::getFrame(uint16_t index, CANFrame& frame) const {
+    if (index >= _count) {
+        return false;
+    }
+    const Record& r = _records[(_start + index) % CAPTURE_BUFFER_FRAMES];
+    frame.id = r.idFlags & CAPTURE_ID_MASK;
+    frame.extended = (r.idFlags & CAPTURE_FLAG_EXT) != 0;
+    frame.rtr = (r.idFlags & CAPTURE_FLAG_RTR) != 0;
+    frame.echo = (r.idFlags & CAPTURE_FLAG_ECHO) != 0;
+    frame.timestamp = r.timeDlc & CAPTURE_TIME_MASK;
+    frame.dlc = (uint8_t)(r.timeDlc >> CAPTURE_DLC_SHIFT);
+    memcpy(frame.data, r.data, sizeof(frame.data));
+    return true;
+}
+
+void FrameCapture::getCounters(uint32_t* triggers, uint32_t* frames) const {
+    if (triggers) *triggers = _triggerCount;
+    if (frames) *frames = _frameCount;
+}
+
+void FrameCapture::resetCounters() {
+    _triggerCount = 0;
+    _frameCount = 0;
+}
+
+bool FrameCapture::triggers(const CANFrame& frame) const {
+    if (_idTrigger && !FrameDecimator::matches(_idRule, frame)) {
+        return false;
+    }
+    if (_dataTrigger) {
+        uint8_t len = frame.rtr ? 0 : frame.dlc;
+        for (uint8_t i = 0; i < 8; i++) {
+            if (_dataMask[i] == 0) {
+                continue;
+            }
+            if (i >= len || (frame.data[i] & _dataMask[i]) != _dataValue[i]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void FrameCapture::store(const CANFrame& frame) {
+    Record& r = _records[(_start + _count) % CAPTURE_BUFFER_FRAMES];
+    r.idFlags = (frame.id & CAPTURE_ID_MASK)
+              | (frame.extended ? CAPTURE_FLAG_EXT : 0)
+              | (frame.rtr ? CAPTURE_FLAG_RTR : 0)
+              | (frame.echo ? CAPTURE_FLAG_ECHO : 0);
+    r.timeDlc = (frame.timestamp & CAPTURE_TIME_MASK) | ((uint32_t)frame.dlc << CAPTURE_DLC_SHIFT);
+    memcpy(r.data, frame.data, sizeof(r.data));
+    _count++;
+    _frameCount++;
+}
+
+void FrameCapture::fire() {
+    _triggerCount++;
+    _state = _postLeft > 0 ? CaptureState::Triggered : CaptureState::Done;
+}
@@ -0,0 +1,188 @@
+/**
+ * Triggered Frame Capture
+ *
+ * Records raw received frames into a dedicated buffer around a trigger
+ * (ID/data match, CAN error event or a command), so a short burst is
+ * kept complete even when the host link can't keep up with the bus.
+ * The host reads the capture afterwards at its own pace.
+ */
+
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include "config.h"
+#include "CANBackend.h"
+#include <stdint.h>
+
+#ifndef CAPTURE_BUFFER_FRAMES
+#define CAPTURE_BUFFER_FRAMES   256
+#endif
+
+static_assert(CAPTURE_BUFFER_FRAMES >= 2 && CAPTURE_BUFFER_FRAMES <= 0xFFFF,
+              "CAPTURE_BUFFER_FRAMES must be 2..65535");
+
+/**
+ * Capture state.
+ */
+enum class CaptureState : uint8_t {
+    Idle,           // Not recording (buffer empty)
+    Armed,          // Recording the pre-trigger ring, waiting for the trigger
+    Triggered,      // Recording post-trigger frames
+    Done            // Window complete, frames held until re-armed or stopped
+};
+
+/**
+ * Triggered frame capture.
+ *
+ * While armed, the last `pre` frames are kept in a ring. The trigger
+ * frame (if a frame triggered) and the next `post` frames follow, then
+ * recording stops. Frames are packed into 16-byte records; timestamps
+ * keep their low 28 bits (microseconds, wraps after ~268 s).
+ *
+ * A frame triggers when it matches the ID rule (if set) and the data
+ * pattern (if set); with neither set, only an error event (if enabled)
+ * or trigger() ends the pre-trigger phase. TX echoes are recorded but
+ * never trigger.
+ */
+class FrameCapture {
+public:
+    FrameCapture();
+
+    /**
+     * Set the capture window. Takes effect at the next arm().
+     * @param pre Frames kept before the trigger
+     * @param post Frames recorded after the trigger
+     * @return false if pre + 1 + post exceeds CAPTURE_BUFFER_FRAMES
+     */
+    bool setWindow(uint16_t pre, uint16_t post);
+
+    void getWindow(uint16_t* pre, uint16_t* post) const;
+
+    /**
+     * Trigger on frames matching an ID rule (see CANFilterRule).
+     * @return false if the rule is invalid
+     */
+    bool setIdTrigger(const CANFilterRule& rule);
+
+    void clearIdTrigger();
+
+    /**
+     * Trigger on frames whose payload matches: (data[i] & mask[i]) ==
+     * (value[i] & mask[i]) for every byte; masked bytes must be present.
+     * @param value Expected bytes
+     * @param mask Bits to compare (all zero: no data condition)
+     */
+    void setDataTrigger(const uint8_t value[8], const uint8_t mask[8]);
+
+    void clearDataTrigger();
+
+    /**
+     * Trigger on ICANBackend error events (see checkErrors()).
+     */
+    void setErrorTrigger(bool enable);
+
+    bool hasIdTrigger() const;
+    bool hasDataTrigger() const;
+    bool hasErrorTrigger() const;
+
+    /**
+     * Discard held frames and start recording the pre-trigger ring.
+     */
+    void arm();
+
+    /**
+     * Trigger now (armed only). The next frame is the first post-trigger frame.
+     */
+    void trigger();
+
+    /**
+     * Stop recording and discard held frames.
+     */
+    void stop();
+
+    /**
+     * Check whether record() wants frames.
+     */
+    bool isRecording() const {
+        return _state == CaptureState::Armed || _state == CaptureState::Triggered;
+    }
+
+    /**
+     * Record a received frame (call for every frame read from the backend).
+     * @param frame Received frame
+     * @return true while still recording
+     */
+    bool record(const CANFrame& frame);
+
+    /**
+     * Trigger on a new error event (armed, error trigger enabled).
+     * @param errorEvents Current ICANBackend::getErrorEventCount()
+     */
+    void checkErrors(uint32_t errorEvents);
+
+    CaptureState getState() const;
+
+    /**
+     * Get the number of frames held (oldest first).
+     */
+    uint16_t getCount() const;
+
+    /**
+     * Get the position of the trigger in the held frames: the trigger
+     * frame, or the first frame after an error or forced trigger.
+     */
+    uint16_t getTriggerIndex() const;
+
+    /**
+     * Get a held frame.
+     * @param index Position, 0 = oldest
+     * @param frame Output: frame (timestamp: low 28 bits)
+     * @return false if index is out of range
+     */
+    bool getFrame(uint16_t index, CANFrame& frame) const;
+
+    /**
+     * Get diagnostic counters.
+     * @param triggers Output: captures triggered
+     * @param frames Output: frames recorded
+     */
+    void getCounters(uint32_t* triggers, uint32_t* frames) const;
+
+    void resetCounters();
+
+private:
+    // Packed frame, 16 bytes instead of CANFrame's 20
+    struct Record {
+        uint32_t idFlags;       // ID, bit 29 extended, bit 30 RTR, bit 31 TX echo
+        uint32_t timeDlc;       // Timestamp bits 0-27, DLC in bits 28-31
+        uint8_t data[8];
+    };
+
+    Record _records[CAPTURE_BUFFER_FRAMES];
+    uint16_t _start;            // Oldest held record
+    uint16_t _count;            // Records held
+    uint16_t _pre;
+    uint16_t _post;
+    uint16_t _armedPre;         // _pre as of arm(): the ring size while armed
+    uint16_t _postLeft;         // Post-trigger frames still to record
+    uint16_t _triggerIndex;
+    CaptureState _state;
+
+    CANFilterRule _idRule;
+    bool _idTrigger;
+    uint8_t _dataValue[8];
+    uint8_t _dataMask[8];
+    bool _dataTrigger;
+    bool _errorTrigger;
+    bool _errorMarkValid;       // _errorMark taken since arm()
+    uint32_t _errorMark;
+
+    uint32_t _triggerCount;
+    uint32_t _frameCount;
+
+    bool triggers(const CANFrame& frame) const;
+    void store(const CANFrame& frame);
+    void fire();
+};
+
+#endif // FRAME_CAPTURE_H
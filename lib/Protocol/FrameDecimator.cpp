@@ -0,0 +1,143 @@
+/**
+ * Frame Decimator Implementation
+ */
+
+#include "FrameDecimator.h"
+
+// Token bucket units: one frame is worth one second of a 1 Hz refill
+#define DECIMATE_TOKEN_UNIT     1000000UL
+#define DECIMATE_TOKEN_MAX      ((uint32_t)DECIMATE_BUCKET_BURST * DECIMATE_TOKEN_UNIT)
+
+FrameDecimator::FrameDecimator()
+    : _ruleCount(0)
+    , _decimatedCount(0)
+{
+}
+
+bool FrameDecimator::add(const CANFilterRule& match, DecimateMode mode, uint16_t n) {
+    if (!isValid(match)) {
+        return false;
+    }
+    if (mode == DecimateMode::OneInN ? (n < 2 || n > 255) : n == 0) {
+        return false;
+    }
+
+    int8_t index = find(match);
+    if (index < 0) {
+        if (_ruleCount >= DECIMATE_MAX_RULES) {
+            return false;
+        }
+        index = (int8_t)_ruleCount++;
+        _rules[index].match = match;
+    }
+
+    // New or changed limit starts fresh (first frame passes)
+    Rule& rule = _rules[index];
+    rule.mode = mode;
+    rule.n = n;
+    rule.state = (mode == DecimateMode::MaxRate) ? DECIMATE_TOKEN_UNIT : 0;
+    rule.lastUs = 0;
+    rule.started = false;
+    return true;
+}
+
+bool FrameDecimator::remove(const CANFilterRule& match) {
+    int8_t index = find(match);
+    if (index < 0) {
+        return false;
+    }
+    // Keep rule order: the first match wins
+    for (uint8_t i = (uint8_t)index; i + 1 < _ruleCount; i++) {
+        _rules[i] = _rules[i + 1];
+    }
+    _ruleCount--;
+    return true;
+}
+
+void FrameDecimator::clear() {
+    _ruleCount = 0;
+}
+
+uint8_t FrameDecimator::getRuleCount() const {
+    return _ruleCount;
+}
+
+bool FrameDecimator::admitSlow(const CANFrame& frame) {
+    for (uint8_t i = 0; i < _ruleCount; i++) {
+        if (matches(_rules[i].match, frame)) {
+            if (admitRule(_rules[i], frame.timestamp)) {
+                return true;
+            }
+            _decimatedCount++;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FrameDecimator::admitRule(Rule& rule, uint32_t timestamp) {
+    if (rule.mode == DecimateMode::OneInN) {
+        bool keep = (rule.state == 0);
+        rule.state = (rule.state + 1 >= rule.n) ? 0 : rule.state + 1;
+        return keep;
+    }
+
+    // MaxRate: refill n tokens per second of capture time, up to the burst
+    if (rule.started) {
+        uint64_t refill = (uint64_t)(uint32_t)(timestamp - rule.lastUs) * rule.n;
+        uint64_t tokens = rule.state + refill;
+        rule.state = tokens > DECIMATE_TOKEN_MAX ? DECIMATE_TOKEN_MAX : (uint32_t)tokens;
+    }
+    rule.lastUs = timestamp;
+    rule.started = true;
+
+    if (rule.state < DECIMATE_TOKEN_UNIT) {
+        return false;
+    }
+    rule.state -= DECIMATE_TOKEN_UNIT;
+    return true;
+}
+
+bool FrameDecimator::matches(const CANFilterRule& match, const CANFrame& frame) {
+    switch (match.kind) {
+        case CANFilterRule::Kind::StdRange:
+            return !frame.extended && frame.id >= match.first && frame.id <= match.second;
+        case CANFilterRule::Kind::ExtRange:
+            return frame.extended && frame.id >= match.first && frame.id <= match.second;
+        case CANFilterRule::Kind::ExtMask:
+            return frame.extended && (frame.id & match.second) == (match.first & match.second);
+        default:
+            return false;
+    }
+}
+
+bool FrameDecimator::isValid(const CANFilterRule& match) {
+    switch (match.kind) {
+        case CANFilterRule::Kind::StdRange:
+            return match.first <= match.second && match.second <= 0x7FF;
+        case CANFilterRule::Kind::ExtRange:
+            return match.first <= match.second && match.second <= 0x1FFFFFFF;
+        case CANFilterRule::Kind::ExtMask:
+            return match.first <= 0x1FFFFFFF && match.second <= 0x1FFFFFFF;
+        default:
+            return false;
+    }
+}
+
+int8_t FrameDecimator::find(const CANFilterRule& match) const {
+    for (uint8_t i = 0; i < _ruleCount; i++) {
+        const CANFilterRule& m = _rules[i].match;
+        if (m.kind == match.kind && m.first == match.first && m.second == match.second) {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+void FrameDecimator::getCounters(uint32_t* decimated) const {
+    if (decimated) *decimated = _decimatedCount;
+}
+
+void FrameDecimator::resetCounters() {
+    _decimatedCount = 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * Frame Decimator
+ *
+ * Per-rule rate limiting of received frames before they enter the shared
+ * frame bus, so chatty IDs are sampled instead of crowding out rare
+ * frames when the ring fills up.
+ */
+
+#ifndef FRAME_DECIMATOR_H
+#define FRAME_DECIMATOR_H
+
+#include "config.h"
+#include "CANBackend.h"
+#include <stdint.h>
+
+#ifndef DECIMATE_MAX_RULES
+#define DECIMATE_MAX_RULES      8
+#endif
+
+#ifndef DECIMATE_BUCKET_BURST
+#define DECIMATE_BUCKET_BURST   2
+#endif
+
+static_assert(DECIMATE_BUCKET_BURST >= 1 && DECIMATE_BUCKET_BURST <= 255,
+              "DECIMATE_BUCKET_BURST must be 1..255");
+
+/**
+ * How a decimation rule thins out its frames.
+ */
+enum class DecimateMode : uint8_t {
+    OneInN,         // Forward the first frame of every N
+    MaxRate         // Token bucket: at most N frames per second
+};
+
+/**
+ * Decimation rule table.
+ *
+ * Each rule matches IDs the same way as an acceptance filter rule (see
+ * CANFilterRule). A frame is thinned by the first rule that matches it;
+ * frames that match no rule always pass. The rate state is kept per rule,
+ * so a rule covering a range limits the range as a whole (use one-ID
+ * rules for strictly per-ID limits). Token buckets refill from the
+ * frames' capture timestamps, so bursty delivery from the backend does
+ * not distort the rate. TX echoes are never decimated.
+ */
+class FrameDecimator {
+public:
+    FrameDecimator();
+
+    /**
+     * Add a rule, or replace the limit of an existing rule with the same match.
+     * @param match IDs the rule applies to
+     * @param mode Decimation mode
+     * @param n OneInN: keep 1 in n (2..255); MaxRate: frames per second (1..65535)
+     * @return true on success, false if invalid or the table is full
+     */
+    bool add(const CANFilterRule& match, DecimateMode mode, uint16_t n);
+
+    /**
+     * Remove the rule with exactly this match.
+     * @return true if removed, false if not found
+     */
+    bool remove(const CANFilterRule& match);
+
+    /**
+     * Remove all rules (forward every frame).
+     */
+    void clear();
+
+    uint8_t getRuleCount() const;
+
+    /**
+     * Decide whether a received frame enters the frame bus.
+     * @param frame Received frame
+     * @return false if the frame is decimated away
+     */
+    bool admit(const CANFrame& frame) {
+        if (_ruleCount == 0 || frame.echo) {
+            return true;
+        }
+        return admitSlow(frame);
+    }
+
+    /**
+     * Get diagnostic counters.
+     * @param decimated Output: frames dropped by a decimation rule
+     */
+    void getCounters(uint32_t* decimated) const;
+
+    /**
+     * Reset diagnostic counters.
+     */
+    void resetCounters();
+
+    /**
+     * Check a frame against a rule's match (acceptance filter semantics).
+     */
+    static bool matches(const CANFilterRule& match, const CANFrame& frame);
+
+    /**
+     * Check that a rule's IDs fit its ID type (and ranges are ordered).
+     */
+    static bool isValid(const CANFilterRule& match);
+
+private:
+    struct Rule {
+        CANFilterRule match;
+        DecimateMode mode;
+        uint16_t n;
+        uint32_t state;         // OneInN: frames seen; MaxRate: tokens (1 frame = 1000000)
+        uint32_t lastUs;        // MaxRate: timestamp of the last refill
+        bool started;           // MaxRate: lastUs is valid
+    };
+
+    Rule _rules[DECIMATE_MAX_RULES];
+    uint8_t _ruleCount;
+    uint32_t _decimatedCount;
+
+    bool admitSlow(const CANFrame& frame);
+    bool admitRule(Rule& rule, uint32_t timestamp);
+
+    int8_t find(const CANFilterRule& match) const;
+};
+
+#endif // FRAME_DECIMATOR_H
@@ -0,0 +1,82 @@
+/**
+ * Loop Scheduler Implementation
+ */
+
+#include "LoopScheduler.h"
+#include <Arduino.h>
+
+static const uint32_t RX_MIN_SHARE_US = (uint32_t)SCHED_TICK_BUDGET_US * SCHED_RX_MIN_SHARE_PCT / 100;
+static const uint32_t RX_MAX_SHARE_US = (uint32_t)SCHED_TICK_BUDGET_US * SCHED_RX_MAX_SHARE_PCT / 100;
+
+LoopScheduler::LoopScheduler(FrameBus& bus, ICANBackend& can)
+    : _bus(bus)
+    , _can(can)
+    , _tickStart(0)
+    , _tickActive(false)
+    , _rxBoostTicks(0)
+    , _txPriorityTicks(0)
+    , _overrunCount(0)
+{
+    _policy.cmdBudgetUs = SCHED_TICK_BUDGET_US - RX_MIN_SHARE_US;
+    _policy.rxBudgetUs = RX_MIN_SHARE_US;
+    _policy.txPriority = false;
+}
+
+void LoopScheduler::beginTick() {
+    uint32_t now = micros();
+    if (_tickActive && (uint32_t)(now - _tickStart) > SCHED_TICK_BUDGET_US) {
+        _overrunCount++;
+    }
+    _tickStart = now;
+    _tickActive = true;
+
+    // RX share grows with the frames still waiting for the slowest reader
+    uint32_t level = _bus.level();
+    uint32_t rxShare = RX_MIN_SHARE_US
+                     + (RX_MAX_SHARE_US - RX_MIN_SHARE_US) * level / FrameBus::capacity();
+    if (rxShare > RX_MIN_SHARE_US) {
+        _rxBoostTicks++;
+    }
+    _policy.rxBudgetUs = (uint16_t)rxShare;
+    _policy.cmdBudgetUs = (uint16_t)(SCHED_TICK_BUDGET_US - rxShare);
+
+    uint8_t pending, capacity;
+    _can.getTxQueueLevel(&pending, &capacity);
+    _policy.txPriority = capacity > 0 && (uint32_t)pending * 100 >= (uint32_t)capacity * SCHED_TX_PRIORITY_PCT;
+    if (_policy.txPriority) {
+        _txPriorityTicks++;
+    }
+}
+
+bool LoopScheduler::commandTimeLeft() const {
+    return (uint32_t)(micros() - _tickStart) < _policy.cmdBudgetUs;
+}
+
+bool LoopScheduler::txPriority() const {
+    return _policy.txPriority;
+}
+
+void LoopScheduler::beginForward() {
+    // An idle command side hands its unused time to RX forwarding
+    uint32_t used = micros() - _tickStart;
+    if (used < SCHED_TICK_BUDGET_US && SCHED_TICK_BUDGET_US - used > _policy.rxBudgetUs) {
+        _policy.rxBudgetUs = (uint16_t)(SCHED_TICK_BUDGET_US - used);
+    }
+    _bus.setForwardBudget(_policy.rxBudgetUs);
+}
+
+const SchedulerPolicy& LoopScheduler::getPolicy() const {
+    return _policy;
+}
+
+void LoopScheduler::getCounters(uint32_t* rxBoostTicks, uint32_t* txPriorityTicks, uint32_t* overruns) const {
+    if (rxBoostTicks) *rxBoostTicks = _rxBoostTicks;
+    if (txPriorityTicks) *txPriorityTicks = _txPriorityTicks;
+    if (overruns) *overruns = _overrunCount;
+}
+
+void LoopScheduler::resetCounters() {
+    _rxBoostTicks = 0;
+    _txPriorityTicks = 0;
+    _overrunCount = 0;
+}
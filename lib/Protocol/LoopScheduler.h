@@ -0,0 +1,124 @@
+/**
+ * Loop Scheduler
+ *
+ * Cooperative time-budget scheduler for the main loop: splits each loop
+ * iteration between command processing and RX forwarding according to
+ * how full the frame bus and the TX queue are.
+ */
+
+#ifndef LOOP_SCHEDULER_H
+#define LOOP_SCHEDULER_H
+
+#include "config.h"
+#include "FrameBus.h"
+#include "CANBackend.h"
+#include <stdint.h>
+
+#ifndef SCHED_TICK_BUDGET_US
+#define SCHED_TICK_BUDGET_US 1000
+#endif
+
+#ifndef SCHED_RX_MIN_SHARE_PCT
+#define SCHED_RX_MIN_SHARE_PCT 25
+#endif
+
+#ifndef SCHED_RX_MAX_SHARE_PCT
+#define SCHED_RX_MAX_SHARE_PCT 90
+#endif
+
+#ifndef SCHED_TX_PRIORITY_PCT
+#define SCHED_TX_PRIORITY_PCT 75
+#endif
+
+static_assert(SCHED_TICK_BUDGET_US > 0 && SCHED_TICK_BUDGET_US <= 0xFFFF,
+              "SCHED_TICK_BUDGET_US must fit the 16-bit policy fields");
+static_assert(SCHED_RX_MIN_SHARE_PCT <= SCHED_RX_MAX_SHARE_PCT && SCHED_RX_MAX_SHARE_PCT <= 100,
+              "SCHED_RX_*_SHARE_PCT must satisfy MIN <= MAX <= 100");
+
+/**
+ * Budgets chosen for the current loop iteration.
+ */
+struct SchedulerPolicy {
+    uint16_t cmdBudgetUs;       // Commands are read until this much of the tick is used
+    uint16_t rxBudgetUs;        // RX forwarding time (share, or all time commands left)
+    bool txPriority;            // TX queue nearly full: service it before each command
+};
+
+/**
+ * Main loop scheduler.
+ *
+ * Per tick (loop iteration):
+ * - beginTick() sizes the RX share from the frame bus fill level,
+ *   linearly from SCHED_RX_MIN_SHARE_PCT (empty) to SCHED_RX_MAX_SHARE_PCT
+ *   (full); commands get the rest.
+ * - Commands are processed while commandTimeLeft() (at least one).
+ * - beginForward() hands RX forwarding its share, or everything the
+ *   command side left unused if that is more, as the frame bus forward
+ *   budget.
+ *
+ * When the TX queue is at least SCHED_TX_PRIORITY_PCT full, txPriority()
+ * asks the loop to refill the TX mailboxes before each command so queued
+ * frames drain ahead of new ones.
+ */
+class LoopScheduler {
+public:
+    /**
+     * Constructor.
+     * @param bus Shared RX frame bus (fill level in, forward budget out)
+     * @param can CAN backend (TX queue level)
+     */
+    LoopScheduler(FrameBus& bus, ICANBackend& can);
+
+    /**
+     * Start a loop iteration and choose its budgets.
+     */
+    void beginTick();
+
+    /**
+     * Check whether the command side may process another command.
+     * @return true while the tick's command budget has time left
+     */
+    bool commandTimeLeft() const;
+
+    /**
+     * Check whether the TX queue should be serviced before each command.
+     */
+    bool txPriority() const;
+
+    /**
+     * End the command side and start the RX forward budget.
+     */
+    void beginForward();
+
+    /**
+     * Get the budgets of the current (or last) tick.
+     */
+    const SchedulerPolicy& getPolicy() const;
+
+    /**
+     * Get diagnostic counters.
+     * @param rxBoostTicks Output: ticks with more than the minimum RX share
+     * @param txPriorityTicks Output: ticks run with TX priority
+     * @param overruns Output: ticks that took longer than SCHED_TICK_BUDGET_US
+     */
+    void getCounters(uint32_t* rxBoostTicks, uint32_t* txPriorityTicks, uint32_t* overruns) const;
+
+    /**
+     * Reset diagnostic counters.
+     */
+    void resetCounters();
+
+private:
+    FrameBus& _bus;
+    ICANBackend& _can;
+    SchedulerPolicy _policy;
+    uint32_t _tickStart;        // micros() at beginTick()
+    bool _tickActive;           // beginTick() seen (overrun check needs a previous tick)
+
+    // Diagnostic counters
+    uint32_t _rxBoostTicks;
+    uint32_t _txPriorityTicks;
+    uint32_t _overrunCount;
+};
+
+#endif // LOOP_SCHEDULER_H
@@ -3,13 +3,17 @@
  */
 
 #include "ProtocolDispatcher.h"
+#include "Profiler.h"
 #include <string.h>
 
 ProtocolDispatcher::ProtocolDispatcher()
     : _handlerCount(0)
+    , _streamOwner(nullptr)
+    , _can(nullptr)
 {
     for (size_t i = 0; i < MAX_PROTOCOL_HANDLERS; i++) {
         _handlers[i] = nullptr;
+        _readers[i] = FRAME_BUS_NO_READER;
     }
 }
 
@@ -30,7 +34,24 @@ bool ProtocolDispatcher::registerHandler(IProtocolHandler* handler) {
         return false;
     }
 
-    _handlers[_handlerCount++] = handler;
+    uint8_t reader = _bus.attachReader();
+    _handlers[_handlerCount] = handler;
+    _readers[_handlerCount] = reader;
+    _handlerCount++;
+    handler->attachFrameBus(&_bus, reader);
+
+    // Later handlers only get the bytes nobody claimed yet
+    _routes.setSlot((uint8_t)(_handlerCount - 1));
+    handler->registerRoutes(_routes);
+    _routes.setSlot(COMMAND_ROUTE_NO_SLOT);
+
+    // First handler owns the RX stream until someone takes it over
+    if (_streamOwner == nullptr) {
+        _streamOwner = handler;
+        handler->onStreamOwnership(true);
+    } else {
+        handler->onStreamOwnership(false);
+    }
     return true;
 }
 
@@ -41,11 +62,28 @@ bool ProtocolDispatcher::unregisterHandler(IProtocolHandler* handler) {
 
     for (size_t i = 0; i < _handlerCount; i++) {
         if (_handlers[i] == handler) {
+            _bus.detachReader(_readers[i]);
+            handler->attachFrameBus(nullptr, FRAME_BUS_NO_READER);
+
             // Shift remaining handlers down
             for (size_t j = i; j < _handlerCount - 1; j++) {
                 _handlers[j] = _handlers[j + 1];
+                _readers[j] = _readers[j + 1];
+            }
+            _handlerCount--;
+            _handlers[_handlerCount] = nullptr;
+            _readers[_handlerCount] = FRAME_BUS_NO_READER;
+
+            // Slots shifted and freed bytes may fall to a later handler
+            rebuildRoutes();
+
+            if (_streamOwner == handler) {
+                handler->onStreamOwnership(false);
+                _streamOwner = (_handlerCount > 0) ? _handlers[0] : nullptr;
+                if (_streamOwner != nullptr) {
+                    _streamOwner->onStreamOwnership(true);
+                }
             }
-            _handlers[--_handlerCount] = nullptr;
             return true;
         }
     }
@@ -63,11 +101,10 @@ bool ProtocolDispatcher::dispatch(const char* cmd, char* response, size_t maxLen
         return false;
     }
 
-    // Try each handler in order
-    for (size_t i = 0; i < _handlerCount; i++) {
-        if (_handlers[i] != nullptr && _handlers[i]->canHandle(cmd)) {
-            return _handlers[i]->processCommand(cmd, response, maxLen);
-        }
+    uint8_t slot;
+    CommandRouteFn fn = _routes.lookup((uint8_t)cmd[0], &slot);
+    if (fn != nullptr) {
+        return fn(_handlers[slot], cmd, response, maxLen);
     }
 
     // No handler found - return error
@@ -81,7 +118,21 @@ bool ProtocolDispatcher::dispatch(const char* cmd, char* response, size_t maxLen
     return false;
 }
 
+void ProtocolDispatcher::setFrameSource(ICANBackend* can) {
+    _can = can;
+}
+
+FrameBus& ProtocolDispatcher::getFrameBus() {
+    return _bus;
+}
+
 void ProtocolDispatcher::pollAll(ITransport* transport) {
+    // Pull received frames from the backend once for all handlers
+    if (_can != nullptr && _can->isOpen()) {
+        PROFILE_SCOPE(ProfileProbe::FrameBusFill);
+        _bus.fill(*_can);
+    }
+
     for (size_t i = 0; i < _handlerCount; i++) {
         if (_handlers[i] != nullptr) {
             _handlers[i]->poll(transport);
@@ -99,3 +150,48 @@ IProtocolHandler* ProtocolDispatcher::getHandler(size_t index) const {
     }
     return _handlers[index];
 }
+
+bool ProtocolDispatcher::setStreamOwner(IProtocolHandler* handler) {
+    if (handler != nullptr) {
+        bool registered = false;
+        for (size_t i = 0; i < _handlerCount; i++) {
+            if (_handlers[i] == handler) {
+                registered = true;
+                break;
+            }
+        }
+        if (!registered) {
+            return false;
+        }
+    }
+
+    if (handler == _streamOwner) {
+        return true;
+    }
+
+    if (_streamOwner != nullptr) {
+        _streamOwner->onStreamOwnership(false);
+    }
+    _streamOwner = handler;
+    if (_streamOwner != nullptr) {
+        _streamOwner->onStreamOwnership(true);
+    }
+    return true;
+}
+
+IProtocolHandler* ProtocolDispatcher::getStreamOwner() const {
+    return _streamOwner;
+}
+
+uint16_t ProtocolDispatcher::getRouteCount() const {
+    return _routes.size();
+}
+
+void ProtocolDispatcher::rebuildRoutes() {
+    _routes.clear();
+    for (size_t i = 0; i < _handlerCount; i++) {
+        _routes.setSlot((uint8_t)i);
+        _handlers[i]->registerRoutes(_routes);
+    }
+    _routes.setSlot(COMMAND_ROUTE_NO_SLOT);
+}
@@ -10,18 +10,26 @@
 
 #include "ProtocolHandler.h"
 #include "Transport.h"
+#include "FrameBus.h"
+#include "CommandRouteTable.h"
 
 #ifndef MAX_PROTOCOL_HANDLERS
-#define MAX_PROTOCOL_HANDLERS 4
+#define MAX_PROTOCOL_HANDLERS 5
 #endif
 
+static_assert(MAX_PROTOCOL_HANDLERS < COMMAND_ROUTE_NO_SLOT,
+              "MAX_PROTOCOL_HANDLERS must fit a route table slot");
+
 /**
  * Protocol dispatcher for routing commands to handlers.
  *
  * Features:
  * - Register multiple protocol handlers
- * - Route commands to the appropriate handler
+ * - Route commands to the appropriate handler through a 256-entry
+ *   table indexed by the first command byte (filled at registration)
  * - Poll all handlers for async operations
+ * - Select which handler streams received frames to the host
+ * - Own the shared RX frame bus that all handlers read from
  */
 class ProtocolDispatcher {
 public:
@@ -43,6 +51,7 @@ public:
 
     /**
      * Dispatch a command to the appropriate handler.
+     * One table lookup on the first byte, independent of the handler count.
      *
      * @param cmd The command string
      * @param response Output buffer for the response
@@ -51,9 +60,21 @@ public:
      */
     bool dispatch(const char* cmd, char* response, size_t maxLen);
 
+    /**
+     * Set the CAN backend that feeds the shared frame bus.
+     * @param can Backend pointer (must remain valid), or nullptr
+     */
+    void setFrameSource(ICANBackend* can);
+
+    /**
+     * Get the shared RX frame bus.
+     */
+    FrameBus& getFrameBus();
+
     /**
      * Poll all registered handlers.
-     * Call this regularly from the main loop.
+     * Call this regularly from the main loop. Fills the frame bus from
+     * the backend once, then lets every handler consume it.
      *
      * @param transport Transport to pass to handlers for output
      */
@@ -72,9 +93,40 @@ public:
      */
     IProtocolHandler* getHandler(size_t index) const;
 
+    /**
+     * Select the handler that forwards received CAN frames to the host.
+     * The first registered handler owns the stream by default. The old
+     * and new owners are notified via onStreamOwnership().
+     *
+     * @param handler Registered handler to take the stream (nullptr = nobody)
+     * @return true on success, false if the handler is not registered
+     */
+    bool setStreamOwner(IProtocolHandler* handler);
+
+    /**
+     * Get the handler that currently owns the RX stream.
+     * @return Handler pointer or nullptr if none
+     */
+    IProtocolHandler* getStreamOwner() const;
+
+    /**
+     * Get the number of command bytes that are routed to a handler.
+     */
+    uint16_t getRouteCount() const;
+
 private:
+    /**
+     * Rebuild the route table from the registered handlers, in order.
+     */
+    void rebuildRoutes();
+
     IProtocolHandler* _handlers[MAX_PROTOCOL_HANDLERS];
+    uint8_t _readers[MAX_PROTOCOL_HANDLERS];     // Frame bus reader per handler
     size_t _handlerCount;
+    IProtocolHandler* _streamOwner;
+    FrameBus _bus;
+    ICANBackend* _can;
+    CommandRouteTable _routes;
 };
 
 #endif // PROTOCOL_DISPATCHER_H
@@ -11,8 +11,41 @@
 #include <stdint.h>
 #include <stddef.h>
 
-// Forward declaration
+// Forward declarations
 class ITransport;
+class FrameBus;
+class IProtocolHandler;
+
+/**
+ * Command route target.
+ * Called by the dispatcher with the handler that registered the route.
+ *
+ * @param handler Handler that registered the route
+ * @param cmd The command string (without terminator)
+ * @param response Output buffer for the response (without terminator)
+ * @param maxLen Maximum response buffer size
+ * @return true if a response was generated, false if no response needed
+ */
+typedef bool (*CommandRouteFn)(IProtocolHandler* handler, const char* cmd,
+                               char* response, size_t maxLen);
+
+/**
+ * Sink for command routes, filled by handlers at registration time.
+ * A route maps the first byte of a command line to a function.
+ */
+class ICommandRoutes {
+public:
+    /**
+     * Route commands starting with a byte to a function.
+     * @param prefix First command byte (not 0)
+     * @param fn Function to call for such commands
+     * @return true if added, false if the byte is already taken
+     */
+    virtual bool addRoute(uint8_t prefix, CommandRouteFn fn) = 0;
+
+protected:
+    ~ICommandRoutes() = default;
+};
 
 /**
  * Abstract protocol handler interface.
@@ -48,6 +81,28 @@ public:
      */
     virtual bool processCommand(const char* cmd, char* response, size_t maxLen) = 0;
 
+    /**
+     * Register the command prefixes this handler serves.
+     * Called by the dispatcher whenever its route table is rebuilt. Routes
+     * go by the first command byte only; a byte already taken by an
+     * earlier handler stays with it.
+     *
+     * The default asks canHandle() about every one-byte prefix and routes
+     * the matches to processCommand(). Handlers with many commands can
+     * route each prefix straight to the function that implements it.
+     *
+     * @param routes Route table to fill in
+     */
+    virtual void registerRoutes(ICommandRoutes& routes) const {
+        char probe[2] = { 0, '\0' };
+        for (unsigned c = 1; c < 256; c++) {
+            probe[0] = (char)c;
+            if (canHandle(probe)) {
+                routes.addRoute((uint8_t)c, &IProtocolHandler::routeProcessCommand);
+            }
+        }
+    }
+
     /**
      * Periodic poll function.
      * Called regularly from the main loop for async operations
@@ -63,7 +118,35 @@ public:
      */
     virtual bool isActive() const = 0;
 
+    /**
+     * Notify the handler that it gained or lost the RX frame stream.
+     * Only the dispatcher's stream owner forwards received CAN frames to
+     * the host. Handlers that never forward frames can ignore this.
+     *
+     * @param owner true if this handler now owns the RX stream
+     */
+    virtual void onStreamOwnership(bool owner) { (void)owner; }
+
+    /**
+     * Give the handler its cursor on the dispatcher's shared RX frame bus.
+     * Called on registration (and with nullptr on unregistration).
+     * Handlers that don't consume received frames can ignore this.
+     *
+     * @param bus Shared frame bus, or nullptr when detached
+     * @param reader Reader id to use with the bus
+     */
+    virtual void attachFrameBus(FrameBus* bus, uint8_t reader) { (void)bus; (void)reader; }
+
     virtual ~IProtocolHandler() = default;
+
+protected:
+    /**
+     * Route target that forwards to processCommand().
+     */
+    static bool routeProcessCommand(IProtocolHandler* handler, const char* cmd,
+                                    char* response, size_t maxLen) {
+        return handler->processCommand(cmd, response, maxLen);
+    }
 };
 
 #endif // PROTOCOL_HANDLER_H
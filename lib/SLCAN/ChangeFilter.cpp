@@ -0,0 +1,136 @@
+/**
+ * Change Filter Implementation
+ */
+
+#include "ChangeFilter.h"
+#include <string.h>
+
+#define CHANGE_CACHE_NO_SLOT    0xFF
+#define CHANGE_CACHE_EXT_EMPTY  0xFFFFFFFFUL    // Not a valid 29-bit ID
+
+ChangeFilter::ChangeFilter()
+    : _enabled(false)
+    , _keepAliveMs(0)
+    , _stdUsed(0)
+    , _suppressedCount(0)
+    , _untrackedCount(0)
+{
+    clear();
+}
+
+void ChangeFilter::setEnabled(bool enabled, uint16_t keepAliveMs) {
+    if (enabled) {
+        clear();    // Also lets the host force a full refresh with u1
+    }
+    _enabled = enabled;
+    _keepAliveMs = enabled ? keepAliveMs : 0;
+}
+
+bool ChangeFilter::isEnabled() const {
+    return _enabled;
+}
+
+uint16_t ChangeFilter::getKeepAlive() const {
+    return _keepAliveMs;
+}
+
+bool ChangeFilter::check(const CANFrame& frame) {
+    if (!_enabled || frame.rtr || frame.echo) {
+        return true;
+    }
+
+    const Slot* slot = lookup(frame, true);
+    if (slot == nullptr) {
+        _untrackedCount++;
+        return true;
+    }
+
+    if (!slot->valid || slot->dlc != frame.dlc || memcmp(slot->data, frame.data, frame.dlc) != 0) {
+        return true;
+    }
+
+    // Unchanged: refresh anyway once the keep-alive interval has passed
+    // (frame.timestamp is in microseconds, wrap-safe difference)
+    if (_keepAliveMs != 0 && frame.timestamp - slot->sentAt >= (uint32_t)_keepAliveMs * 1000UL) {
+        return true;
+    }
+
+    _suppressedCount++;
+    return false;
+}
+
+void ChangeFilter::commit(const CANFrame& frame) {
+    if (!_enabled || frame.rtr || frame.echo) {
+        return;
+    }
+
+    Slot* slot = lookup(frame, false);
+    if (slot == nullptr) {
+        return;
+    }
+    memcpy(slot->data, frame.data, sizeof(slot->data));
+    slot->dlc = frame.dlc;
+    slot->sentAt = frame.timestamp;
+    slot->valid = true;
+}
+
+void ChangeFilter::clear() {
+    memset(_stdIndex, CHANGE_CACHE_NO_SLOT, sizeof(_stdIndex));
+    for (uint8_t i = 0; i < CHANGE_CACHE_STD_SLOTS; i++) {
+        _std[i].valid = false;
+    }
+    _stdUsed = 0;
+    for (uint8_t i = 0; i < CHANGE_CACHE_EXT_SLOTS; i++) {
+        _ext[i].id = CHANGE_CACHE_EXT_EMPTY;
+        _ext[i].payload.valid = false;
+    }
+}
+
+void ChangeFilter::getCounters(uint32_t* suppressed, uint32_t* untracked) const {
+    if (suppressed) *suppressed = _suppressedCount;
+    if (untracked) *untracked = _untrackedCount;
+}
+
+void ChangeFilter::resetCounters() {
+    _suppressedCount = 0;
+    _untrackedCount = 0;
+}
+
+ChangeFilter::Slot* ChangeFilter::lookup(const CANFrame& frame, bool allocate) {
+    if (!frame.extended) {
+        uint16_t id = frame.id & (CHANGE_CACHE_STD_IDS - 1);
+        uint8_t index = _stdIndex[id];
+        if (index == CHANGE_CACHE_NO_SLOT) {
+            if (!allocate || _stdUsed >= CHANGE_CACHE_STD_SLOTS) {
+                return nullptr;
+            }
+            index = _stdUsed++;
+            _stdIndex[id] = index;
+        }
+        return &_std[index];
+    }
+
+    // Linear probing; slots are only freed all at once by clear()
+    uint8_t i = extHash(frame.id);
+    for (uint8_t probes = 0; probes < CHANGE_CACHE_EXT_SLOTS; probes++) {
+        ExtSlot& e = _ext[i];
+        if (e.id == frame.id) {
+            return &e.payload;
+        }
+        if (e.id == CHANGE_CACHE_EXT_EMPTY) {
+            if (!allocate) {
+                return nullptr;
+            }
+            e.id = frame.id;
+            return &e.payload;
+        }
+        i = (i + 1) & (CHANGE_CACHE_EXT_SLOTS - 1);
+    }
+    return nullptr;
+}
+
+uint8_t ChangeFilter::extHash(uint32_t id) {
+    // Fibonacci hashing: the top bits of id * 2^32/phi spread nearby IDs
+    uint32_t h = id * 2654435761UL;
+    return (uint8_t)((h >> 24) & (CHANGE_CACHE_EXT_SLOTS - 1));
+}
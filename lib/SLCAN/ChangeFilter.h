@@ -0,0 +1,126 @@
+/**
+ * Change Filter
+ *
+ * Per-ID cache of the last forwarded payload for change-only RX
+ * forwarding (u command): on buses dominated by cyclic frames whose data
+ * rarely changes, only frames that differ from the last one sent for
+ * their ID reach the host.
+ */
+
+#ifndef CHANGE_FILTER_H
+#define CHANGE_FILTER_H
+
+#include "config.h"
+#include "CANBackend.h"
+#include <stdint.h>
+
+#ifndef CHANGE_CACHE_STD_SLOTS
+#define CHANGE_CACHE_STD_SLOTS  64
+#endif
+
+#ifndef CHANGE_CACHE_EXT_SLOTS
+#define CHANGE_CACHE_EXT_SLOTS  16
+#endif
+
+#define CHANGE_CACHE_STD_IDS    2048    // Direct index covers every 11-bit ID
+
+static_assert(CHANGE_CACHE_STD_SLOTS > 0 && CHANGE_CACHE_STD_SLOTS < 255,
+              "CHANGE_CACHE_STD_SLOTS must be 1..254");
+static_assert((CHANGE_CACHE_EXT_SLOTS & (CHANGE_CACHE_EXT_SLOTS - 1)) == 0,
+              "CHANGE_CACHE_EXT_SLOTS must be a power of two");
+
+/**
+ * Duplicate-payload filter for the RX stream.
+ *
+ * Standard IDs are looked up through a 2048-entry direct index into a
+ * pool of CHANGE_CACHE_STD_SLOTS payload slots, handed out as new IDs
+ * appear. Extended IDs live in a CHANGE_CACHE_EXT_SLOTS open-addressing
+ * (linear probing) hash. IDs that find no free slot are never
+ * suppressed. Remote frames and TX echoes always pass.
+ *
+ * check() and commit() are split so a frame the transport refuses is not
+ * remembered: its retry must not be suppressed as a duplicate.
+ */
+class ChangeFilter {
+public:
+    ChangeFilter();
+
+    /**
+     * Turn change-only forwarding on or off. Turning it on starts with an
+     * empty cache, so every ID is forwarded once.
+     * @param enabled true to suppress unchanged frames
+     * @param keepAliveMs Forward an unchanged frame anyway once this long
+     *                    has passed since its ID was last sent (0 = never)
+     */
+    void setEnabled(bool enabled, uint16_t keepAliveMs);
+
+    bool isEnabled() const;
+    uint16_t getKeepAlive() const;
+
+    /**
+     * Check whether a frame has to be forwarded.
+     * @param frame Received frame
+     * @return false if it repeats the cached payload of its ID (and no
+     *         keep-alive is due); always true while disabled
+     */
+    bool check(const CANFrame& frame);
+
+    /**
+     * Remember a frame that was forwarded.
+     * @param frame Frame that check() passed and the transport accepted
+     */
+    void commit(const CANFrame& frame);
+
+    /**
+     * Forget every cached payload (the next frame of each ID passes).
+     */
+    void clear();
+
+    /**
+     * Get diagnostic counters.
+     * @param suppressed Output: frames not forwarded (unchanged payload)
+     * @param untracked Output: frames forwarded because their ID found no cache slot
+     */
+    void getCounters(uint32_t* suppressed, uint32_t* untracked) const;
+
+    /**
+     * Reset diagnostic counters.
+     */
+    void resetCounters();
+
+private:
+    struct Slot {
+        uint32_t sentAt;        // Timestamp of the last forwarded frame (us)
+        uint8_t data[8];
+        uint8_t dlc;
+        bool valid;
+    };
+
+    struct ExtSlot {
+        uint32_t id;
+        Slot payload;
+    };
+
+    bool _enabled;
+    uint16_t _keepAliveMs;
+
+    uint8_t _stdIndex[CHANGE_CACHE_STD_IDS];    // Slot per 11-bit ID (0xFF = none)
+    Slot _std[CHANGE_CACHE_STD_SLOTS];
+    uint8_t _stdUsed;
+    ExtSlot _ext[CHANGE_CACHE_EXT_SLOTS];
+
+    // Diagnostic counters
+    uint32_t _suppressedCount;
+    uint32_t _untrackedCount;
+
+    /**
+     * Find the cache slot for a frame's ID.
+     * @param allocate true to claim a free slot for a new ID
+     * @return Slot, or nullptr if the ID has none (and none was free)
+     */
+    Slot* lookup(const CANFrame& frame, bool allocate);
+
+    static uint8_t extHash(uint32_t id);
+};
+
+#endif // CHANGE_FILTER_H
@@ -0,0 +1,225 @@
+/**
+ * Cyclic Transmitter Implementation
+ */
+
+#include "CyclicTransmitter.h"
+#include <string.h>
+
+#define CYCLIC_TX_NO_ENTRY      0xFF
+#define CYCLIC_TX_WHEEL_MASK    (CYCLIC_TX_WHEEL_SLOTS - 1)
+
+CyclicTransmitter::CyclicTransmitter()
+    : _count(0)
+    , _tick(0)
+    , _sentCount(0)
+    , _rejectCount(0)
+{
+    clear();
+}
+
+bool CyclicTransmitter::set(const CANFrame& frame, uint16_t periodMs) {
+    uint32_t maxId = frame.extended ? 0x1FFFFFFFUL : 0x7FFUL;
+    if (periodMs == 0 || frame.id > maxId || frame.dlc > 8) {
+        return false;
+    }
+
+    int8_t index = find(frame.id, frame.extended);
+    if (index >= 0) {
+        unlink((uint8_t)index);
+    } else {
+        for (uint8_t i = 0; i < CYCLIC_TX_MAX_ENTRIES && index < 0; i++) {
+            if (_entries[i].period == 0) {
+                index = (int8_t)i;
+            }
+        }
+        if (index < 0) {
+            return false;
+        }
+        Entry& fresh = _entries[index];
+        fresh.counterByte = CYCLIC_TX_NO_BYTE;
+        fresh.modulus = 0;
+        fresh.counter = 0;
+        fresh.checksumByte = CYCLIC_TX_NO_BYTE;
+        _count++;
+    }
+
+    Entry& entry = _entries[index];
+    entry.frame = frame;
+    entry.frame.echo = false;
+    entry.period = periodMs;
+    entry.due = _tick + 1;
+    entry.fireAt = entry.due;
+    link((uint8_t)index);
+    return true;
+}
+
+bool CyclicTransmitter::update(const CANFrame& frame) {
+    int8_t index = find(frame.id, frame.extended);
+    if (index < 0 || frame.dlc > 8) {
+        return false;
+    }
+    CANFrame& stored = _entries[index].frame;
+    stored.dlc = frame.dlc;
+    stored.rtr = frame.rtr;
+    memcpy(stored.data, frame.data, sizeof(stored.data));
+    return true;
+}
+
+bool CyclicTransmitter::setCounter(uint32_t id, bool extended, uint8_t counterByte,
+                                   uint8_t modulus, uint8_t checksumByte) {
+    int8_t index = find(id, extended);
+    if (index < 0) {
+        return false;
+    }
+    bool counterOk = counterByte == CYCLIC_TX_NO_BYTE || counterByte < 8;
+    bool checksumOk = checksumByte == CYCLIC_TX_NO_BYTE || checksumByte < 8;
+    if (!counterOk || !checksumOk
+        || (counterByte != CYCLIC_TX_NO_BYTE && counterByte == checksumByte)) {
+        return false;
+    }
+
+    Entry& entry = _entries[index];
+    entry.counterByte = counterByte;
+    entry.modulus = modulus;
+    entry.counter = 0;
+    entry.checksumByte = checksumByte;
+    return true;
+}
+
+bool CyclicTransmitter::remove(uint32_t id, bool extended) {
+    int8_t index = find(id, extended);
+    if (index < 0) {
+        return false;
+    }
+    unlink((uint8_t)index);
+    _entries[index].period = 0;
+    _count--;
+    return true;
+}
+
+void CyclicTransmitter::clear() {
+    for (uint8_t i = 0; i < CYCLIC_TX_MAX_ENTRIES; i++) {
+        _entries[i].period = 0;
+    }
+    memset(_wheel, CYCLIC_TX_NO_ENTRY, sizeof(_wheel));
+    _count = 0;
+}
+
+uint8_t CyclicTransmitter::getEntryCount() const {
+    return _count;
+}
+
+uint8_t CyclicTransmitter::poll(ICANBackend& can, uint32_t nowMs) {
+    // After a long stall one revolution visits every slot once, which
+    // sends each overdue entry once
+    if ((uint32_t)(nowMs - _tick) > CYCLIC_TX_WHEEL_SLOTS) {
+        _tick = nowMs - CYCLIC_TX_WHEEL_SLOTS;
+    }
+    if (_count == 0) {
+        _tick = nowMs;
+        return 0;
+    }
+
+    uint8_t queued = 0;
+    bool full = false;
+    while (_tick != nowMs) {
+        _tick++;
+
+        // Detach the slot, then send or re-link each entry in it
+        uint8_t slot = (uint8_t)(_tick & CYCLIC_TX_WHEEL_MASK);
+        uint8_t index = _wheel[slot];
+        _wheel[slot] = CYCLIC_TX_NO_ENTRY;
+
+        while (index != CYCLIC_TX_NO_ENTRY) {
+            Entry& entry = _entries[index];
+            uint8_t following = entry.next;
+
+            if ((int32_t)(_tick - entry.fireAt) >= 0) {
+                stamp(entry);
+                if (!full && can.write(entry.frame)) {
+                    queued++;
+                    _sentCount++;
+                    if (entry.counterByte != CYCLIC_TX_NO_BYTE) {
+                        entry.counter++;
+                        if (entry.modulus != 0 && entry.counter >= entry.modulus) {
+                            entry.counter = 0;
+                        }
+                    }
+                    entry.due += entry.period;
+                    if ((int32_t)(entry.due - nowMs) <= 0) {
+                        entry.due = nowMs + entry.period;   // Skip missed cycles
+                    }
+                    entry.fireAt = entry.due;
+                } else {
+                    // TX queue full: the rest of this poll waits for the next tick
+                    if (!full) {
+                        _rejectCount++;
+                    }
+                    full = true;
+                    entry.fireAt = nowMs + 1;
+                }
+            }
+
+            link(index);
+            index = following;
+        }
+    }
+    return queued;
+}
+
+void CyclicTransmitter::stamp(Entry& entry) {
+    CANFrame& f = entry.frame;
+    if (f.rtr) {
+        return;
+    }
+    if (entry.counterByte < f.dlc) {
+        f.data[entry.counterByte] = entry.counter;
+    }
+    if (entry.checksumByte < f.dlc) {
+        uint8_t sum = 0;
+        for (uint8_t i = 0; i < f.dlc; i++) {
+            if (i != entry.checksumByte) {
+                sum ^= f.data[i];
+            }
+        }
+        f.data[entry.checksumByte] = sum;
+    }
+}
+
+int8_t CyclicTransmitter::find(uint32_t id, bool extended) const {
+    for (uint8_t i = 0; i < CYCLIC_TX_MAX_ENTRIES; i++) {
+        const Entry& e = _entries[i];
+        if (e.period != 0 && e.frame.id == id && e.frame.extended == extended) {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+void CyclicTransmitter::link(uint8_t index) {
+    uint8_t slot = (uint8_t)(_entries[index].fireAt & CYCLIC_TX_WHEEL_MASK);
+    _entries[index].next = _wheel[slot];
+    _wheel[slot] = index;
+}
+
+void CyclicTransmitter::unlink(uint8_t index) {
+    uint8_t slot = (uint8_t)(_entries[index].fireAt & CYCLIC_TX_WHEEL_MASK);
+    uint8_t* p = &_wheel[slot];
+    while (*p != CYCLIC_TX_NO_ENTRY) {
+        if (*p == index) {
+            *p = _entries[index].next;
+            return;
+        }
+        p = &_entries[*p].next;
+    }
+}
+
+void CyclicTransmitter::getCounters(uint32_t* sent, uint32_t* rejects) const {
+    if (sent) *sent = _sentCount;
+    if (rejects) *rejects = _rejectCount;
+}
+
+void CyclicTransmitter::resetCounters() {
+    _sentCount = 0;
+    _rejectCount = 0;
+}
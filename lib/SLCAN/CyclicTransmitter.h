@@ -0,0 +1,143 @@
+/**
+ * Cyclic Transmitter
+ *
+ * On-device periodic transmit table (c command): simulated ECU frames
+ * are sent at their cycle time from firmware, so host jitter and USB
+ * latency don't reach the bus and the host only sends payload updates.
+ */
+
+#ifndef CYCLIC_TRANSMITTER_H
+#define CYCLIC_TRANSMITTER_H
+
+#include "config.h"
+#include "CANBackend.h"
+#include <stdint.h>
+
+#ifndef CYCLIC_TX_MAX_ENTRIES
+#define CYCLIC_TX_MAX_ENTRIES   16
+#endif
+
+#ifndef CYCLIC_TX_WHEEL_SLOTS
+#define CYCLIC_TX_WHEEL_SLOTS   64
+#endif
+
+#define CYCLIC_TX_NO_BYTE       0xFF    // No counter / checksum byte
+
+static_assert(CYCLIC_TX_MAX_ENTRIES > 0 && CYCLIC_TX_MAX_ENTRIES <= 127,
+              "CYCLIC_TX_MAX_ENTRIES must be 1..127");
+static_assert((CYCLIC_TX_WHEEL_SLOTS & (CYCLIC_TX_WHEEL_SLOTS - 1)) == 0,
+              "CYCLIC_TX_WHEEL_SLOTS must be a power of two");
+
+/**
+ * Periodic frame table on a hashed timer wheel.
+ *
+ * The wheel has one slot per millisecond tick, CYCLIC_TX_WHEEL_SLOTS
+ * slots around; an entry sits in the slot of its next send time. poll()
+ * walks the slots of the ticks that passed since the last call and sends
+ * the entries that are due, so the cost per call depends on the entries
+ * due, not on the table size. Periods longer than one revolution just
+ * skip their slot until their round comes.
+ *
+ * Cycles are kept on a fixed grid (next = previous + period). After a
+ * stall longer than a period the missed cycles are skipped, not sent in
+ * a burst. A frame the TX queue refuses is retried on the next tick.
+ *
+ * Each entry can carry a rolling counter byte (0..modulus-1, one step
+ * per transmission) and an XOR checksum byte over the other data bytes,
+ * both filled in at send time.
+ */
+class CyclicTransmitter {
+public:
+    CyclicTransmitter();
+
+    /**
+     * Add an entry, or replace the entry with the same ID. The first
+     * frame goes out on the next tick; counter settings are kept on replace.
+     * @param frame Frame to send (ID, type, RTR, DLC, data)
+     * @param periodMs Cycle time in ms (1-65535)
+     * @return true on success, false if invalid or the table is full
+     */
+    bool set(const CANFrame& frame, uint16_t periodMs);
+
+    /**
+     * Change the DLC and data of an entry without touching its timing.
+     * @param frame New payload for the entry with frame's ID and type
+     * @return true if the entry exists
+     */
+    bool update(const CANFrame& frame);
+
+    /**
+     * Set the counter and checksum bytes of an entry.
+     * @param id CAN identifier
+     * @param extended true for a 29-bit ID
+     * @param counterByte Data byte for the rolling counter, or CYCLIC_TX_NO_BYTE
+     * @param modulus Counter wraps to 0 here (0 = 256)
+     * @param checksumByte Data byte for the XOR checksum, or CYCLIC_TX_NO_BYTE
+     * @return true if the entry exists and the bytes are valid
+     */
+    bool setCounter(uint32_t id, bool extended, uint8_t counterByte, uint8_t modulus,
+                    uint8_t checksumByte);
+
+    /**
+     * Remove the entry with this ID.
+     * @return true if it existed
+     */
+    bool remove(uint32_t id, bool extended);
+
+    /**
+     * Remove all entries.
+     */
+    void clear();
+
+    uint8_t getEntryCount() const;
+
+    /**
+     * Send the entries that became due up to nowMs.
+     * Call once per main loop iteration while the channel can transmit.
+     * @param can Backend to write to
+     * @param nowMs Current time (millis())
+     * @return Number of frames queued
+     */
+    uint8_t poll(ICANBackend& can, uint32_t nowMs);
+
+    /**
+     * Get diagnostic counters.
+     * @param sent Output: frames the backend accepted
+     * @param rejects Output: sends the backend refused (TX queue full)
+     */
+    void getCounters(uint32_t* sent, uint32_t* rejects) const;
+
+    /**
+     * Reset diagnostic counters.
+     */
+    void resetCounters();
+
+private:
+    struct Entry {
+        CANFrame frame;
+        uint32_t due;           // Next cycle on the grid (ms)
+        uint32_t fireAt;        // Wheel position: due, or a retry tick
+        uint16_t period;        // 0 = entry unused
+        uint8_t counterByte;
+        uint8_t modulus;
+        uint8_t counter;
+        uint8_t checksumByte;
+        uint8_t next;           // Next entry in the same wheel slot
+    };
+
+    Entry _entries[CYCLIC_TX_MAX_ENTRIES];
+    uint8_t _wheel[CYCLIC_TX_WHEEL_SLOTS];     // First entry per slot
+    uint8_t _count;
+    uint32_t _tick;                             // Last tick poll() handled
+
+    // Diagnostic counters
+    uint32_t _sentCount;
+    uint32_t _rejectCount;
+
+    int8_t find(uint32_t id, bool extended) const;
+    void link(uint8_t index);
+    void unlink(uint8_t index);
+    void stamp(Entry& entry);
+};
+
+#endif // CYCLIC_TRANSMITTER_H
@@ -3,22 +3,54 @@
  */
 
 #include "SLCAN.h"
+#include "SLCANHex.h"
 #include "Transport.h"
+#include "Profiler.h"
 #include "config.h"
 #include <Arduino.h>
 #include <string.h>
 
+// Frames parsed per ICANBackend::writeBatch() call in the b command
+static const uint8_t TX_BATCH_CHUNK = 8;
+
+// Bytes of A readout packed into one transport write (an RX record holds 255)
+static const size_t POLL_ALL_CHUNK_LEN = 240;
+
+static_assert(RESPONSE_BUFFER_SIZE >= SLCAN_PROFILE_RESPONSE_LEN + 2,
+              "RESPONSE_BUFFER_SIZE too small for the y response");
+static_assert(RESPONSE_BUFFER_SIZE >= SLCAN_GEN_RESPONSE_LEN + 2,
+              "RESPONSE_BUFFER_SIZE too small for the g response");
+static_assert(RESPONSE_BUFFER_SIZE >= SLCAN_CHANGE_RESPONSE_LEN + 2,
+              "RESPONSE_BUFFER_SIZE too small for the u response");
+static_assert(RESPONSE_BUFFER_SIZE >= SLCAN_DECIMATE_RESPONSE_LEN + 2,
+              "RESPONSE_BUFFER_SIZE too small for the d response");
+static_assert(RESPONSE_BUFFER_SIZE >= SLCAN_CYCLIC_RESPONSE_LEN + 2,
+              "RESPONSE_BUFFER_SIZE too small for the c response");
+static_assert(RESPONSE_BUFFER_SIZE >= SLCAN_OVERFLOW_RESPONSE_LEN + 2,
+              "RESPONSE_BUFFER_SIZE too small for the o response");
+static_assert(RESPONSE_BUFFER_SIZE >= SLCAN_CAPTURE_RESPONSE_LEN + 2,
+              "RESPONSE_BUFFER_SIZE too small for the G response");
+static_assert(RESPONSE_BUFFER_SIZE >= SLCAN_POLL_RESPONSE_LEN + 2,
+              "RESPONSE_BUFFER_SIZE too small for the P response");
+
 SLCAN::SLCAN(ICANBackend& can)
     : _can(can)
     , _state(SLCANState::Closed)
     , _configuredBitrate(SLCAN_BITRATE_500K)  // Default to S6 (500k)
-    , _timestampEnabled(false)
+    , _timestampMode(SLCAN_TIMESTAMP_OFF)
     , _autoForward(true)                      // Default: auto-forward enabled
+    , _pollAll(false)
+    , _pollAllLeft(0)
+    , _streamOwner(true)                      // Until the dispatcher says otherwise
+    , _quietTx(false)
     , _filterMask(0)
     , _filterCode(0)
-    , _rxHead(0)
-    , _rxTail(0)
-    , _rxOverflowCount(0)
+    , _filterOpCount(0)
+    , _filterOpsOverflow(false)
+    , _bus(nullptr)
+    , _busReader(FRAME_BUS_NO_READER)
+    , _captureReadout(false)
+    , _captureReadPos(0)
     , _canRxDropCount(0)
 #if ENABLE_STATUS_LED
     , _lastTxLedTime(0)
@@ -26,10 +58,10 @@ SLCAN::SLCAN(ICANBackend& can)
     , _ledState(false)
 #endif
 {
-    // Initialize RX ring buffer
-    for (uint16_t i = 0; i < CAN_RX_QUEUE_SIZE; i++) {
-        _rxQueue[i].valid = false;
-        _rxQueue[i].timestamp = 0;
+    // canHandle() answers from this instead of walking the route list
+    memset(_prefixMask, 0, sizeof(_prefixMask));
+    for (size_t i = 0; i < ROUTE_COUNT; i++) {
+        _prefixMask[ROUTES[i].prefix >> 5] |= 1UL << (ROUTES[i].prefix & 31);
     }
 
 #if ENABLE_STATUS_LED
@@ -42,32 +74,55 @@ const char* SLCAN::getName() const {
     return "SLCAN";
 }
 
+// SLCAN handles all single-character command prefixes. The dispatcher's
+// route table, canHandle() and processCommand() all come from this list.
+const SLCAN::Route SLCAN::ROUTES[] = {
+    { SLCAN_CMD_SETUP,       &routeCommand<&SLCAN::handleSetup> },
+    { SLCAN_CMD_SETUP_BTR,   &routeResponse<&SLCAN::handleSetupBtr> },
+    { SLCAN_CMD_OPEN,        &routeResponse<&SLCAN::handleOpen> },
+    { SLCAN_CMD_LISTEN,      &routeResponse<&SLCAN::handleListen> },
+    { SLCAN_CMD_LOOPBACK,    &routeResponse<&SLCAN::handleLoopback> },
+    { SLCAN_CMD_CLOSE,       &routeResponse<&SLCAN::handleClose> },
+    { SLCAN_CMD_TX_STD,      &routeCommand<&SLCAN::handleTransmitStd> },
+    { SLCAN_CMD_TX_EXT,      &routeCommand<&SLCAN::handleTransmitExt> },
+    { SLCAN_CMD_TX_RTR_STD,  &routeCommand<&SLCAN::handleTransmitRtrStd> },
+    { SLCAN_CMD_TX_RTR_EXT,  &routeCommand<&SLCAN::handleTransmitRtrExt> },
+    { SLCAN_CMD_STATUS,      &routeResponse<&SLCAN::handleStatus> },
+    { SLCAN_CMD_VERSION,     &routeResponse<&SLCAN::handleVersion> },
+    { SLCAN_CMD_SERIAL,      &routeResponse<&SLCAN::handleSerial> },
+    { SLCAN_CMD_TIMESTAMP,   &routeCommand<&SLCAN::handleTimestamp> },
+    { SLCAN_CMD_FILTER_MASK, &routeCommand<&SLCAN::handleFilterMask> },
+    { SLCAN_CMD_FILTER_CODE, &routeCommand<&SLCAN::handleFilterCode> },
+    { SLCAN_CMD_FILTER_RULE, &routeCommand<&SLCAN::handleFilterRule> },
+    { SLCAN_CMD_TX_BATCH,    &routeCommand<&SLCAN::handleBatchTransmit> },
+    { SLCAN_CMD_QUIET_TX,    &routeCommand<&SLCAN::handleQuietTx> },
+    { SLCAN_CMD_TX_ECHO,     &routeCommand<&SLCAN::handleTxEcho> },
+    { SLCAN_CMD_PROFILE,     &routeCommand<&SLCAN::handleProfile> },
+    { SLCAN_CMD_GENERATOR,   &routeCommand<&SLCAN::handleGenerator> },
+    { SLCAN_CMD_CHANGE_ONLY, &routeCommand<&SLCAN::handleChangeOnly> },
+    { SLCAN_CMD_DECIMATE,    &routeCommand<&SLCAN::handleDecimate> },
+    { SLCAN_CMD_CYCLIC,      &routeCommand<&SLCAN::handleCyclic> },
+    { SLCAN_CMD_OVERFLOW,    &routeCommand<&SLCAN::handleOverflow> },
+    { SLCAN_CMD_CAPTURE,     &routeCommand<&SLCAN::handleCapture> },
+    { SLCAN_CMD_AUTOPOLL,    &routeCommand<&SLCAN::handleAutoPoll> },
+    { SLCAN_CMD_POLL,        &routeCommand<&SLCAN::handlePoll> },
+    { SLCAN_CMD_POLL_ALL,    &routeCommand<&SLCAN::handlePollAll> },
+};
+
+const size_t SLCAN::ROUTE_COUNT = sizeof(SLCAN::ROUTES) / sizeof(SLCAN::ROUTES[0]);
+
 bool SLCAN::canHandle(const char* cmd) const {
     if (cmd == nullptr || cmd[0] == '\0') {
         return false;
     }
 
-    // SLCAN handles all single-character command prefixes
-    char c = cmd[0];
-    switch (c) {
-        case SLCAN_CMD_SETUP:
-        case SLCAN_CMD_SETUP_BTR:
-        case SLCAN_CMD_OPEN:
-        case SLCAN_CMD_LISTEN:
-        case SLCAN_CMD_CLOSE:
-        case SLCAN_CMD_TX_STD:
-        case SLCAN_CMD_TX_EXT:
-        case SLCAN_CMD_TX_RTR_STD:
-        case SLCAN_CMD_TX_RTR_EXT:
-        case SLCAN_CMD_STATUS:
-        case SLCAN_CMD_VERSION:
-        case SLCAN_CMD_SERIAL:
-        case SLCAN_CMD_TIMESTAMP:
-        case SLCAN_CMD_FILTER_MASK:
-        case SLCAN_CMD_FILTER_CODE:
-            return true;
-        default:
-            return false;
+    uint8_t prefix = (uint8_t)cmd[0];
+    return (_prefixMask[prefix >> 5] & (1UL << (prefix & 31))) != 0;
+}
+
+void SLCAN::registerRoutes(ICommandRoutes& routes) const {
+    for (size_t i = 0; i < ROUTE_COUNT; i++) {
+        routes.addRoute(ROUTES[i].prefix, ROUTES[i].fn);
     }
 }
 
@@ -76,60 +131,15 @@ bool SLCAN::processCommand(const char* cmd, char* response, size_t maxLen) {
         return false;
     }
 
-    char cmdChar = cmd[0];
-
-    switch (cmdChar) {
-        case SLCAN_CMD_SETUP:
-            return handleSetup(cmd, response);
-
-        case SLCAN_CMD_SETUP_BTR:
-            // Custom BTR not supported - return error
-            setError(response);
-            return true;
-
-        case SLCAN_CMD_OPEN:
-            return handleOpen(response);
-
-        case SLCAN_CMD_LISTEN:
-            return handleListen(response);
-
-        case SLCAN_CMD_CLOSE:
-            return handleClose(response);
-
-        case SLCAN_CMD_TX_STD:
-            return handleTransmitStd(cmd, response);
-
-        case SLCAN_CMD_TX_EXT:
-            return handleTransmitExt(cmd, response);
-
-        case SLCAN_CMD_TX_RTR_STD:
-            return handleTransmitRtrStd(cmd, response);
-
-        case SLCAN_CMD_TX_RTR_EXT:
-            return handleTransmitRtrExt(cmd, response);
-
-        case SLCAN_CMD_STATUS:
-            return handleStatus(response);
-
-        case SLCAN_CMD_VERSION:
-            return handleVersion(response);
-
-        case SLCAN_CMD_SERIAL:
-            return handleSerial(response);
-
-        case SLCAN_CMD_TIMESTAMP:
-            return handleTimestamp(cmd, response);
-
-        case SLCAN_CMD_FILTER_MASK:
-            return handleFilterMask(cmd, response);
-
-        case SLCAN_CMD_FILTER_CODE:
-            return handleFilterCode(cmd, response);
-
-        default:
-            setError(response);
-            return true;
+    // Same handlers the dispatcher's route table calls directly
+    for (size_t i = 0; i < ROUTE_COUNT; i++) {
+        if (ROUTES[i].prefix == (uint8_t)cmd[0]) {
+            return ROUTES[i].fn(this, cmd, response, maxLen);
+        }
     }
+
+    setError(response);
+    return true;
 }
 
 void SLCAN::poll(ITransport* transport) {
@@ -141,40 +151,66 @@ void SLCAN::poll(ITransport* transport) {
     updateLed();
 #endif
 
+    // Readouts (GR, then A) also run after the channel is closed
+    bool readout = _captureReadout && pollCaptureReadout(transport);
+    if (!readout && _pollAll) {
+        readout = pollAllReadout(transport);
+    }
+
     // Only forward frames if channel is open
     if (_state == SLCANState::Closed) {
         return;
     }
 
+    // Cyclic frames, then bench traffic, join the TX queue before it is serviced
+    if (_cyclic.getEntryCount() > 0 && canTransmit()) {
+        _cyclic.poll(_can, millis());
+    }
+    if (_generator.isRunning() && canTransmit()) {
+        _generator.poll(_can);
+    }
+
     // Step 0: Service TX queue first (drain pending TX frames)
     _can.serviceTxQueue();
 
-    if (!_autoForward) {
-        // Auto-forward disabled, skip RX processing
+    if (!_autoForward || !_streamOwner || _bus == nullptr) {
+        // Auto-forward disabled or another handler streams RX, skip RX processing
         return;
     }
 
-    // Step 1: Drain hardware backend into ring buffer (non-blocking)
-    drainFromBackend();
-
-    // Step 2: Forward from ring to serial, rate-limited
-    uint8_t framesProcessed = 0;
+    if (!transport->isConnected() || readout) {
+        return;  // No host yet, or a readout has the link: frames wait on the bus
+    }
 
-    while (framesProcessed < MAX_FRAMES_PER_POLL) {
-        CANFrame frame;
-        uint16_t timestamp;
+    // Forward from the shared frame bus to serial within the scheduler's
+    // time budget, at least one frame per poll.
+    // (The dispatcher filled the bus from the backend before polling us.)
+    uint16_t framesProcessed = 0;
 
-        if (!getNextRxFrame(frame, &timestamp)) {
-            break;  // Ring empty
+    while (framesProcessed == 0 || _bus->forwardTimeLeft()) {
+        const CANFrame* frame = _bus->peek(_busReader);
+        if (frame == nullptr) {
+            break;  // Nothing pending for us
         }
 
 #if ENABLE_STATUS_LED
         blinkRxLed();
 #endif
 
+        // Change-only mode: an unchanged payload costs no formatting or USB
+        if (!_changeFilter.check(*frame)) {
+            _bus->consume(_busReader);
+            framesProcessed++;
+            continue;
+        }
+
         // Format frame to SLCAN ASCII
         char buffer[SLCAN_MAX_EXT_FRAME_LEN];
-        size_t len = formatFrame(frame, buffer, sizeof(buffer));
+        size_t len;
+        {
+            PROFILE_SCOPE(ProfileProbe::Format);
+            len = formatFrame(*frame, buffer, sizeof(buffer));
+        }
         if (len > 0) {
             if (len + 1 > sizeof(buffer)) {
                 _canRxDropCount++;
@@ -182,28 +218,103 @@ void SLCAN::poll(ITransport* transport) {
             }
             buffer[len] = '\r';
             // Attempt write with CAN_RX_FRAME priority (0ms timeout, drop if no space)
-            if (!transport->writeWithPriority(buffer, len + 1, WritePriority::CAN_RX_FRAME)) {
+            bool written;
+            {
+                PROFILE_SCOPE(ProfileProbe::SerialWrite);
+                written = transport->writeWithPriority(buffer, len + 1, WritePriority::CAN_RX_FRAME);
+            }
+            if (!written) {
                 _canRxDropCount++;
-                break;  // USB blocked, stop forwarding this iteration (frames stay in ring)
+                break;  // USB blocked, stop forwarding this iteration (frame stays on the bus)
             }
+            _changeFilter.commit(*frame);
         }
 
+        _bus->consume(_busReader);
         framesProcessed++;
     }
 
-    // Note: Remaining frames stay in ring for next poll() call
+    // Note: Remaining frames stay on the bus for next poll() call
 }
 
 bool SLCAN::isActive() const {
     return _state != SLCANState::Closed;
 }
 
+void SLCAN::onStreamOwnership(bool owner) {
+    _streamOwner = owner;
+    if (!owner) {
+        _pollAll = false;   // The rest of an A readout would land in another protocol's stream
+    }
+    updateBusReader();
+}
+
+void SLCAN::attachFrameBus(FrameBus* bus, uint8_t reader) {
+    _bus = bus;
+    _busReader = reader;
+    updateBusReader();
+}
+
+bool SLCAN::canTransmit() const {
+    return _state == SLCANState::Open || _state == SLCANState::Loopback;
+}
+
+void SLCAN::updateBusReader() {
+    if (_bus != nullptr) {
+        // With X0 the frames wait on the bus for P/A
+        _bus->setReaderEnabled(_busReader, _state != SLCANState::Closed && _streamOwner);
+    }
+}
+
 SLCANState SLCAN::getState() const {
     return _state;
 }
 
 bool SLCAN::isTimestampEnabled() const {
-    return _timestampEnabled;
+    return _timestampMode != SLCAN_TIMESTAMP_OFF;
+}
+
+uint8_t SLCAN::getTimestampMode() const {
+    return _timestampMode;
+}
+
+void SLCAN::getSettings(SLCANSettings& settings) const {
+    settings.bitrate = _configuredBitrate;
+    settings.timestampMode = _timestampMode;
+    settings.filterMask = _filterMask;
+    settings.filterCode = _filterCode;
+    settings.filterOpCount = _filterOpCount;
+    settings.filterOpsOverflow = _filterOpsOverflow;
+    memcpy(settings.filterOps, _filterOps, sizeof(settings.filterOps));
+}
+
+bool SLCAN::applySettings(const SLCANSettings& settings) {
+    if (_state != SLCANState::Closed ||
+        settings.bitrate > 8 ||
+        !_can.isBitrateSupported(static_cast<CANBitrate>(settings.bitrate)) ||
+        settings.timestampMode > SLCAN_TIMESTAMP_US ||
+        settings.filterOpCount > SLCAN_SETTINGS_MAX_FILTER_OPS ||
+        settings.filterOpsOverflow) {
+        return false;
+    }
+
+    _configuredBitrate = settings.bitrate;
+    _timestampMode = settings.timestampMode;
+    _filterMask = settings.filterMask;
+    _filterCode = settings.filterCode;
+
+    // Rebuild the filter table; keep the edits the backend took, as f+/f- would
+    _can.clearFilterRules();
+    _filterOpCount = 0;
+    _filterOpsOverflow = false;
+    for (uint8_t i = 0; i < settings.filterOpCount; i++) {
+        const SLCANFilterOp& op = settings.filterOps[i];
+        bool ok = op.add ? _can.addFilterRule(op.rule) : _can.removeFilterRule(op.rule);
+        if (ok) {
+            _filterOps[_filterOpCount++] = op;
+        }
+    }
+    return true;
 }
 
 // =============================================================================
@@ -243,6 +354,12 @@ bool SLCAN::handleSetup(const char* cmd, char* response) {
     return true;
 }
 
+bool SLCAN::handleSetupBtr(char* response) {
+    // Custom BTR not supported - return error
+    setError(response);
+    return true;
+}
+
 bool SLCAN::handleOpen(char* response) {
     // Can only open if closed
     if (_state != SLCANState::Closed) {
@@ -262,6 +379,7 @@ bool SLCAN::handleOpen(char* response) {
     }
 
     _state = SLCANState::Open;
+    updateBusReader();
     setOk(response);
     return true;
 }
@@ -285,6 +403,31 @@ bool SLCAN::handleListen(char* response) {
     }
 
     _state = SLCANState::ListenOnly;
+    updateBusReader();
+    setOk(response);
+    return true;
+}
+
+bool SLCAN::handleLoopback(char* response) {
+    // Can only open if closed
+    if (_state != SLCANState::Closed) {
+        setError(response);
+        return true;
+    }
+
+    CANBitrate bitrate = static_cast<CANBitrate>(_configuredBitrate);
+    if (!_can.begin(bitrate, CANMode::Loopback)) {
+        setError(response);
+        return true;
+    }
+
+    // Apply filter if configured
+    if (_filterMask != 0) {
+        _can.setFilter(_filterMask, _filterCode);
+    }
+
+    _state = SLCANState::Loopback;
+    updateBusReader();
     setOk(response);
     return true;
 }
@@ -296,15 +439,18 @@ bool SLCAN::handleClose(char* response) {
         return true;
     }
 
+    _generator.stop();
+    _changeFilter.clear();
     _can.end();
     _state = SLCANState::Closed;
+    updateBusReader();
     setOk(response);
     return true;
 }
 
 bool SLCAN::handleTransmitStd(const char* cmd, char* response) {
-    // Must be open in normal mode
-    if (_state != SLCANState::Open) {
+    // Must be open in a mode that transmits (normal or loopback)
+    if (!canTransmit()) {
         setError(response);
         return true;
     }
@@ -324,6 +470,11 @@ bool SLCAN::handleTransmitStd(const char* cmd, char* response) {
     blinkTxLed();
 #endif
 
+    if (_quietTx) {
+        response[0] = '\0';
+        return false;  // q1: no response at all
+    }
+
     // Return 'z' for standard frame TX OK
     response[0] = SLCAN_TX_OK_STD;
     response[1] = '\0';
@@ -331,8 +482,8 @@ bool SLCAN::handleTransmitStd(const char* cmd, char* response) {
 }
 
 bool SLCAN::handleTransmitExt(const char* cmd, char* response) {
-    // Must be open in normal mode
-    if (_state != SLCANState::Open) {
+    // Must be open in a mode that transmits (normal or loopback)
+    if (!canTransmit()) {
         setError(response);
         return true;
     }
@@ -352,6 +503,11 @@ bool SLCAN::handleTransmitExt(const char* cmd, char* response) {
     blinkTxLed();
 #endif
 
+    if (_quietTx) {
+        response[0] = '\0';
+        return false;  // q1: no response at all
+    }
+
     // Return 'Z' for extended frame TX OK
     response[0] = SLCAN_TX_OK_EXT;
     response[1] = '\0';
@@ -359,8 +515,8 @@ bool SLCAN::handleTransmitExt(const char* cmd, char* response) {
 }
 
 bool SLCAN::handleTransmitRtrStd(const char* cmd, char* response) {
-    // Must be open in normal mode
-    if (_state != SLCANState::Open) {
+    // Must be open in a mode that transmits (normal or loopback)
+    if (!canTransmit()) {
         setError(response);
         return true;
     }
@@ -380,14 +536,19 @@ bool SLCAN::handleTransmitRtrStd(const char* cmd, char* response) {
     blinkTxLed();
 #endif
 
+    if (_quietTx) {
+        response[0] = '\0';
+        return false;  // q1: no response at all
+    }
+
     response[0] = SLCAN_TX_OK_STD;
     response[1] = '\0';
     return true;
 }
 
 bool SLCAN::handleTransmitRtrExt(const char* cmd, char* response) {
-    // Must be open in normal mode
-    if (_state != SLCANState::Open) {
+    // Must be open in a mode that transmits (normal or loopback)
+    if (!canTransmit()) {
         setError(response);
         return true;
     }
@@ -407,6 +568,11 @@ bool SLCAN::handleTransmitRtrExt(const char* cmd, char* response) {
     blinkTxLed();
 #endif
 
+    if (_quietTx) {
+        response[0] = '\0';
+        return false;  // q1: no response at all
+    }
+
     response[0] = SLCAN_TX_OK_EXT;
     response[1] = '\0';
     return true;
@@ -426,8 +592,7 @@ bool SLCAN::handleStatus(char* response) {
 
     // Format: Fxx
     response[0] = 'F';
-    response[1] = nibbleToHexChar((flags >> 4) & 0x0F);
-    response[2] = nibbleToHexChar(flags & 0x0F);
+    slcanHexByte(response + 1, flags);
     response[3] = '\0';
     return true;
 }
@@ -435,10 +600,8 @@ bool SLCAN::handleStatus(char* response) {
 bool SLCAN::handleVersion(char* response) {
     // Format: Vxxyy (hardware version xx, software version yy)
     response[0] = 'V';
-    response[1] = nibbleToHexChar((FIRMWARE_VERSION_MAJOR >> 4) & 0x0F);
-    response[2] = nibbleToHexChar(FIRMWARE_VERSION_MAJOR & 0x0F);
-    response[3] = nibbleToHexChar((FIRMWARE_VERSION_MINOR >> 4) & 0x0F);
-    response[4] = nibbleToHexChar(FIRMWARE_VERSION_MINOR & 0x0F);
+    slcanHexByte(response + 1, FIRMWARE_VERSION_MAJOR);
+    slcanHexByte(response + 3, FIRMWARE_VERSION_MINOR);
     response[5] = '\0';
     return true;
 }
@@ -456,7 +619,7 @@ bool SLCAN::handleSerial(char* response) {
 }
 
 bool SLCAN::handleTimestamp(const char* cmd, char* response) {
-    // Format: Z0 or Z1
+    // Format: Z0, Z1 or Z2
     if (strlen(cmd) < 2) {
         setError(response);
         return true;
@@ -464,10 +627,13 @@ bool SLCAN::handleTimestamp(const char* cmd, char* response) {
 
     char val = cmd[1];
     if (val == '0') {
-        _timestampEnabled = false;
+        _timestampMode = SLCAN_TIMESTAMP_OFF;
         setOk(response);
     } else if (val == '1') {
-        _timestampEnabled = true;
+        _timestampMode = SLCAN_TIMESTAMP_MS;
+        setOk(response);
+    } else if (val == '2') {
+        _timestampMode = SLCAN_TIMESTAMP_US;
         setOk(response);
     } else {
         setError(response);
@@ -482,16 +648,12 @@ bool SLCAN::handleFilterMask(const char* cmd, char* response) {
         return true;
     }
 
-    // Validate hex digits
-    for (int i = 1; i <= 8; i++) {
-        if (!isHexChar(cmd[i])) {
-            setError(response);
-            return true;
-        }
+    // Validate and parse hex digits
+    if (!parseHexField(cmd + 1, 8, &_filterMask)) {
+        setError(response);
+        return true;
     }
 
-    _filterMask = parseHex(cmd + 1, 8);
-
     // Apply filter if channel is open
     if (_state != SLCANState::Closed) {
         _can.setFilter(_filterMask, _filterCode);
@@ -508,16 +670,12 @@ bool SLCAN::handleFilterCode(const char* cmd, char* response) {
         return true;
     }
 
-    // Validate hex digits
-    for (int i = 1; i <= 8; i++) {
-        if (!isHexChar(cmd[i])) {
-            setError(response);
-            return true;
-        }
+    // Validate and parse hex digits
+    if (!parseHexField(cmd + 1, 8, &_filterCode)) {
+        setError(response);
+        return true;
     }
 
-    _filterCode = parseHex(cmd + 1, 8);
-
     // Apply filter if channel is open
     if (_state != SLCANState::Closed) {
         _can.setFilter(_filterMask, _filterCode);
@@ -527,151 +685,1004 @@ bool SLCAN::handleFilterCode(const char* cmd, char* response) {
     return true;
 }
 
-// =============================================================================
-// Frame Parsing and Formatting
-// =============================================================================
+bool SLCAN::handleFilterRule(const char* cmd, char* response) {
+    char op = cmd[1];
+
+    if (op == '\0') {
+        // Query: fsssee
+        uint16_t stdCount = 0;
+        uint8_t extCount = 0;
+        _can.getFilterRuleCounts(&stdCount, &extCount);
+        response[0] = SLCAN_CMD_FILTER_RULE;
+        formatHex(stdCount, response + 1, 3);
+        formatHex(extCount, response + 4, 2);
+        response[6] = '\0';
+        return true;
+    }
 
-bool SLCAN::parseFrame(const char* cmd, CANFrame& frame, bool extended, bool rtr) {
-    size_t idLen = extended ? SLCAN_EXT_ID_LEN : SLCAN_STD_ID_LEN;
-    size_t minLen = 1 + idLen + SLCAN_DLC_LEN;  // cmd + id + dlc
+    if (op == SLCAN_FILTER_CLEAR && cmd[2] == '\0') {
+        _can.clearFilterRules();
+        _filterOpCount = 0;
+        _filterOpsOverflow = false;
+        setOk(response);
+        return true;
+    }
 
-    if (strlen(cmd) < minLen) {
-        return false;
+    if (op != SLCAN_FILTER_ADD && op != SLCAN_FILTER_REMOVE) {
+        setError(response);
+        return true;
     }
 
-    // Parse ID
-    const char* idStr = cmd + 1;
-    for (size_t i = 0; i < idLen; i++) {
-        if (!isHexChar(idStr[i])) {
-            return false;
+    // Rule after "f+" / "f-"
+    CANFilterRule rule;
+    if (!parseFilterRuleText(cmd + 2, rule)) {
+        setError(response);
+        return true;
+    }
+
+    bool ok = (op == SLCAN_FILTER_ADD) ? _can.addFilterRule(rule) : _can.removeFilterRule(rule);
+    if (ok) {
+        // Record the edit so the table can be saved (Q commands)
+        if (_filterOpCount < SLCAN_SETTINGS_MAX_FILTER_OPS) {
+            _filterOps[_filterOpCount].rule = rule;
+            _filterOps[_filterOpCount].add = (op == SLCAN_FILTER_ADD);
+            _filterOpCount++;
+        } else {
+            _filterOpsOverflow = true;
         }
+        setOk(response);
+    } else {
+        setError(response);
     }
-    frame.id = parseHex(idStr, idLen);
+    return true;
+}
 
-    // Validate ID range
-    if (!extended && frame.id > 0x7FF) {
+bool SLCAN::parseFilterRuleText(const char* text, CANFilterRule& rule) {
+    // Kind letter, then the IDs (see SLCANCommands.h)
+    if (text[0] == '\0') {
         return false;
     }
-    if (extended && frame.id > 0x1FFFFFFF) {
+    const char* args = text + 1;
+    size_t argLen = strlen(args);
+    uint32_t first = 0;
+    uint32_t second = 0;
+    bool valid = false;
+
+    switch (text[0]) {
+        case SLCAN_FILTER_STD:
+            rule.kind = CANFilterRule::Kind::StdRange;
+            if (argLen == 3) {
+                valid = parseHexField(args, 3, &first);
+                second = first;
+            } else if (argLen == 6) {
+                valid = parseHexField(args, 3, &first) && parseHexField(args + 3, 3, &second);
+            }
+            break;
+
+        case SLCAN_FILTER_EXT:
+            rule.kind = CANFilterRule::Kind::ExtRange;
+            if (argLen == 8) {
+                valid = parseHexField(args, 8, &first);
+                second = first;
+            } else if (argLen == 16) {
+                valid = parseHexField(args, 8, &first) && parseHexField(args + 8, 8, &second);
+            }
+            break;
+
+        case SLCAN_FILTER_EXT_MASK:
+            rule.kind = CANFilterRule::Kind::ExtMask;
+            if (argLen == 16) {
+                valid = parseHexField(args, 8, &first) && parseHexField(args + 8, 8, &second);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (!valid) {
         return false;
     }
 
-    // Parse DLC
-    const char* dlcStr = cmd + 1 + idLen;
-    if (!isHexChar(dlcStr[0])) {
+    rule.first = first;
+    rule.second = second;
+    return true;
+}
+
+bool SLCAN::handleBatchTransmit(const char* cmd, char* response) {
+    // Format: b<frame><frame>... (see SLCANCommands.h)
+    if (!canTransmit()) {
+        setError(response);
+        return true;
+    }
+
+    const char* frames = cmd + 1;
+    size_t len = strlen(frames);
+
+    // Validate the whole line first so a malformed batch sends nothing
+    CANFrame chunk[TX_BATCH_CHUNK];
+    uint16_t total = 0;
+    for (size_t pos = 0; pos < len; total++) {
+        size_t used = parseFrameText(frames + pos, len - pos, chunk[0]);
+        if (used == 0 || total >= SLCAN_BATCH_MAX_FRAMES) {
+            setError(response);
+            return true;
+        }
+        pos += used;
+    }
+    if (total == 0) {
+        setError(response);
+        return true;
+    }
+
+    // Queue in chunks until the backend stops accepting
+    uint8_t accepted = 0;
+    size_t pos = 0;
+    while (pos < len) {
+        uint8_t n = 0;
+        while (n < TX_BATCH_CHUNK && pos < len) {
+            pos += parseFrameText(frames + pos, len - pos, chunk[n++]);
+        }
+        uint8_t queued = _can.writeBatch(chunk, n);
+        accepted += queued;
+        if (queued < n) {
+            break;  // TX queue full: host resends from frame 'accepted'
+        }
+    }
+
+#if ENABLE_STATUS_LED
+    if (accepted > 0) {
+        blinkTxLed();
+    }
+#endif
+
+    // Format: bNN
+    response[0] = SLCAN_CMD_TX_BATCH;
+    slcanHexByte(response + 1, accepted);
+    response[3] = '\0';
+    return true;
+}
+
+bool SLCAN::handleQuietTx(const char* cmd, char* response) {
+    // Format: q0 or q1
+    if (cmd[1] == '0' && cmd[2] == '\0') {
+        _quietTx = false;
+        setOk(response);
+    } else if (cmd[1] == '1' && cmd[2] == '\0') {
+        _quietTx = true;
+        setOk(response);
+    } else {
+        setError(response);
+    }
+    return true;
+}
+
+bool SLCAN::handleTxEcho(const char* cmd, char* response) {
+    // Format: e0 or e1
+    bool enable;
+    if (cmd[1] == '0' && cmd[2] == '\0') {
+        enable = false;
+    } else if (cmd[1] == '1' && cmd[2] == '\0') {
+        enable = true;
+    } else {
+        setError(response);
+        return true;
+    }
+
+    if (_can.setTxEcho(enable)) {
+        setOk(response);
+    } else {
+        setError(response);
+    }
+    return true;
+}
+
+bool SLCAN::handleGenerator(const char* cmd, char* response) {
+    // Format: see SLCANCommands.h
+    size_t len = strlen(cmd);
+
+    switch (cmd[1]) {
+        case '\0': {
+            // Query: grqqqqqqqqxxxxxxxx
+            uint32_t queued, rejects;
+            _generator.getCounters(&queued, &rejects);
+            char* p = response;
+            *p++ = SLCAN_CMD_GENERATOR;
+            *p++ = _generator.isRunning() ? '1' : '0';
+            p += formatHex(queued, p, 8);
+            p += formatHex(rejects, p, 8);
+            *p = '\0';
+            return true;
+        }
+
+        case '0':
+            if (len != 2) {
+                break;
+            }
+            _generator.stop();
+            setOk(response);
+            return true;
+
+        case '1': {
+            uint32_t count = 0;
+            if (len != 2 && (len != 10 || !parseHexField(cmd + 2, 8, &count))) {
+                break;
+            }
+            if (!canTransmit()) {
+                break;
+            }
+            _generator.start(count);
+            setOk(response);
+            return true;
+        }
+
+        case 's':
+        case 'e': {
+            bool extended = (cmd[1] == 'e');
+            size_t digits = extended ? 8 : 3;
+            uint32_t first, last;
+            if (len != 2 + 2 * digits + 1
+                || !parseHexField(cmd + 2, digits, &first)
+                || !parseHexField(cmd + 2 + digits, digits, &last)) {
+                break;
+            }
+
+            char d = cmd[len - 1];
+            uint8_t dlc;
+            if (d == SLCAN_GEN_DLC_MIX) {
+                dlc = TRAFFIC_GEN_DLC_MIX;
+            } else if (d >= '0' && d <= '8') {
+                dlc = (uint8_t)(d - '0');
+            } else {
+                break;
+            }
+
+            if (!_generator.configure(extended, first, last, dlc)) {
+                break;
+            }
+            setOk(response);
+            return true;
+        }
+
+        default:
+            break;
+    }
+
+    setError(response);
+    return true;
+}
+
+bool SLCAN::handleChangeOnly(const char* cmd, char* response) {
+    // Format: see SLCANCommands.h
+    size_t len = strlen(cmd);
+
+    if (len == 1) {
+        // Query: urkkkkssssssssxxxxxxxx
+        uint32_t suppressed, untracked;
+        _changeFilter.getCounters(&suppressed, &untracked);
+        char* p = response;
+        *p++ = SLCAN_CMD_CHANGE_ONLY;
+        *p++ = _changeFilter.isEnabled() ? '1' : '0';
+        p += formatHex(_changeFilter.getKeepAlive(), p, 4);
+        p += formatHex(suppressed, p, 8);
+        p += formatHex(untracked, p, 8);
+        *p = '\0';
+        return true;
+    }
+
+    if (cmd[1] == '0' && len == 2) {
+        _changeFilter.setEnabled(false, 0);
+        setOk(response);
+        return true;
+    }
+
+    uint32_t keepAlive = 0;
+    if (cmd[1] == '1' && (len == 2 || (len == 6 && parseHexField(cmd + 2, 4, &keepAlive)))) {
+        _changeFilter.setEnabled(true, (uint16_t)keepAlive);
+        setOk(response);
+        return true;
+    }
+
+    setError(response);
+    return true;
+}
+
+bool SLCAN::handleDecimate(const char* cmd, char* response) {
+    // Format: see SLCANCommands.h. The rules live on the shared frame bus.
+    if (_bus == nullptr) {
+        setError(response);
+        return true;
+    }
+    FrameDecimator& decimator = _bus->getDecimator();
+    char op = cmd[1];
+
+    if (op == '\0') {
+        // Query: dnnxxxxxxxx
+        uint32_t decimated;
+        decimator.getCounters(&decimated);
+        response[0] = SLCAN_CMD_DECIMATE;
+        formatHex(decimator.getRuleCount(), response + 1, 2);
+        formatHex(decimated, response + 3, 8);
+        response[11] = '\0';
+        return true;
+    }
+
+    if (op == SLCAN_DECIMATE_CLEAR && cmd[2] == '\0') {
+        decimator.clear();
+        setOk(response);
+        return true;
+    }
+
+    CANFilterRule rule;
+    bool ok = false;
+    if (op == SLCAN_FILTER_REMOVE) {
+        ok = parseFilterRuleText(cmd + 2, rule) && decimator.remove(rule);
+    } else if (op == SLCAN_FILTER_ADD) {
+        // d+Nnn<rule> or d+Hhhhh<rule>
+        uint32_t n = 0;
+        size_t digits = 0;
+        DecimateMode mode = DecimateMode::OneInN;
+        if (cmd[2] == SLCAN_DECIMATE_ONE_IN_N) {
+            digits = 2;
+        } else if (cmd[2] == SLCAN_DECIMATE_MAX_RATE) {
+            mode = DecimateMode::MaxRate;
+            digits = 4;
+        }
+        ok = digits != 0
+            && strlen(cmd + 3) > digits
+            && parseHexField(cmd + 3, digits, &n)
+            && parseFilterRuleText(cmd + 3 + digits, rule)
+            && decimator.add(rule, mode, (uint16_t)n);
+    }
+
+    if (ok) {
+        setOk(response);
+    } else {
+        setError(response);
+    }
+    return true;
+}
+
+bool SLCAN::handleOverflow(const char* cmd, char* response) {
+    // Format: see SLCANCommands.h. Policy and lane live on the shared frame bus.
+    if (_bus == nullptr) {
+        setError(response);
+        return true;
+    }
+    char op = cmd[1];
+
+    if (op == '\0') {
+        // Query: opnnxxxxxxxxyyyyyyyy
+        uint32_t mainDrops, priorityDrops;
+        _bus->getLaneCounters(&mainDrops, &priorityDrops);
+        char* p = response;
+        *p++ = SLCAN_CMD_OVERFLOW;
+        p += formatHex((uint8_t)_bus->getOverflowPolicy(), p, 1);
+        p += formatHex(_bus->getPriorityRuleCount(), p, 2);
+        p += formatHex(mainDrops, p, 8);
+        p += formatHex(priorityDrops, p, 8);
+        *p = '\0';
+        return true;
+    }
+
+    CANFilterRule rule;
+    bool ok = false;
+    if (op >= '0' && op <= '2' && cmd[2] == '\0') {
+        _bus->setOverflowPolicy((OverflowPolicy)(op - '0'));
+        ok = true;
+    } else if (op == SLCAN_OVERFLOW_CLEAR && cmd[2] == '\0') {
+        _bus->clearPriorityRules();
+        ok = true;
+    } else if (op == SLCAN_FILTER_ADD) {
+        ok = parseFilterRuleText(cmd + 2, rule) && _bus->addPriorityRule(rule);
+    } else if (op == SLCAN_FILTER_REMOVE) {
+        ok = parseFilterRuleText(cmd + 2, rule) && _bus->removePriorityRule(rule);
+    }
+
+    if (ok) {
+        setOk(response);
+    } else {
+        setError(response);
+    }
+    return true;
+}
+
+bool SLCAN::handleCapture(const char* cmd, char* response) {
+    // Format: see SLCANCommands.h. The capture lives on the shared frame bus.
+    if (_bus == nullptr) {
+        setError(response);
+        return true;
+    }
+    FrameCapture& capture = _bus->getCapture();
+    size_t len = strlen(cmd);
+    char op = cmd[1];
+
+    if (op == '\0') {
+        // Query: Gsnnnniiii
+        char* p = response;
+        *p++ = SLCAN_CMD_CAPTURE;
+        p += formatHex((uint8_t)capture.getState(), p, 1);
+        p += formatHex(capture.getCount(), p, 4);
+        p += formatHex(capture.getTriggerIndex(), p, 4);
+        *p = '\0';
+        return true;
+    }
+
+    bool ok = false;
+    switch (op) {
+        case SLCAN_CAPTURE_WINDOW: {
+            uint32_t pre, post;
+            ok = len == 10 && parseHexField(cmd + 2, 4, &pre) && parseHexField(cmd + 6, 4, &post)
+                 && capture.setWindow((uint16_t)pre, (uint16_t)post);
+            break;
+        }
+
+        case SLCAN_CAPTURE_TRIGGER_ID: {
+            if (len == 2) {
+                capture.clearIdTrigger();
+                ok = true;
+            } else {
+                CANFilterRule rule;
+                ok = parseFilterRuleText(cmd + 2, rule) && capture.setIdTrigger(rule);
+            }
+            break;
+        }
+
+        case SLCAN_CAPTURE_TRIGGER_DATA: {
+            if (len == 2) {
+                capture.clearDataTrigger();
+                ok = true;
+            } else if (len == 2 + 32) {
+                uint8_t value[8];
+                uint8_t mask[8];
+                ok = true;
+                for (uint8_t i = 0; i < 8 && ok; i++) {
+                    uint32_t v, m;
+                    ok = parseHexField(cmd + 2 + i * 2, 2, &v) && parseHexField(cmd + 18 + i * 2, 2, &m);
+                    value[i] = (uint8_t)v;
+                    mask[i] = (uint8_t)m;
+                }
+                if (ok) {
+                    capture.setDataTrigger(value, mask);
+                }
+            }
+            break;
+        }
+
+        case SLCAN_CAPTURE_TRIGGER_ERROR:
+            if (len == 3 && (cmd[2] == '0' || cmd[2] == '1')) {
+                capture.setErrorTrigger(cmd[2] == '1');
+                ok = true;
+            }
+            break;
+
+        case SLCAN_CAPTURE_ARM:
+            if (len == 2) {
+                _captureReadout = false;
+                capture.arm();
+                ok = true;
+            }
+            break;
+
+        case SLCAN_CAPTURE_FORCE:
+            if (len == 2 && capture.getState() == CaptureState::Armed) {
+                capture.trigger();
+                ok = true;
+            }
+            break;
+
+        case SLCAN_CAPTURE_STOP:
+            if (len == 2) {
+                _captureReadout = false;
+                capture.stop();
+                ok = true;
+            }
+            break;
+
+        case SLCAN_CAPTURE_READ:
+            // The readout shares the RX stream, so not while B1 owns it
+            if (len == 2 && capture.getState() == CaptureState::Done && _streamOwner) {
+                _captureReadout = true;
+                _captureReadPos = 0;
+                ok = true;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (ok) {
+        setOk(response);
+    } else {
+        setError(response);
+    }
+    return true;
+}
+
+bool SLCAN::handleAutoPoll(const char* cmd, char* response) {
+    // Format: X0 or X1
+    if ((cmd[1] == '0' || cmd[1] == '1') && cmd[2] == '\0') {
+        _autoForward = (cmd[1] == '1');
+        setOk(response);
+    } else {
+        setError(response);
+    }
+    return true;
+}
+
+bool SLCAN::canPoll() const {
+    return _state != SLCANState::Closed && !_autoForward && _streamOwner && _bus != nullptr && !_pollAll;
+}
+
+bool SLCAN::handlePoll(const char* cmd, char* response) {
+    // Format: P. Responds with one frame line, or an empty line
+    if (cmd[1] != '\0' || !canPoll()) {
+        setError(response);
+        return true;
+    }
+
+    response[0] = '\0';
+    const CANFrame* frame;
+    while ((frame = _bus->peek(_busReader)) != nullptr) {
+        bool changed = _changeFilter.check(*frame);
+        if (changed) {
+            formatFrame(*frame, response, SLCAN_POLL_RESPONSE_LEN + 1);
+            _changeFilter.commit(*frame);
+        }
+        _bus->consume(_busReader);
+        if (changed) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool SLCAN::handlePollAll(const char* cmd, char* response) {
+    // Format: A. The frames and the A terminator follow from poll()
+    if (cmd[1] != '\0' || !canPoll()) {
+        setError(response);
+        return true;
+    }
+
+    _pollAll = true;
+    _pollAllLeft = _bus->pending(_busReader);
+    response[0] = '\0';
+    return false;   // No response line of its own
+}
+
+bool SLCAN::handleCyclic(const char* cmd, char* response) {
+    // Format: see SLCANCommands.h
+    size_t len = strlen(cmd);
+    char op = cmd[1];
+    CANFrame frame;
+    bool ok = false;
+
+    switch (op) {
+        case '\0': {
+            // Query: cnnssssssssxxxxxxxx
+            uint32_t sent, rejects;
+            _cyclic.getCounters(&sent, &rejects);
+            char* p = response;
+            *p++ = SLCAN_CMD_CYCLIC;
+            p += formatHex(_cyclic.getEntryCount(), p, 2);
+            p += formatHex(sent, p, 8);
+            p += formatHex(rejects, p, 8);
+            *p = '\0';
+            return true;
+        }
+
+        case SLCAN_CYCLIC_SET: {
+            // c+pppp<frame>
+            uint32_t period = 0;
+            ok = len > 6
+                && parseHexField(cmd + 2, 4, &period)
+                && parseFrameText(cmd + 6, len - 6, frame) == len - 6
+                && _cyclic.set(frame, (uint16_t)period);
+            break;
+        }
+
+        case SLCAN_CYCLIC_UPDATE:
+            // c=<frame>
+            ok = len > 2
+                && parseFrameText(cmd + 2, len - 2, frame) == len - 2
+                && _cyclic.update(frame);
+            break;
+
+        case SLCAN_CYCLIC_REMOVE: {
+            // c-t<iii> or c-T<iiiiiiii>
+            uint32_t id;
+            bool extended;
+            size_t used = parseIdText(cmd + 2, len - 2, &id, &extended);
+            ok = used != 0 && used == len - 2 && _cyclic.remove(id, extended);
+            break;
+        }
+
+        case SLCAN_CYCLIC_COUNTER: {
+            // c#t<iii><p><mm><q> or c#T<iiiiiiii><p><mm><q>
+            uint32_t id, modulus;
+            bool extended;
+            size_t used = parseIdText(cmd + 2, len - 2, &id, &extended);
+            const char* args = cmd + 2 + used;
+            if (used == 0 || len - 2 - used != 4 || !parseHexField(args + 1, 2, &modulus)) {
+                break;
+            }
+            uint8_t counterByte = (args[0] == SLCAN_CYCLIC_NO_BYTE) ? CYCLIC_TX_NO_BYTE
+                                : (args[0] >= '0' && args[0] <= '7') ? (uint8_t)(args[0] - '0') : 8;
+            uint8_t checksumByte = (args[3] == SLCAN_CYCLIC_NO_BYTE) ? CYCLIC_TX_NO_BYTE
+                                 : (args[3] >= '0' && args[3] <= '7') ? (uint8_t)(args[3] - '0') : 8;
+            ok = _cyclic.setCounter(id, extended, counterByte, (uint8_t)modulus, checksumByte);
+            break;
+        }
+
+        case SLCAN_CYCLIC_CLEAR:
+            if (len == 2) {
+                _cyclic.clear();
+                ok = true;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (ok) {
+        setOk(response);
+    } else {
+        setError(response);
+    }
+    return true;
+}
+
+bool SLCAN::handleProfile(const char* cmd, char* response) {
+#if ENABLE_PROFILER
+    // Format: y (probe count), yR (reset), yNN (statistics of probe NN)
+    if (cmd[1] == '\0') {
+        response[0] = SLCAN_CMD_PROFILE;
+        formatHex((uint8_t)ProfileProbe::Count, response + 1, 2);
+        response[3] = '\0';
+        return true;
+    }
+
+    if (cmd[1] == 'R' && cmd[2] == '\0') {
+        Profiler::reset();
+        setOk(response);
+        return true;
+    }
+
+    uint32_t index;
+    const ProfileStats* stats = nullptr;
+    if (strlen(cmd) == 3 && parseHexField(cmd + 1, 2, &index)) {
+        stats = Profiler::getStats((uint8_t)index);
+    }
+    if (stats == nullptr) {
+        setError(response);
+        return true;
+    }
+
+    uint32_t mean = stats->count ? (uint32_t)(stats->totalCycles / stats->count) : 0;
+    char* p = response;
+    *p++ = SLCAN_CMD_PROFILE;
+    p += formatHex(index, p, 2);
+    p += formatHex(stats->count, p, 8);
+    p += formatHex(stats->count ? stats->minCycles : 0, p, 8);
+    p += formatHex(stats->maxCycles, p, 8);
+    p += formatHex(mean, p, 8);
+    for (uint8_t i = 0; i < PROFILE_HISTOGRAM_BUCKETS; i++) {
+        p += formatHex(stats->histogram[i], p, 4);
+    }
+    *p = '\0';
+#else
+    (void)cmd;
+    setError(response);
+#endif
+    return true;
+}
+
+// =============================================================================
+// Frame Parsing and Formatting
+// =============================================================================
+
+// Fast paths are specialized per (extended, rtr, timestamp mode) combination so
+// the per-frame work is straight-line table lookups with no mode branches.
+
+template<bool Ext, bool Rtr>
+static bool parseFrameFast(const char* cmd, size_t len, CANFrame& frame) {
+    constexpr size_t idLen = Ext ? SLCAN_EXT_ID_LEN : SLCAN_STD_ID_LEN;
+    constexpr size_t headerLen = 1 + idLen + SLCAN_DLC_LEN;  // cmd + id + dlc
+
+    if (len < headerLen) {
+        return false;
+    }
+
+    // Parse ID
+    uint32_t id;
+    if (!slcanHexDecode(cmd + 1, idLen, &id)) {
         return false;
     }
-    frame.dlc = hexCharToNibble(dlcStr[0]);
-    if (frame.dlc > 8) {
+    if (id > (Ext ? 0x1FFFFFFFUL : 0x7FFUL)) {
         return false;
     }
 
-    frame.extended = extended;
-    frame.rtr = rtr;
+    // Parse DLC
+    uint8_t dlc = SLCAN_HEX_DECODE[(uint8_t)cmd[1 + idLen]];
+    if (dlc > 8) {
+        return false;  // Also rejects SLCAN_HEX_INVALID
+    }
 
     // Parse data bytes (not for RTR frames)
-    if (!rtr) {
-        const char* dataStr = cmd + 1 + idLen + SLCAN_DLC_LEN;
-        size_t expectedDataLen = frame.dlc * 2;
-
-        if (strlen(dataStr) < expectedDataLen) {
+    if (!Rtr) {
+        if (len < headerLen + dlc * SLCAN_DATA_CHAR_LEN) {
             return false;
         }
-
-        for (uint8_t i = 0; i < frame.dlc; i++) {
-            if (!isHexChar(dataStr[i * 2]) || !isHexChar(dataStr[i * 2 + 1])) {
+        const char* dataStr = cmd + headerLen;
+        for (uint8_t i = 0; i < dlc; i++) {
+            if (!slcanHexDecodeByte(dataStr + i * SLCAN_DATA_CHAR_LEN, &frame.data[i])) {
                 return false;
             }
-            frame.data[i] = (hexCharToNibble(dataStr[i * 2]) << 4) |
-                            hexCharToNibble(dataStr[i * 2 + 1]);
         }
     }
 
     // Zero remaining data bytes
-    for (uint8_t i = frame.dlc; i < 8; i++) {
+    for (uint8_t i = Rtr ? 0 : dlc; i < 8; i++) {
         frame.data[i] = 0;
     }
 
+    frame.id = id;
+    frame.dlc = dlc;
+    frame.extended = Ext;
+    frame.rtr = Rtr;
     return true;
 }
 
-size_t SLCAN::formatFrame(const CANFrame& frame, char* buffer, size_t maxLen) {
-    size_t pos = 0;
+template<bool Ext, bool Rtr, uint8_t Ts>
+static size_t formatFrameFast(const CANFrame& frame, char* buffer) {
+    char* p = buffer;
+    uint8_t dlc = frame.dlc > 8 ? 8 : frame.dlc;
 
-    // Determine command character
-    char cmdChar;
-    if (frame.rtr) {
-        cmdChar = frame.extended ? SLCAN_CMD_TX_RTR_EXT : SLCAN_CMD_TX_RTR_STD;
-    } else {
-        cmdChar = frame.extended ? SLCAN_CMD_TX_EXT : SLCAN_CMD_TX_STD;
-    }
-
-    if (pos >= maxLen) return 0;
-    buffer[pos++] = cmdChar;
+    *p++ = Rtr ? (Ext ? SLCAN_CMD_TX_RTR_EXT : SLCAN_CMD_TX_RTR_STD)
+               : (Ext ? SLCAN_CMD_TX_EXT : SLCAN_CMD_TX_STD);
 
     // Format ID
-    size_t idDigits = frame.extended ? SLCAN_EXT_ID_LEN : SLCAN_STD_ID_LEN;
-    if (pos + idDigits >= maxLen) return 0;
-    pos += formatHex(frame.id, buffer + pos, idDigits);
+    if (Ext) {
+        slcanHexByte(p,     (uint8_t)(frame.id >> 24));
+        slcanHexByte(p + 2, (uint8_t)(frame.id >> 16));
+        slcanHexByte(p + 4, (uint8_t)(frame.id >> 8));
+        slcanHexByte(p + 6, (uint8_t)frame.id);
+        p += SLCAN_EXT_ID_LEN;
+    } else {
+        slcanHexNibble(p, (uint8_t)(frame.id >> 8));
+        slcanHexByte(p + 1, (uint8_t)frame.id);
+        p += SLCAN_STD_ID_LEN;
+    }
 
     // Format DLC
-    if (pos >= maxLen) return 0;
-    buffer[pos++] = nibbleToHexChar(frame.dlc);
+    slcanHexNibble(p++, dlc);
 
     // Format data bytes (not for RTR)
-    if (!frame.rtr) {
-        for (uint8_t i = 0; i < frame.dlc && pos + 2 < maxLen; i++) {
-            buffer[pos++] = nibbleToHexChar((frame.data[i] >> 4) & 0x0F);
-            buffer[pos++] = nibbleToHexChar(frame.data[i] & 0x0F);
+    if (!Rtr) {
+        for (uint8_t i = 0; i < dlc; i++) {
+            slcanHexByte(p, frame.data[i]);
+            p += SLCAN_DATA_CHAR_LEN;
         }
     }
 
-    // Format timestamp if enabled
-    if (_timestampEnabled && pos + SLCAN_TIMESTAMP_LEN < maxLen) {
-        pos += formatHex(frame.timestamp, buffer + pos, SLCAN_TIMESTAMP_LEN);
+    // Format timestamp
+    if (Ts == SLCAN_TIMESTAMP_MS) {
+        uint16_t ms = (uint16_t)(frame.timestamp / 1000);
+        slcanHexByte(p,     (uint8_t)(ms >> 8));
+        slcanHexByte(p + 2, (uint8_t)ms);
+        p += SLCAN_TIMESTAMP_LEN;
+    } else if (Ts == SLCAN_TIMESTAMP_US) {
+        slcanHexByte(p,     (uint8_t)(frame.timestamp >> 24));
+        slcanHexByte(p + 2, (uint8_t)(frame.timestamp >> 16));
+        slcanHexByte(p + 4, (uint8_t)(frame.timestamp >> 8));
+        slcanHexByte(p + 6, (uint8_t)frame.timestamp);
+        p += SLCAN_TIMESTAMP_US_LEN;
+    }
+
+    *p = '\0';
+    return (size_t)(p - buffer);
+}
+
+typedef size_t (*FrameFormatter)(const CANFrame&, char*);
+
+// Indexed by [(extended << 1) | rtr][timestamp mode]
+static const FrameFormatter FRAME_FORMATTERS[4][3] = {
+    { formatFrameFast<false, false, SLCAN_TIMESTAMP_OFF>,
+      formatFrameFast<false, false, SLCAN_TIMESTAMP_MS>,
+      formatFrameFast<false, false, SLCAN_TIMESTAMP_US> },
+    { formatFrameFast<false, true,  SLCAN_TIMESTAMP_OFF>,
+      formatFrameFast<false, true,  SLCAN_TIMESTAMP_MS>,
+      formatFrameFast<false, true,  SLCAN_TIMESTAMP_US> },
+    { formatFrameFast<true,  false, SLCAN_TIMESTAMP_OFF>,
+      formatFrameFast<true,  false, SLCAN_TIMESTAMP_MS>,
+      formatFrameFast<true,  false, SLCAN_TIMESTAMP_US> },
+    { formatFrameFast<true,  true,  SLCAN_TIMESTAMP_OFF>,
+      formatFrameFast<true,  true,  SLCAN_TIMESTAMP_MS>,
+      formatFrameFast<true,  true,  SLCAN_TIMESTAMP_US> },
+};
+
+static const uint8_t TIMESTAMP_DIGITS[3] = { 0, SLCAN_TIMESTAMP_LEN, SLCAN_TIMESTAMP_US_LEN };
+
+bool SLCAN::parseFrame(const char* cmd, CANFrame& frame, bool extended, bool rtr) {
+    size_t len = strlen(cmd);
+    if (extended) {
+        return rtr ? parseFrameFast<true, true>(cmd, len, frame)
+                   : parseFrameFast<true, false>(cmd, len, frame);
     }
+    return rtr ? parseFrameFast<false, true>(cmd, len, frame)
+               : parseFrameFast<false, false>(cmd, len, frame);
+}
 
-    // Null terminate
-    if (pos < maxLen) {
-        buffer[pos] = '\0';
+size_t SLCAN::parseFrameText(const char* text, size_t len, CANFrame& frame) {
+    // One t/T/r/R command inside a longer line; returns its length or 0
+    bool ok;
+    switch (text[0]) {
+        case SLCAN_CMD_TX_STD:     ok = parseFrameFast<false, false>(text, len, frame); break;
+        case SLCAN_CMD_TX_EXT:     ok = parseFrameFast<true,  false>(text, len, frame); break;
+        case SLCAN_CMD_TX_RTR_STD: ok = parseFrameFast<false, true>(text, len, frame);  break;
+        case SLCAN_CMD_TX_RTR_EXT: ok = parseFrameFast<true,  true>(text, len, frame);  break;
+        default:                   return 0;
+    }
+    if (!ok) {
+        return 0;
     }
 
-    return pos;
+    return 1 + (frame.extended ? SLCAN_EXT_ID_LEN : SLCAN_STD_ID_LEN) + SLCAN_DLC_LEN
+             + (frame.rtr ? 0 : frame.dlc * SLCAN_DATA_CHAR_LEN);
 }
 
-// =============================================================================
-// Helper Functions
-// =============================================================================
+size_t SLCAN::parseIdText(const char* text, size_t len, uint32_t* id, bool* extended) {
+    // t<iii> or T<iiiiiiii>; returns its length or 0
+    size_t digits;
+    if (len > 0 && text[0] == SLCAN_CMD_TX_STD) {
+        digits = SLCAN_STD_ID_LEN;
+    } else if (len > 0 && text[0] == SLCAN_CMD_TX_EXT) {
+        digits = SLCAN_EXT_ID_LEN;
+    } else {
+        return 0;
+    }
+    if (len < 1 + digits || !parseHexField(text + 1, digits, id)) {
+        return 0;
+    }
+    *extended = (digits == SLCAN_EXT_ID_LEN);
+    return 1 + digits;
+}
+
+size_t SLCAN::formatFrame(const CANFrame& frame, char* buffer, size_t maxLen) {
+    // Worst-case length for this frame type, so the fast path needs no checks
+    size_t prefix = frame.echo ? SLCAN_ECHO_PREFIX_LEN : 0;
+    size_t needed = prefix + 1 + (frame.extended ? SLCAN_EXT_ID_LEN : SLCAN_STD_ID_LEN) + SLCAN_DLC_LEN
+                  + (frame.rtr ? 0 : 8 * SLCAN_DATA_CHAR_LEN)
+                  + TIMESTAMP_DIGITS[_timestampMode] + 1;
+    if (buffer == nullptr || maxLen < needed) {
+        return 0;
+    }
 
-uint8_t SLCAN::hexCharToNibble(char c) {
-    if (c >= '0' && c <= '9') return c - '0';
-    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-    return 0;
+    if (prefix) {
+        buffer[0] = SLCAN_ECHO_PREFIX;
+    }
+    uint8_t kind = (frame.extended ? 2 : 0) | (frame.rtr ? 1 : 0);
+    return prefix + FRAME_FORMATTERS[kind][_timestampMode](frame, buffer + prefix);
 }
 
-char SLCAN::nibbleToHexChar(uint8_t n) {
-    n &= 0x0F;
-    return (n < 10) ? ('0' + n) : ('A' + n - 10);
+bool SLCAN::pollCaptureReadout(ITransport* transport) {
+    if (_bus == nullptr || !_streamOwner || !transport->isConnected()) {
+        return _captureReadout;     // Resumes once the host is back
+    }
+    const FrameCapture& capture = _bus->getCapture();
+    uint16_t count = capture.getCount();
+    char line[SLCAN_CAPTURE_LINE_LEN];
+
+    // At least one line per poll; a line the link can't take is retried
+    uint16_t written = 0;
+    while (written == 0 || _bus->forwardTimeLeft()) {
+        size_t len;
+        if (_captureReadPos == 0) {
+            // Header: GHnnnniiii
+            char* p = line;
+            *p++ = SLCAN_CMD_CAPTURE;
+            *p++ = SLCAN_CAPTURE_HEADER;
+            p += formatHex(count, p, 4);
+            p += formatHex(capture.getTriggerIndex(), p, 4);
+            len = (size_t)(p - line);
+        } else {
+            CANFrame frame;
+            if (!capture.getFrame((uint16_t)(_captureReadPos - 1), frame)) {
+                _captureReadout = false;    // All frames sent
+                break;
+            }
+            char* p = line;
+            *p++ = SLCAN_CMD_CAPTURE;
+            if (frame.echo) {
+                *p++ = SLCAN_ECHO_PREFIX;
+            }
+            uint8_t kind = (frame.extended ? 2 : 0) | (frame.rtr ? 1 : 0);
+            p += FRAME_FORMATTERS[kind][SLCAN_TIMESTAMP_US](frame, p);
+            len = (size_t)(p - line);
+        }
+
+        line[len] = '\r';
+        if (!transport->writeWithPriority(line, len + 1, WritePriority::CAN_RX_FRAME)) {
+            break;
+        }
+        _captureReadPos++;
+        written++;
+    }
+    return _captureReadout;
 }
 
-bool SLCAN::isHexChar(char c) {
-    return (c >= '0' && c <= '9') ||
-           (c >= 'A' && c <= 'F') ||
-           (c >= 'a' && c <= 'f');
+bool SLCAN::pollAllReadout(ITransport* transport) {
+    if (!transport->isConnected()) {
+        return true;    // Resumes once the host is back
+    }
+
+    // Pack lines into one write per chunk; the host asked for everything,
+    // so the forward budget doesn't apply. Frames are only taken once the
+    // transport has room for the whole chunk.
+    char chunk[POLL_ALL_CHUNK_LEN];
+    while (true) {
+        size_t room = transport->writeRoom(WritePriority::CAN_RX_FRAME);
+        if (room < SLCAN_MAX_EXT_FRAME_LEN) {
+            transport->flushBatch();
+            room = transport->writeRoom(WritePriority::CAN_RX_FRAME);
+            if (room < SLCAN_MAX_EXT_FRAME_LEN) {
+                return true;    // Link busy: the rest next poll
+            }
+        }
+        if (room > sizeof(chunk)) {
+            room = sizeof(chunk);
+        }
+
+        size_t len = 0;
+        while (_pollAllLeft > 0 && len + SLCAN_MAX_EXT_FRAME_LEN <= room) {
+            const CANFrame* frame = _bus->peek(_busReader);
+            if (frame == nullptr) {
+                _pollAllLeft = 0;   // Overwritten (o2) or the channel closed
+                break;
+            }
+            if (_changeFilter.check(*frame)) {
+                len += formatFrame(*frame, chunk + len, room - len);
+                chunk[len++] = '\r';
+                _changeFilter.commit(*frame);
+            }
+            _bus->consume(_busReader);
+            _pollAllLeft--;
+        }
+
+        bool done = (_pollAllLeft == 0 && len + 2 <= room);
+        if (done) {
+            chunk[len++] = SLCAN_CMD_POLL_ALL;
+            chunk[len++] = '\r';
+        }
+        if (len > 0) {
+            transport->writeWithPriority(chunk, len, WritePriority::CAN_RX_FRAME);
+        }
+        if (done) {
+            _pollAll = false;
+            return false;
+        }
+    }
+}
+
+// =============================================================================
+// Helper Functions
+// =============================================================================
+
+bool SLCAN::parseHexField(const char* str, size_t len, uint32_t* value) {
+    return slcanHexDecode(str, len, value);
 }
 
 uint32_t SLCAN::parseHex(const char* str, size_t len) {
     uint32_t value = 0;
-    for (size_t i = 0; i < len; i++) {
-        value = (value << 4) | hexCharToNibble(str[i]);
-    }
+    slcanHexDecode(str, len, &value);
     return value;
 }
 
 size_t SLCAN::formatHex(uint32_t value, char* buffer, size_t digits) {
     for (size_t i = digits; i > 0; i--) {
-        buffer[i - 1] = nibbleToHexChar(value & 0x0F);
+        slcanHexNibble(&buffer[i - 1], (uint8_t)value);
         value >>= 4;
     }
     return digits;
@@ -722,56 +1733,33 @@ void SLCAN::updateLed() {
 #endif // ENABLE_STATUS_LED
 
 // =============================================================================
-// RX Ring Buffer Management
+// Diagnostic Counters
 // =============================================================================
 
-void SLCAN::drainFromBackend() {
-    // Pull frames from hardware CAN backend into our protocol-layer ring
-    while (_can.available()) {
-        uint16_t nextHead = (_rxHead + 1) % CAN_RX_QUEUE_SIZE;
-
-        if (nextHead == _rxTail) {
-            // Ring full: drop NEWEST frame (per user preference - keep history)
-            _rxOverflowCount++;
-            return;  // Stop draining, preserve oldest frames
-        }
-
-        CANFrame msg;
-        if (_can.read(msg)) {
-            _rxQueue[_rxHead].msg = msg;
-            _rxQueue[_rxHead].timestamp = millis() & 0xFFFF;
-            _rxQueue[_rxHead].valid = true;
-            _rxHead = nextHead;
-        } else {
-            break;  // No more frames available
-        }
+void SLCAN::getCounters(uint32_t* rxOverflows, uint32_t* canRxDrops) const {
+    if (rxOverflows) {
+        *rxOverflows = 0;
+        if (_bus != nullptr) _bus->getCounters(rxOverflows);
     }
+    if (canRxDrops) *canRxDrops = _canRxDropCount;
 }
 
-bool SLCAN::getNextRxFrame(CANFrame& frame, uint16_t* timestamp) {
-    // Internal helper: get next frame from ring
-    if (_rxTail == _rxHead) {
-        return false;  // Ring empty
-    }
-
-    frame = _rxQueue[_rxTail].msg;
-    if (timestamp) *timestamp = _rxQueue[_rxTail].timestamp;
-    _rxQueue[_rxTail].valid = false;
-    _rxTail = (_rxTail + 1) % CAN_RX_QUEUE_SIZE;
-
-    return true;
+void SLCAN::getGeneratorCounters(uint32_t* queued, uint32_t* rejects) const {
+    _generator.getCounters(queued, rejects);
 }
 
-// =============================================================================
-// Diagnostic Counters
-// =============================================================================
+void SLCAN::getCyclicCounters(uint32_t* sent, uint32_t* rejects) const {
+    _cyclic.getCounters(sent, rejects);
+}
 
-void SLCAN::getCounters(uint32_t* rxOverflows, uint32_t* canRxDrops) const {
-    if (rxOverflows) *rxOverflows = _rxOverflowCount;
-    if (canRxDrops) *canRxDrops = _canRxDropCount;
+void SLCAN::getChangeFilterCounters(uint32_t* suppressed, uint32_t* untracked) const {
+    _changeFilter.getCounters(suppressed, untracked);
 }
 
 void SLCAN::resetCounters() {
-    _rxOverflowCount = 0;
+    if (_bus != nullptr) _bus->resetCounters();
     _canRxDropCount = 0;
+    _generator.resetCounters();
+    _changeFilter.resetCounters();
+    _cyclic.resetCounters();
 }
@@ -12,8 +12,12 @@
 
 #include "config.h"
 #include "ProtocolHandler.h"
+#include "FrameBus.h"
 #include "CANBackend.h"
 #include "SLCANCommands.h"
+#include "TrafficGenerator.h"
+#include "ChangeFilter.h"
+#include "CyclicTransmitter.h"
 #include <stdint.h>
 
 /**
@@ -22,7 +26,36 @@
 enum class SLCANState : uint8_t {
     Closed,         // Channel closed (default)
     Open,           // Channel open in normal mode
-    ListenOnly      // Channel open in listen-only mode
+    ListenOnly,     // Channel open in listen-only mode
+    Loopback        // Channel open in internal loopback mode
+};
+
+#ifndef SLCAN_SETTINGS_MAX_FILTER_OPS
+#define SLCAN_SETTINGS_MAX_FILTER_OPS 8
+#endif
+
+/**
+ * One f+ or f- edit of the multi-rule filter table.
+ */
+struct SLCANFilterOp {
+    CANFilterRule rule;
+    bool add;                   // f+ (true) or f- (false)
+};
+
+/**
+ * Channel configuration that can be saved and restored (Q commands).
+ *
+ * The backend's filter table can't be read back, so it is kept as the
+ * f+/f- edits that built it since boot or the last fC, in order.
+ */
+struct SLCANSettings {
+    uint8_t bitrate;            // S value (0-8)
+    uint8_t timestampMode;      // SLCAN_TIMESTAMP_OFF/MS/US
+    uint32_t filterMask;        // M value
+    uint32_t filterCode;        // m value
+    uint8_t filterOpCount;
+    bool filterOpsOverflow;     // More edits than fit: the table can't be restored
+    SLCANFilterOp filterOps[SLCAN_SETTINGS_MAX_FILTER_OPS];
 };
 
 /**
@@ -36,14 +69,27 @@ enum class SLCANState : uint8_t {
  *   S0-S8  : Set bitrate preset (only S4, S5, S6, S8 supported)
  *   O      : Open channel (normal mode)
  *   L      : Open channel (listen-only mode)
+ *   l      : Open channel (internal loopback self-test, see SLCANCommands.h)
  *   C      : Close channel
  *   t/T    : Transmit standard/extended frame
  *   r/R    : Transmit standard/extended RTR frame
  *   F      : Read status flags
  *   V      : Get version
  *   N      : Get serial number
- *   Z0/Z1  : Disable/enable timestamps
+ *   Z0/Z1  : Disable/enable timestamps (Z2: 32-bit microsecond timestamps)
  *   M/m    : Set acceptance filter mask/code
+ *   f      : Multi-rule filter table extension (see SLCANCommands.h)
+ *   b      : Batch transmit extension (see SLCANCommands.h)
+ *   q0/q1  : Quiet TX off/on (no z/Z responses)
+ *   e0/e1  : TX echo off/on (sent frames reported in the RX stream)
+ *   g      : Traffic generator (see SLCANCommands.h)
+ *   y      : Profiler statistics (ENABLE_PROFILER builds, see SLCANCommands.h)
+ *   u0/u1  : Change-only RX forwarding off/on (see SLCANCommands.h)
+ *   d      : RX decimation rules (see SLCANCommands.h)
+ *   c      : Cyclic transmit table (see SLCANCommands.h)
+ *   o      : RX overflow policy and priority lane (see SLCANCommands.h)
+ *   G      : Triggered burst capture (see SLCANCommands.h)
+ *   X/P/A  : Auto-poll off/on, poll one/all pending frames (see SLCANCommands.h)
  */
 class SLCAN : public IProtocolHandler {
 public:
@@ -57,12 +103,33 @@ public:
     const char* getName() const override;
     bool canHandle(const char* cmd) const override;
     bool processCommand(const char* cmd, char* response, size_t maxLen) override;
+    void registerRoutes(ICommandRoutes& routes) const override;
     void poll(ITransport* transport) override;
     bool isActive() const override;
+    void onStreamOwnership(bool owner) override;
+    void attachFrameBus(FrameBus* bus, uint8_t reader) override;
 
     // State accessors
     SLCANState getState() const;
     bool isTimestampEnabled() const;
+    uint8_t getTimestampMode() const;
+
+    /**
+     * Get the current channel configuration (S, Z, M/m and the f table).
+     * @param settings Output: configuration
+     */
+    void getSettings(SLCANSettings& settings) const;
+
+    /**
+     * Restore a channel configuration saved with getSettings().
+     * The channel must be closed; the filter table is rebuilt from the
+     * recorded edits.
+     *
+     * @param settings Configuration to apply
+     * @return true if applied, false if the channel is open or the
+     *         settings are invalid (nothing is changed)
+     */
+    bool applySettings(const SLCANSettings& settings);
 
     /**
      * Format a CAN frame as an SLCAN string for transmission to host.
@@ -75,13 +142,35 @@ public:
 
     /**
      * Get diagnostic counters.
-     * @param rxOverflows Output: RX ring buffer overflows
+     * @param rxOverflows Output: shared RX frame bus overflows
      * @param canRxDrops Output: CAN RX frames dropped due to USB blocking
      */
     void getCounters(uint32_t* rxOverflows, uint32_t* canRxDrops) const;
 
     /**
-     * Reset diagnostic counters.
+     * Get the traffic generator counters.
+     * @param queued Output: generated frames the backend accepted
+     * @param rejects Output: generated frames refused (TX queue full)
+     */
+    void getGeneratorCounters(uint32_t* queued, uint32_t* rejects) const;
+
+    /**
+     * Get the cyclic transmit counters.
+     * @param sent Output: cyclic frames the backend accepted
+     * @param rejects Output: cyclic sends refused (TX queue full)
+     */
+    void getCyclicCounters(uint32_t* sent, uint32_t* rejects) const;
+
+    /**
+     * Get the change-only forwarding counters.
+     * @param suppressed Output: frames not forwarded (unchanged payload)
+     * @param untracked Output: frames forwarded because the ID cache was full
+     */
+    void getChangeFilterCounters(uint32_t* suppressed, uint32_t* untracked) const;
+
+    /**
+     * Reset diagnostic counters (including the traffic generator's, the
+     * change filter's and the cyclic transmitter's).
      */
     void resetCounters();
 
@@ -89,24 +178,41 @@ private:
     ICANBackend& _can;
     SLCANState _state;
     uint8_t _configuredBitrate;     // S command value (0-8)
-    bool _timestampEnabled;
+    uint8_t _timestampMode;         // SLCAN_TIMESTAMP_OFF/MS/US (Z0/Z1/Z2)
     bool _autoForward;              // Runtime auto-forward control (X0/X1)
+    bool _pollAll;                  // A readout running (terminator not sent yet)
+    uint16_t _pollAllLeft;          // Frames the A readout still sends
+    bool _streamOwner;              // We own the RX stream (see ProtocolDispatcher)
+    bool _quietTx;                  // Suppress z/Z responses (q1)
     uint32_t _filterMask;
     uint32_t _filterCode;
 
-    // Ring buffer for RX frames (protocol layer)
-    struct FrameSlot {
-        CANFrame msg;
-        uint16_t timestamp;
-        bool valid;
-    };
+    // f+/f- edits since boot or fC, replayed by applySettings()
+    SLCANFilterOp _filterOps[SLCAN_SETTINGS_MAX_FILTER_OPS];
+    uint8_t _filterOpCount;
+    bool _filterOpsOverflow;
+
+    // Bench traffic source (g command)
+    TrafficGenerator _generator;
+
+    // Periodic transmit table (c command)
+    CyclicTransmitter _cyclic;
 
-    FrameSlot _rxQueue[CAN_RX_QUEUE_SIZE];
-    uint16_t _rxHead;  // drainFromBackend() writes here
-    uint16_t _rxTail;  // poll() reads here
+    // Per-ID payload cache for change-only forwarding (u command)
+    ChangeFilter _changeFilter;
+
+    // Cursor on the dispatcher's shared RX frame bus
+    FrameBus* _bus;
+    uint8_t _busReader;
+
+    // GR readout of the bus's capture: 0 = header next, n = frame n - 1 next
+    bool _captureReadout;
+    uint32_t _captureReadPos;
+
+    // Prefixes in ROUTES, one bit per command byte (canHandle())
+    uint32_t _prefixMask[8];
 
     // Diagnostic counters
-    uint32_t _rxOverflowCount;      // RX ring buffer overflows
     uint32_t _canRxDropCount;       // CAN RX frames dropped due to USB blocking
 
     // LED state for activity indication
@@ -116,10 +222,41 @@ private:
     bool _ledState;
 #endif
 
+    // Route targets: the dispatcher calls a command handler directly,
+    // without going through processCommand()
+    template<bool (SLCAN::*Handler)(const char*, char*)>
+    static bool routeCommand(IProtocolHandler* self, const char* cmd,
+                             char* response, size_t maxLen) {
+        if (response == nullptr || maxLen < 2) {
+            return false;
+        }
+        return (static_cast<SLCAN*>(self)->*Handler)(cmd, response);
+    }
+
+    template<bool (SLCAN::*Handler)(char*)>
+    static bool routeResponse(IProtocolHandler* self, const char* cmd,
+                              char* response, size_t maxLen) {
+        (void)cmd;
+        if (response == nullptr || maxLen < 2) {
+            return false;
+        }
+        return (static_cast<SLCAN*>(self)->*Handler)(response);
+    }
+
+    // Command prefix -> route target, one entry per command letter
+    struct Route {
+        uint8_t prefix;
+        CommandRouteFn fn;
+    };
+    static const Route ROUTES[];
+    static const size_t ROUTE_COUNT;
+
     // Command handlers
     bool handleSetup(const char* cmd, char* response);
+    bool handleSetupBtr(char* response);
     bool handleOpen(char* response);
     bool handleListen(char* response);
+    bool handleLoopback(char* response);
     bool handleClose(char* response);
     bool handleTransmitStd(const char* cmd, char* response);
     bool handleTransmitExt(const char* cmd, char* response);
@@ -131,12 +268,44 @@ private:
     bool handleTimestamp(const char* cmd, char* response);
     bool handleFilterMask(const char* cmd, char* response);
     bool handleFilterCode(const char* cmd, char* response);
+    bool handleFilterRule(const char* cmd, char* response);
+    bool handleBatchTransmit(const char* cmd, char* response);
+    bool handleQuietTx(const char* cmd, char* response);
+    bool handleTxEcho(const char* cmd, char* response);
+    bool handleProfile(const char* cmd, char* response);
+    bool handleGenerator(const char* cmd, char* response);
+    bool handleChangeOnly(const char* cmd, char* response);
+    bool handleDecimate(const char* cmd, char* response);
+    bool handleCyclic(const char* cmd, char* response);
+    bool handleOverflow(const char* cmd, char* response);
+    bool handleCapture(const char* cmd, char* response);
+    bool handleAutoPoll(const char* cmd, char* response);
+    bool handlePoll(const char* cmd, char* response);
+    bool handlePollAll(const char* cmd, char* response);
+
+    /**
+     * Check whether P/A may take frames now.
+     */
+    bool canPoll() const;
+
+    /**
+     * Send the next A readout frames and its terminator, as far as the link takes them.
+     * @return true while the readout is still running
+     */
+    bool pollAllReadout(ITransport* transport);
+
+    /**
+     * Stream the next GR readout lines within the forward budget.
+     * @return true while the readout is still running
+     */
+    bool pollCaptureReadout(ITransport* transport);
 
     // Helper functions
     bool parseFrame(const char* cmd, CANFrame& frame, bool extended, bool rtr);
-    uint8_t hexCharToNibble(char c);
-    char nibbleToHexChar(uint8_t n);
-    bool isHexChar(char c);
+    size_t parseFrameText(const char* text, size_t len, CANFrame& frame);
+    bool parseFilterRuleText(const char* text, CANFilterRule& rule);
+    size_t parseIdText(const char* text, size_t len, uint32_t* id, bool* extended);
+    bool parseHexField(const char* str, size_t len, uint32_t* value);
     uint32_t parseHex(const char* str, size_t len);
     size_t formatHex(uint32_t value, char* buffer, size_t digits);
 
@@ -152,9 +321,11 @@ private:
     // Set OK response
     void setOk(char* response);
 
-    // RX ring buffer management
-    void drainFromBackend();                             // Pull from backend into ring
-    bool getNextRxFrame(CANFrame& frame, uint16_t* timestamp);  // Get next frame from ring
+    // Channel is open in a mode that transmits (O or l)
+    bool canTransmit() const;
+
+    // Enable our frame bus reader only while we forward frames
+    void updateBusReader();
 };
 
 #endif // SLCAN_H
@@ -19,6 +19,7 @@
 #define SLCAN_CMD_SETUP_BTR     's'     // Set custom bit timing registers
 #define SLCAN_CMD_OPEN          'O'     // Open CAN channel (normal mode)
 #define SLCAN_CMD_LISTEN        'L'     // Open CAN channel (listen-only mode)
+#define SLCAN_CMD_LOOPBACK      'l'     // Open CAN channel (internal loopback self-test)
 #define SLCAN_CMD_CLOSE         'C'     // Close CAN channel
 
 // Transmit commands
@@ -33,7 +34,7 @@
 #define SLCAN_CMD_SERIAL        'N'     // Get serial number
 
 // Feature commands
-#define SLCAN_CMD_TIMESTAMP     'Z'     // Enable/disable timestamps (Z0/Z1)
+#define SLCAN_CMD_TIMESTAMP     'Z'     // Set timestamp mode (Z0/Z1/Z2)
 #define SLCAN_CMD_FILTER_MASK   'M'     // Set acceptance filter mask
 #define SLCAN_CMD_FILTER_CODE   'm'     // Set acceptance filter code
 
@@ -42,6 +43,327 @@
 #define SLCAN_CMD_POLL          'P'     // Poll for single CAN frame
 #define SLCAN_CMD_POLL_ALL      'A'     // Poll for all pending CAN frames
 
+// SpeeduinoR4 extensions
+#define SLCAN_CMD_FILTER_RULE   'f'     // Multi-rule filter table (f+, f-, fC, f)
+#define SLCAN_CMD_TX_BATCH      'b'     // Transmit several frames in one line
+#define SLCAN_CMD_QUIET_TX      'q'     // Quiet TX mode (q0/q1)
+#define SLCAN_CMD_TX_ECHO       'e'     // TX echo mode (e0/e1)
+#define SLCAN_CMD_PROFILE       'y'     // Profiler dump/reset (ENABLE_PROFILER builds)
+#define SLCAN_CMD_GENERATOR     'g'     // Traffic generator (bench measurements)
+#define SLCAN_CMD_CHANGE_ONLY   'u'     // Change-only RX forwarding (u0/u1)
+#define SLCAN_CMD_DECIMATE      'd'     // RX decimation rules (d+, d-, dC, d)
+#define SLCAN_CMD_CYCLIC        'c'     // Cyclic transmit table (c+, c=, c-, c#, cC, c)
+#define SLCAN_CMD_OVERFLOW      'o'     // RX overflow policy and priority lane (o0-o2, o+, o-, oC, o)
+#define SLCAN_CMD_CAPTURE       'G'     // Triggered burst capture (GW, GT, GD, GE, GA, GF, GX, GR, G)
+
+// =============================================================================
+// Polling Mode (X, P, A commands)
+// =============================================================================
+
+/*
+ *   X1                       Auto-poll/send on: received frames are sent as
+ *                            they arrive (default)
+ *   X0                       Auto-poll/send off: received frames wait on the
+ *                            frame bus until the host polls for them
+ *   P                        Poll one frame: responds with the oldest pending
+ *                            frame line, or an empty line if none (X0 only)
+ *   A                        Poll all: sends every frame pending when A
+ *                            arrives, then A<CR> (X0 only)
+ *
+ * P and A take frames in the order auto-forwarding would send them (the
+ * o priority lane first, u applies). A has no command response of its
+ * own: the frame lines and the A<CR> terminator go out through the RX
+ * frame lane, packed into as few transport writes as the link takes, and
+ * without the per-iteration forward budget. P and another A are refused
+ * (BELL) until the terminator is sent. The channel must be open and SLCAN
+ * must own the RX stream (not while B1 is on).
+ */
+
+#define SLCAN_POLL_RESPONSE_LEN (SLCAN_MAX_EXT_FRAME_LEN - 1)
+
+// =============================================================================
+// Filter Rule Extension (f command)
+// =============================================================================
+
+/*
+ *   f+Siii[jjj]              Accept standard IDs iii..jjj (or just iii)
+ *   f+Eiiiiiiii[jjjjjjjj]    Accept extended IDs iiiiiiii..jjjjjjjj
+ *   f+Mccccccccmmmmmmmm      Accept extended IDs where (id & m) == (c & m)
+ *   f-...                    Remove a rule (same syntax as f+)
+ *   fC                       Clear all rules (accept every frame)
+ *   f                        Query: responds fsssee (sss = standard IDs
+ *                            accepted, ee = extended rules), in hex
+ *
+ * With no rules installed every frame is accepted. Once any rule exists,
+ * only frames matching a rule of their ID type pass. The M/m mask/code
+ * filter still applies on top of the rule table.
+ */
+
+#define SLCAN_FILTER_ADD        '+'
+#define SLCAN_FILTER_REMOVE     '-'
+#define SLCAN_FILTER_CLEAR      'C'
+#define SLCAN_FILTER_STD        'S'
+#define SLCAN_FILTER_EXT        'E'
+#define SLCAN_FILTER_EXT_MASK   'M'
+
+// =============================================================================
+// Batch / Quiet Transmit Extension (b, q commands)
+// =============================================================================
+
+/*
+ *   b<frame><frame>...       Transmit frames back to back; each <frame> is a
+ *                            complete t/T/r/R command including its letter,
+ *                            e.g. bt1232AABBT123456780r7FF0
+ *                            Responds bNN (NN = frames queued, hex). Frames
+ *                            are queued in order; on a full TX queue the rest
+ *                            are not sent and the host resumes at frame NN.
+ *                            A malformed frame rejects the whole line (BELL,
+ *                            nothing sent).
+ *   q0 / q1                  Quiet TX off/on. When on, successful t/T/r/R
+ *                            commands send no response at all (errors still
+ *                            send BELL). Batch acks are always sent.
+ */
+
+#define SLCAN_BATCH_MAX_FRAMES  255     // Frames per b line (2-digit hex ack)
+
+// =============================================================================
+// TX Echo Extension (e command)
+// =============================================================================
+
+/*
+ *   e0 / e1                  TX echo off/on. When on, every frame that
+ *                            completes transmission on the bus is reported in
+ *                            the RX stream as 'e' followed by the frame in RX
+ *                            format, e.g. et1232AABB or eT123456780 (plus the
+ *                            Z1/Z2 timestamp, which is then the TX completion
+ *                            time). Echoes and received frames are sent in bus
+ *                            order. The z/Z response only means "queued".
+ */
+
+#define SLCAN_ECHO_PREFIX       'e'     // Leads each TX echo line
+#define SLCAN_ECHO_PREFIX_LEN   1
+
+// =============================================================================
+// Loopback / Traffic Generator Extension (l, g commands)
+// =============================================================================
+
+/*
+ *   l                        Open the channel in internal loopback mode: every
+ *                            transmitted frame is received back (and forwarded
+ *                            like any RX frame), nothing reaches the bus.
+ *                            Needs no second node or termination.
+ *   gsiiijjjd                Generate standard frames with IDs iii..jjj
+ *   geiiiiiiiijjjjjjjjd      Generate extended frames with IDs iiiiiiii..jjjjjjjj
+ *                            d = DLC 0-8, or M to cycle the DLC through 0..8.
+ *                            IDs step through the range and wrap. Data bytes
+ *                            are the frame's sequence number (LE, repeated).
+ *   g1[nnnnnnnn]             Start generating (nnnnnnnn frames, hex; default
+ *                            until stopped). Needs an open channel that can
+ *                            transmit (O or l). The TX queue is kept full.
+ *   g0                       Stop generating (C also stops it)
+ *   g                        Query: responds grqqqqqqqqxxxxxxxx
+ *                            r = running (0/1), q = frames queued, x = frames
+ *                            refused by the full TX queue, in hex
+ *
+ * Default profile: standard IDs 100..1FF, DLC 8. Counters clear with DR.
+ */
+
+#define SLCAN_GEN_DLC_MIX       'M'
+#define SLCAN_GEN_RESPONSE_LEN  (1 + 1 + 8 + 8)
+
+// =============================================================================
+// Change-Only Forwarding Extension (u command)
+// =============================================================================
+
+/*
+ *   u1[kkkk]                 Change-only forwarding on: a received frame is
+ *                            only forwarded if its DLC or data differ from
+ *                            the last frame forwarded for its ID. kkkk =
+ *                            keep-alive in ms (hex): an unchanged frame is
+ *                            forwarded anyway once this long has passed
+ *                            since its ID was last sent (default 0 = never).
+ *                            Starts with an empty cache.
+ *   u0                       Change-only forwarding off (forward every frame)
+ *   u                        Query: responds urkkkkssssssssxxxxxxxx
+ *                            r = on (0/1), k = keep-alive, s = frames
+ *                            suppressed, x = frames forwarded because their
+ *                            ID found no cache slot, in hex
+ *
+ * Remote frames and TX echoes are always forwarded. The cache holds every
+ * standard ID seen up to CHANGE_CACHE_STD_SLOTS distinct IDs, plus
+ * CHANGE_CACHE_EXT_SLOTS extended IDs; it is cleared when the channel
+ * closes. Counters clear with DR.
+ */
+
+#define SLCAN_CHANGE_RESPONSE_LEN   (1 + 1 + 4 + 8 + 8)
+
+// =============================================================================
+// RX Decimation Extension (d command)
+// =============================================================================
+
+/*
+ *   d+Nnn<rule>              Forward only 1 in nn (hex, 02-FF) frames matching
+ *                            <rule>
+ *   d+Hhhhh<rule>            Forward at most hhhh (hex) frames per second
+ *                            matching <rule> (token bucket on the capture
+ *                            timestamps, burst DECIMATE_BUCKET_BURST)
+ *   d-<rule>                 Remove the rule with this <rule>
+ *   dC                       Remove all rules
+ *   d                        Query: responds dnnxxxxxxxx (nn = rules,
+ *                            x = frames decimated), in hex
+ *
+ * <rule> is an f+ rule body: Siii[jjj], Eiiiiiiii[jjjjjjjj] or
+ * Mccccccccmmmmmmmm. Adding a rule that already exists replaces its
+ * limit. A frame is thinned by the first rule it matches, and a rule's
+ * limit covers all of its IDs together. Decimated frames are dropped
+ * before they enter the shared frame bus, so they take no ring space and
+ * no handler sees them. TX echoes are never decimated. Up to
+ * DECIMATE_MAX_RULES rules; the counter clears with DR.
+ */
+
+#define SLCAN_DECIMATE_ONE_IN_N     'N'
+#define SLCAN_DECIMATE_MAX_RATE     'H'
+#define SLCAN_DECIMATE_CLEAR        'C'
+#define SLCAN_DECIMATE_RESPONSE_LEN (1 + 2 + 8)
+
+// =============================================================================
+// Cyclic Transmit Extension (c command)
+// =============================================================================
+
+/*
+ *   c+pppp<frame>            Send <frame> every pppp ms (hex, 0001-FFFF).
+ *                            <frame> is a complete t/T/r/R command, e.g.
+ *                            c+0064t1232AABB. Replaces the entry with the
+ *                            same ID (and type); the first frame goes out
+ *                            on the next 1 ms tick.
+ *   c=<frame>                Change the DLC and data of an entry; its cycle
+ *                            timing and counter settings are unchanged
+ *   c-t<iii> / c-T<iiiiiiii> Remove the entry with this ID
+ *   c#t<iii>pmmq             Counter and checksum bytes of an entry (c#T with
+ *                            an 8-digit ID): p = data byte (0-7) that carries
+ *                            a rolling counter 0..mm-1 (mm hex, 00 = 256),
+ *                            q = data byte (0-7) that carries the XOR of the
+ *                            other data bytes; '-' for none. The counter
+ *                            restarts at 0.
+ *   cC                       Remove all entries
+ *   c                        Query: responds cnnssssssssxxxxxxxx
+ *                            n = entries, s = frames sent, x = sends refused
+ *                            by the full TX queue, in hex
+ *
+ * Entries are sent while the channel is open in a mode that transmits
+ * (O or l); they stay in the table across C. Cycles keep a fixed grid;
+ * after a stall the missed cycles are skipped. CYCLIC_TX_MAX_ENTRIES
+ * entries. The counters clear with DR.
+ */
+
+#define SLCAN_CYCLIC_SET        '+'
+#define SLCAN_CYCLIC_UPDATE     '='
+#define SLCAN_CYCLIC_REMOVE     '-'
+#define SLCAN_CYCLIC_COUNTER    '#'
+#define SLCAN_CYCLIC_CLEAR      'C'
+#define SLCAN_CYCLIC_NO_BYTE    '-'
+#define SLCAN_CYCLIC_RESPONSE_LEN   (1 + 2 + 8 + 8)
+
+// =============================================================================
+// RX Overflow Policy / Priority Lane Extension (o command)
+// =============================================================================
+
+/*
+ *   o0                       Full frame bus: leave new frames in the backend
+ *                            (default; the backend ring drops newest)
+ *   o1                       Full frame bus: discard new frames
+ *   o2                       Full frame bus: overwrite the oldest unread frame
+ *   o+<rule>                 Forward frames matching <rule> through the
+ *                            priority lane
+ *   o-<rule>                 Remove the priority rule with this <rule>
+ *   oC                       Remove all priority rules
+ *   o                        Query: responds opnnxxxxxxxxyyyyyyyy
+ *                            p = policy (0-2), n = priority rules,
+ *                            x = main ring drops, y = priority lane drops,
+ *                            in hex
+ *
+ * <rule> is an f+ rule body (see d). Priority frames are forwarded ahead
+ * of everything waiting in the main ring, so they can arrive out of
+ * timestamp order with other IDs. The lane holds FRAME_BUS_PRIORITY_SIZE
+ * frames; when it is full they use the main ring. Up to
+ * FRAME_BUS_PRIORITY_RULES rules. Drops are only counted by o1 and o2
+ * (with o0 the backend's RX ring overflow counter goes up instead); the
+ * counters clear with DR.
+ */
+
+#define SLCAN_OVERFLOW_CLEAR        'C'
+#define SLCAN_OVERFLOW_RESPONSE_LEN (1 + 1 + 2 + 8 + 8)
+
+// =============================================================================
+// Triggered Capture Extension (G command)
+// =============================================================================
+
+/*
+ *   GW<pppp><qqqq>           Window: keep p frames before the trigger and
+ *                            q after it (hex, p + 1 + q <= CAPTURE_BUFFER_FRAMES)
+ *   GT<rule>                 Trigger on frames matching <rule> (f+ body, see d)
+ *   GT                       No ID condition
+ *   GD<v x16><m x16>         Trigger on payloads where (byte & m) == v for
+ *                            every masked byte (8 value bytes, 8 mask bytes)
+ *   GD                       No data condition
+ *   GE0 / GE1                Trigger on a CAN error event off / on
+ *   GA                       Arm: discard the held capture and start recording
+ *   GF                       Force the trigger now (armed only)
+ *   GX                       Stop and discard the capture
+ *   GR                       Read out a complete capture (see below)
+ *   G                        Query: responds Gsnnnniiii
+ *                            s = 0 idle, 1 armed, 2 triggered, 3 done,
+ *                            n = frames held, i = trigger position, in hex
+ *
+ * A frame triggers when it matches both the ID rule and the data pattern
+ * (whichever are set); TX echoes never trigger. Every frame that passes
+ * the M/m and f filters is recorded at bus rate, ahead of d decimation and
+ * u: while the capture records, frames the host link can't take are
+ * dropped from the live stream instead of being held in the backend.
+ *
+ * GR streams, from the main loop as fast as the host reads:
+ *
+ *   GHnnnniiii<CR>           Header: frame count, trigger position
+ *   G<frame><CR>             One per frame, oldest first: a t/T/r/R line
+ *                            (e-prefixed for TX echoes) with a Z2 timestamp
+ *                            (low 28 bits of the microsecond clock)
+ *
+ * No frame is skipped when the link is busy; the readout resumes on the
+ * next poll, and live RX lines wait until it ends. GA or GX abort it.
+ */
+
+#define SLCAN_CAPTURE_WINDOW        'W'
+#define SLCAN_CAPTURE_TRIGGER_ID    'T'
+#define SLCAN_CAPTURE_TRIGGER_DATA  'D'
+#define SLCAN_CAPTURE_TRIGGER_ERROR 'E'
+#define SLCAN_CAPTURE_ARM           'A'
+#define SLCAN_CAPTURE_FORCE         'F'
+#define SLCAN_CAPTURE_STOP          'X'
+#define SLCAN_CAPTURE_READ          'R'
+#define SLCAN_CAPTURE_HEADER        'H'
+#define SLCAN_CAPTURE_RESPONSE_LEN  (1 + 1 + 4 + 4)
+#define SLCAN_CAPTURE_HEADER_LEN    (2 + 4 + 4 + 1)
+#define SLCAN_CAPTURE_LINE_LEN      (1 + SLCAN_MAX_EXT_FRAME_LEN)
+
+// =============================================================================
+// Profiler Extension (y command, ENABLE_PROFILER builds only)
+// =============================================================================
+
+/*
+ *   y                        Responds yNN: number of probes (hex)
+ *   yNN                      Statistics of probe NN (see ProfileProbe in
+ *                            Profiler.h), all in CPU cycles, hex:
+ *                            yNNccccccccmmmmmmmmxxxxxxxxaaaaaaaa + 8 x hhhh
+ *                            c = samples, m = min, x = max, a = mean,
+ *                            h = histogram buckets (< 64 cycles, then powers
+ *                            of 4 up to >= 256k cycles), saturating at FFFF
+ *   yR                       Reset all statistics
+ *
+ * Without ENABLE_PROFILER every y command returns BELL.
+ */
+
+#define SLCAN_PROFILE_RESPONSE_LEN  (1 + 2 + 4 * 8 + 8 * 4)
+
 // =============================================================================
 // SLCAN Response Characters
 // =============================================================================
@@ -100,19 +422,27 @@
  *
  * Received frames (when timestamps enabled):
  *   tiiildd..tttt or Tiiiiiiiildd..tttt
- *   tttt = 4 hex digits for timestamp (0000-FFFF ms)
+ *   tttt = 4 hex digits for timestamp (0000-FFFF ms)           (Z1)
+ *   tiiildd..tttttttt or Tiiiiiiiildd..tttttttt
+ *   tttttttt = 8 hex digits, 32-bit reception time in us       (Z2, extension)
  */
 
+// Timestamp modes (Z command)
+#define SLCAN_TIMESTAMP_OFF     0       // Z0: no timestamp
+#define SLCAN_TIMESTAMP_MS      1       // Z1: 16-bit milliseconds (Lawicel compatible)
+#define SLCAN_TIMESTAMP_US      2       // Z2: 32-bit microseconds
+
 // Frame format lengths
 #define SLCAN_STD_ID_LEN        3       // 3 hex chars for 11-bit ID
 #define SLCAN_EXT_ID_LEN        8       // 8 hex chars for 29-bit ID
 #define SLCAN_DLC_LEN           1       // 1 hex char for DLC
 #define SLCAN_DATA_CHAR_LEN     2       // 2 hex chars per data byte
-#define SLCAN_TIMESTAMP_LEN     4       // 4 hex chars for timestamp
+#define SLCAN_TIMESTAMP_LEN     4       // 4 hex chars for timestamp (Z1)
+#define SLCAN_TIMESTAMP_US_LEN  8       // 8 hex chars for timestamp (Z2)
 
 // Maximum frame string lengths
-#define SLCAN_MAX_STD_FRAME_LEN (1 + SLCAN_STD_ID_LEN + SLCAN_DLC_LEN + 16 + SLCAN_TIMESTAMP_LEN + 1)
-#define SLCAN_MAX_EXT_FRAME_LEN (1 + SLCAN_EXT_ID_LEN + SLCAN_DLC_LEN + 16 + SLCAN_TIMESTAMP_LEN + 1)
+#define SLCAN_MAX_STD_FRAME_LEN (SLCAN_ECHO_PREFIX_LEN + 1 + SLCAN_STD_ID_LEN + SLCAN_DLC_LEN + 16 + SLCAN_TIMESTAMP_US_LEN + 1)
+#define SLCAN_MAX_EXT_FRAME_LEN (SLCAN_ECHO_PREFIX_LEN + 1 + SLCAN_EXT_ID_LEN + SLCAN_DLC_LEN + 16 + SLCAN_TIMESTAMP_US_LEN + 1)
 
 // =============================================================================
 // Status Flags (F command response)
@@ -0,0 +1,85 @@
+/**
+ * SLCAN Hex Tables
+ *
+ * Table-driven hex encoding and validating decoding for the SLCAN
+ * frame formatter and parser.
+ */
+
+#ifndef SLCAN_HEX_H
+#define SLCAN_HEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SLCAN_HEX_INVALID   0xFF    // Decode table entry for non-hex characters
+
+// Byte -> two uppercase hex characters ("00".."FF"), 512 chars + NUL
+extern const char SLCAN_HEX_PAIRS[513];
+
+// Character -> nibble value (0-15), or SLCAN_HEX_INVALID
+extern const uint8_t SLCAN_HEX_DECODE[256];
+
+/**
+ * Write one byte as two hex characters.
+ * @param out Output (2 chars, not terminated)
+ * @param value Byte to encode
+ */
+inline void slcanHexByte(char* out, uint8_t value) {
+    const char* pair = &SLCAN_HEX_PAIRS[value * 2];
+    out[0] = pair[0];
+    out[1] = pair[1];
+}
+
+/**
+ * Write the low nibble as one hex character.
+ * @param out Output (1 char)
+ * @param value Nibble to encode (upper bits ignored)
+ */
+inline void slcanHexNibble(char* out, uint8_t value) {
+    out[0] = SLCAN_HEX_PAIRS[(value & 0x0F) * 2 + 1];
+}
+
+/**
+ * Decode a fixed number of hex characters.
+ *
+ * Invalid characters are collected into one check after the loop
+ * (every invalid entry has its high bits set), so the loop has no
+ * per-character branch.
+ *
+ * @param str Input characters (need not be terminated)
+ * @param digits Number of characters to decode (at most 8)
+ * @param value Output: decoded value (written only on success)
+ * @return true if all characters were hex digits
+ */
+inline bool slcanHexDecode(const char* str, size_t digits, uint32_t* value) {
+    uint32_t result = 0;
+    uint8_t bad = 0;
+    for (size_t i = 0; i < digits; i++) {
+        uint8_t n = SLCAN_HEX_DECODE[(uint8_t)str[i]];
+        bad |= n;
+        result = (result << 4) | (n & 0x0F);
+    }
+    if (bad & 0xF0) {
+        return false;
+    }
+    *value = result;
+    return true;
+}
+
+/**
+ * Decode two hex characters into a byte.
+ * @param str Input characters
+ * @param value Output byte (written only on success)
+ * @return true if both characters were hex digits
+ */
+inline bool slcanHexDecodeByte(const char* str, uint8_t* value) {
+    uint8_t hi = SLCAN_HEX_DECODE[(uint8_t)str[0]];
+    uint8_t lo = SLCAN_HEX_DECODE[(uint8_t)str[1]];
+    if ((hi | lo) & 0xF0) {
+        return false;
+    }
+    *value = (uint8_t)((hi << 4) | lo);
+    return true;
+}
+
+#endif // SLCAN_HEX_H
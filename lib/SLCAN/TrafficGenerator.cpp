@@ -0,0 +1,97 @@
+/**
+ * Traffic Generator Implementation
+ */
+
+#include "TrafficGenerator.h"
+
+TrafficGenerator::TrafficGenerator()
+    : _running(false)
+    , _extended(false)
+    , _dlc(8)
+    , _firstId(0x100)
+    , _lastId(0x1FF)
+    , _nextId(0x100)
+    , _remaining(0)
+    , _sequence(0)
+    , _queuedCount(0)
+    , _rejectCount(0)
+{
+}
+
+bool TrafficGenerator::configure(bool extended, uint32_t firstId, uint32_t lastId, uint8_t dlc) {
+    uint32_t maxId = extended ? 0x1FFFFFFFUL : 0x7FFUL;
+    if (firstId > lastId || lastId > maxId) {
+        return false;
+    }
+    if (dlc > 8 && dlc != TRAFFIC_GEN_DLC_MIX) {
+        return false;
+    }
+
+    _extended = extended;
+    _firstId = firstId;
+    _lastId = lastId;
+    _nextId = firstId;
+    _dlc = dlc;
+    return true;
+}
+
+void TrafficGenerator::start(uint32_t count) {
+    _remaining = count;
+    _sequence = 0;
+    _nextId = _firstId;
+    _running = true;
+}
+
+void TrafficGenerator::stop() {
+    _running = false;
+}
+
+bool TrafficGenerator::isRunning() const {
+    return _running;
+}
+
+uint8_t TrafficGenerator::poll(ICANBackend& can) {
+    if (!_running) {
+        return 0;
+    }
+
+    uint8_t queued = 0;
+    while (queued < TRAFFIC_GEN_MAX_PER_POLL) {
+        CANFrame frame;
+        buildFrame(frame);
+        if (!can.write(frame)) {
+            _rejectCount++;     // TX queue full: try again next loop
+            break;
+        }
+
+        queued++;
+        _queuedCount++;
+        _sequence++;
+        _nextId = (_nextId >= _lastId) ? _firstId : _nextId + 1;
+
+        if (_remaining != 0 && --_remaining == 0) {
+            _running = false;
+            break;
+        }
+    }
+    return queued;
+}
+
+void TrafficGenerator::buildFrame(CANFrame& frame) const {
+    frame.id = _nextId;
+    frame.extended = _extended;
+    frame.dlc = (_dlc == TRAFFIC_GEN_DLC_MIX) ? (uint8_t)(_sequence % 9) : _dlc;
+    for (uint8_t i = 0; i < 8; i++) {
+        frame.data[i] = (uint8_t)(_sequence >> (8 * (i & 3)));
+    }
+}
+
+void TrafficGenerator::getCounters(uint32_t* queued, uint32_t* rejects) const {
+    if (queued) *queued = _queuedCount;
+    if (rejects) *rejects = _rejectCount;
+}
+
+void TrafficGenerator::resetCounters() {
+    _queuedCount = 0;
+    _rejectCount = 0;
+}
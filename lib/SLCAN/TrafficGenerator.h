@@ -0,0 +1,95 @@
+/**
+ * Traffic Generator
+ *
+ * On-device CAN frame source for bench measurements (g command): keeps
+ * the TX queue full with a configurable ID range and DLC mix so the
+ * adapter's sustained TX-accept and RX-forward rates can be measured,
+ * e.g. against itself in loopback mode.
+ */
+
+#ifndef TRAFFIC_GENERATOR_H
+#define TRAFFIC_GENERATOR_H
+
+#include "config.h"
+#include "CANBackend.h"
+#include <stdint.h>
+
+#ifndef TRAFFIC_GEN_MAX_PER_POLL
+#define TRAFFIC_GEN_MAX_PER_POLL 16
+#endif
+
+#define TRAFFIC_GEN_DLC_MIX     0xFF    // Cycle the DLC through 0..8
+
+/**
+ * Frame generator feeding an ICANBackend from the main loop.
+ *
+ * IDs step from firstId to lastId and wrap. Each frame's data is the
+ * generator's sequence number, little-endian and repeated, so the host
+ * can spot lost or reordered frames.
+ */
+class TrafficGenerator {
+public:
+    TrafficGenerator();
+
+    /**
+     * Set the frames to generate (takes effect with the next frame).
+     * @param extended true for 29-bit IDs
+     * @param firstId First ID of the range
+     * @param lastId Last ID of the range (inclusive, >= firstId)
+     * @param dlc Data length 0-8, or TRAFFIC_GEN_DLC_MIX
+     * @return true if the configuration is valid
+     */
+    bool configure(bool extended, uint32_t firstId, uint32_t lastId, uint8_t dlc);
+
+    /**
+     * Start generating.
+     * @param count Frames to generate, 0 for no limit
+     */
+    void start(uint32_t count);
+
+    /**
+     * Stop generating.
+     */
+    void stop();
+
+    bool isRunning() const;
+
+    /**
+     * Offer frames to the backend until it refuses one, the burst limit
+     * (TRAFFIC_GEN_MAX_PER_POLL) is reached or the count is done.
+     * Call once per main loop iteration while the channel can transmit.
+     * @param can Backend to write to
+     * @return Number of frames queued
+     */
+    uint8_t poll(ICANBackend& can);
+
+    /**
+     * Get diagnostic counters.
+     * @param queued Output: frames the backend accepted
+     * @param rejects Output: frames the backend refused (TX queue full)
+     */
+    void getCounters(uint32_t* queued, uint32_t* rejects) const;
+
+    /**
+     * Reset diagnostic counters.
+     */
+    void resetCounters();
+
+private:
+    bool _running;
+    bool _extended;
+    uint8_t _dlc;               // 0-8 or TRAFFIC_GEN_DLC_MIX
+    uint32_t _firstId;
+    uint32_t _lastId;
+    uint32_t _nextId;
+    uint32_t _remaining;        // Frames left to generate (0 = no limit)
+    uint32_t _sequence;         // Sequence number of the next frame
+
+    // Diagnostic counters
+    uint32_t _queuedCount;      // Frames the backend accepted
+    uint32_t _rejectCount;      // Frames the backend refused
+
+    void buildFrame(CANFrame& frame) const;
+};
+
+#endif // TRAFFIC_GENERATOR_H
@@ -0,0 +1,275 @@
+/**
+ * Persisted Configuration Handler Implementation
+ */
+
+#include "ConfigStore.h"
+#include "Transport.h"
+#include <string.h>
+
+static bool setOk(char* response) {
+    response[0] = '\0';
+    return true;
+}
+
+static bool setError(char* response) {
+    response[0] = '\x07';  // BELL - error
+    response[1] = '\0';
+    return true;
+}
+
+static void putU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+ConfigStore::ConfigStore(SLCAN& slcan, BinaryStream& binaryStream, ISettingsStorage& storage)
+    : _slcan(slcan)
+    , _binaryStream(binaryStream)
+    , _storage(storage)
+    , _autoStart(CONFIG_AUTOSTART_OFF)
+    , _stored(false)
+{
+}
+
+const char* ConfigStore::getName() const {
+    return "CONFIG";
+}
+
+bool ConfigStore::canHandle(const char* cmd) const {
+    return cmd != nullptr && cmd[0] == 'Q';
+}
+
+bool ConfigStore::processCommand(const char* cmd, char* response, size_t maxLen) {
+    if (cmd == nullptr || response == nullptr || maxLen < 4) {
+        return false;
+    }
+
+    char op = cmd[1];
+    if (op == '\0') {
+        // Query: Q<a><v>
+        response[0] = 'Q';
+        response[1] = (char)('0' + _autoStart);
+        response[2] = _stored ? '1' : '0';
+        response[3] = '\0';
+        return true;
+    }
+    if (cmd[2] != '\0') {
+        return setError(response);
+    }
+
+    switch (op) {
+        case '0':
+        case '1':
+        case '2':
+            return save((uint8_t)(op - '0')) ? setOk(response) : setError(response);
+
+        case CONFIG_CMD_WRITE:
+            return save(_autoStart) ? setOk(response) : setError(response);
+
+        case CONFIG_CMD_READ: {
+            StoredConfig config;
+            if (_slcan.getState() != SLCANState::Closed || !load(config) || !apply(config)) {
+                return setError(response);
+            }
+            return setOk(response);
+        }
+
+        case CONFIG_CMD_ERASE: {
+            // A broken magic is enough to invalidate the record
+            uint8_t blank[CONFIG_RECORD_HEADER_LEN];
+            memset(blank, 0xFF, sizeof(blank));
+            if (!_storage.write(CONFIG_STORE_OFFSET, blank, sizeof(blank))) {
+                return setError(response);
+            }
+            _autoStart = CONFIG_AUTOSTART_OFF;
+            _stored = false;
+            return setOk(response);
+        }
+
+        default:
+            return setError(response);
+    }
+}
+
+void ConfigStore::poll(ITransport* transport) {
+    (void)transport;
+}
+
+bool ConfigStore::isActive() const {
+    return false;
+}
+
+bool ConfigStore::begin() {
+    StoredConfig config;
+    if (!load(config) || !apply(config)) {
+        return false;
+    }
+
+    // Open straight away: frames queue on the frame bus until a host connects
+    char response[4];
+    if (config.autoStart == CONFIG_AUTOSTART_NORMAL) {
+        _slcan.processCommand("O", response, sizeof(response));
+    } else if (config.autoStart == CONFIG_AUTOSTART_LISTEN) {
+        _slcan.processCommand("L", response, sizeof(response));
+    }
+    return true;
+}
+
+uint8_t ConfigStore::getAutoStart() const {
+    return _autoStart;
+}
+
+bool ConfigStore::hasStoredConfig() const {
+    return _stored;
+}
+
+bool ConfigStore::save(uint8_t autoStart) {
+    StoredConfig config;
+    config.autoStart = autoStart;
+    config.binaryOutput = _binaryStream.isActive();
+    _slcan.getSettings(config.slcan);
+
+    uint8_t record[CONFIG_RECORD_MAX_LEN];
+    size_t len = encodeRecord(config, record);
+    if (len == 0 || !_storage.write(CONFIG_STORE_OFFSET, record, len)) {
+        return false;
+    }
+    _autoStart = autoStart;
+    _stored = true;
+    return true;
+}
+
+bool ConfigStore::load(StoredConfig& config) {
+    uint8_t record[CONFIG_RECORD_MAX_LEN];
+    if (!_storage.read(CONFIG_STORE_OFFSET, record, CONFIG_RECORD_HEADER_LEN)) {
+        return false;
+    }
+
+    // Read only as much as the header says is there
+    size_t len = CONFIG_RECORD_HEADER_LEN + record[3] + CONFIG_RECORD_CRC_LEN;
+    if (len > sizeof(record) ||
+        !_storage.read(CONFIG_STORE_OFFSET + CONFIG_RECORD_HEADER_LEN,
+                       record + CONFIG_RECORD_HEADER_LEN, len - CONFIG_RECORD_HEADER_LEN) ||
+        !decodeRecord(record, len, config)) {
+        _autoStart = CONFIG_AUTOSTART_OFF;
+        _stored = false;
+        return false;
+    }
+
+    _autoStart = config.autoStart;
+    _stored = true;
+    return true;
+}
+
+bool ConfigStore::apply(const StoredConfig& config) {
+    if (!_slcan.applySettings(config.slcan)) {
+        return false;
+    }
+
+    char response[4];
+    _binaryStream.processCommand(config.binaryOutput ? "B1" : "B0", response, sizeof(response));
+    return true;
+}
+
+size_t ConfigStore::encodeRecord(const StoredConfig& config, uint8_t* buffer) {
+    const SLCANSettings& s = config.slcan;
+    if (buffer == nullptr || s.filterOpsOverflow || s.filterOpCount > SLCAN_SETTINGS_MAX_FILTER_OPS ||
+        config.autoStart > CONFIG_AUTOSTART_LISTEN) {
+        return 0;
+    }
+
+    size_t payloadLen = (size_t)(CONFIG_RECORD_FIXED_LEN + s.filterOpCount * CONFIG_RECORD_FILTER_OP_LEN);
+    buffer[0] = CONFIG_RECORD_MAGIC0;
+    buffer[1] = CONFIG_RECORD_MAGIC1;
+    buffer[2] = CONFIG_RECORD_VERSION;
+    buffer[3] = (uint8_t)payloadLen;
+
+    uint8_t* p = buffer + CONFIG_RECORD_HEADER_LEN;
+    *p++ = config.autoStart;
+    *p++ = config.binaryOutput ? 1 : 0;
+    *p++ = s.bitrate;
+    *p++ = s.timestampMode;
+    putU32(p, s.filterMask);
+    putU32(p + 4, s.filterCode);
+    p += 8;
+    *p++ = s.filterOpCount;
+    for (uint8_t i = 0; i < s.filterOpCount; i++) {
+        const SLCANFilterOp& op = s.filterOps[i];
+        *p++ = (uint8_t)op.rule.kind | (op.add ? 0x80 : 0x00);
+        putU32(p, op.rule.first);
+        putU32(p + 4, op.rule.second);
+        p += 8;
+    }
+
+    size_t len = CONFIG_RECORD_HEADER_LEN + payloadLen;
+    uint16_t crc = crc16(buffer, len);
+    buffer[len++] = (uint8_t)crc;
+    buffer[len++] = (uint8_t)(crc >> 8);
+    return len;
+}
+
+bool ConfigStore::decodeRecord(const uint8_t* buffer, size_t len, StoredConfig& config) {
+    if (buffer == nullptr || len < CONFIG_RECORD_HEADER_LEN + CONFIG_RECORD_FIXED_LEN + CONFIG_RECORD_CRC_LEN ||
+        buffer[0] != CONFIG_RECORD_MAGIC0 || buffer[1] != CONFIG_RECORD_MAGIC1 ||
+        buffer[2] != CONFIG_RECORD_VERSION) {
+        return false;
+    }
+
+    size_t payloadLen = buffer[3];
+    size_t crcPos = CONFIG_RECORD_HEADER_LEN + payloadLen;
+    if (crcPos + CONFIG_RECORD_CRC_LEN > len) {
+        return false;
+    }
+    uint16_t crc = (uint16_t)buffer[crcPos] | ((uint16_t)buffer[crcPos + 1] << 8);
+    if (crc != crc16(buffer, crcPos)) {
+        return false;
+    }
+
+    const uint8_t* p = buffer + CONFIG_RECORD_HEADER_LEN;
+    SLCANSettings& s = config.slcan;
+    config.autoStart = p[0];
+    config.binaryOutput = p[1] != 0;
+    s.bitrate = p[2];
+    s.timestampMode = p[3];
+    s.filterMask = getU32(p + 4);
+    s.filterCode = getU32(p + 8);
+    s.filterOpCount = p[12];
+    s.filterOpsOverflow = false;
+    if (config.autoStart > CONFIG_AUTOSTART_LISTEN || p[1] > 1 ||
+        s.filterOpCount > SLCAN_SETTINGS_MAX_FILTER_OPS ||
+        payloadLen != (size_t)(CONFIG_RECORD_FIXED_LEN + s.filterOpCount * CONFIG_RECORD_FILTER_OP_LEN)) {
+        return false;
+    }
+
+    p += CONFIG_RECORD_FIXED_LEN;
+    for (uint8_t i = 0; i < s.filterOpCount; i++) {
+        uint8_t kind = p[0] & 0x7F;
+        if (kind > (uint8_t)CANFilterRule::Kind::ExtMask) {
+            return false;
+        }
+        SLCANFilterOp& op = s.filterOps[i];
+        op.add = (p[0] & 0x80) != 0;
+        op.rule.kind = static_cast<CANFilterRule::Kind>(kind);
+        op.rule.first = getU32(p + 1);
+        op.rule.second = getU32(p + 5);
+        p += CONFIG_RECORD_FILTER_OP_LEN;
+    }
+    return true;
+}
+
+uint16_t ConfigStore::crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,153 @@
+/**
+ * Persisted Configuration Handler
+ *
+ * Saves the channel configuration (S, M/m, Z, filter table, output
+ * protocol) to non-volatile storage and restores it at boot, so a
+ * headless adapter opens the CAN channel without a host replaying the
+ * setup commands.
+ */
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include "config.h"
+#include "ProtocolHandler.h"
+#include "SettingsStorage.h"
+#include "SLCAN.h"
+#include "BinaryStream.h"
+#include <stdint.h>
+
+#ifndef CONFIG_STORE_OFFSET
+#define CONFIG_STORE_OFFSET 0
+#endif
+
+// Stored record: header, payload, CRC-16/CCITT (over header and payload)
+#define CONFIG_RECORD_MAGIC0        'S'
+#define CONFIG_RECORD_MAGIC1        'R'
+#define CONFIG_RECORD_VERSION       1
+#define CONFIG_RECORD_HEADER_LEN    4       // Magic (2), version, payload length
+#define CONFIG_RECORD_FIXED_LEN     13      // Auto-start, output, S, Z, M (4), m (4), edit count
+#define CONFIG_RECORD_FILTER_OP_LEN 9       // Kind + f+ flag, first (4), second (4)
+#define CONFIG_RECORD_CRC_LEN       2
+#define CONFIG_RECORD_MAX_LEN       (CONFIG_RECORD_HEADER_LEN + CONFIG_RECORD_FIXED_LEN + \
+                                     SLCAN_SETTINGS_MAX_FILTER_OPS * CONFIG_RECORD_FILTER_OP_LEN + \
+                                     CONFIG_RECORD_CRC_LEN)
+
+static_assert(CONFIG_RECORD_MAX_LEN - CONFIG_RECORD_HEADER_LEN - CONFIG_RECORD_CRC_LEN <= 255,
+              "Config payload length must fit a byte");
+
+// Auto-start modes (Q0/Q1/Q2, as on the Lawicel CANUSB)
+#define CONFIG_AUTOSTART_OFF        0       // Stay closed at power on
+#define CONFIG_AUTOSTART_NORMAL     1       // Open in normal mode (O)
+#define CONFIG_AUTOSTART_LISTEN     2       // Open in listen-only mode (L)
+
+// Command letters after Q
+#define CONFIG_CMD_WRITE            'W'
+#define CONFIG_CMD_READ             'R'
+#define CONFIG_CMD_ERASE            'E'
+
+/**
+ * Everything the stored record holds.
+ */
+struct StoredConfig {
+    uint8_t autoStart;              // CONFIG_AUTOSTART_*
+    bool binaryOutput;              // RX stream in binary (B1) instead of SLCAN text
+    SLCANSettings slcan;
+};
+
+/**
+ * Persisted configuration handler (Q commands).
+ *
+ *   Q0/Q1/Q2 : Set auto-start (off / open normal / open listen-only) and
+ *              save the current configuration
+ *   QW       : Save the current configuration (auto-start unchanged)
+ *   QR       : Load and apply the stored configuration (channel closed)
+ *   QE       : Erase the stored configuration (defaults at next boot)
+ *   Q        : Query: Q<a><v> (auto-start mode, 1 if a record is stored)
+ *
+ * Saved: S bitrate, M/m, Z mode, the f table (as its f+/f- edits since
+ * the last fC, at most SLCAN_SETTINGS_MAX_FILTER_OPS) and whether the RX
+ * stream is binary (B1). Saving fails (BELL) when the f table has had
+ * more edits than fit; fC and rebuild it to save.
+ */
+class ConfigStore : public IProtocolHandler {
+public:
+    /**
+     * Constructor.
+     * @param slcan SLCAN handler whose configuration is saved
+     * @param binaryStream Binary stream handler (output protocol)
+     * @param storage Non-volatile storage for the record
+     */
+    ConfigStore(SLCAN& slcan, BinaryStream& binaryStream, ISettingsStorage& storage);
+
+    // IProtocolHandler interface
+    const char* getName() const override;
+    bool canHandle(const char* cmd) const override;
+    bool processCommand(const char* cmd, char* response, size_t maxLen) override;
+    void poll(ITransport* transport) override;
+    bool isActive() const override;
+
+    /**
+     * Apply the stored configuration and auto-start the channel.
+     * Call once at boot, after every handler is registered.
+     * @return true if a valid record was found and applied
+     */
+    bool begin();
+
+    /**
+     * Get the auto-start mode of the stored record.
+     * @return CONFIG_AUTOSTART_* (OFF if nothing is stored)
+     */
+    uint8_t getAutoStart() const;
+
+    /**
+     * Check if a valid record is stored.
+     */
+    bool hasStoredConfig() const;
+
+    /**
+     * Serialize a configuration into a record.
+     * @param config Configuration to store
+     * @param buffer Output: at least CONFIG_RECORD_MAX_LEN bytes
+     * @return Record length, 0 if the configuration can't be stored
+     */
+    static size_t encodeRecord(const StoredConfig& config, uint8_t* buffer);
+
+    /**
+     * Parse and check a record.
+     * @param buffer Record bytes
+     * @param len Bytes available
+     * @param config Output: stored configuration
+     * @return true if the record is intact (magic, version, CRC, values)
+     */
+    static bool decodeRecord(const uint8_t* buffer, size_t len, StoredConfig& config);
+
+private:
+    SLCAN& _slcan;
+    BinaryStream& _binaryStream;
+    ISettingsStorage& _storage;
+    uint8_t _autoStart;             // Auto-start mode of the stored record
+    bool _stored;                   // A valid record is stored
+
+    /**
+     * Save the current configuration with the given auto-start mode.
+     */
+    bool save(uint8_t autoStart);
+
+    /**
+     * Read the stored record.
+     */
+    bool load(StoredConfig& config);
+
+    /**
+     * Apply a configuration to SLCAN and the output protocol.
+     */
+    bool apply(const StoredConfig& config);
+
+    /**
+     * CRC-16/CCITT-FALSE.
+     */
+    static uint16_t crc16(const uint8_t* data, size_t len);
+};
+
+#endif // CONFIG_STORE_H
@@ -0,0 +1,46 @@
+/**
+ * EEPROM Settings Storage
+ *
+ * ISettingsStorage on the Arduino EEPROM library (data flash emulation
+ * on the Uno R4). Header-only: included by the board build only, so the
+ * native tests never see <EEPROM.h>.
+ */
+
+#ifndef EEPROM_STORAGE_H
+#define EEPROM_STORAGE_H
+
+#include "SettingsStorage.h"
+#include <EEPROM.h>
+
+/**
+ * Settings storage in the emulated EEPROM.
+ */
+class EepromStorage : public ISettingsStorage {
+public:
+    size_t capacity() const override {
+        return EEPROM.length();
+    }
+
+    bool read(size_t offset, uint8_t* data, size_t len) override {
+        if (data == nullptr || offset + len > capacity()) {
+            return false;
+        }
+        for (size_t i = 0; i < len; i++) {
+            data[i] = EEPROM.read((int)(offset + i));
+        }
+        return true;
+    }
+
+    bool write(size_t offset, const uint8_t* data, size_t len) override {
+        if (data == nullptr || offset + len > capacity()) {
+            return false;
+        }
+        // update() skips unchanged bytes, sparing the flash
+        for (size_t i = 0; i < len; i++) {
+            EEPROM.update((int)(offset + i), data[i]);
+        }
+        return true;
+    }
+};
+
+#endif // EEPROM_STORAGE_H
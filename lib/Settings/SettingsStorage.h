@@ -0,0 +1,47 @@
+/**
+ * Settings Storage Interface
+ *
+ * Byte-addressed non-volatile storage for the persisted configuration.
+ * The board uses the RA4M1's emulated EEPROM (EepromStorage.h); native
+ * tests use a RAM-backed mock.
+ */
+
+#ifndef SETTINGS_STORAGE_H
+#define SETTINGS_STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Abstract non-volatile storage.
+ */
+class ISettingsStorage {
+public:
+    /**
+     * Get the storage size.
+     * @return Number of bytes that can be stored
+     */
+    virtual size_t capacity() const = 0;
+
+    /**
+     * Read bytes.
+     * @param offset Start address
+     * @param data Output buffer
+     * @param len Number of bytes to read
+     * @return true on success, false if out of range
+     */
+    virtual bool read(size_t offset, uint8_t* data, size_t len) = 0;
+
+    /**
+     * Write bytes. May block while the flash is programmed.
+     * @param offset Start address
+     * @param data Bytes to write
+     * @param len Number of bytes to write
+     * @return true on success, false if out of range or the write failed
+     */
+    virtual bool write(size_t offset, const uint8_t* data, size_t len) = 0;
+
+    virtual ~ISettingsStorage() = default;
+};
+
+#endif // SETTINGS_STORAGE_H
@@ -0,0 +1,22 @@
+/**
+ * Host Transport Selection
+ *
+ * The transport the firmware talks to the host over: USB CDC serial by
+ * default, WiFi UDP with ENABLE_WIFI_TRANSPORT. Both share the counter
+ * interface Diagnostics reads.
+ */
+
+#ifndef HOST_TRANSPORT_H
+#define HOST_TRANSPORT_H
+
+#include "config.h"
+
+#if ENABLE_WIFI_TRANSPORT
+#include "UdpTransport.h"
+typedef UdpTransport HostTransport;
+#else
+#include "SerialTransport.h"
+typedef SerialTransport HostTransport;
+#endif
+
+#endif // HOST_TRANSPORT_H
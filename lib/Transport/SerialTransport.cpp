@@ -7,111 +7,255 @@
 
 SerialTransport::SerialTransport(Stream& serial)
     : _serial(serial)
-    , _cmdHead(0)
-    , _cmdTail(0)
-    , _rxAccIndex(0)
+    , _rxStart(0)
+    , _rxEnd(0)
+    , _rxScan(0)
+    , _lineEnd(0)
+    , _lineHeld(false)
+    , _rxDiscard(false)
+    , _txRespLen(0)
+    , _txBatchLen(0)
+    , _txRecHead(0)
+    , _txRecCount(0)
     , _cmdResponseDropCount(0)
     , _canTxDropCount(0)
     , _cmdOverflowCount(0)
+    , _rxHighWater(0)
+    , _txHighWater(0)
 {
-    memset(_rxAccumulator, 0, sizeof(_rxAccumulator));
-    for (uint8_t i = 0; i < SERIAL_CMD_QUEUE_SIZE; i++) {
-        memset(_cmdQueue[i].buffer, 0, sizeof(_cmdQueue[i].buffer));
-        _cmdQueue[i].length = 0;
-        _cmdQueue[i].valid = false;
-    }
 }
 
 void SerialTransport::begin(uint32_t baudRate) {
     // For USB CDC on R4 WiFi, Serial is already available
     // but we call begin() for compatibility and to set baud rate
     // Note: USB CDC ignores baud rate, but hardware UART would use it
+    // No wait for the host: RX frames are held back until isConnected()
     if (&_serial == &Serial) {
         Serial.begin(baudRate);
-        // Wait for USB CDC to be ready (with timeout)
-        unsigned long start = millis();
-        while (!Serial && (millis() - start) < 3000) {
-            // Wait up to 3 seconds for USB connection
-        }
     }
     resetBuffer();
 }
 
 bool SerialTransport::available() {
-    return _serial.available() > 0 || (_cmdTail != _cmdHead);
+    return _serial.available() > 0 || (_rxStart != _rxEnd);
 }
 
 bool SerialTransport::readLine(char* buffer, size_t maxLen) {
-    // First, try to drain new input
-    processIncoming();
-
-    // Check if queue has a command ready
-    if (_cmdTail == _cmdHead) {
-        return false;  // Queue empty
+    const char* line;
+    size_t len;
+    if (buffer == nullptr || maxLen == 0 || !readLine(&line, &len)) {
+        return false;
     }
 
-    // Dequeue oldest command
-    size_t copyLen = _cmdQueue[_cmdTail].length;
-    if (copyLen >= maxLen) {
-        copyLen = maxLen - 1;
+    if (len >= maxLen) {
+        len = maxLen - 1;
     }
+    memcpy(buffer, line, len);
+    buffer[len] = '\0';
 
-    memcpy(buffer, _cmdQueue[_cmdTail].buffer, copyLen);
-    buffer[copyLen] = '\0';
+    releaseLine();
+    return true;
+}
 
-    _cmdQueue[_cmdTail].valid = false;
-    _cmdTail = (_cmdTail + 1) % SERIAL_CMD_QUEUE_SIZE;
+bool SerialTransport::readLine(const char** line, size_t* len) {
+    releaseLine();
 
-    return true;
+    // Hand out lines already buffered before reading more input
+    bool ingested = false;
+    while (true) {
+        // Skip empty lines (CR LF pairs, stray terminators)
+        while (_rxStart < _rxEnd && (_rxBuf[_rxStart] == '\r' || _rxBuf[_rxStart] == '\n')) {
+            _rxStart++;
+        }
+        if (_rxScan < _rxStart) {
+            _rxScan = _rxStart;
+        }
+
+        uint16_t end = findTerminator();
+        if (end < _rxEnd) {
+            if (_rxDiscard) {
+                // End of an over-long line: drop it and look again
+                _rxDiscard = false;
+                _rxStart = end + 1;
+                _rxScan = _rxStart;
+                continue;
+            }
+
+            _rxBuf[end] = '\0';  // Terminate in place
+            _lineEnd = end;
+            _lineHeld = true;
+            *line = _rxBuf + _rxStart;
+            *len = end - _rxStart;
+            return true;
+        }
+        _rxScan = _rxEnd;
+
+        // Buffer full without a terminator: line too long, discard it
+        if (_rxDiscard || (_rxStart == 0 && _rxEnd == SERIAL_RX_RING_SIZE)) {
+            if (!_rxDiscard) {
+                _cmdOverflowCount++;
+                _rxDiscard = true;
+            }
+            _rxStart = 0;
+            _rxEnd = 0;
+            _rxScan = 0;
+        }
+
+        if (ingested) {
+            return false;
+        }
+        processIncoming();
+        ingested = true;
+    }
+}
+
+void SerialTransport::releaseLine() {
+    if (_lineHeld) {
+        _rxStart = _lineEnd + 1;
+        _rxScan = _rxStart;
+        _lineHeld = false;
+    }
 }
 
 void SerialTransport::writeLine(const char* response) {
     if (response && *response) {
-        _serial.print(response);
+        writeWithPriority(response, strlen(response), WritePriority::COMMAND_RESPONSE);
     }
-    _serial.print('\r');
+    char cr = '\r';
+    writeWithPriority(&cr, 1, WritePriority::COMMAND_RESPONSE);
 }
 
 void SerialTransport::writeChar(char c) {
-    _serial.print(c);
+    writeWithPriority(&c, 1, WritePriority::COMMAND_RESPONSE);
 }
 
 void SerialTransport::writeRaw(const char* data, size_t len) {
-    _serial.write(data, len);
+    writeWithPriority(data, len, WritePriority::COMMAND_RESPONSE);
 }
 
 bool SerialTransport::writeWithPriority(const char* data, size_t len, WritePriority prio) {
-    // Check if USB CDC can accept the full write atomically.
-    // Note: Some cores return 0 for availableForWrite() to indicate "unknown".
-    int available = _serial.availableForWrite();
-    if (available > 0 && available < (int)len) {
+    if (len == 0) {
+        return true;
+    }
+
+    if (!stage(data, len, prio)) {
         if (prio == WritePriority::COMMAND_RESPONSE) {
-            // Critical: Block briefly with timeout (10ms max to stay within loop budget)
-            uint32_t start = millis();
-            while (_serial.availableForWrite() < (int)len) {
-                if (millis() - start > 10) {
-                    // Timeout expired: drop response to prevent hang
-                    _cmdResponseDropCount++;
-                    return false;
-                }
-            }
-            // Space available after wait
+            _cmdResponseDropCount++;   // Response lane full: drop rather than stall the loop
         } else {
-            // CAN RX frame: Drop immediately if no space (0ms timeout)
-            _canTxDropCount++;
-            return false;
+            _canTxDropCount++;         // CAN RX frame: no space, drop immediately
         }
+        return false;
+    }
+    return true;
+}
+
+size_t SerialTransport::writeRoom(WritePriority prio) const {
+    if (prio == WritePriority::COMMAND_RESPONSE) {
+        return respSpace();
     }
 
-    // All-or-nothing write (space is available)
-    _serial.write(data, len);
+    // RX records have nowhere to go until a host opens the port
+    if (_txRecCount >= SERIAL_TX_FRAME_SLOTS || !isConnected()) {
+        return 0;
+    }
+    size_t room = batchSpace();
+    return room > SERIAL_TX_MAX_RECORD_LEN ? SERIAL_TX_MAX_RECORD_LEN : room;
+}
+
+bool SerialTransport::isConnected() const {
+    if (&_serial == &Serial) {
+        return (bool)Serial;
+    }
     return true;
 }
 
+void SerialTransport::flushBatch() {
+    drainBatch();
+}
+
 void SerialTransport::flush() {
+    // Explicit flush: wait briefly (10ms max) for both lanes to empty
+    uint32_t start = millis();
+    while (drainBatch() > 0 && millis() - start <= 10) {
+    }
     _serial.flush();
 }
 
+bool SerialTransport::stage(const char* data, size_t len, WritePriority prio) {
+    if (writeRoom(prio) < len) {
+        drainBatch();
+        if (writeRoom(prio) < len) {
+            return false;
+        }
+    }
+
+    // All-or-nothing append
+    if (prio == WritePriority::COMMAND_RESPONSE) {
+        memcpy(_txResp + _txRespLen, data, len);
+        _txRespLen += len;
+    } else {
+        memcpy(_txBatch + _txBatchLen, data, len);
+        _txBatchLen += len;
+        _txRecLen[(_txRecHead + _txRecCount) % SERIAL_TX_FRAME_SLOTS] = (uint8_t)len;
+        _txRecCount++;
+    }
+    updateTxHighWater();
+    return true;
+}
+
+size_t SerialTransport::drainBatch() {
+    if (_txRespLen == 0 && _txBatchLen == 0) {
+        return 0;
+    }
+
+    // Note: Some cores return 0 for availableForWrite() to indicate "unknown".
+    int available = _serial.availableForWrite();
+    size_t room = available > 0 ? (size_t)available : SIZE_MAX;
+
+    // Responses first. They may be split across writes: frames wait until
+    // the lane is empty, so the byte stream stays in order.
+    if (_txRespLen > 0) {
+        size_t len = _txRespLen < room ? _txRespLen : room;
+        _serial.write(_txResp, len);
+        consumeFront(_txResp, &_txRespLen, len);
+        room -= len;
+        if (_txRespLen > 0) {
+            return _txRespLen + _txBatchLen;
+        }
+    }
+
+    // Then as many whole frame records as fit, in one write
+    size_t len = 0;
+    uint8_t records = 0;
+    uint8_t idx = _txRecHead;
+    while (records < _txRecCount && len + _txRecLen[idx] <= room) {
+        len += _txRecLen[idx];
+        records++;
+        idx = (idx + 1) % SERIAL_TX_FRAME_SLOTS;
+    }
+    if (len > 0) {
+        _serial.write(_txBatch, len);
+        consumeFront(_txBatch, &_txBatchLen, len);
+        _txRecHead = idx;
+        _txRecCount -= records;
+    }
+    return _txRespLen + _txBatchLen;
+}
+
+void SerialTransport::consumeFront(char* buf, uint16_t* len, size_t n) {
+    if (n < *len) {
+        memmove(buf, buf + n, *len - n);
+    }
+    *len -= n;
+}
+
+void SerialTransport::updateTxHighWater() {
+    uint16_t staged = _txRespLen + _txBatchLen;
+    if (staged > _txHighWater) {
+        _txHighWater = staged;
+    }
+}
+
 void SerialTransport::getCounters(uint32_t* cmdResponseDrops, uint32_t* canTxDrops, uint32_t* cmdOverflows) const {
     if (cmdResponseDrops) *cmdResponseDrops = _cmdResponseDropCount;
     if (canTxDrops) *canTxDrops = _canTxDropCount;
@@ -122,50 +266,72 @@ void SerialTransport::resetCounters() {
     _cmdResponseDropCount = 0;
     _canTxDropCount = 0;
     _cmdOverflowCount = 0;
+    _rxHighWater = 0;
+    _txHighWater = 0;
+}
+
+uint16_t SerialTransport::getRxHighWaterMark() const {
+    return _rxHighWater;
+}
+
+void SerialTransport::getTxLevel(uint16_t* responseBytes, uint16_t* frameBytes) const {
+    if (responseBytes) *responseBytes = _txRespLen;
+    if (frameBytes) *frameBytes = _txBatchLen;
+}
+
+uint16_t SerialTransport::getTxHighWaterMark() const {
+    return _txHighWater;
 }
 
 void SerialTransport::resetBuffer() {
-    _cmdHead = 0;
-    _cmdTail = 0;
-    _rxAccIndex = 0;
-    memset(_rxAccumulator, 0, sizeof(_rxAccumulator));
+    _rxStart = 0;
+    _rxEnd = 0;
+    _rxScan = 0;
+    _lineEnd = 0;
+    _lineHeld = false;
+    _rxDiscard = false;
 }
 
 void SerialTransport::processIncoming() {
-    // Drain all available serial data
-    while (_serial.available() > 0) {
-        char c = _serial.read();
-
-        // CR or LF marks end of line (SLCAN standard)
-        if (c == '\r' || c == '\n') {
-            if (_rxAccIndex > 0) {
-                // Line complete: enqueue it
-                uint8_t nextHead = (_cmdHead + 1) % SERIAL_CMD_QUEUE_SIZE;
-
-                if (nextHead == _cmdTail) {
-                    // Queue full: drop new command, count overflow
-                    _cmdOverflowCount++;
-                    _rxAccIndex = 0;  // Discard current line
-                    continue;
-                }
-
-                // Copy to queue slot
-                memcpy(_cmdQueue[_cmdHead].buffer, _rxAccumulator, _rxAccIndex);
-                _cmdQueue[_cmdHead].buffer[_rxAccIndex] = '\0';
-                _cmdQueue[_cmdHead].length = _rxAccIndex;
-                _cmdQueue[_cmdHead].valid = true;
-                _cmdHead = nextHead;
-
-                _rxAccIndex = 0;  // Reset accumulator, keep draining
-            }
-        } else {
-            // Accumulate character
-            if (_rxAccIndex < SERIAL_RX_BUFFER_SIZE - 1) {
-                _rxAccumulator[_rxAccIndex++] = c;
-            } else {
-                // Line too long: count overflow and truncate
-                _cmdOverflowCount++;
-            }
-        }
+    // Reclaim consumed space (never called while a line is held)
+    if (_rxStart == _rxEnd) {
+        _rxStart = 0;
+        _rxEnd = 0;
+        _rxScan = 0;
+    } else if (_rxStart > 0 && SERIAL_RX_RING_SIZE - _rxEnd < SERIAL_RX_RING_SIZE / 4) {
+        uint16_t used = _rxEnd - _rxStart;
+        memmove(_rxBuf, _rxBuf + _rxStart, used);
+        _rxScan -= _rxStart;
+        _rxStart = 0;
+        _rxEnd = used;
+    }
+
+    // One bulk read of everything that fits. When the buffer is full of
+    // unread lines, leave the rest in the USB CDC buffer (backpressure).
+    int available = _serial.available();
+    size_t space = SERIAL_RX_RING_SIZE - _rxEnd;
+    if (available <= 0 || space == 0) {
+        return;
+    }
+    if ((size_t)available < space) {
+        space = available;
+    }
+    _rxEnd += _serial.readBytes(_rxBuf + _rxEnd, space);
+
+    uint16_t pending = _rxEnd - _rxStart;
+    if (pending > _rxHighWater) {
+        _rxHighWater = pending;
     }
 }
+
+uint16_t SerialTransport::findTerminator() const {
+    // CR or LF marks end of line (SLCAN standard)
+    const char* base = _rxBuf + _rxScan;
+    size_t n = _rxEnd - _rxScan;
+
+    const char* cr = (const char*)memchr(base, '\r', n);
+    const char* lf = (const char*)memchr(base, '\n', cr ? (size_t)(cr - base) : n);
+    const char* hit = lf ? lf : cr;
+
+    return hit ? (uint16_t)(hit - _rxBuf) : _rxEnd;
+}
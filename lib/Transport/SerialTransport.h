@@ -15,21 +15,43 @@
 /**
  * Default values if not defined in config.h
  */
-#ifndef SERIAL_RX_BUFFER_SIZE
-#define SERIAL_RX_BUFFER_SIZE 256
+#ifndef SERIAL_RX_RING_SIZE
+#define SERIAL_RX_RING_SIZE 512
 #endif
 
-#ifndef SERIAL_CMD_QUEUE_SIZE
-#define SERIAL_CMD_QUEUE_SIZE 4
+#ifndef SERIAL_TX_BATCH_SIZE
+#define SERIAL_TX_BATCH_SIZE 512
 #endif
 
+#ifndef SERIAL_TX_RESPONSE_SIZE
+#define SERIAL_TX_RESPONSE_SIZE 256
+#endif
+
+#ifndef SERIAL_TX_FRAME_SLOTS
+#define SERIAL_TX_FRAME_SLOTS 64
+#endif
+
+// Longest single frame record (record lengths are tracked in a byte)
+#define SERIAL_TX_MAX_RECORD_LEN 255
+
+static_assert(SERIAL_TX_FRAME_SLOTS > 0 && SERIAL_TX_FRAME_SLOTS <= 255,
+              "SERIAL_TX_FRAME_SLOTS must be 1..255");
+
 /**
  * Serial transport implementation using Arduino Serial (USB CDC).
  *
  * Features:
  * - Line-based buffering with CR terminator
  * - Non-blocking readLine() operation
+ * - Bulk RX: input is read in chunks into one buffer and commands are
+ *   handed out in place (readLine() view + releaseLine()), not copied
  * - Automatic CR appending on writeLine()
+ * - Output staging: writes are coalesced into one USB CDC write per lane
+ *   per flushBatch() call instead of one small packet per frame/response
+ * - Two output lanes: command responses are sent ahead of queued RX
+ *   frames. Frames leave as whole records, so a response never lands
+ *   inside one. Writes never wait; a full lane refuses the write and
+ *   writeRoom() reports what fits.
  */
 class SerialTransport : public ITransport {
 public:
@@ -42,12 +64,23 @@ public:
     void begin(uint32_t baudRate) override;
     bool available() override;
     bool readLine(char* buffer, size_t maxLen) override;
+    bool readLine(const char** line, size_t* len) override;
+    void releaseLine() override;
     void writeLine(const char* response) override;
     void writeChar(char c) override;
     void writeRaw(const char* data, size_t len) override;
     bool writeWithPriority(const char* data, size_t len, WritePriority prio) override;
+    size_t writeRoom(WritePriority prio) const override;
+    void flushBatch() override;
     void flush() override;
 
+    /**
+     * Check for a host: a port opened with DTR asserted, as far as the
+     * core's Serial can tell (a UART bridge always reads as connected).
+     * Streams other than Serial always count as connected.
+     */
+    bool isConnected() const override;
+
     /**
      * Reset the internal line buffer.
      * Call this to discard any partially received data.
@@ -56,45 +89,101 @@ public:
 
     /**
      * Get diagnostic counters.
-     * @param cmdResponseDrops Output: command responses dropped due to timeout
-     * @param canTxDrops Output: CAN RX frames dropped due to USB unavailable
-     * @param cmdOverflows Output: command queue overflows
+     * @param cmdResponseDrops Output: command responses dropped, response lane full
+     * @param canTxDrops Output: CAN RX frames dropped, frame lane full
+     * @param cmdOverflows Output: over-long command lines discarded
      */
     void getCounters(uint32_t* cmdResponseDrops, uint32_t* canTxDrops, uint32_t* cmdOverflows) const;
 
     /**
-     * Reset all diagnostic counters to zero.
+     * Get the peak number of unconsumed command bytes buffered.
+     * @return High-water mark of the RX line buffer (bytes)
+     */
+    uint16_t getRxHighWaterMark() const;
+
+    /**
+     * Get the number of bytes staged for output.
+     * @param responseBytes Output: bytes in the response lane
+     * @param frameBytes Output: bytes in the frame lane
+     */
+    void getTxLevel(uint16_t* responseBytes, uint16_t* frameBytes) const;
+
+    /**
+     * Get the peak number of bytes staged for output (both lanes).
+     * @return High-water mark of the TX lanes (bytes)
+     */
+    uint16_t getTxHighWaterMark() const;
+
+    /**
+     * Reset all diagnostic counters (and the high-water marks) to zero.
      */
     void resetCounters();
 
 private:
     Stream& _serial;
 
-    // Multi-command queue
-    struct CommandSlot {
-        char buffer[SERIAL_RX_BUFFER_SIZE];
-        uint16_t length;
-        bool valid;
-    };
-
-    CommandSlot _cmdQueue[SERIAL_CMD_QUEUE_SIZE];
-    uint8_t _cmdHead;  // processIncoming() writes here
-    uint8_t _cmdTail;  // readLine() reads here
-
-    // Current accumulator (for incomplete line)
-    char _rxAccumulator[SERIAL_RX_BUFFER_SIZE];
-    uint16_t _rxAccIndex;
+    // Inbound bytes: [_rxStart, _rxEnd) is unconsumed input, complete lines
+    // first. Compacted to the front only while no line is held.
+    char _rxBuf[SERIAL_RX_RING_SIZE];
+    uint16_t _rxStart;      // First byte of the next line
+    uint16_t _rxEnd;        // End of received data
+    uint16_t _rxScan;       // Scanned up to here without finding a terminator
+    uint16_t _lineEnd;      // Terminator index of the held line
+    bool _lineHeld;         // readLine() view outstanding
+    bool _rxDiscard;        // Dropping an over-long line until its terminator
+
+    // Response lane (sent first; may be split across writes)
+    char _txResp[SERIAL_TX_RESPONSE_SIZE];
+    uint16_t _txRespLen;
+
+    // Frame lane (sent whole records at a time once no response waits)
+    char _txBatch[SERIAL_TX_BATCH_SIZE];
+    uint16_t _txBatchLen;
+    uint8_t _txRecLen[SERIAL_TX_FRAME_SLOTS];   // Ring of staged record lengths
+    uint8_t _txRecHead;
+    uint8_t _txRecCount;
 
     // Diagnostic counters
-    uint32_t _cmdResponseDropCount;  // Command responses dropped (timeout)
-    uint32_t _canTxDropCount;        // CAN RX frames dropped (no space)
-    uint32_t _cmdOverflowCount;      // Command queue overflow
+    uint32_t _cmdResponseDropCount;  // Command responses dropped (response lane full)
+    uint32_t _canTxDropCount;        // CAN RX frames dropped (frame lane full)
+    uint32_t _cmdOverflowCount;      // Over-long command lines discarded
+    uint16_t _rxHighWater;           // Peak unconsumed bytes in _rxBuf
+    uint16_t _txHighWater;           // Peak staged bytes in both TX lanes
 
     /**
-     * Process incoming serial data into the line buffer.
+     * Read all available serial data into the line buffer in one bulk read.
      * Called internally by readLine().
      */
     void processIncoming();
+
+    /**
+     * Find the next CR or LF in [_rxScan, _rxEnd).
+     * @return Index of the terminator, or _rxEnd if there is none
+     */
+    uint16_t findTerminator() const;
+
+    /**
+     * Write as much staged output as the link accepts right now:
+     * the response lane first, then whole frame records.
+     * @return Number of bytes still staged (both lanes)
+     */
+    size_t drainBatch();
+
+    /**
+     * Append to a lane, draining once first if it lacks room. Never waits.
+     * @return true if appended
+     */
+    bool stage(const char* data, size_t len, WritePriority prio);
+
+    /**
+     * Drop the first n bytes of a staging buffer.
+     */
+    static void consumeFront(char* buf, uint16_t* len, size_t n);
+
+    void updateTxHighWater();
+
+    size_t respSpace() const { return (size_t)SERIAL_TX_RESPONSE_SIZE - _txRespLen; }
+    size_t batchSpace() const { return (size_t)SERIAL_TX_BATCH_SIZE - _txBatchLen; }
 };
 
 #endif // SERIAL_TRANSPORT_H
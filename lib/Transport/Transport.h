@@ -13,11 +13,11 @@
 
 /**
  * Write priority for non-blocking TX flow control.
- * Determines behavior when output buffer is full.
+ * Selects the output lane; neither lane ever waits for the link.
  */
 enum class WritePriority {
-    COMMAND_RESPONSE,  // Critical: command responses, wait briefly (10ms)
-    CAN_RX_FRAME      // Droppable: CAN RX frames, drop immediately if no space
+    COMMAND_RESPONSE,  // Critical: command responses, sent ahead of queued RX frames
+    CAN_RX_FRAME      // Droppable: CAN RX frames, sent when no response is waiting
 };
 
 /**
@@ -50,6 +50,25 @@ public:
      */
     virtual bool readLine(char* buffer, size_t maxLen) = 0;
 
+    /**
+     * Get the next complete line in place, without copying it.
+     * Non-blocking: returns false if no complete line is ready.
+     *
+     * The line is null-terminated (without terminator) and stays valid
+     * until releaseLine() or the next readLine() call.
+     *
+     * @param line Output: pointer to the line inside the transport buffer
+     * @param len Output: line length in bytes
+     * @return true if a complete line is available, false otherwise
+     */
+    virtual bool readLine(const char** line, size_t* len) = 0;
+
+    /**
+     * Release the line returned by readLine(const char**, size_t*).
+     * Safe to call when no line is held.
+     */
+    virtual void releaseLine() = 0;
+
     /**
      * Write a null-terminated response string followed by CR.
      * @param response Response string to write
@@ -71,20 +90,45 @@ public:
 
     /**
      * Write data with priority-based flow control.
-     * Non-blocking with configurable timeout based on priority.
+     * Never blocks: data is written whole or refused. Implementations may
+     * stage the data and send it on flushBatch().
      *
      * @param data Data to write
      * @param len Number of bytes to write
      * @param prio Write priority (command response vs CAN RX frame)
-     * @return true if written successfully, false if dropped/timeout
+     * @return true if written successfully, false if dropped (no room)
      */
     virtual bool writeWithPriority(const char* data, size_t len, WritePriority prio) = 0;
 
+    /**
+     * Get how many bytes writeWithPriority() would accept right now.
+     * Lets callers hold back (backpressure) instead of having writes refused.
+     *
+     * @param prio Write priority to ask about
+     * @return Largest write that currently fits (SIZE_MAX if unbounded)
+     */
+    virtual size_t writeRoom(WritePriority prio) const = 0;
+
+    /**
+     * Send any output staged by writeWithPriority() as one write.
+     * Call once per main loop iteration, after all handlers have written.
+     * Non-blocking: data the link cannot accept yet stays staged.
+     */
+    virtual void flushBatch() = 0;
+
     /**
      * Flush any pending output.
+     * Unlike the write calls this may wait (briefly) for the link.
      */
     virtual void flush() = 0;
 
+    /**
+     * Check if a host is listening. Until one is, RX frames should stay
+     * queued on the adapter rather than be written (and lost).
+     * @return true if output reaches a host (default: always)
+     */
+    virtual bool isConnected() const { return true; }
+
     virtual ~ITransport() = default;
 };
 
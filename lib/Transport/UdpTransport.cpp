@@ -0,0 +1,281 @@
+/**
+ * UDP Transport Implementation
+ */
+
+#include "UdpTransport.h"
+#include <string.h>
+
+UdpTransport::UdpTransport(UDP& udp, uint16_t port)
+    : _udp(udp)
+    , _port(port)
+    , _peerPort(0)
+    , _hasPeer(false)
+    , _rxStart(0)
+    , _rxEnd(0)
+    , _lineEnd(0)
+    , _lineHeld(false)
+    , _txRespLen(0)
+    , _txBatchLen(0)
+    , _cmdResponseDropCount(0)
+    , _canTxDropCount(0)
+    , _cmdOverflowCount(0)
+    , _datagramsSent(0)
+    , _datagramsLost(0)
+    , _datagramsReceived(0)
+    , _rxHighWater(0)
+    , _txHighWater(0)
+{
+}
+
+void UdpTransport::begin(uint32_t baudRate) {
+    (void)baudRate;
+    _udp.begin(_port);
+    _rxStart = 0;
+    _rxEnd = 0;
+    _lineHeld = false;
+    _txRespLen = 0;
+    _txBatchLen = 0;
+}
+
+bool UdpTransport::available() {
+    return _rxStart < _rxEnd;
+}
+
+bool UdpTransport::readLine(char* buffer, size_t maxLen) {
+    const char* line;
+    size_t len;
+    if (buffer == nullptr || maxLen == 0 || !readLine(&line, &len)) {
+        return false;
+    }
+
+    if (len >= maxLen) {
+        len = maxLen - 1;
+    }
+    memcpy(buffer, line, len);
+    buffer[len] = '\0';
+
+    releaseLine();
+    return true;
+}
+
+bool UdpTransport::readLine(const char** line, size_t* len) {
+    releaseLine();
+
+    bool received = false;
+    while (true) {
+        // Skip empty lines (CR LF pairs, stray terminators)
+        while (_rxStart < _rxEnd && (_rxBuf[_rxStart] == '\r' || _rxBuf[_rxStart] == '\n')) {
+            _rxStart++;
+        }
+
+        if (_rxStart < _rxEnd) {
+            // Line ends at the next CR or LF, or with the datagram
+            const char* base = _rxBuf + _rxStart;
+            size_t n = _rxEnd - _rxStart;
+            const char* cr = (const char*)memchr(base, '\r', n);
+            const char* lf = (const char*)memchr(base, '\n', cr ? (size_t)(cr - base) : n);
+            const char* hit = lf ? lf : cr;
+            uint16_t end = hit ? (uint16_t)(hit - _rxBuf) : _rxEnd;
+
+            _rxBuf[end] = '\0';  // Terminate in place (spare byte at _rxEnd)
+            _lineEnd = end;
+            _lineHeld = true;
+            *line = base;
+            *len = end - _rxStart;
+            return true;
+        }
+
+        // At most one new datagram per call keeps readLine() bounded
+        if (received || !receiveDatagram()) {
+            return false;
+        }
+        received = true;
+    }
+}
+
+void UdpTransport::releaseLine() {
+    if (_lineHeld) {
+        _rxStart = _lineEnd + 1;
+        if (_rxStart > _rxEnd) {
+            _rxStart = _rxEnd;
+        }
+        _lineHeld = false;
+    }
+}
+
+void UdpTransport::writeLine(const char* response) {
+    if (response && *response) {
+        writeWithPriority(response, strlen(response), WritePriority::COMMAND_RESPONSE);
+    }
+    char cr = '\r';
+    writeWithPriority(&cr, 1, WritePriority::COMMAND_RESPONSE);
+}
+
+void UdpTransport::writeChar(char c) {
+    writeWithPriority(&c, 1, WritePriority::COMMAND_RESPONSE);
+}
+
+void UdpTransport::writeRaw(const char* data, size_t len) {
+    writeWithPriority(data, len, WritePriority::COMMAND_RESPONSE);
+}
+
+bool UdpTransport::writeWithPriority(const char* data, size_t len, WritePriority prio) {
+    if (len == 0) {
+        return true;
+    }
+
+    bool response = (prio == WritePriority::COMMAND_RESPONSE);
+    if (len > writeRoom(prio)) {
+        if (response) {
+            _cmdResponseDropCount++;
+        } else {
+            _canTxDropCount++;
+        }
+        return false;
+    }
+
+    // Lane full: this datagram is as packed as it gets, send it now
+    uint16_t used = response ? _txRespLen : _txBatchLen;
+    size_t capacity = response ? NET_TX_RESPONSE_SIZE : NET_TX_DATAGRAM_SIZE;
+    if (used + len > capacity) {
+        sendDatagram();
+    }
+
+    // All-or-nothing append
+    if (response) {
+        memcpy(_txResp + _txRespLen, data, len);
+        _txRespLen += len;
+    } else {
+        memcpy(_txBatch + _txBatchLen, data, len);
+        _txBatchLen += len;
+    }
+
+    uint16_t staged = _txRespLen + _txBatchLen;
+    if (staged > _txHighWater) {
+        _txHighWater = staged;
+    }
+    return true;
+}
+
+size_t UdpTransport::writeRoom(WritePriority prio) const {
+    // A full lane is sent early, so a whole lane is available to any write.
+    // RX records have nowhere to go until a host has talked to us.
+    if (prio == WritePriority::COMMAND_RESPONSE) {
+        return NET_TX_RESPONSE_SIZE;
+    }
+    return _hasPeer ? NET_TX_DATAGRAM_SIZE : 0;
+}
+
+void UdpTransport::flushBatch() {
+    if (_txRespLen > 0 || _txBatchLen > 0) {
+        sendDatagram();
+    }
+}
+
+void UdpTransport::flush() {
+    flushBatch();
+}
+
+bool UdpTransport::isConnected() const {
+    return _hasPeer;
+}
+
+bool UdpTransport::hasPeer() const {
+    return _hasPeer;
+}
+
+bool UdpTransport::receiveDatagram() {
+    int size = _udp.parsePacket();
+    if (size <= 0) {
+        return false;
+    }
+
+    // The latest sender is the host we answer
+    _peerIp = _udp.remoteIP();
+    _peerPort = _udp.remotePort();
+    _hasPeer = true;
+    _datagramsReceived++;
+
+    if (size > NET_RX_BUFFER_SIZE) {
+        // Too large to hold: drop it whole rather than run a partial command
+        _cmdOverflowCount++;
+        _udp.flush();
+        return false;
+    }
+
+    int n = _udp.read(_rxBuf, (size_t)size);
+    _rxStart = 0;
+    _rxEnd = n > 0 ? (uint16_t)n : 0;
+    if (_rxEnd > _rxHighWater) {
+        _rxHighWater = _rxEnd;
+    }
+    return _rxEnd > 0;
+}
+
+void UdpTransport::sendDatagram() {
+    if (!_hasPeer) {
+        // Only responses can be staged without a peer; nobody to send them to
+        if (_txRespLen > 0) {
+            _cmdResponseDropCount++;
+        }
+        _txRespLen = 0;
+        _txBatchLen = 0;
+        return;
+    }
+
+    bool ok = _udp.beginPacket(_peerIp, _peerPort) != 0;
+    if (ok) {
+        if (_txRespLen > 0) {
+            _udp.write((const uint8_t*)_txResp, _txRespLen);
+        }
+        if (_txBatchLen > 0) {
+            _udp.write((const uint8_t*)_txBatch, _txBatchLen);
+        }
+        ok = _udp.endPacket() != 0;
+    }
+
+    // UDP is lossy anyway: a refused datagram is counted, not retried
+    if (ok) {
+        _datagramsSent++;
+    } else {
+        _datagramsLost++;
+    }
+    _txRespLen = 0;
+    _txBatchLen = 0;
+}
+
+void UdpTransport::getCounters(uint32_t* cmdResponseDrops, uint32_t* canTxDrops, uint32_t* cmdOverflows) const {
+    if (cmdResponseDrops) *cmdResponseDrops = _cmdResponseDropCount;
+    if (canTxDrops) *canTxDrops = _canTxDropCount;
+    if (cmdOverflows) *cmdOverflows = _cmdOverflowCount;
+}
+
+void UdpTransport::getDatagramCounters(uint32_t* sent, uint32_t* lost, uint32_t* received) const {
+    if (sent) *sent = _datagramsSent;
+    if (lost) *lost = _datagramsLost;
+    if (received) *received = _datagramsReceived;
+}
+
+uint16_t UdpTransport::getRxHighWaterMark() const {
+    return _rxHighWater;
+}
+
+void UdpTransport::getTxLevel(uint16_t* responseBytes, uint16_t* frameBytes) const {
+    if (responseBytes) *responseBytes = _txRespLen;
+    if (frameBytes) *frameBytes = _txBatchLen;
+}
+
+uint16_t UdpTransport::getTxHighWaterMark() const {
+    return _txHighWater;
+}
+
+void UdpTransport::resetCounters() {
+    _cmdResponseDropCount = 0;
+    _canTxDropCount = 0;
+    _cmdOverflowCount = 0;
+    _datagramsSent = 0;
+    _datagramsLost = 0;
+    _datagramsReceived = 0;
+    _rxHighWater = 0;
+    _txHighWater = 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * UDP Transport Implementation
+ *
+ * Network transport over a UDP socket (the Uno R4 WiFi's ESP32-S3 via
+ * WiFiS3, or any Arduino UDP implementation). Carries the same CR
+ * terminated command lines and RX records as the USB CDC transport.
+ */
+
+#ifndef UDP_TRANSPORT_H
+#define UDP_TRANSPORT_H
+
+#include "Transport.h"
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Default values if not defined in config.h
+ */
+#ifndef NET_UDP_PORT
+#define NET_UDP_PORT 3333
+#endif
+
+#ifndef NET_RX_BUFFER_SIZE
+#define NET_RX_BUFFER_SIZE 512
+#endif
+
+#ifndef NET_TX_RESPONSE_SIZE
+#define NET_TX_RESPONSE_SIZE 256
+#endif
+
+#ifndef NET_TX_DATAGRAM_SIZE
+#define NET_TX_DATAGRAM_SIZE 1024
+#endif
+
+// Largest UDP payload that avoids IP fragmentation on a 1500-byte MTU
+#define NET_UDP_MAX_PAYLOAD 1472
+
+static_assert(NET_TX_RESPONSE_SIZE + NET_TX_DATAGRAM_SIZE <= NET_UDP_MAX_PAYLOAD,
+              "NET_TX_RESPONSE_SIZE + NET_TX_DATAGRAM_SIZE must fit one datagram");
+
+/**
+ * UDP transport implementation.
+ *
+ * Features:
+ * - One host (the peer) at a time: the sender of the last command
+ *   datagram gets all responses and RX records
+ * - A datagram may carry several command lines (CR or LF separated);
+ *   the end of the datagram also ends a line. Lines are handed out in
+ *   place (readLine() view + releaseLine())
+ * - Output batching: responses and RX records are packed into one
+ *   datagram per flushBatch() call, responses first. A lane that fills
+ *   up sends the datagram early instead of dropping records
+ * - Same counter interface as SerialTransport, plus datagram counters
+ */
+class UdpTransport : public ITransport {
+public:
+    /**
+     * Constructor.
+     * @param udp UDP socket (must remain valid; started by begin())
+     * @param port Local port to listen on
+     */
+    explicit UdpTransport(UDP& udp, uint16_t port = NET_UDP_PORT);
+
+    /**
+     * Start listening. The network link must already be up.
+     * @param baudRate Ignored
+     */
+    void begin(uint32_t baudRate) override;
+
+    /**
+     * Check for unread command bytes of the current datagram.
+     * New datagrams are picked up by readLine().
+     */
+    bool available() override;
+
+    bool readLine(char* buffer, size_t maxLen) override;
+    bool readLine(const char** line, size_t* len) override;
+    void releaseLine() override;
+    void writeLine(const char* response) override;
+    void writeChar(char c) override;
+    void writeRaw(const char* data, size_t len) override;
+    bool writeWithPriority(const char* data, size_t len, WritePriority prio) override;
+    size_t writeRoom(WritePriority prio) const override;
+    void flushBatch() override;
+    void flush() override;
+
+    /**
+     * Connected once a host has sent us a datagram (same as hasPeer()).
+     */
+    bool isConnected() const override;
+
+    /**
+     * Check if a host has sent us a datagram yet.
+     */
+    bool hasPeer() const;
+
+    /**
+     * Get diagnostic counters (same meaning as SerialTransport's).
+     * @param cmdResponseDrops Output: responses dropped (larger than the lane)
+     * @param canTxDrops Output: RX records dropped (no host yet, or too large)
+     * @param cmdOverflows Output: command datagrams dropped (larger than the RX buffer)
+     */
+    void getCounters(uint32_t* cmdResponseDrops, uint32_t* canTxDrops, uint32_t* cmdOverflows) const;
+
+    /**
+     * Get datagram counters.
+     * @param sent Output: datagrams handed to the network
+     * @param lost Output: datagrams the network refused (contents dropped)
+     * @param received Output: command datagrams received
+     */
+    void getDatagramCounters(uint32_t* sent, uint32_t* lost, uint32_t* received) const;
+
+    /**
+     * Get the size of the largest command datagram received.
+     * @return High-water mark of the RX buffer (bytes)
+     */
+    uint16_t getRxHighWaterMark() const;
+
+    /**
+     * Get the number of bytes staged for the next datagram.
+     * @param responseBytes Output: bytes in the response lane
+     * @param frameBytes Output: bytes in the frame lane
+     */
+    void getTxLevel(uint16_t* responseBytes, uint16_t* frameBytes) const;
+
+    /**
+     * Get the largest datagram payload staged (both lanes).
+     * @return High-water mark of the TX lanes (bytes)
+     */
+    uint16_t getTxHighWaterMark() const;
+
+    /**
+     * Reset all diagnostic counters (and the high-water marks) to zero.
+     */
+    void resetCounters();
+
+private:
+    UDP& _udp;
+    uint16_t _port;
+
+    // Host that receives our output
+    IPAddress _peerIp;
+    uint16_t _peerPort;
+    bool _hasPeer;
+
+    // Current command datagram: [_rxStart, _rxEnd) is unconsumed.
+    // One spare byte terminates a line that ends with the datagram.
+    char _rxBuf[NET_RX_BUFFER_SIZE + 1];
+    uint16_t _rxStart;
+    uint16_t _rxEnd;
+    uint16_t _lineEnd;      // Terminator index of the held line
+    bool _lineHeld;         // readLine() view outstanding
+
+    // Output lanes, sent together as one datagram (responses first)
+    char _txResp[NET_TX_RESPONSE_SIZE];
+    uint16_t _txRespLen;
+    char _txBatch[NET_TX_DATAGRAM_SIZE];
+    uint16_t _txBatchLen;
+
+    // Diagnostic counters
+    uint32_t _cmdResponseDropCount;  // Responses dropped
+    uint32_t _canTxDropCount;        // RX records dropped
+    uint32_t _cmdOverflowCount;      // Command datagrams dropped (too large)
+    uint32_t _datagramsSent;
+    uint32_t _datagramsLost;         // endPacket() failures
+    uint32_t _datagramsReceived;
+    uint16_t _rxHighWater;
+    uint16_t _txHighWater;
+
+    /**
+     * Read the next command datagram into the RX buffer.
+     * @return true if a datagram was read
+     */
+    bool receiveDatagram();
+
+    /**
+     * Send both lanes as one datagram to the peer and empty them.
+     */
+    void sendDatagram();
+};
+
+#endif // UDP_TRANSPORT_H
@@ -17,21 +17,40 @@
  *   Compatible with python-can's slcan interface:
  *   >>> import can
  *   >>> bus = can.Bus(interface='slcan', channel='/dev/ttyACM0', bitrate=500000)
+ *
+ *   With ENABLE_WIFI_TRANSPORT the same SLCAN lines travel in UDP
+ *   datagrams (port NET_UDP_PORT) instead of over USB.
  */
 
 #include <Arduino.h>
 #include "config.h"
-#include "SerialTransport.h"
+#include "HostTransport.h"
+#if ENABLE_WIFI_TRANSPORT
+#include <WiFiS3.h>
+#endif
 #include "RA4M1CAN.h"
 #include "SLCAN.h"
 #include "ProtocolDispatcher.h"
+#include "BinaryStream.h"
+#include "IsoTpHandler.h"
+#include "ConfigStore.h"
+#include "EepromStorage.h"
+#include "LoopScheduler.h"
+#include "Diagnostics.h"
+#include "Profiler.h"
 
 // =============================================================================
 // Global Objects
 // =============================================================================
 
+#if ENABLE_WIFI_TRANSPORT
+// Transport layer - UDP over the ESP32-S3 WiFi module
+WiFiUDP udp;
+HostTransport transport(udp);
+#else
 // Transport layer - USB CDC serial
-SerialTransport transport;
+HostTransport transport;
+#endif
 
 // CAN backend - RA4M1 hardware CAN controller
 RA4M1CAN canBackend;
@@ -42,24 +61,128 @@ SLCAN slcan(canBackend);
 // Protocol dispatcher for command routing
 ProtocolDispatcher dispatcher;
 
-// Buffers for command processing
-static char cmdBuffer[CMD_BUFFER_SIZE];
+// Binary streaming handler (B1/B0 switches the RX stream)
+BinaryStream binaryStream(canBackend, dispatcher);
+
+// ISO-TP segmentation offload (I commands)
+IsoTpHandler isotp(canBackend);
+
+// Saved configuration and auto-start (Q commands)
+EepromStorage settingsStorage;
+ConfigStore configStore(slcan, binaryStream, settingsStorage);
+
+// Splits each loop iteration between commands and RX forwarding
+LoopScheduler scheduler(dispatcher.getFrameBus(), canBackend);
+
+// Adapter health counters (D command)
+Diagnostics diagnostics(transport, canBackend, dispatcher.getFrameBus(), slcan, binaryStream,
+                        isotp, scheduler);
+
+// Buffer for command responses (commands are read in place from the transport)
 static char responseBuffer[RESPONSE_BUFFER_SIZE];
 
+// =============================================================================
+// RAM Budget
+// =============================================================================
+
+// Largest buffers, by owner
+static constexpr size_t RAM_FRAME_BUS      = sizeof(CANFrame) * CAN_RX_QUEUE_SIZE;
+static constexpr size_t RAM_CAPTURE_BUFFER = sizeof(FrameCapture);
+static constexpr size_t RAM_ISR_RX_RING    = sizeof(CANFrame) * CAN_ISR_RX_RING_SIZE;
+static constexpr size_t RAM_TX_ECHO_RING   = sizeof(CANFrame) * CAN_TX_ECHO_RING_SIZE;
+static constexpr size_t RAM_CAN_TX_QUEUE   = sizeof(TxPriorityQueue<CAN_TX_QUEUE_SIZE>);
+static constexpr size_t RAM_CHANGE_CACHE   = sizeof(ChangeFilter);
+static constexpr size_t RAM_ISOTP_BUFFERS  = 2 * ISOTP_MAX_PDU_SIZE;
+#if ENABLE_WIFI_TRANSPORT
+static constexpr size_t RAM_HOST_RX        = NET_RX_BUFFER_SIZE;
+static constexpr size_t RAM_HOST_TX        = NET_TX_DATAGRAM_SIZE + NET_TX_RESPONSE_SIZE;
+#else
+static constexpr size_t RAM_HOST_RX        = SERIAL_RX_RING_SIZE;
+static constexpr size_t RAM_HOST_TX        = SERIAL_TX_BATCH_SIZE + SERIAL_TX_RESPONSE_SIZE;
+#endif
+
+// Whole objects (buffers above plus bookkeeping)
+static constexpr size_t RAM_TOTAL = sizeof(transport) + sizeof(canBackend) + sizeof(slcan)
+                                  + sizeof(dispatcher) + sizeof(binaryStream) + sizeof(isotp)
+                                  + sizeof(configStore) + sizeof(diagnostics) + sizeof(scheduler)
+                                  + sizeof(responseBuffer);
+
+static_assert(RAM_TOTAL <= RAM_BUDGET_BYTES,
+              "Static buffers exceed RAM_BUDGET_BYTES; shrink the queue sizes in config.h");
+
+/**
+ * Print the RAM used by each buffer (DEBUG_SERIAL builds only).
+ */
+static void printRamBudget() {
+    DEBUG_PRINTF("RAM: frame bus %u B (%u x %u B)\n", (unsigned)RAM_FRAME_BUS,
+                 (unsigned)CAN_RX_QUEUE_SIZE, (unsigned)sizeof(CANFrame));
+    DEBUG_PRINTF("RAM: capture buffer %u B (%u frames)\n", (unsigned)RAM_CAPTURE_BUFFER,
+                 (unsigned)CAPTURE_BUFFER_FRAMES);
+    DEBUG_PRINTF("RAM: ISR RX ring %u B, CAN TX queue %u B, TX echo ring %u B\n",
+                 (unsigned)RAM_ISR_RX_RING, (unsigned)RAM_CAN_TX_QUEUE, (unsigned)RAM_TX_ECHO_RING);
+    DEBUG_PRINTF("RAM: host RX %u B, host TX %u B, change cache %u B, ISO-TP buffers %u B\n",
+                 (unsigned)RAM_HOST_RX, (unsigned)RAM_HOST_TX, (unsigned)RAM_CHANGE_CACHE,
+                 (unsigned)RAM_ISOTP_BUFFERS);
+    DEBUG_PRINTF("RAM: transport %u, backend %u, slcan %u, dispatcher %u, binary %u, isotp %u, diag %u\n",
+                 (unsigned)sizeof(transport), (unsigned)sizeof(canBackend), (unsigned)sizeof(slcan),
+                 (unsigned)sizeof(dispatcher), (unsigned)sizeof(binaryStream), (unsigned)sizeof(isotp),
+                 (unsigned)sizeof(diagnostics));
+    DEBUG_PRINTF("RAM: total %u of %u B budget\n", (unsigned)RAM_TOTAL, (unsigned)RAM_BUDGET_BYTES);
+}
+
 // =============================================================================
 // Setup
 // =============================================================================
 
+#if ENABLE_WIFI_TRANSPORT
+/**
+ * Join the WiFi network (ESP32-S3 module) before the UDP socket opens.
+ * Gives up after WIFI_CONNECT_TIMEOUT_MS; the adapter then runs CAN-only
+ * and the D counters show no datagrams.
+ */
+static void connectWifi() {
+    unsigned long start = millis();
+    while (WiFi.status() != WL_CONNECTED && (millis() - start) < WIFI_CONNECT_TIMEOUT_MS) {
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    }
+    DEBUG_PRINTLN(WiFi.status() == WL_CONNECTED ? "WiFi connected" : "WiFi not connected");
+}
+#endif
+
 void setup() {
-    // Initialize serial transport (USB CDC)
+#if ENABLE_WIFI_TRANSPORT
+    // USB stays available for debug output
+    Serial.begin(SERIAL_BAUD_RATE);
+    connectWifi();
+#endif
+
+    // Initialize host transport (USB CDC, or UDP with ENABLE_WIFI_TRANSPORT)
     transport.begin(SERIAL_BAUD_RATE);
 
-    // Register SLCAN as the protocol handler
+    // Received frames reach every handler through the dispatcher's frame bus
+    dispatcher.setFrameSource(&canBackend);
+
+    // Register SLCAN first: it owns the RX stream by default
     dispatcher.registerHandler(&slcan);
+    dispatcher.registerHandler(&binaryStream);
+    dispatcher.registerHandler(&isotp);
+    dispatcher.registerHandler(&configStore);
+    dispatcher.registerHandler(&diagnostics);
+
+    // Stored configuration, and the channel opened if Q1/Q2 was saved. The
+    // transport doesn't wait for the host: frames queue on the frame bus
+    // until one connects.
+    configStore.begin();
 
     DEBUG_PRINTLN(FIRMWARE_NAME " v" + String(FIRMWARE_VERSION_MAJOR) + "." + String(FIRMWARE_VERSION_MINOR));
     DEBUG_PRINTLN("SLCAN USB-to-CAN adapter ready");
     DEBUG_PRINTLN("Supported bitrates: S4(125k), S5(250k), S6(500k), S8(1000k)");
+    DEBUG_PRINTLN(configStore.hasStoredConfig() ? "Stored configuration applied" : "No stored configuration");
+    printRamBudget();
+
+#if ENABLE_PROFILER
+    Profiler::begin();
+#endif
 }
 
 // =============================================================================
@@ -67,31 +190,66 @@ void setup() {
 // =============================================================================
 
 void loop() {
-    // Process ALL queued commands (up to a limit to prevent CAN starvation)
-    uint8_t cmdsProcessed = 0;
+    PROFILE_SCOPE(ProfileProbe::Loop);
+
+    // Budgets for this iteration follow the frame bus and TX queue levels
+    scheduler.beginTick();
 
-    while (cmdsProcessed < MAX_CMDS_PER_LOOP) {
-        if (!transport.readLine(cmdBuffer, sizeof(cmdBuffer))) {
-            break;  // Queue empty
+    // Process queued commands while the command budget lasts (at least one)
+    uint16_t cmdsProcessed = 0;
+
+    while (cmdsProcessed == 0 || scheduler.commandTimeLeft()) {
+        // TX queue nearly full: feed the mailboxes before more frames arrive
+        if (scheduler.txPriority()) {
+            canBackend.serviceTxQueue();
+        }
+
+        // Response lane can't take another response: leave the commands
+        // in the RX buffer (and the host's) until it drains
+        if (transport.writeRoom(WritePriority::COMMAND_RESPONSE) < sizeof(responseBuffer)) {
+            break;
+        }
+
+        // Command is parsed in place in the transport's RX buffer
+        const char* cmd;
+        size_t cmdLen;
+        bool haveLine;
+        {
+            PROFILE_SCOPE(ProfileProbe::SerialIngest);
+            haveLine = transport.readLine(&cmd, &cmdLen);
+        }
+        if (!haveLine) {
+            break;  // No complete command
         }
 
         // Dispatch command to appropriate handler
-        bool hasResponse = dispatcher.dispatch(cmdBuffer, responseBuffer, sizeof(responseBuffer));
+        bool hasResponse;
+        {
+            PROFILE_SCOPE(ProfileProbe::Dispatch);
+            hasResponse = dispatcher.dispatch(cmd, responseBuffer, sizeof(responseBuffer));
+        }
+        transport.releaseLine();
 
         if (hasResponse) {
-            // Send response with high priority (10ms timeout)
-            if (responseBuffer[0] != '\0') {
-                transport.writeWithPriority(responseBuffer, strlen(responseBuffer),
-                                           WritePriority::COMMAND_RESPONSE);
+            // Stage response and its CR terminator as one high-priority write
+            size_t len = strlen(responseBuffer);
+            if (len + 1 >= sizeof(responseBuffer)) {
+                len = sizeof(responseBuffer) - 2;
             }
-            // Send CR terminator also with high priority
-            char cr = '\r';
-            transport.writeWithPriority(&cr, 1, WritePriority::COMMAND_RESPONSE);
+            responseBuffer[len++] = '\r';
+            PROFILE_SCOPE(ProfileProbe::SerialWrite);
+            transport.writeWithPriority(responseBuffer, len, WritePriority::COMMAND_RESPONSE);
         }
 
         cmdsProcessed++;
     }
 
     // Poll handlers for async operations (e.g., forwarding received CAN frames)
+    // within the RX budget, plus whatever the commands left unused
+    scheduler.beginForward();
     dispatcher.pollAll(&transport);
+
+    // Send everything staged this iteration as one USB write
+    PROFILE_SCOPE(ProfileProbe::Flush);
+    transport.flushBatch();
 }
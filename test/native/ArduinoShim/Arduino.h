@@ -0,0 +1,154 @@
+/**
+ * Arduino API Shim (native builds)
+ *
+ * The subset of the Arduino core that the portable libraries (SLCAN,
+ * Protocol, Transport) use, implemented on the host so they can be unit
+ * tested and benchmarked with `pio test -e native`. Not used by the
+ * firmware build.
+ */
+
+#ifndef ARDUINO_SHIM_H
+#define ARDUINO_SHIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define LED_BUILTIN 13
+#define HIGH        1
+#define LOW         0
+#define INPUT       0
+#define OUTPUT      1
+
+/**
+ * Time since start-up. Backed by the host's monotonic clock plus any
+ * offset added with shimAdvanceMicros().
+ */
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+/**
+ * Move the shim clock forward without sleeping.
+ * @param us Microseconds to add
+ */
+void shimAdvanceMicros(unsigned long us);
+
+// GPIO and interrupt control are no-ops on the host
+inline void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+inline void digitalWrite(uint8_t pin, uint8_t value) { (void)pin; (void)value; }
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+/**
+ * Byte sink (Arduino Print, write side only).
+ */
+class Print {
+public:
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (n < size && write(buffer[n])) {
+            n++;
+        }
+        return n;
+    }
+
+    size_t write(const char* buffer, size_t size) {
+        return write((const uint8_t*)buffer, size);
+    }
+
+    /**
+     * Bytes that can be written without blocking (0 = unknown).
+     */
+    virtual int availableForWrite() { return 0; }
+
+    virtual void flush() {}
+
+    virtual ~Print() = default;
+};
+
+/**
+ * Byte stream (Arduino Stream, without the parsing helpers).
+ */
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    virtual size_t readBytes(char* buffer, size_t length) {
+        size_t n = 0;
+        while (n < length) {
+            int c = read();
+            if (c < 0) {
+                break;
+            }
+            buffer[n++] = (char)c;
+        }
+        return n;
+    }
+
+    size_t readBytes(uint8_t* buffer, size_t length) {
+        return readBytes((char*)buffer, length);
+    }
+};
+
+/**
+ * IPv4 address (Arduino IPAddress, comparison and byte access only).
+ */
+class IPAddress {
+public:
+    IPAddress() : _addr{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _addr{a, b, c, d} {}
+
+    uint8_t operator[](int index) const { return _addr[index]; }
+    bool operator==(const IPAddress& other) const { return memcmp(_addr, other._addr, 4) == 0; }
+    bool operator!=(const IPAddress& other) const { return !(*this == other); }
+
+private:
+    uint8_t _addr[4];
+};
+
+/**
+ * Datagram socket (Arduino UDP interface).
+ */
+class UDP : public Stream {
+public:
+    virtual uint8_t begin(uint16_t port) = 0;
+    virtual void stop() = 0;
+    virtual int beginPacket(IPAddress ip, uint16_t port) = 0;
+    virtual int beginPacket(const char* host, uint16_t port) = 0;
+    virtual int endPacket() = 0;
+    virtual int parsePacket() = 0;
+    virtual int read(unsigned char* buffer, size_t len) = 0;
+    virtual int read(char* buffer, size_t len) = 0;
+    virtual IPAddress remoteIP() = 0;
+    virtual uint16_t remotePort() = 0;
+
+    using Stream::read;
+    using Print::write;
+};
+
+/**
+ * Stand-in for the USB CDC port: never has input, discards output.
+ */
+class ShimSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    explicit operator bool() const { return connected; }
+
+    bool connected = true;  // Host terminal present (DTR)
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t c) override { (void)c; return 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { (void)buffer; return size; }
+    using Print::write;
+};
+
+extern ShimSerial Serial;
+
+#endif // ARDUINO_SHIM_H
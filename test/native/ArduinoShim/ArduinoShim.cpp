@@ -0,0 +1,30 @@
+/**
+ * Arduino API Shim Implementation (native builds)
+ */
+
+#include "Arduino.h"
+#include <chrono>
+#include <thread>
+
+ShimSerial Serial;
+
+static const std::chrono::steady_clock::time_point s_start = std::chrono::steady_clock::now();
+static unsigned long s_offsetUs = 0;
+
+unsigned long micros() {
+    auto elapsed = std::chrono::steady_clock::now() - s_start;
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+         + s_offsetUs;
+}
+
+unsigned long millis() {
+    return micros() / 1000UL;
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void shimAdvanceMicros(unsigned long us) {
+    s_offsetUs += us;
+}
@@ -0,0 +1,154 @@
+/**
+ * Mock CAN Backend (native builds)
+ *
+ * ICANBackend test double: received frames come from a queue the test
+ * fills, transmitted frames are recorded. In CANMode::Loopback every
+ * transmitted frame is also received.
+ */
+
+#ifndef MOCK_CAN_BACKEND_H
+#define MOCK_CAN_BACKEND_H
+
+#include "CANBackend.h"
+#include <deque>
+#include <vector>
+
+class MockCANBackend : public ICANBackend {
+public:
+    // Test-visible state
+    std::deque<CANFrame> rxQueue;       // Frames read() hands out, oldest first
+    std::vector<CANFrame> txFrames;     // Frames accepted by write()/writeBatch()
+    size_t txCapacity = SIZE_MAX;       // write() fails once txFrames holds this many
+    bool open = false;
+    bool txEcho = false;
+    CANMode mode = CANMode::Normal;
+    CANBitrate bitrate = CANBitrate::BR_500K;
+    CANStatus status = {};
+    uint32_t errorEvents = 0;           // getErrorEventCount() result
+    uint32_t filterMask = 0;
+    uint32_t filterCode = 0;
+    std::vector<CANFilterRule> rules;
+    uint32_t serviceCalls = 0;
+    uint8_t txPending = 0;              // getTxQueueLevel() results
+    uint8_t txQueueCapacity = 16;
+
+    /**
+     * Queue a received frame.
+     */
+    void pushRx(const CANFrame& frame) { rxQueue.push_back(frame); }
+
+    bool isBitrateSupported(CANBitrate br) const override {
+        return br == CANBitrate::BR_125K || br == CANBitrate::BR_250K
+            || br == CANBitrate::BR_500K || br == CANBitrate::BR_1000K;
+    }
+
+    bool begin(CANBitrate br, CANMode m = CANMode::Normal) override {
+        if (!isBitrateSupported(br)) {
+            return false;
+        }
+        bitrate = br;
+        mode = m;
+        open = true;
+        return true;
+    }
+
+    void end() override { open = false; }
+    bool isOpen() const override { return open; }
+    CANMode getMode() const override { return mode; }
+
+    bool write(const CANFrame& frame) override {
+        if (!open || txFrames.size() >= txCapacity) {
+            return false;
+        }
+        txFrames.push_back(frame);
+        if (mode == CANMode::Loopback) {
+            rxQueue.push_back(frame);
+        }
+        return true;
+    }
+
+    uint8_t writeBatch(const CANFrame* frames, uint8_t count) override {
+        uint8_t accepted = 0;
+        while (accepted < count && write(frames[accepted])) {
+            accepted++;
+        }
+        return accepted;
+    }
+
+    bool available() override { return !rxQueue.empty(); }
+
+    bool read(CANFrame& frame) override {
+        if (rxQueue.empty()) {
+            return false;
+        }
+        frame = rxQueue.front();
+        rxQueue.pop_front();
+        return true;
+    }
+
+    bool setTxEcho(bool enable) override {
+        txEcho = enable;
+        return true;
+    }
+
+    CANStatus getStatus() override {
+        CANStatus s = status;
+        status = {};
+        return s;
+    }
+
+    uint32_t getErrorEventCount() const override { return errorEvents; }
+
+    bool setFilter(uint32_t mask, uint32_t filter) override {
+        filterMask = mask;
+        filterCode = filter;
+        return true;
+    }
+
+    bool clearFilter() override {
+        filterMask = 0;
+        filterCode = 0;
+        return true;
+    }
+
+    bool addFilterRule(const CANFilterRule& rule) override {
+        rules.push_back(rule);
+        return true;
+    }
+
+    bool removeFilterRule(const CANFilterRule& rule) override {
+        for (size_t i = 0; i < rules.size(); i++) {
+            if (rules[i].kind == rule.kind && rules[i].first == rule.first
+                && rules[i].second == rule.second) {
+                rules.erase(rules.begin() + i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void clearFilterRules() override { rules.clear(); }
+
+    void getFilterRuleCounts(uint16_t* stdIds, uint8_t* extRules) const override {
+        uint16_t s = 0;
+        uint8_t e = 0;
+        for (const CANFilterRule& r : rules) {
+            if (r.kind == CANFilterRule::Kind::StdRange) {
+                s += (uint16_t)(r.second - r.first + 1);
+            } else {
+                e++;
+            }
+        }
+        if (stdIds) *stdIds = s;
+        if (extRules) *extRules = e;
+    }
+
+    void getTxQueueLevel(uint8_t* pending, uint8_t* capacity) const override {
+        if (pending) *pending = txPending;
+        if (capacity) *capacity = txQueueCapacity;
+    }
+
+    void serviceTxQueue() override { serviceCalls++; }
+};
+
+#endif // MOCK_CAN_BACKEND_H
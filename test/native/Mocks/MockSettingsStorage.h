@@ -0,0 +1,44 @@
+/**
+ * Mock settings storage (native builds)
+ *
+ * ISettingsStorage test double: a RAM array that starts erased (0xFF),
+ * like fresh flash. Tests can corrupt bytes or make writes fail.
+ */
+
+#ifndef MOCK_SETTINGS_STORAGE_H
+#define MOCK_SETTINGS_STORAGE_H
+
+#include "SettingsStorage.h"
+#include <string.h>
+#include <vector>
+
+class MockSettingsStorage : public ISettingsStorage {
+public:
+    // Test-visible state
+    std::vector<uint8_t> bytes;     // Storage contents
+    bool failWrite = false;         // write() reports failure
+    uint32_t writes = 0;            // Successful write() calls
+
+    explicit MockSettingsStorage(size_t size = 256) : bytes(size, 0xFF) {}
+
+    size_t capacity() const override { return bytes.size(); }
+
+    bool read(size_t offset, uint8_t* data, size_t len) override {
+        if (offset + len > bytes.size()) {
+            return false;
+        }
+        memcpy(data, bytes.data() + offset, len);
+        return true;
+    }
+
+    bool write(size_t offset, const uint8_t* data, size_t len) override {
+        if (failWrite || offset + len > bytes.size()) {
+            return false;
+        }
+        memcpy(bytes.data() + offset, data, len);
+        writes++;
+        return true;
+    }
+};
+
+#endif // MOCK_SETTINGS_STORAGE_H
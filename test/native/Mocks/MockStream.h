@@ -0,0 +1,70 @@
+/**
+ * Mock Stream (native builds)
+ *
+ * Arduino Stream test double for SerialTransport: input bytes are fed by
+ * the test, output is captured, and the write room can be limited to
+ * model a busy USB CDC link.
+ */
+
+#ifndef MOCK_STREAM_H
+#define MOCK_STREAM_H
+
+#include <Arduino.h>
+#include <string>
+
+class MockStream : public Stream {
+public:
+    // Test-visible state
+    std::string input;              // Bytes not yet read
+    size_t inputPos = 0;            // Read position in input
+    std::string output;             // Everything written so far
+    int writeRoom = 0;              // availableForWrite() result (0 = unknown)
+
+    /**
+     * Append bytes to the input.
+     */
+    void feed(const char* data) { input += data; }
+
+    /**
+     * Drop consumed input and captured output.
+     */
+    void clear() {
+        input.clear();
+        inputPos = 0;
+        output.clear();
+    }
+
+    int available() override { return (int)(input.size() - inputPos); }
+
+    int read() override {
+        return inputPos < input.size() ? (uint8_t)input[inputPos++] : -1;
+    }
+
+    int peek() override {
+        return inputPos < input.size() ? (uint8_t)input[inputPos] : -1;
+    }
+
+    using Stream::readBytes;
+
+    size_t readBytes(char* buffer, size_t length) override {
+        size_t n = input.copy(buffer, length, inputPos);
+        inputPos += n;
+        return n;
+    }
+
+    size_t write(uint8_t c) override {
+        output += (char)c;
+        return 1;
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        output.append((const char*)buffer, size);
+        return size;
+    }
+
+    using Print::write;
+
+    int availableForWrite() override { return writeRoom; }
+};
+
+#endif // MOCK_STREAM_H
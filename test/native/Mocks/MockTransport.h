@@ -0,0 +1,92 @@
+/**
+ * Mock Transport (native builds)
+ *
+ * ITransport test double: lines to read are queued by the test, all
+ * output is captured in one string (in write order).
+ */
+
+#ifndef MOCK_TRANSPORT_H
+#define MOCK_TRANSPORT_H
+
+#include "Transport.h"
+#include <deque>
+#include <string>
+
+class MockTransport : public ITransport {
+public:
+    // Test-visible state
+    std::deque<std::string> lines;  // Pending input lines, without terminator
+    std::string output;             // Everything written so far
+    size_t frameRoom = SIZE_MAX;    // CAN_RX_FRAME writes accepted before dropping
+    uint32_t frameDrops = 0;        // CAN_RX_FRAME writes refused
+    uint32_t flushBatches = 0;      // flushBatch() calls
+    bool connected = true;          // isConnected() result
+
+    void begin(uint32_t baudRate) override { (void)baudRate; }
+
+    bool available() override { return !lines.empty(); }
+
+    bool readLine(char* buffer, size_t maxLen) override {
+        if (lines.empty() || maxLen == 0) {
+            return false;
+        }
+        size_t len = lines.front().copy(buffer, maxLen - 1);
+        buffer[len] = '\0';
+        lines.pop_front();
+        return true;
+    }
+
+    bool readLine(const char** line, size_t* len) override {
+        if (!_held.empty()) {
+            releaseLine();
+        }
+        if (lines.empty()) {
+            return false;
+        }
+        _held = lines.front();
+        lines.pop_front();
+        *line = _held.c_str();
+        *len = _held.size();
+        return true;
+    }
+
+    void releaseLine() override { _held.clear(); }
+
+    void writeLine(const char* response) override {
+        output += response;
+        output += '\r';
+    }
+
+    void writeChar(char c) override { output += c; }
+
+    void writeRaw(const char* data, size_t len) override { output.append(data, len); }
+
+    bool writeWithPriority(const char* data, size_t len, WritePriority prio) override {
+        if (prio == WritePriority::CAN_RX_FRAME) {
+            if (frameRoom < len) {
+                frameDrops++;
+                return false;
+            }
+            if (frameRoom != SIZE_MAX) {
+                frameRoom -= len;
+            }
+        }
+        output.append(data, len);
+        return true;
+    }
+
+    size_t writeRoom(WritePriority prio) const override {
+        return prio == WritePriority::CAN_RX_FRAME ? frameRoom : SIZE_MAX;
+    }
+
+    void flushBatch() override { flushBatches++; }
+
+    void flush() override {}
+
+    bool isConnected() const override { return connected; }
+
+private:
+    std::string _held;
+};
+
+#endif // MOCK_TRANSPORT_H
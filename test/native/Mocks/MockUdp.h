@@ -0,0 +1,115 @@
+/**
+ * Mock UDP socket (native builds)
+ *
+ * Arduino UDP test double for UdpTransport: the test queues inbound
+ * datagrams with their sender, sent datagrams are captured whole, and
+ * endPacket() can be made to fail to model a congested network.
+ */
+
+#ifndef MOCK_UDP_H
+#define MOCK_UDP_H
+
+#include <Arduino.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+class MockUdp : public UDP {
+public:
+    struct Datagram {
+        std::string data;
+        IPAddress ip;
+        uint16_t port;
+    };
+
+    // Test-visible state
+    std::deque<Datagram> inbound;   // Datagrams not yet parsed
+    std::vector<Datagram> sent;     // Datagrams sent so far
+    uint16_t localPort = 0;         // Port passed to begin()
+    bool failSend = false;          // endPacket() reports failure
+
+    /**
+     * Queue a datagram from a host.
+     */
+    void deliver(const std::string& data, IPAddress ip = IPAddress(10, 0, 0, 2),
+                 uint16_t port = 40000) {
+        inbound.push_back({ data, ip, port });
+    }
+
+    uint8_t begin(uint16_t port) override { localPort = port; return 1; }
+    void stop() override {}
+
+    int beginPacket(IPAddress ip, uint16_t port) override {
+        _out = { std::string(), ip, port };
+        return 1;
+    }
+
+    int beginPacket(const char* host, uint16_t port) override {
+        (void)host;
+        return beginPacket(IPAddress(), port);
+    }
+
+    int endPacket() override {
+        if (failSend) {
+            return 0;
+        }
+        sent.push_back(_out);
+        return 1;
+    }
+
+    size_t write(uint8_t c) override {
+        _out.data += (char)c;
+        return 1;
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        _out.data.append((const char*)buffer, size);
+        return size;
+    }
+
+    int parsePacket() override {
+        if (inbound.empty()) {
+            _in = { std::string(), IPAddress(), 0 };
+            _inPos = 0;
+            return 0;
+        }
+        _in = inbound.front();
+        inbound.pop_front();
+        _inPos = 0;
+        return (int)_in.data.size();
+    }
+
+    int available() override { return (int)(_in.data.size() - _inPos); }
+
+    int read() override {
+        return _inPos < _in.data.size() ? (uint8_t)_in.data[_inPos++] : -1;
+    }
+
+    int read(unsigned char* buffer, size_t len) override {
+        return read((char*)buffer, len);
+    }
+
+    int read(char* buffer, size_t len) override {
+        size_t n = _in.data.copy(buffer, len, _inPos);
+        _inPos += n;
+        return (int)n;
+    }
+
+    int peek() override {
+        return _inPos < _in.data.size() ? (uint8_t)_in.data[_inPos] : -1;
+    }
+
+    void flush() override { _inPos = _in.data.size(); }
+
+    IPAddress remoteIP() override { return _in.ip; }
+    uint16_t remotePort() override { return _in.port; }
+
+    using UDP::write;
+
+private:
+    Datagram _out;
+    Datagram _in;
+    size_t _inPos = 0;
+};
+
+#endif // MOCK_UDP_H
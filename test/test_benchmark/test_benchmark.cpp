@@ -0,0 +1,217 @@
+/**
+ * Host benchmarks for the SLCAN hot path (native)
+ *
+ * Reports ns per frame for formatting, parsing, serial ingest and full
+ * poll cycles so regressions show up before they reach the board. Host
+ * numbers are only comparable with each other (same machine, same
+ * build), not with cycle counts from the on-target profiler.
+ *
+ * Run with: pio test -e native -f test_benchmark -v
+ */
+
+#include <unity.h>
+#include "SLCAN.h"
+#include "ProtocolDispatcher.h"
+#include "LoopScheduler.h"
+#include "SerialTransport.h"
+#include "MockCANBackend.h"
+#include "MockStream.h"
+#include <chrono>
+#include <stdio.h>
+#include <string>
+
+// Frames (or lines) per measurement
+#define BENCH_ITERATIONS    200000
+
+// Keeps results observable so the optimizer can't drop the work
+static volatile size_t s_sink;
+
+void setUp() {}
+void tearDown() {}
+
+static double nsSince(std::chrono::steady_clock::time_point start, uint32_t count) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / count;
+}
+
+static void report(const char* name, double nsPerFrame) {
+    printf("BENCH %-34s %9.1f ns/frame\n", name, nsPerFrame);
+}
+
+static CANFrame makeFrame(uint32_t id, bool extended, uint8_t dlc) {
+    CANFrame f;
+    f.id = id;
+    f.extended = extended;
+    f.dlc = dlc;
+    for (uint8_t i = 0; i < 8; i++) {
+        f.data[i] = (uint8_t)(id + i);
+    }
+    f.timestamp = id * 250;
+    return f;
+}
+
+// =============================================================================
+// formatFrame
+// =============================================================================
+
+static void benchFormat(const char* name, const char* tsCmd, bool extended) {
+    MockCANBackend can;
+    SLCAN slcan(can);
+    char response[RESPONSE_BUFFER_SIZE];
+    slcan.processCommand(tsCmd, response, sizeof(response));
+
+    CANFrame frames[64];
+    for (uint32_t i = 0; i < 64; i++) {
+        frames[i] = makeFrame(extended ? 0x18DA0000 + i : 0x100 + i, extended, 8);
+    }
+
+    char buf[SLCAN_MAX_EXT_FRAME_LEN];
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        total += slcan.formatFrame(frames[i & 63], buf, sizeof(buf));
+    }
+    report(name, nsSince(start, BENCH_ITERATIONS));
+    s_sink = total;
+    TEST_ASSERT_TRUE(total > 0);
+}
+
+static void test_format_frame() {
+    benchFormat("formatFrame std dlc8", "Z0", false);
+    benchFormat("formatFrame ext dlc8", "Z0", true);
+    benchFormat("formatFrame std dlc8 Z2", "Z2", false);
+}
+
+// =============================================================================
+// parseFrame (through the t/T command handlers, direct and routed)
+// =============================================================================
+
+static void benchParse(const char* name, const char* cmd, bool viaDispatcher) {
+    MockCANBackend can;
+    SLCAN slcan(can);
+    ProtocolDispatcher dispatcher;
+    dispatcher.registerHandler(&slcan);
+    char response[RESPONSE_BUFFER_SIZE];
+    slcan.processCommand("O", response, sizeof(response));
+    can.txFrames.reserve(1024);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        if (viaDispatcher) {
+            dispatcher.dispatch(cmd, response, sizeof(response));
+        } else {
+            slcan.processCommand(cmd, response, sizeof(response));
+        }
+        if (can.txFrames.size() == 1024) {
+            can.txFrames.clear();
+        }
+    }
+    report(name, nsSince(start, BENCH_ITERATIONS));
+    TEST_ASSERT_EQUAL_HEX8('z', response[0] | 0x20);
+}
+
+static void test_parse_frame() {
+    benchParse("parseFrame std dlc8", "t12381122334455667788", false);
+    benchParse("parseFrame ext dlc8", "T18DA10F181122334455667788", false);
+    benchParse("parseFrame std dlc0", "t7FF0", false);
+    benchParse("dispatch std dlc8", "t12381122334455667788", true);
+}
+
+// =============================================================================
+// processIncoming (SerialTransport line ingest)
+// =============================================================================
+
+static void test_process_incoming() {
+    MockStream stream;
+    SerialTransport transport(stream);
+
+    std::string input;
+    input.reserve(BENCH_ITERATIONS * 22);
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        input += "t12381122334455667788\r";
+    }
+    stream.input = input;
+
+    const char* line;
+    size_t len;
+    uint32_t lines = 0;
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (transport.readLine(&line, &len)) {
+        total += len;
+        lines++;
+        transport.releaseLine();
+    }
+    report("processIncoming + readLine", nsSince(start, lines));
+    s_sink = total;
+    TEST_ASSERT_EQUAL(BENCH_ITERATIONS, lines);
+}
+
+// =============================================================================
+// Full poll() cycle: scheduler -> backend -> frame bus -> SLCAN -> serial staging -> flush
+// =============================================================================
+
+static void benchPoll(uint16_t depth) {
+    MockCANBackend can;
+    MockStream stream;
+    SerialTransport transport(stream);
+    SLCAN slcan(can);
+    ProtocolDispatcher dispatcher;
+    LoopScheduler scheduler(dispatcher.getFrameBus(), can);
+    dispatcher.setFrameSource(&can);
+    dispatcher.registerHandler(&slcan);
+
+    char response[RESPONSE_BUFFER_SIZE];
+    dispatcher.dispatch("O", response, sizeof(response));
+    stream.output.reserve(SERIAL_TX_BATCH_SIZE * 4);
+
+    CANFrame frames[64];
+    for (uint32_t i = 0; i < 64; i++) {
+        frames[i] = makeFrame(0x100 + i, false, 8);
+    }
+
+    uint32_t frameCount = 0;
+    uint32_t cycles = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (frameCount < BENCH_ITERATIONS) {
+        // Queue a burst of `depth` frames, then run loop iterations until drained
+        for (uint16_t i = 0; i < depth; i++) {
+            can.pushRx(frames[i & 63]);
+        }
+        do {
+            scheduler.beginTick();
+            scheduler.beginForward();
+            dispatcher.pollAll(&transport);
+            transport.flushBatch();
+            stream.output.clear();
+            cycles++;
+        } while (!can.rxQueue.empty() || dispatcher.getFrameBus().pending(0) > 0);
+        frameCount += depth;
+    }
+    double ns = nsSince(start, frameCount);
+
+    char name[48];
+    snprintf(name, sizeof(name), "poll depth %u (%.1f cycles/burst)",
+             depth, (double)cycles / (frameCount / depth));
+    report(name, ns);
+
+    uint32_t rxOverflows, canRxDrops;
+    slcan.getCounters(&rxOverflows, &canRxDrops);
+    TEST_ASSERT_EQUAL(0, canRxDrops);
+}
+
+static void test_poll_cycle() {
+    const uint16_t depths[] = { 1, 8, 24, 64, CAN_RX_QUEUE_SIZE };
+    for (uint16_t depth : depths) {
+        benchPoll(depth);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_format_frame);
+    RUN_TEST(test_parse_frame);
+    RUN_TEST(test_process_incoming);
+    RUN_TEST(test_poll_cycle);
+    return UNITY_END();
+}
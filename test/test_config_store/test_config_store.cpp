@@ -0,0 +1,233 @@
+/**
+ * Persisted configuration tests (native)
+ *
+ * Q commands, the stored record and boot-time restore against a mock
+ * CAN backend and a RAM-backed settings storage.
+ */
+
+#include <unity.h>
+#include "ConfigStore.h"
+#include "ProtocolDispatcher.h"
+#include "MockCANBackend.h"
+#include "MockSettingsStorage.h"
+#include <Arduino.h>
+#include <string>
+
+// One power cycle of the adapter; the storage outlives it
+struct Adapter {
+    MockCANBackend can;
+    SLCAN slcan;
+    ProtocolDispatcher dispatcher;
+    BinaryStream binaryStream;
+    ConfigStore config;
+    char response[RESPONSE_BUFFER_SIZE];
+
+    explicit Adapter(ISettingsStorage& storage)
+        : slcan(can)
+        , binaryStream(can, dispatcher)
+        , config(slcan, binaryStream, storage)
+    {
+        dispatcher.setFrameSource(&can);
+        dispatcher.registerHandler(&slcan);
+        dispatcher.registerHandler(&binaryStream);
+        dispatcher.registerHandler(&config);
+    }
+
+    std::string command(const char* cmd) {
+        response[0] = '\0';
+        dispatcher.dispatch(cmd, response, sizeof(response));
+        return response;
+    }
+};
+
+static MockSettingsStorage* storage;
+
+void setUp() {
+    storage = new MockSettingsStorage();
+}
+
+void tearDown() {
+    delete storage;
+}
+
+// =============================================================================
+// Commands
+// =============================================================================
+
+static void test_nothing_stored() {
+    Adapter a(*storage);
+    TEST_ASSERT_FALSE(a.config.begin());
+    TEST_ASSERT_FALSE(a.can.isOpen());
+    TEST_ASSERT_EQUAL_STRING("Q00", a.command("Q").c_str());
+    TEST_ASSERT_EQUAL_STRING("\x07", a.command("QR").c_str());
+    TEST_ASSERT_EQUAL_STRING("\x07", a.command("Q3").c_str());
+    TEST_ASSERT_EQUAL_STRING("\x07", a.command("QWX").c_str());
+    TEST_ASSERT_EQUAL(0, storage->writes);
+}
+
+static void test_save_and_boot_into_open_channel() {
+    {
+        Adapter a(*storage);
+        a.command("S4");
+        a.command("Z2");
+        a.command("M000007FF");
+        a.command("m00000120");
+        TEST_ASSERT_EQUAL_STRING("", a.command("f+S100").c_str());
+        TEST_ASSERT_EQUAL_STRING("", a.command("f+S200280").c_str());
+        TEST_ASSERT_EQUAL_STRING("", a.command("f-S100").c_str());
+        TEST_ASSERT_EQUAL_STRING("", a.command("B1").c_str());
+        TEST_ASSERT_EQUAL_STRING("", a.command("Q1").c_str());
+        TEST_ASSERT_EQUAL_STRING("Q11", a.command("Q").c_str());
+    }
+
+    // Power cycle: no host commands, the channel opens as configured
+    Adapter b(*storage);
+    TEST_ASSERT_TRUE(b.config.begin());
+    TEST_ASSERT_TRUE(b.can.isOpen());
+    TEST_ASSERT_EQUAL(CANMode::Normal, b.can.getMode());
+    TEST_ASSERT_EQUAL(CANBitrate::BR_125K, b.can.bitrate);
+    TEST_ASSERT_EQUAL(SLCANState::Open, b.slcan.getState());
+    TEST_ASSERT_EQUAL(SLCAN_TIMESTAMP_US, b.slcan.getTimestampMode());
+    TEST_ASSERT_EQUAL_HEX32(0x7FF, b.can.filterMask);
+    TEST_ASSERT_EQUAL_HEX32(0x120, b.can.filterCode);
+    TEST_ASSERT_EQUAL(1, b.can.rules.size());
+    TEST_ASSERT_EQUAL_HEX32(0x200, b.can.rules[0].first);
+    TEST_ASSERT_EQUAL_HEX32(0x280, b.can.rules[0].second);
+    TEST_ASSERT_TRUE(b.binaryStream.isActive());
+    TEST_ASSERT_EQUAL_STRING("Q11", b.command("Q").c_str());
+
+    // The replayed edits are saved again unchanged
+    SLCANSettings s;
+    b.slcan.getSettings(s);
+    TEST_ASSERT_EQUAL(3, s.filterOpCount);
+}
+
+static void test_listen_autostart_and_reload() {
+    {
+        Adapter a(*storage);
+        a.command("S8");
+        TEST_ASSERT_EQUAL_STRING("", a.command("Q2").c_str());
+    }
+
+    Adapter b(*storage);
+    TEST_ASSERT_TRUE(b.config.begin());
+    TEST_ASSERT_EQUAL(CANMode::ListenOnly, b.can.getMode());
+    TEST_ASSERT_EQUAL(CANBitrate::BR_1000K, b.can.bitrate);
+    TEST_ASSERT_FALSE(b.binaryStream.isActive());
+
+    // QR only while closed; it restores without opening
+    TEST_ASSERT_EQUAL_STRING("\x07", b.command("QR").c_str());
+    b.command("C");
+    b.command("S6");
+    b.command("Z1");
+    TEST_ASSERT_EQUAL_STRING("", b.command("QR").c_str());
+    TEST_ASSERT_FALSE(b.can.isOpen());
+    TEST_ASSERT_EQUAL(SLCAN_TIMESTAMP_OFF, b.slcan.getTimestampMode());
+    TEST_ASSERT_EQUAL_STRING("", b.command("O").c_str());
+    TEST_ASSERT_EQUAL(CANBitrate::BR_1000K, b.can.bitrate);
+
+    // QW keeps the auto-start mode
+    b.command("C");
+    TEST_ASSERT_EQUAL_STRING("", b.command("QW").c_str());
+    TEST_ASSERT_EQUAL_STRING("Q21", b.command("Q").c_str());
+}
+
+static void test_erase_and_corruption() {
+    {
+        Adapter a(*storage);
+        TEST_ASSERT_EQUAL_STRING("", a.command("Q1").c_str());
+        TEST_ASSERT_EQUAL_STRING("", a.command("QE").c_str());
+        TEST_ASSERT_EQUAL_STRING("Q00", a.command("Q").c_str());
+    }
+    {
+        Adapter a(*storage);
+        TEST_ASSERT_FALSE(a.config.begin());
+        TEST_ASSERT_FALSE(a.can.isOpen());
+        TEST_ASSERT_EQUAL_STRING("", a.command("Q1").c_str());
+    }
+
+    // A flipped bit fails the CRC: boot with defaults, channel closed
+    storage->bytes[CONFIG_STORE_OFFSET + CONFIG_RECORD_HEADER_LEN + 2] ^= 0x01;
+    Adapter b(*storage);
+    TEST_ASSERT_FALSE(b.config.begin());
+    TEST_ASSERT_FALSE(b.can.isOpen());
+    TEST_ASSERT_EQUAL_STRING("Q00", b.command("Q").c_str());
+}
+
+static void test_save_refused() {
+    Adapter a(*storage);
+
+    // More f edits than the record keeps: the table can't be saved
+    char cmd[16];
+    for (int i = 0; i <= SLCAN_SETTINGS_MAX_FILTER_OPS; i++) {
+        snprintf(cmd, sizeof(cmd), "f+S%03X", 0x100 + i);
+        TEST_ASSERT_EQUAL_STRING("", a.command(cmd).c_str());
+    }
+    TEST_ASSERT_EQUAL_STRING("\x07", a.command("Q1").c_str());
+    TEST_ASSERT_EQUAL_STRING("Q00", a.command("Q").c_str());
+
+    a.command("fC");
+    TEST_ASSERT_EQUAL_STRING("", a.command("f+S100").c_str());
+    storage->failWrite = true;
+    TEST_ASSERT_EQUAL_STRING("\x07", a.command("QW").c_str());
+    storage->failWrite = false;
+    TEST_ASSERT_EQUAL_STRING("", a.command("QW").c_str());
+    TEST_ASSERT_EQUAL_STRING("Q01", a.command("Q").c_str());
+}
+
+// =============================================================================
+// Record format
+// =============================================================================
+
+static void test_record_round_trip() {
+    StoredConfig in = {};
+    in.autoStart = CONFIG_AUTOSTART_LISTEN;
+    in.binaryOutput = true;
+    in.slcan.bitrate = 6;
+    in.slcan.timestampMode = SLCAN_TIMESTAMP_MS;
+    in.slcan.filterMask = 0x1FFFFFFF;
+    in.slcan.filterCode = 0x18DAF110;
+    in.slcan.filterOpCount = 2;
+    in.slcan.filterOps[0].rule = { CANFilterRule::Kind::ExtMask, 0x18DAF100, 0x1FFFFF00 };
+    in.slcan.filterOps[0].add = true;
+    in.slcan.filterOps[1].rule = { CANFilterRule::Kind::StdRange, 0x7E0, 0x7EF };
+    in.slcan.filterOps[1].add = false;
+
+    uint8_t record[CONFIG_RECORD_MAX_LEN];
+    size_t len = ConfigStore::encodeRecord(in, record);
+    TEST_ASSERT_EQUAL(CONFIG_RECORD_HEADER_LEN + CONFIG_RECORD_FIXED_LEN +
+                      2 * CONFIG_RECORD_FILTER_OP_LEN + CONFIG_RECORD_CRC_LEN, len);
+
+    StoredConfig out;
+    TEST_ASSERT_TRUE(ConfigStore::decodeRecord(record, len, out));
+    TEST_ASSERT_EQUAL(CONFIG_AUTOSTART_LISTEN, out.autoStart);
+    TEST_ASSERT_TRUE(out.binaryOutput);
+    TEST_ASSERT_EQUAL(6, out.slcan.bitrate);
+    TEST_ASSERT_EQUAL(SLCAN_TIMESTAMP_MS, out.slcan.timestampMode);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFFFFF, out.slcan.filterMask);
+    TEST_ASSERT_EQUAL_HEX32(0x18DAF110, out.slcan.filterCode);
+    TEST_ASSERT_EQUAL(2, out.slcan.filterOpCount);
+    TEST_ASSERT_EQUAL(CANFilterRule::Kind::ExtMask, out.slcan.filterOps[0].rule.kind);
+    TEST_ASSERT_EQUAL_HEX32(0x1FFFFF00, out.slcan.filterOps[0].rule.second);
+    TEST_ASSERT_TRUE(out.slcan.filterOps[0].add);
+    TEST_ASSERT_EQUAL(CANFilterRule::Kind::StdRange, out.slcan.filterOps[1].rule.kind);
+    TEST_ASSERT_FALSE(out.slcan.filterOps[1].add);
+
+    // Truncated, other version, or overflowed edit log
+    TEST_ASSERT_FALSE(ConfigStore::decodeRecord(record, len - 1, out));
+    record[2] = CONFIG_RECORD_VERSION + 1;
+    TEST_ASSERT_FALSE(ConfigStore::decodeRecord(record, len, out));
+    in.slcan.filterOpsOverflow = true;
+    TEST_ASSERT_EQUAL(0, ConfigStore::encodeRecord(in, record));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_nothing_stored);
+    RUN_TEST(test_save_and_boot_into_open_channel);
+    RUN_TEST(test_listen_autostart_and_reload);
+    RUN_TEST(test_erase_and_corruption);
+    RUN_TEST(test_save_refused);
+    RUN_TEST(test_record_round_trip);
+    return UNITY_END();
+}
@@ -0,0 +1,617 @@
+/**
+ * Frame bus and protocol dispatcher tests (native)
+ */
+
+#include <unity.h>
+#include "FrameBus.h"
+#include "ProtocolDispatcher.h"
+#include "MockCANBackend.h"
+#include <stdio.h>
+#include <vector>
+
+static MockCANBackend* can;
+static FrameBus* bus;
+
+void setUp() {
+    can = new MockCANBackend();
+    bus = new FrameBus();
+}
+
+void tearDown() {
+    delete bus;
+    delete can;
+}
+
+static void pushFrames(uint32_t firstId, int count) {
+    for (int i = 0; i < count; i++) {
+        CANFrame f;
+        f.id = firstId + i;
+        can->pushRx(f);
+    }
+}
+
+// =============================================================================
+// FrameBus
+// =============================================================================
+
+static void test_no_enabled_reader_leaves_frames_in_backend() {
+    uint8_t r = bus->attachReader();
+    TEST_ASSERT_NOT_EQUAL(FRAME_BUS_NO_READER, r);
+    pushFrames(1, 3);
+    TEST_ASSERT_EQUAL(0, bus->fill(*can));
+    TEST_ASSERT_EQUAL(3, can->rxQueue.size());
+}
+
+static void test_readers_see_same_frames() {
+    uint8_t a = bus->attachReader();
+    uint8_t b = bus->attachReader();
+    bus->setReaderEnabled(a, true);
+    bus->setReaderEnabled(b, true);
+
+    pushFrames(0x10, 3);
+    TEST_ASSERT_EQUAL(3, bus->fill(*can));
+
+    for (uint32_t id = 0x10; id < 0x13; id++) {
+        TEST_ASSERT_EQUAL_HEX32(id, bus->peek(a)->id);
+        bus->consume(a);
+    }
+    TEST_ASSERT_NULL(bus->peek(a));
+    TEST_ASSERT_EQUAL(3, bus->pending(b));
+    TEST_ASSERT_EQUAL_HEX32(0x10, bus->peek(b)->id);
+}
+
+static void test_slowest_reader_holds_ring_back() {
+    uint8_t fast = bus->attachReader();
+    uint8_t slow = bus->attachReader();
+    bus->setReaderEnabled(fast, true);
+    bus->setReaderEnabled(slow, true);
+
+    pushFrames(0, CAN_RX_QUEUE_SIZE + 10);
+    TEST_ASSERT_EQUAL(CAN_RX_QUEUE_SIZE, bus->fill(*can));
+    TEST_ASSERT_EQUAL(10, can->rxQueue.size());      // BlockBackend: excess stays in backend
+
+    uint32_t overflows;
+    bus->getCounters(&overflows);
+    TEST_ASSERT_EQUAL(1, overflows);
+    TEST_ASSERT_EQUAL(CAN_RX_QUEUE_SIZE, bus->getHighWaterMark());
+
+    // Fast reader drains everything, slow reader still blocks the ring
+    while (bus->peek(fast)) bus->consume(fast);
+    TEST_ASSERT_EQUAL(0, bus->fill(*can));
+
+    bus->consume(slow);
+    TEST_ASSERT_EQUAL(1, bus->fill(*can));
+    TEST_ASSERT_EQUAL_HEX32(CAN_RX_QUEUE_SIZE, bus->peek(fast)->id);
+
+    bus->resetCounters();
+    bus->getCounters(&overflows);
+    TEST_ASSERT_EQUAL(0, overflows);
+    TEST_ASSERT_EQUAL(0, bus->getHighWaterMark());
+}
+
+static void test_disabled_reader_restarts_at_newest() {
+    uint8_t a = bus->attachReader();
+    uint8_t b = bus->attachReader();
+    bus->setReaderEnabled(a, true);
+
+    pushFrames(1, 2);
+    bus->fill(*can);
+    bus->setReaderEnabled(b, true);
+    TEST_ASSERT_NULL(bus->peek(b));
+
+    pushFrames(3, 1);
+    bus->fill(*can);
+    TEST_ASSERT_EQUAL_HEX32(3, bus->peek(b)->id);
+    TEST_ASSERT_EQUAL(3, bus->pending(a));
+}
+
+static void test_reader_slots_exhaust() {
+    for (uint8_t i = 0; i < FRAME_BUS_MAX_READERS; i++) {
+        TEST_ASSERT_EQUAL(i, bus->attachReader());
+    }
+    TEST_ASSERT_EQUAL(FRAME_BUS_NO_READER, bus->attachReader());
+    bus->detachReader(1);
+    TEST_ASSERT_EQUAL(1, bus->attachReader());
+}
+
+// =============================================================================
+// ProtocolDispatcher
+// =============================================================================
+
+class StubHandler : public IProtocolHandler {
+public:
+    StubHandler(const char* name, char prefix) : _name(name), _prefix(prefix) {}
+
+    const char* getName() const override { return _name; }
+    bool canHandle(const char* cmd) const override { return cmd[0] == _prefix; }
+
+    bool processCommand(const char* cmd, char* response, size_t maxLen) override {
+        (void)cmd;
+        snprintf(response, maxLen, "%s", _name);
+        return true;
+    }
+
+    void poll(ITransport* transport) override { (void)transport; polls++; }
+    bool isActive() const override { return true; }
+    void onStreamOwnership(bool isOwner) override { owner = isOwner; }
+
+    int polls = 0;
+    bool owner = false;
+
+private:
+    const char* _name;
+    char _prefix;
+};
+
+static CANFilterRule stdRule(uint32_t first, uint32_t last) {
+    CANFilterRule rule;
+    rule.kind = CANFilterRule::Kind::StdRange;
+    rule.first = first;
+    rule.second = last;
+    return rule;
+}
+
+static void test_decimate_one_in_n_before_ring() {
+    uint8_t r = bus->attachReader();
+    bus->setReaderEnabled(r, true);
+    TEST_ASSERT_TRUE(bus->getDecimator().add(stdRule(0x100, 0x100), DecimateMode::OneInN, 4));
+
+    // 12 frames of the chatty ID and one rare ID: 3 + 1 make it onto the bus
+    for (int i = 0; i < 12; i++) {
+        pushFrames(0x100, 1);
+    }
+    pushFrames(0x7DF, 1);
+    TEST_ASSERT_EQUAL(4, bus->fill(*can));
+    TEST_ASSERT_EQUAL(0, can->rxQueue.size());
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_HEX32(0x100, bus->peek(r)->id);
+        bus->consume(r);
+    }
+    TEST_ASSERT_EQUAL_HEX32(0x7DF, bus->peek(r)->id);
+
+    uint32_t decimated;
+    bus->getDecimator().getCounters(&decimated);
+    TEST_ASSERT_EQUAL(9, decimated);
+    bus->resetCounters();
+    bus->getDecimator().getCounters(&decimated);
+    TEST_ASSERT_EQUAL(0, decimated);
+}
+
+static void test_decimate_max_rate_uses_capture_time() {
+    uint8_t r = bus->attachReader();
+    bus->setReaderEnabled(r, true);
+    TEST_ASSERT_TRUE(bus->getDecimator().add(stdRule(0x000, 0x0FF), DecimateMode::MaxRate, 10));
+
+    // 1 ms period for 1 s at 10 Hz: the first frame, then one per 100 ms
+    for (uint32_t ms = 0; ms < 1000; ms++) {
+        CANFrame f;
+        f.id = 0x010;
+        f.timestamp = ms * 1000;
+        can->pushRx(f);
+        bus->fill(*can);
+        while (bus->peek(r)) bus->consume(r);
+    }
+    uint32_t decimated;
+    bus->getDecimator().getCounters(&decimated);
+    TEST_ASSERT_EQUAL(1000 - 10, decimated);
+
+    // After a pause the bucket allows a short burst
+    for (uint32_t i = 0; i < 4; i++) {
+        CANFrame f;
+        f.id = 0x010;
+        f.timestamp = 5000000 + i;
+        can->pushRx(f);
+    }
+    TEST_ASSERT_EQUAL(DECIMATE_BUCKET_BURST, bus->fill(*can));
+}
+
+static void test_decimate_rule_table() {
+    FrameDecimator& d = bus->getDecimator();
+    TEST_ASSERT_FALSE(d.add(stdRule(0x200, 0x100), DecimateMode::OneInN, 2));   // Inverted range
+    TEST_ASSERT_FALSE(d.add(stdRule(0x100, 0x800), DecimateMode::OneInN, 2));   // Not 11-bit
+    TEST_ASSERT_FALSE(d.add(stdRule(0x100, 0x100), DecimateMode::OneInN, 1));
+    TEST_ASSERT_FALSE(d.add(stdRule(0x100, 0x100), DecimateMode::MaxRate, 0));
+
+    for (uint32_t i = 0; i < DECIMATE_MAX_RULES; i++) {
+        TEST_ASSERT_TRUE(d.add(stdRule(i, i), DecimateMode::OneInN, 2));
+    }
+    TEST_ASSERT_FALSE(d.add(stdRule(0x7FF, 0x7FF), DecimateMode::OneInN, 2));
+    TEST_ASSERT_TRUE(d.add(stdRule(0, 0), DecimateMode::MaxRate, 100));     // Same match: replaced
+    TEST_ASSERT_EQUAL(DECIMATE_MAX_RULES, d.getRuleCount());
+
+    TEST_ASSERT_TRUE(d.remove(stdRule(0, 0)));
+    TEST_ASSERT_FALSE(d.remove(stdRule(0, 0)));
+    TEST_ASSERT_EQUAL(DECIMATE_MAX_RULES - 1, d.getRuleCount());
+    d.clear();
+    TEST_ASSERT_EQUAL(0, d.getRuleCount());
+
+    // TX echoes always pass
+    TEST_ASSERT_TRUE(d.add(stdRule(0x100, 0x100), DecimateMode::OneInN, 255));
+    CANFrame echo;
+    echo.id = 0x100;
+    echo.echo = true;
+    TEST_ASSERT_TRUE(d.admit(echo));
+    TEST_ASSERT_TRUE(d.admit(echo));
+}
+
+static void test_overflow_drop_policies() {
+    uint8_t fast = bus->attachReader();
+    uint8_t slow = bus->attachReader();
+    bus->setReaderEnabled(fast, true);
+    bus->setReaderEnabled(slow, true);
+
+    // Drop newest: the backend is drained, the excess is counted
+    bus->setOverflowPolicy(OverflowPolicy::DropNewest);
+    pushFrames(0, CAN_RX_QUEUE_SIZE + 10);
+    TEST_ASSERT_EQUAL(CAN_RX_QUEUE_SIZE, bus->fill(*can));
+    TEST_ASSERT_EQUAL(0, can->rxQueue.size());
+    uint32_t overflows, mainDrops, priorityDrops;
+    bus->getCounters(&overflows);
+    bus->getLaneCounters(&mainDrops, &priorityDrops);
+    TEST_ASSERT_EQUAL(1, overflows);
+    TEST_ASSERT_EQUAL(10, mainDrops);
+    TEST_ASSERT_EQUAL(0, priorityDrops);
+    TEST_ASSERT_EQUAL_HEX32(0, bus->peek(slow)->id);
+
+    // Drop oldest: only readers still holding the oldest frame lose it
+    bus->setOverflowPolicy(OverflowPolicy::DropOldest);
+    for (int i = 0; i < 5; i++) bus->consume(fast);
+    pushFrames(0x1000, 3);
+    TEST_ASSERT_EQUAL(3, bus->fill(*can));
+    bus->getLaneCounters(&mainDrops, nullptr);
+    TEST_ASSERT_EQUAL(13, mainDrops);
+    TEST_ASSERT_EQUAL(CAN_RX_QUEUE_SIZE, bus->pending(slow));
+    TEST_ASSERT_EQUAL_HEX32(3, bus->peek(slow)->id);
+    TEST_ASSERT_EQUAL_HEX32(5, bus->peek(fast)->id);
+    TEST_ASSERT_EQUAL(CAN_RX_QUEUE_SIZE - 2, bus->pending(fast));
+
+    // Newest frames are at the end for both
+    while (bus->pending(slow) > 1) bus->consume(slow);
+    TEST_ASSERT_EQUAL_HEX32(0x1002, bus->peek(slow)->id);
+
+    bus->resetCounters();
+    bus->getLaneCounters(&mainDrops, nullptr);
+    TEST_ASSERT_EQUAL(0, mainDrops);
+}
+
+static void test_priority_lane_forwarded_first() {
+    uint8_t r = bus->attachReader();
+    bus->setReaderEnabled(r, true);
+    TEST_ASSERT_FALSE(bus->addPriorityRule(stdRule(0x800, 0x800)));
+    TEST_ASSERT_TRUE(bus->addPriorityRule(stdRule(0x0A0, 0x0A0)));
+    TEST_ASSERT_TRUE(bus->addPriorityRule(stdRule(0x0A0, 0x0A0)));     // Already there
+    TEST_ASSERT_EQUAL(1, bus->getPriorityRuleCount());
+
+    pushFrames(0x090, 0x20);    // 0x0A0 in the middle
+    CANFrame echo;
+    echo.id = 0x0A0;
+    echo.echo = true;
+    can->pushRx(echo);
+    TEST_ASSERT_EQUAL(0x21, bus->fill(*can));
+
+    // Priority frame first, then the main ring in order (echo included)
+    TEST_ASSERT_EQUAL(0x21, bus->pending(r));
+    TEST_ASSERT_EQUAL_HEX32(0x0A0, bus->peek(r)->id);
+    TEST_ASSERT_FALSE(bus->peek(r)->echo);
+    bus->consume(r);
+    TEST_ASSERT_EQUAL_HEX32(0x090, bus->peek(r)->id);
+    while (bus->pending(r) > 1) bus->consume(r);
+    TEST_ASSERT_TRUE(bus->peek(r)->echo);
+    bus->consume(r);
+
+    // Full lane falls back to the main ring; with both full the frame is dropped
+    bus->setOverflowPolicy(OverflowPolicy::DropNewest);
+    for (int i = 0; i < FRAME_BUS_PRIORITY_SIZE + CAN_RX_QUEUE_SIZE + 1; i++) {
+        CANFrame f;
+        f.id = 0x0A0;
+        can->pushRx(f);
+    }
+    bus->fill(*can);
+    uint32_t mainDrops, priorityDrops;
+    bus->getLaneCounters(&mainDrops, &priorityDrops);
+    TEST_ASSERT_EQUAL(0, mainDrops);
+    TEST_ASSERT_EQUAL(1, priorityDrops);
+    TEST_ASSERT_EQUAL(FRAME_BUS_PRIORITY_SIZE + CAN_RX_QUEUE_SIZE, bus->pending(r));
+
+    TEST_ASSERT_FALSE(bus->removePriorityRule(stdRule(0x0A1, 0x0A1)));
+    TEST_ASSERT_TRUE(bus->removePriorityRule(stdRule(0x0A0, 0x0A0)));
+    for (uint32_t i = 0; i < FRAME_BUS_PRIORITY_RULES; i++) {
+        TEST_ASSERT_TRUE(bus->addPriorityRule(stdRule(i, i)));
+    }
+    TEST_ASSERT_FALSE(bus->addPriorityRule(stdRule(0x7FF, 0x7FF)));
+    bus->clearPriorityRules();
+    TEST_ASSERT_EQUAL(0, bus->getPriorityRuleCount());
+}
+
+static void test_capture_pre_and_post_window() {
+    FrameCapture& c = bus->getCapture();
+    TEST_ASSERT_FALSE(c.setWindow(CAPTURE_BUFFER_FRAMES, 0));
+    TEST_ASSERT_TRUE(c.setWindow(4, 3));
+    TEST_ASSERT_TRUE(c.setIdTrigger(stdRule(0x0A0, 0x0A0)));
+
+    // Not armed: nothing is read for the capture
+    pushFrames(0x090, 2);
+    TEST_ASSERT_EQUAL(0, bus->fill(*can));
+    TEST_ASSERT_EQUAL(2, can->rxQueue.size());
+    can->rxQueue.clear();
+
+    // Armed with no reader enabled: the backend is drained into the capture
+    c.arm();
+    pushFrames(0x090, 0x20);    // 0x0A0 is the 17th frame
+    TEST_ASSERT_EQUAL(0, bus->fill(*can));
+    TEST_ASSERT_EQUAL(CaptureState::Done, c.getState());
+    TEST_ASSERT_EQUAL(8, c.getCount());
+    TEST_ASSERT_EQUAL(4, c.getTriggerIndex());
+    TEST_ASSERT_EQUAL(0x20 - 0x14, can->rxQueue.size());   // Left once the window is complete
+
+    CANFrame f;
+    for (uint16_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(c.getFrame(i, f));
+        TEST_ASSERT_EQUAL_HEX32(0x09C + i, f.id);
+    }
+    TEST_ASSERT_FALSE(c.getFrame(8, f));
+
+    uint32_t triggers, frames;
+    c.getCounters(&triggers, &frames);
+    TEST_ASSERT_EQUAL(1, triggers);
+    TEST_ASSERT_EQUAL(0x14, frames);
+
+    c.stop();
+    TEST_ASSERT_EQUAL(CaptureState::Idle, c.getState());
+    TEST_ASSERT_EQUAL(0, c.getCount());
+    bus->resetCounters();
+    c.getCounters(&triggers, &frames);
+    TEST_ASSERT_EQUAL(0, frames);
+}
+
+static void test_capture_window_change_waits_for_arm() {
+    FrameCapture& c = bus->getCapture();
+    TEST_ASSERT_TRUE(c.setWindow(0, CAPTURE_BUFFER_FRAMES - 1));
+    c.arm();
+
+    // A new window while armed leaves this capture's window alone
+    TEST_ASSERT_TRUE(c.setWindow(CAPTURE_BUFFER_FRAMES - 1, 0));
+    pushFrames(0, 2 * CAPTURE_BUFFER_FRAMES);
+    bus->fill(*can);
+    c.trigger();
+    pushFrames(0x1000, 2 * CAPTURE_BUFFER_FRAMES);
+    bus->fill(*can);
+    TEST_ASSERT_EQUAL(CaptureState::Done, c.getState());
+    TEST_ASSERT_EQUAL(CAPTURE_BUFFER_FRAMES - 1, c.getCount());
+    TEST_ASSERT_EQUAL(0, c.getTriggerIndex());
+    CANFrame f;
+    TEST_ASSERT_TRUE(c.getFrame(0, f));
+    TEST_ASSERT_EQUAL_HEX32(0x1000, f.id);
+    TEST_ASSERT_TRUE(c.getFrame(CAPTURE_BUFFER_FRAMES - 2, f));
+    TEST_ASSERT_EQUAL_HEX32(0x1000 + CAPTURE_BUFFER_FRAMES - 2, f.id);
+
+    // The next arm() uses it
+    uint16_t pre, post;
+    c.getWindow(&pre, &post);
+    TEST_ASSERT_EQUAL(CAPTURE_BUFFER_FRAMES - 1, pre);
+    c.arm();
+    pushFrames(0x2000, 2 * CAPTURE_BUFFER_FRAMES);
+    bus->fill(*can);
+    c.trigger();
+    TEST_ASSERT_EQUAL(CaptureState::Done, c.getState());
+    TEST_ASSERT_EQUAL(CAPTURE_BUFFER_FRAMES - 1, c.getCount());
+    TEST_ASSERT_TRUE(c.getFrame(0, f));
+    TEST_ASSERT_EQUAL_HEX32(0x2000 + CAPTURE_BUFFER_FRAMES + 1, f.id);
+}
+
+static void test_capture_data_error_and_forced_triggers() {
+    FrameCapture& c = bus->getCapture();
+    TEST_ASSERT_TRUE(c.setWindow(2, 1));
+
+    // Data trigger: masked bytes must match and be present; echoes never trigger
+    uint8_t value[8] = { 0x00, 0x40 };
+    uint8_t mask[8] = { 0x00, 0xF0 };
+    c.setDataTrigger(value, mask);
+    TEST_ASSERT_TRUE(c.hasDataTrigger());
+    c.arm();
+    CANFrame f;
+    f.id = 0x100;
+    f.dlc = 1;
+    f.data[1] = 0x45;
+    c.record(f);                // Byte 1 beyond the DLC
+    f.dlc = 2;
+    f.echo = true;
+    c.record(f);
+    TEST_ASSERT_EQUAL(CaptureState::Armed, c.getState());
+    f.echo = false;
+    f.data[1] = 0x4F;
+    c.record(f);
+    TEST_ASSERT_EQUAL(CaptureState::Triggered, c.getState());
+    TEST_ASSERT_EQUAL(2, c.getTriggerIndex());
+    TEST_ASSERT_FALSE(c.record(f));
+    TEST_ASSERT_EQUAL(CaptureState::Done, c.getState());
+    TEST_ASSERT_FALSE(c.record(f));
+    TEST_ASSERT_EQUAL(4, c.getCount());
+    TEST_ASSERT_TRUE(c.getFrame(1, f));
+    TEST_ASSERT_TRUE(f.echo);
+    c.clearDataTrigger();
+
+    // Error trigger: only events after arm() count
+    c.setErrorTrigger(true);
+    can->errorEvents = 5;
+    c.arm();
+    pushFrames(1, 1);
+    bus->fill(*can);
+    TEST_ASSERT_EQUAL(CaptureState::Armed, c.getState());
+    can->errorEvents = 6;
+    pushFrames(2, 3);
+    bus->fill(*can);
+    TEST_ASSERT_EQUAL(CaptureState::Done, c.getState());
+    TEST_ASSERT_EQUAL(2, c.getCount());
+    TEST_ASSERT_EQUAL(1, c.getTriggerIndex());
+    c.setErrorTrigger(false);
+
+    // Forced trigger with timestamps past 28 bits
+    c.arm();
+    f.timestamp = 0x12345678;
+    c.record(f);
+    c.trigger();
+    c.record(f);
+    TEST_ASSERT_EQUAL(CaptureState::Done, c.getState());
+    TEST_ASSERT_TRUE(c.getFrame(1, f));
+    TEST_ASSERT_EQUAL_HEX32(0x02345678, f.timestamp);
+}
+
+static void test_capture_drains_backend_while_ring_is_full() {
+    uint8_t r = bus->attachReader();
+    bus->setReaderEnabled(r, true);
+    pushFrames(0, CAN_RX_QUEUE_SIZE);
+    TEST_ASSERT_EQUAL(CAN_RX_QUEUE_SIZE, bus->fill(*can));
+
+    // The default policy leaves the excess in the backend; a capture takes it
+    FrameCapture& c = bus->getCapture();
+    TEST_ASSERT_TRUE(c.setWindow(0, 10));
+    c.arm();
+    c.trigger();
+    pushFrames(0x1000, 15);
+    TEST_ASSERT_EQUAL(0, bus->fill(*can));
+    TEST_ASSERT_EQUAL(CaptureState::Done, c.getState());
+    TEST_ASSERT_EQUAL(10, c.getCount());
+    TEST_ASSERT_EQUAL(5, can->rxQueue.size());
+    uint32_t mainDrops;
+    bus->getLaneCounters(&mainDrops, nullptr);
+    TEST_ASSERT_EQUAL(10, mainDrops);
+
+    // The live stream is untouched
+    TEST_ASSERT_EQUAL(CAN_RX_QUEUE_SIZE, bus->pending(r));
+    TEST_ASSERT_EQUAL_HEX32(0, bus->peek(r)->id);
+}
+
+static void test_dispatch_routes_by_prefix() {
+    ProtocolDispatcher dispatcher;
+    StubHandler a("A", 'a');
+    StubHandler b("B", 'b');
+    dispatcher.registerHandler(&a);
+    dispatcher.registerHandler(&b);
+
+    char response[16];
+    TEST_ASSERT_TRUE(dispatcher.dispatch("b1", response, sizeof(response)));
+    TEST_ASSERT_EQUAL_STRING("B", response);
+    TEST_ASSERT_TRUE(dispatcher.dispatch("x", response, sizeof(response)));
+    TEST_ASSERT_EQUAL_STRING("\x07", response);
+    TEST_ASSERT_FALSE(dispatcher.dispatch("", response, sizeof(response)));
+}
+
+static void test_stream_ownership() {
+    ProtocolDispatcher dispatcher;
+    StubHandler a("A", 'a');
+    StubHandler b("B", 'b');
+    dispatcher.registerHandler(&a);
+    dispatcher.registerHandler(&b);
+
+    TEST_ASSERT_TRUE(a.owner);
+    TEST_ASSERT_FALSE(b.owner);
+    TEST_ASSERT_TRUE(dispatcher.setStreamOwner(&b));
+    TEST_ASSERT_FALSE(a.owner);
+    TEST_ASSERT_TRUE(b.owner);
+
+    // Removing the owner hands the stream back to the first handler
+    dispatcher.unregisterHandler(&b);
+    TEST_ASSERT_TRUE(a.owner);
+    TEST_ASSERT_EQUAL(1, dispatcher.getHandlerCount());
+}
+
+static void test_poll_all_fills_bus_when_open() {
+    ProtocolDispatcher dispatcher;
+    StubHandler a("A", 'a');
+    dispatcher.registerHandler(&a);
+    dispatcher.setFrameSource(can);
+    dispatcher.getFrameBus().setReaderEnabled(0, true);
+
+    pushFrames(1, 2);
+    dispatcher.pollAll(nullptr);
+    TEST_ASSERT_EQUAL(2, can->rxQueue.size());      // Backend closed: not drained
+    TEST_ASSERT_EQUAL(1, a.polls);
+
+    can->open = true;
+    dispatcher.pollAll(nullptr);
+    TEST_ASSERT_EQUAL(0, can->rxQueue.size());
+    TEST_ASSERT_EQUAL(2, dispatcher.getFrameBus().pending(0));
+}
+
+static void test_routes_first_handler_wins_and_rebuild() {
+    ProtocolDispatcher dispatcher;
+    StubHandler a("A", 'x');
+    StubHandler b("B", 'x');
+    StubHandler c("C", 'c');
+    dispatcher.registerHandler(&a);
+    dispatcher.registerHandler(&b);
+    dispatcher.registerHandler(&c);
+    TEST_ASSERT_EQUAL(2, dispatcher.getRouteCount());
+
+    char response[16];
+    dispatcher.dispatch("x", response, sizeof(response));
+    TEST_ASSERT_EQUAL_STRING("A", response);
+
+    // The freed byte falls to the next handler, and shifted slots still match
+    dispatcher.unregisterHandler(&a);
+    dispatcher.dispatch("x", response, sizeof(response));
+    TEST_ASSERT_EQUAL_STRING("B", response);
+    dispatcher.dispatch("c", response, sizeof(response));
+    TEST_ASSERT_EQUAL_STRING("C", response);
+
+    dispatcher.unregisterHandler(&b);
+    dispatcher.dispatch("x", response, sizeof(response));
+    TEST_ASSERT_EQUAL_STRING("\x07", response);
+    TEST_ASSERT_EQUAL(1, dispatcher.getRouteCount());
+}
+
+static void test_route_table_rejects_taken_and_unowned() {
+    CommandRouteTable table;
+    CommandRouteFn fn = [](IProtocolHandler*, const char*, char*, size_t) { return true; };
+
+    TEST_ASSERT_FALSE(table.addRoute('a', fn));     // No slot selected
+    table.setSlot(2);
+    TEST_ASSERT_TRUE(table.addRoute('a', fn));
+    TEST_ASSERT_FALSE(table.addRoute('a', fn));
+    TEST_ASSERT_FALSE(table.addRoute(0, fn));
+
+    uint8_t slot;
+    TEST_ASSERT_TRUE(table.lookup('a', &slot) == fn);
+    TEST_ASSERT_EQUAL(2, slot);
+    TEST_ASSERT_TRUE(table.lookup(0xFF, &slot) == nullptr);
+    TEST_ASSERT_EQUAL(COMMAND_ROUTE_NO_SLOT, slot);
+}
+
+static void test_handler_table_full() {
+    ProtocolDispatcher dispatcher;
+    std::vector<StubHandler> h;
+    for (int i = 0; i <= MAX_PROTOCOL_HANDLERS; i++) {
+        h.emplace_back("H", (char)('0' + i));
+    }
+    for (int i = 0; i < MAX_PROTOCOL_HANDLERS; i++) {
+        TEST_ASSERT_TRUE(dispatcher.registerHandler(&h[i]));
+    }
+    TEST_ASSERT_FALSE(dispatcher.registerHandler(&h[MAX_PROTOCOL_HANDLERS]));
+    TEST_ASSERT_TRUE(dispatcher.registerHandler(&h[0]));   // Re-registering is a no-op
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_no_enabled_reader_leaves_frames_in_backend);
+    RUN_TEST(test_readers_see_same_frames);
+    RUN_TEST(test_slowest_reader_holds_ring_back);
+    RUN_TEST(test_disabled_reader_restarts_at_newest);
+    RUN_TEST(test_reader_slots_exhaust);
+    RUN_TEST(test_decimate_one_in_n_before_ring);
+    RUN_TEST(test_decimate_max_rate_uses_capture_time);
+    RUN_TEST(test_decimate_rule_table);
+    RUN_TEST(test_overflow_drop_policies);
+    RUN_TEST(test_priority_lane_forwarded_first);
+    RUN_TEST(test_capture_pre_and_post_window);
+    RUN_TEST(test_capture_window_change_waits_for_arm);
+    RUN_TEST(test_capture_data_error_and_forced_triggers);
+    RUN_TEST(test_capture_drains_backend_while_ring_is_full);
+    RUN_TEST(test_dispatch_routes_by_prefix);
+    RUN_TEST(test_stream_ownership);
+    RUN_TEST(test_poll_all_fills_bus_when_open);
+    RUN_TEST(test_routes_first_handler_wins_and_rebuild);
+    RUN_TEST(test_route_table_rejects_taken_and_unowned);
+    RUN_TEST(test_handler_table_full);
+    return UNITY_END();
+}
@@ -0,0 +1,551 @@
+/**
+ * ISO-TP tests (native)
+ *
+ * Segmentation, flow control and timing of the protocol engine, and the
+ * I commands and records of the handler, against a mock CAN backend and
+ * transport.
+ */
+
+#include <unity.h>
+#include "IsoTpHandler.h"
+#include "FrameBus.h"
+#include "MockCANBackend.h"
+#include "MockTransport.h"
+#include <Arduino.h>
+#include <string>
+
+static MockCANBackend* can;
+static IsoTpLink* link;
+
+void setUp() {
+    can = new MockCANBackend();
+    can->begin(CANBitrate::BR_500K);
+    link = new IsoTpLink();
+    link->setAddress(0x7E0, 0x7E8, false);
+}
+
+void tearDown() {
+    delete link;
+    delete can;
+}
+
+static CANFrame makeFrame(uint32_t id, const uint8_t* data, uint8_t dlc) {
+    CANFrame f;
+    f.id = id;
+    f.dlc = dlc;
+    for (uint8_t i = 0; i < dlc; i++) {
+        f.data[i] = data[i];
+    }
+    return f;
+}
+
+static CANFrame flowControl(uint8_t status, uint8_t blockSize, uint8_t stMin) {
+    uint8_t d[3] = { (uint8_t)(0x30 | status), blockSize, stMin };
+    return makeFrame(0x7E8, d, 3);
+}
+
+static void stage(uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        uint8_t b = (uint8_t)i;
+        link->append(&b, 1);
+    }
+}
+
+// =============================================================================
+// Transmit
+// =============================================================================
+
+static void test_send_single_frame() {
+    uint8_t req[3] = { 0x22, 0xF1, 0x90 };
+    TEST_ASSERT_TRUE(link->append(req, 3));
+    TEST_ASSERT_TRUE(link->startSend(*can, 0));
+
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());
+    const CANFrame& f = can->txFrames[0];
+    TEST_ASSERT_EQUAL_HEX32(0x7E0, f.id);
+    TEST_ASSERT_EQUAL(4, f.dlc);
+    TEST_ASSERT_EQUAL_HEX8(0x03, f.data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x90, f.data[3]);
+
+    uint8_t code = 0xFF;
+    TEST_ASSERT_TRUE(link->takeTxResult(&code));
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_RESULT_OK, code);
+    TEST_ASSERT_FALSE(link->takeTxResult(&code));
+    TEST_ASSERT_EQUAL(IsoTpTxState::Idle, link->getTxState());
+    TEST_ASSERT_EQUAL(0, link->getStagedLength());
+
+    // Nothing staged, nothing to send
+    TEST_ASSERT_FALSE(link->startSend(*can, 0));
+}
+
+static void test_send_padding_and_queue_retry() {
+    link->setPadding(true, 0xAA);
+    can->txCapacity = 0;
+    stage(2);
+    TEST_ASSERT_TRUE(link->startSend(*can, 0));
+    TEST_ASSERT_EQUAL(IsoTpTxState::SendFirst, link->getTxState());
+
+    // TX queue full: the frame goes out on a later poll
+    link->poll(*can, 100);
+    TEST_ASSERT_EQUAL(0, can->txFrames.size());
+    can->txCapacity = SIZE_MAX;
+    link->poll(*can, 200);
+
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());
+    TEST_ASSERT_EQUAL(8, can->txFrames[0].dlc);
+    TEST_ASSERT_EQUAL_HEX8(0x02, can->txFrames[0].data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, can->txFrames[0].data[3]);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, can->txFrames[0].data[7]);
+}
+
+static void test_send_multi_frame_with_block_size() {
+    stage(30);
+    TEST_ASSERT_TRUE(link->startSend(*can, 0));
+
+    // First frame: 12-bit length, 6 data bytes
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());
+    TEST_ASSERT_EQUAL_HEX8(0x10, can->txFrames[0].data[0]);
+    TEST_ASSERT_EQUAL_HEX8(30, can->txFrames[0].data[1]);
+    TEST_ASSERT_EQUAL_HEX8(5, can->txFrames[0].data[7]);
+    TEST_ASSERT_EQUAL(IsoTpTxState::WaitFlowControl, link->getTxState());
+
+    // Block of 2, then wait for the next flow control
+    TEST_ASSERT_TRUE(link->handleFrame(flowControl(0, 2, 0), *can, 10));
+    TEST_ASSERT_EQUAL(3, can->txFrames.size());
+    TEST_ASSERT_EQUAL_HEX8(0x21, can->txFrames[1].data[0]);
+    TEST_ASSERT_EQUAL_HEX8(6, can->txFrames[1].data[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x22, can->txFrames[2].data[0]);
+    TEST_ASSERT_EQUAL(IsoTpTxState::WaitFlowControl, link->getTxState());
+
+    link->handleFrame(flowControl(0, 0, 0), *can, 20);
+    TEST_ASSERT_EQUAL(5, can->txFrames.size());
+    TEST_ASSERT_EQUAL_HEX8(0x24, can->txFrames[4].data[0]);
+    TEST_ASSERT_EQUAL(4, can->txFrames[4].dlc);     // 3 data bytes, unpadded
+    TEST_ASSERT_EQUAL_HEX8(29, can->txFrames[4].data[3]);
+
+    uint8_t code;
+    TEST_ASSERT_TRUE(link->takeTxResult(&code));
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_RESULT_OK, code);
+    uint32_t sent, received, errors;
+    link->getCounters(&sent, &received, &errors);
+    TEST_ASSERT_EQUAL(1, sent);
+    TEST_ASSERT_EQUAL(0, errors);
+}
+
+static void test_send_sequence_number_wraps() {
+    stage(6 + 7 * 17);
+    link->startSend(*can, 0);
+    link->handleFrame(flowControl(0, 0, 0), *can, 0);
+
+    TEST_ASSERT_EQUAL(18, can->txFrames.size());
+    TEST_ASSERT_EQUAL_HEX8(0x2F, can->txFrames[15].data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x20, can->txFrames[16].data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x21, can->txFrames[17].data[0]);
+}
+
+static void test_send_honours_stmin() {
+    stage(30);
+    link->startSend(*can, 0);
+
+    // 10 ms apart; the first consecutive frame goes at once
+    link->handleFrame(flowControl(0, 0, 10), *can, 1000);
+    TEST_ASSERT_EQUAL(2, can->txFrames.size());
+    link->poll(*can, 10999);
+    TEST_ASSERT_EQUAL(2, can->txFrames.size());
+    link->poll(*can, 11000);
+    TEST_ASSERT_EQUAL(3, can->txFrames.size());
+    link->poll(*can, 50000);
+    TEST_ASSERT_EQUAL(4, can->txFrames.size());     // One per poll, never a burst
+
+    TEST_ASSERT_EQUAL(10000, IsoTpLink::stMinToUs(0x0A));
+    TEST_ASSERT_EQUAL(300, IsoTpLink::stMinToUs(0xF3));
+    TEST_ASSERT_EQUAL(127000, IsoTpLink::stMinToUs(0x80));
+    TEST_ASSERT_EQUAL(127000, IsoTpLink::stMinToUs(0xFA));
+}
+
+static void test_send_flow_control_errors() {
+    uint8_t code;
+
+    // N_Bs timeout
+    stage(20);
+    link->startSend(*can, 0);
+    link->poll(*can, ISOTP_TIMEOUT_MS * 1000UL - 1);
+    TEST_ASSERT_FALSE(link->takeTxResult(&code));
+    link->poll(*can, ISOTP_TIMEOUT_MS * 1000UL);
+    TEST_ASSERT_TRUE(link->takeTxResult(&code));
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_ERROR_FC_TIMEOUT, code);
+    TEST_ASSERT_EQUAL(0, link->getStagedLength());
+
+    // WAIT restarts the timer, but only ISOTP_MAX_WAIT_FRAMES times
+    stage(20);
+    link->startSend(*can, 0);
+    uint32_t now = 0;
+    for (int i = 0; i < ISOTP_MAX_WAIT_FRAMES; i++) {
+        now += 900000;
+        link->handleFrame(flowControl(1, 0, 0), *can, now);
+        link->poll(*can, now + 1);
+    }
+    TEST_ASSERT_EQUAL(IsoTpTxState::WaitFlowControl, link->getTxState());
+    link->handleFrame(flowControl(1, 0, 0), *can, now);
+    TEST_ASSERT_TRUE(link->takeTxResult(&code));
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_ERROR_FC_WAIT, code);
+
+    // Receiver overflow and reserved flow status
+    stage(20);
+    link->startSend(*can, 0);
+    link->handleFrame(flowControl(2, 0, 0), *can, 0);
+    TEST_ASSERT_TRUE(link->takeTxResult(&code));
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_ERROR_FC_OVERFLOW, code);
+
+    stage(20);
+    link->startSend(*can, 0);
+    link->handleFrame(flowControl(7, 0, 0), *can, 0);
+    TEST_ASSERT_TRUE(link->takeTxResult(&code));
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_ERROR_FC_INVALID, code);
+
+    uint32_t errors;
+    link->getCounters(nullptr, nullptr, &errors);
+    TEST_ASSERT_EQUAL(4, errors);
+}
+
+static void test_staging_limits() {
+    static uint8_t big[ISOTP_MAX_PDU_SIZE];
+    TEST_ASSERT_TRUE(link->append(big, ISOTP_MAX_PDU_SIZE));
+    TEST_ASSERT_FALSE(link->append(big, 1));
+
+    link->startSend(*can, 0);
+    TEST_ASSERT_FALSE(link->append(big, 1));        // Busy
+    link->abort();
+    uint8_t code;
+    TEST_ASSERT_TRUE(link->takeTxResult(&code));
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_ERROR_ABORTED, code);
+    TEST_ASSERT_TRUE(link->append(big, 1));
+
+    IsoTpLink unaddressed;
+    TEST_ASSERT_TRUE(unaddressed.append(big, 1));
+    TEST_ASSERT_FALSE(unaddressed.startSend(*can, 0));
+    TEST_ASSERT_FALSE(unaddressed.setAddress(0x800, 0x7E8, false));
+    TEST_ASSERT_TRUE(unaddressed.setAddress(0x18DA10F1, 0x18DAF110, true));
+}
+
+// =============================================================================
+// Receive
+// =============================================================================
+
+static void test_receive_single_frame_and_hold() {
+    uint8_t sf[4] = { 0x03, 0x62, 0xF1, 0x90 };
+    TEST_ASSERT_TRUE(link->accepts(makeFrame(0x7E8, sf, 4)));
+    TEST_ASSERT_FALSE(link->accepts(makeFrame(0x7E0, sf, 4)));
+    TEST_ASSERT_TRUE(link->handleFrame(makeFrame(0x7E8, sf, 4), *can, 0));
+
+    uint16_t len = 0;
+    const uint8_t* pdu = link->getRxPdu(&len);
+    TEST_ASSERT_NOT_NULL(pdu);
+    TEST_ASSERT_EQUAL(3, len);
+    TEST_ASSERT_EQUAL_HEX8(0x62, pdu[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x90, pdu[2]);
+
+    // Next PDU waits until the held one is released
+    TEST_ASSERT_FALSE(link->handleFrame(makeFrame(0x7E8, sf, 4), *can, 0));
+    link->releaseRx();
+    TEST_ASSERT_NULL(link->getRxPdu(&len));
+    TEST_ASSERT_TRUE(link->handleFrame(makeFrame(0x7E8, sf, 4), *can, 0));
+
+    // Length beyond the frame is malformed, ignored
+    link->releaseRx();
+    uint8_t bad[2] = { 0x05, 0x00 };
+    TEST_ASSERT_TRUE(link->handleFrame(makeFrame(0x7E8, bad, 2), *can, 0));
+    TEST_ASSERT_EQUAL(IsoTpRxState::Idle, link->getRxState());
+}
+
+static void test_receive_multi_frame_with_block_size() {
+    link->setFlowControl(2, 5);
+    uint8_t ff[8] = { 0x10, 20, 0, 1, 2, 3, 4, 5 };
+    link->handleFrame(makeFrame(0x7E8, ff, 8), *can, 0);
+
+    // Flow control on our TX ID with our block size and STmin
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());
+    TEST_ASSERT_EQUAL_HEX32(0x7E0, can->txFrames[0].id);
+    TEST_ASSERT_EQUAL(3, can->txFrames[0].dlc);
+    TEST_ASSERT_EQUAL_HEX8(0x30, can->txFrames[0].data[0]);
+    TEST_ASSERT_EQUAL_HEX8(2, can->txFrames[0].data[1]);
+    TEST_ASSERT_EQUAL_HEX8(5, can->txFrames[0].data[2]);
+    TEST_ASSERT_EQUAL(IsoTpRxState::Receiving, link->getRxState());
+
+    uint8_t cf1[8] = { 0x21, 6, 7, 8, 9, 10, 11, 12 };
+    uint8_t cf2[8] = { 0x22, 13, 14, 15, 16, 17, 18, 19 };
+    link->handleFrame(makeFrame(0x7E8, cf1, 8), *can, 100);
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());
+    link->handleFrame(makeFrame(0x7E8, cf2, 8), *can, 200);
+
+    // Last frame completes the PDU before the block ends: no second FC
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());
+    uint16_t len;
+    const uint8_t* pdu = link->getRxPdu(&len);
+    TEST_ASSERT_NOT_NULL(pdu);
+    TEST_ASSERT_EQUAL(20, len);
+    for (uint8_t i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL_HEX8(i, pdu[i]);
+    }
+
+    // Longer PDU: a flow control frame after every block
+    link->releaseRx();
+    ff[1] = 30;
+    link->handleFrame(makeFrame(0x7E8, ff, 8), *can, 0);
+    link->handleFrame(makeFrame(0x7E8, cf1, 8), *can, 0);
+    link->handleFrame(makeFrame(0x7E8, cf2, 8), *can, 0);
+    TEST_ASSERT_EQUAL(3, can->txFrames.size());
+    TEST_ASSERT_EQUAL_HEX8(0x30, can->txFrames[2].data[0]);
+}
+
+static void test_receive_flow_control_retry() {
+    can->txCapacity = 0;
+    uint8_t ff[8] = { 0x10, 20, 0, 1, 2, 3, 4, 5 };
+    link->handleFrame(makeFrame(0x7E8, ff, 8), *can, 0);
+    TEST_ASSERT_EQUAL(0, can->txFrames.size());
+
+    can->txCapacity = SIZE_MAX;
+    link->poll(*can, 500000);
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());
+
+    // N_Cr runs from the flow control frame that actually went out
+    link->poll(*can, 500000 + ISOTP_TIMEOUT_MS * 1000UL - 1);
+    TEST_ASSERT_EQUAL(IsoTpRxState::Receiving, link->getRxState());
+}
+
+static void test_receive_errors() {
+    uint8_t code;
+    uint8_t ff[8] = { 0x10, 20, 0, 1, 2, 3, 4, 5 };
+    uint8_t cf2[8] = { 0x22, 13, 14, 15, 16, 17, 18, 19 };
+
+    // Consecutive frame out of sequence
+    link->handleFrame(makeFrame(0x7E8, ff, 8), *can, 0);
+    link->handleFrame(makeFrame(0x7E8, cf2, 8), *can, 0);
+    TEST_ASSERT_EQUAL(IsoTpRxState::Idle, link->getRxState());
+    TEST_ASSERT_TRUE(link->takeRxError(&code));
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_ERROR_WRONG_SN, code);
+
+    // N_Cr timeout
+    link->handleFrame(makeFrame(0x7E8, ff, 8), *can, 0);
+    link->poll(*can, ISOTP_TIMEOUT_MS * 1000UL);
+    TEST_ASSERT_TRUE(link->takeRxError(&code));
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_ERROR_CF_TIMEOUT, code);
+
+    // New first frame in the middle of a PDU replaces it
+    link->handleFrame(makeFrame(0x7E8, ff, 8), *can, 0);
+    link->handleFrame(makeFrame(0x7E8, ff, 8), *can, 0);
+    TEST_ASSERT_TRUE(link->takeRxError(&code));
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_ERROR_UNEXPECTED, code);
+    TEST_ASSERT_EQUAL(IsoTpRxState::Receiving, link->getRxState());
+
+    // Too large for the RX buffer: refused with an overflow flow control
+    link->abort();
+    can->txFrames.clear();
+    uint8_t huge[8] = { 0x1F, 0xFF, 0, 0, 0, 0, 0, 0 };
+    link->handleFrame(makeFrame(0x7E8, huge, 8), *can, 0);
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());
+    TEST_ASSERT_EQUAL_HEX8(0x32, can->txFrames[0].data[0]);
+    TEST_ASSERT_TRUE(link->takeRxError(&code));
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_ERROR_RX_OVERFLOW, code);
+
+    uint32_t received, errors;
+    link->getCounters(nullptr, &received, &errors);
+    TEST_ASSERT_EQUAL(0, received);
+    TEST_ASSERT_EQUAL(4, errors);
+}
+
+// =============================================================================
+// Handler
+// =============================================================================
+
+struct HandlerFixture {
+    FrameBus bus;
+    IsoTpHandler handler;
+    MockTransport transport;
+    char response[RESPONSE_BUFFER_SIZE];
+
+    HandlerFixture() : handler(*can) {
+        handler.attachFrameBus(&bus, bus.attachReader());
+    }
+
+    const char* command(const char* cmd) {
+        response[0] = '\0';
+        handler.processCommand(cmd, response, sizeof(response));
+        return response;
+    }
+
+    void receive(const uint8_t* data, uint8_t dlc) {
+        can->pushRx(makeFrame(0x7E8, data, dlc));
+        bus.fill(*can);
+        handler.poll(&transport);
+    }
+};
+
+static void test_handler_commands() {
+    HandlerFixture fx;
+    TEST_ASSERT_TRUE(fx.handler.canHandle("IS"));
+    TEST_ASSERT_FALSE(fx.handler.canHandle("S6"));
+
+    TEST_ASSERT_FALSE(fx.handler.isActive());
+    TEST_ASSERT_EQUAL_STRING("\x07", fx.command("IS01"));   // No address yet
+    TEST_ASSERT_EQUAL_STRING("", fx.command("IAt7E07E8"));
+    TEST_ASSERT_TRUE(fx.handler.isActive());
+    TEST_ASSERT_EQUAL_STRING("", fx.command("IAT18DA10F118DAF110"));
+    TEST_ASSERT_TRUE(fx.handler.getLink().isExtended());
+    TEST_ASSERT_EQUAL_STRING("\x07", fx.command("IAt7E07E"));
+    TEST_ASSERT_EQUAL_STRING("\x07", fx.command("IAT20000000018DAF110"));
+    TEST_ASSERT_EQUAL_STRING("", fx.command("IA"));
+    TEST_ASSERT_FALSE(fx.handler.isActive());
+
+    TEST_ASSERT_EQUAL_STRING("", fx.command("IF0814"));
+    TEST_ASSERT_EQUAL_STRING("\x07", fx.command("IF08"));
+    TEST_ASSERT_EQUAL_STRING("", fx.command("IPCC"));
+    TEST_ASSERT_EQUAL_STRING("", fx.command("IP"));
+    TEST_ASSERT_EQUAL_STRING("\x07", fx.command("IPC"));
+
+    // Staging: whole hex bytes only, nothing kept from a bad line
+    TEST_ASSERT_EQUAL_STRING("", fx.command("IW1003"));
+    TEST_ASSERT_EQUAL_STRING("\x07", fx.command("IW10G3"));
+    TEST_ASSERT_EQUAL_STRING("\x07", fx.command("IW100"));
+    TEST_ASSERT_EQUAL_STRING("\x07", fx.command("IW"));
+    TEST_ASSERT_EQUAL_STRING("I000002", fx.command("I"));
+    TEST_ASSERT_EQUAL_STRING("", fx.command("IX"));
+    TEST_ASSERT_EQUAL_STRING("I000000", fx.command("I"));
+    TEST_ASSERT_EQUAL_STRING("\x07", fx.command("IQ"));
+
+    // Sending needs a channel that can transmit
+    fx.command("IAt7E07E8");
+    can->end();
+    TEST_ASSERT_EQUAL_STRING("\x07", fx.command("IS1003"));
+    can->begin(CANBitrate::BR_500K, CANMode::ListenOnly);
+    TEST_ASSERT_EQUAL_STRING("\x07", fx.command("IS1003"));
+    TEST_ASSERT_EQUAL_STRING("I000000", fx.command("I"));
+}
+
+static void test_handler_send_reports_result() {
+    HandlerFixture fx;
+    fx.command("IAt7E07E8");
+    TEST_ASSERT_EQUAL_STRING("", fx.command("IW2E"));
+    TEST_ASSERT_EQUAL_STRING("", fx.command("ISF19001020304050607"));
+
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());
+    TEST_ASSERT_EQUAL_HEX8(0x10, can->txFrames[0].data[0]);
+    TEST_ASSERT_EQUAL_HEX8(10, can->txFrames[0].data[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x2E, can->txFrames[0].data[2]);
+    TEST_ASSERT_EQUAL_STRING("I20000A", fx.command("I"));     // Waiting for FC
+    TEST_ASSERT_EQUAL_STRING("\x07", fx.command("IS01"));     // Busy
+
+    uint8_t fc[3] = { 0x30, 0x00, 0x00 };
+    fx.receive(fc, 3);
+    TEST_ASSERT_EQUAL(2, can->txFrames.size());
+    TEST_ASSERT_EQUAL_HEX8(0x21, can->txFrames[1].data[0]);
+    TEST_ASSERT_EQUAL_STRING("It00\r", fx.transport.output.c_str());
+
+    uint32_t sent;
+    fx.handler.getCounters(&sent, nullptr, nullptr);
+    TEST_ASSERT_EQUAL(1, sent);
+}
+
+static void test_handler_writes_received_pdu() {
+    HandlerFixture fx;
+    fx.command("IAt7E07E8");
+
+    // Frames for other IDs are skipped
+    uint8_t other[2] = { 0x01, 0x55 };
+    can->pushRx(makeFrame(0x123, other, 2));
+
+    // 100-byte PDU: header, then a full chunk and the rest
+    uint8_t ff[8] = { 0x10, 100, 0, 1, 2, 3, 4, 5 };
+    fx.receive(ff, 8);
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());     // Flow control
+    uint8_t next = 6;
+    for (uint8_t sn = 1; next < 100; sn++) {
+        uint8_t cf[8] = { (uint8_t)(0x20 | (sn & 0x0F)) };
+        for (uint8_t i = 1; i < 8; i++) {
+            cf[i] = next++;
+        }
+        fx.receive(cf, 8);
+    }
+
+    std::string expected = "Ir0064\rId";
+    char hex[3];
+    for (int i = 0; i < 100; i++) {
+        if (i == ISOTP_RX_CHUNK) {
+            expected += "\rId";
+        }
+        snprintf(hex, sizeof(hex), "%02X", i);
+        expected += hex;
+    }
+    expected += "\r";
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), fx.transport.output.c_str());
+    TEST_ASSERT_EQUAL(IsoTpRxState::Idle, fx.handler.getLink().getRxState());
+}
+
+static void test_handler_output_backpressure() {
+    HandlerFixture fx;
+    fx.command("IAt7E07E8");
+
+    // Room for the header only: the PDU is held, the next one waits on the bus
+    fx.transport.frameRoom = 7;
+    uint8_t sf[3] = { 0x02, 0x50, 0x03 };
+    fx.receive(sf, 3);
+    fx.receive(sf, 3);
+    TEST_ASSERT_EQUAL_STRING("Ir0002\r", fx.transport.output.c_str());
+    TEST_ASSERT_EQUAL(0, fx.transport.frameDrops);
+    TEST_ASSERT_EQUAL(IsoTpRxState::Complete, fx.handler.getLink().getRxState());
+
+    fx.transport.frameRoom = SIZE_MAX;
+    fx.handler.poll(&fx.transport);
+    fx.handler.poll(&fx.transport);
+    TEST_ASSERT_EQUAL_STRING("Ir0002\rId5003\rIr0002\rId5003\r", fx.transport.output.c_str());
+
+    // Errors are reported once room is available
+    fx.transport.output.clear();
+    fx.transport.frameRoom = 0;
+    uint8_t cf[8] = { 0x21 };
+    uint8_t ff[8] = { 0x10, 20 };
+    fx.receive(ff, 8);
+    fx.receive(cf, 8);
+    fx.receive(ff, 8);      // Replaces the unfinished PDU
+    fx.transport.frameRoom = SIZE_MAX;
+    fx.handler.poll(&fx.transport);
+    TEST_ASSERT_EQUAL_STRING("Ie08\r", fx.transport.output.c_str());
+}
+
+static void test_handler_receive_timeout_event() {
+    HandlerFixture fx;
+    fx.command("IAt7E07E8");
+    uint8_t ff[8] = { 0x10, 20 };
+    fx.receive(ff, 8);
+    shimAdvanceMicros(ISOTP_TIMEOUT_MS * 1000UL);
+    fx.handler.poll(&fx.transport);
+    TEST_ASSERT_EQUAL_STRING("Ie05\r", fx.transport.output.c_str());
+
+    uint32_t errors;
+    fx.handler.getCounters(nullptr, nullptr, &errors);
+    TEST_ASSERT_EQUAL(1, errors);
+    fx.handler.resetCounters();
+    fx.handler.getCounters(nullptr, nullptr, &errors);
+    TEST_ASSERT_EQUAL(0, errors);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_send_single_frame);
+    RUN_TEST(test_send_padding_and_queue_retry);
+    RUN_TEST(test_send_multi_frame_with_block_size);
+    RUN_TEST(test_send_sequence_number_wraps);
+    RUN_TEST(test_send_honours_stmin);
+    RUN_TEST(test_send_flow_control_errors);
+    RUN_TEST(test_staging_limits);
+    RUN_TEST(test_receive_single_frame_and_hold);
+    RUN_TEST(test_receive_multi_frame_with_block_size);
+    RUN_TEST(test_receive_flow_control_retry);
+    RUN_TEST(test_receive_errors);
+    RUN_TEST(test_handler_commands);
+    RUN_TEST(test_handler_send_reports_result);
+    RUN_TEST(test_handler_writes_received_pdu);
+    RUN_TEST(test_handler_output_backpressure);
+    RUN_TEST(test_handler_receive_timeout_event);
+    return UNITY_END();
+}
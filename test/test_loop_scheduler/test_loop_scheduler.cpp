@@ -0,0 +1,128 @@
+/**
+ * Main loop scheduler tests (native)
+ *
+ * Budgets are checked against the shim clock, which tests move forward
+ * with shimAdvanceMicros().
+ */
+
+#include <unity.h>
+#include "LoopScheduler.h"
+#include "MockCANBackend.h"
+#include <Arduino.h>
+
+static const uint16_t RX_MIN_US = SCHED_TICK_BUDGET_US * SCHED_RX_MIN_SHARE_PCT / 100;
+static const uint16_t RX_MAX_US = SCHED_TICK_BUDGET_US * SCHED_RX_MAX_SHARE_PCT / 100;
+
+static MockCANBackend* can;
+static FrameBus* bus;
+static LoopScheduler* scheduler;
+static uint8_t reader;
+
+void setUp() {
+    can = new MockCANBackend();
+    bus = new FrameBus();
+    scheduler = new LoopScheduler(*bus, *can);
+    reader = bus->attachReader();
+    bus->setReaderEnabled(reader, true);
+}
+
+void tearDown() {
+    delete scheduler;
+    delete bus;
+    delete can;
+}
+
+static void fillBus(uint16_t frames) {
+    for (uint16_t i = 0; i < frames; i++) {
+        can->pushRx(CANFrame());
+    }
+    bus->fill(*can);
+}
+
+static void test_empty_bus_gets_minimum_rx_share() {
+    scheduler->beginTick();
+    const SchedulerPolicy& p = scheduler->getPolicy();
+    TEST_ASSERT_EQUAL(RX_MIN_US, p.rxBudgetUs);
+    TEST_ASSERT_EQUAL(SCHED_TICK_BUDGET_US - RX_MIN_US, p.cmdBudgetUs);
+    TEST_ASSERT_FALSE(p.txPriority);
+}
+
+static void test_rx_share_grows_with_bus_level() {
+    fillBus(FrameBus::capacity() / 2);
+    scheduler->beginTick();
+    TEST_ASSERT_EQUAL(RX_MIN_US + (RX_MAX_US - RX_MIN_US) / 2, scheduler->getPolicy().rxBudgetUs);
+
+    fillBus(FrameBus::capacity());
+    scheduler->beginTick();
+    TEST_ASSERT_EQUAL(RX_MAX_US, scheduler->getPolicy().rxBudgetUs);
+    TEST_ASSERT_EQUAL(SCHED_TICK_BUDGET_US - RX_MAX_US, scheduler->getPolicy().cmdBudgetUs);
+
+    uint32_t boosts, txTicks, overruns;
+    scheduler->getCounters(&boosts, &txTicks, &overruns);
+    TEST_ASSERT_EQUAL(2, boosts);
+}
+
+static void test_command_budget_expires() {
+    scheduler->beginTick();
+    TEST_ASSERT_TRUE(scheduler->commandTimeLeft());
+    shimAdvanceMicros(scheduler->getPolicy().cmdBudgetUs);
+    TEST_ASSERT_FALSE(scheduler->commandTimeLeft());
+}
+
+static void test_idle_commands_hand_time_to_rx() {
+    scheduler->beginTick();
+    scheduler->beginForward();
+    // Nearly the whole tick is left for forwarding
+    TEST_ASSERT_TRUE(scheduler->getPolicy().rxBudgetUs > SCHED_TICK_BUDGET_US - 50);
+    TEST_ASSERT_TRUE(bus->forwardTimeLeft());
+    shimAdvanceMicros(SCHED_TICK_BUDGET_US);
+    TEST_ASSERT_FALSE(bus->forwardTimeLeft());
+}
+
+static void test_busy_commands_keep_rx_share() {
+    scheduler->beginTick();
+    shimAdvanceMicros(SCHED_TICK_BUDGET_US * 2);        // Commands overran the tick
+    scheduler->beginForward();
+    TEST_ASSERT_EQUAL(RX_MIN_US, scheduler->getPolicy().rxBudgetUs);
+    TEST_ASSERT_TRUE(bus->forwardTimeLeft());
+
+    scheduler->beginTick();
+    uint32_t boosts, txTicks, overruns;
+    scheduler->getCounters(&boosts, &txTicks, &overruns);
+    TEST_ASSERT_EQUAL(1, overruns);
+
+    scheduler->resetCounters();
+    scheduler->getCounters(&boosts, &txTicks, &overruns);
+    TEST_ASSERT_EQUAL(0, overruns);
+}
+
+static void test_tx_priority_near_full_queue() {
+    can->txQueueCapacity = 16;
+    can->txPending = 11;
+    scheduler->beginTick();
+    TEST_ASSERT_FALSE(scheduler->txPriority());
+
+    can->txPending = 12;                                 // 75 %
+    scheduler->beginTick();
+    TEST_ASSERT_TRUE(scheduler->txPriority());
+
+    can->txQueueCapacity = 0;                            // Backend without a queue
+    can->txPending = 0;
+    scheduler->beginTick();
+    TEST_ASSERT_FALSE(scheduler->txPriority());
+
+    uint32_t boosts, txTicks, overruns;
+    scheduler->getCounters(&boosts, &txTicks, &overruns);
+    TEST_ASSERT_EQUAL(1, txTicks);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_bus_gets_minimum_rx_share);
+    RUN_TEST(test_rx_share_grows_with_bus_level);
+    RUN_TEST(test_command_budget_expires);
+    RUN_TEST(test_idle_commands_hand_time_to_rx);
+    RUN_TEST(test_busy_commands_keep_rx_share);
+    RUN_TEST(test_tx_priority_near_full_queue);
+    return UNITY_END();
+}
@@ -0,0 +1,220 @@
+/**
+ * Serial transport tests (native)
+ *
+ * Line framing and output staging of SerialTransport over a mock Stream.
+ */
+
+#include <unity.h>
+#include "SerialTransport.h"
+#include "MockStream.h"
+#include <string>
+
+static MockStream* stream;
+static SerialTransport* transport;
+
+void setUp() {
+    stream = new MockStream();
+    transport = new SerialTransport(*stream);
+}
+
+void tearDown() {
+    delete transport;
+    delete stream;
+}
+
+static std::string nextLine() {
+    const char* line;
+    size_t len;
+    if (!transport->readLine(&line, &len)) {
+        return "<none>";
+    }
+    std::string s(line, len);
+    transport->releaseLine();
+    return s;
+}
+
+// =============================================================================
+// Input framing
+// =============================================================================
+
+static void test_lines_split_on_cr_and_lf() {
+    stream->feed("O\rt1230\nV\r\n");
+    TEST_ASSERT_EQUAL_STRING("O", nextLine().c_str());
+    TEST_ASSERT_EQUAL_STRING("t1230", nextLine().c_str());
+    TEST_ASSERT_EQUAL_STRING("V", nextLine().c_str());
+    TEST_ASSERT_EQUAL_STRING("<none>", nextLine().c_str());
+}
+
+static void test_partial_line_waits_for_terminator() {
+    stream->feed("t12");
+    TEST_ASSERT_EQUAL_STRING("<none>", nextLine().c_str());
+    stream->feed("30\r");
+    TEST_ASSERT_EQUAL_STRING("t1230", nextLine().c_str());
+}
+
+static void test_view_is_null_terminated_in_place() {
+    stream->feed("abc\rdef\r");
+    const char* line;
+    size_t len;
+    TEST_ASSERT_TRUE(transport->readLine(&line, &len));
+    TEST_ASSERT_EQUAL(3, len);
+    TEST_ASSERT_EQUAL_STRING("abc", line);
+    transport->releaseLine();
+    TEST_ASSERT_TRUE(transport->readLine(&line, &len));
+    TEST_ASSERT_EQUAL_STRING("def", line);
+}
+
+static void test_copying_read_line_truncates() {
+    stream->feed("0123456789\r");
+    char buf[5];
+    TEST_ASSERT_TRUE(transport->readLine(buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("0123", buf);
+}
+
+static void test_overlong_line_is_discarded() {
+    std::string big(SERIAL_RX_RING_SIZE + 40, 'x');
+    stream->feed(big.c_str());
+    stream->feed("\rV\r");
+
+    // The long line is dropped as it streams in; the next line survives
+    std::string line;
+    for (int i = 0; i < 4 && (line = nextLine()) == "<none>"; i++) {
+    }
+    TEST_ASSERT_EQUAL_STRING("V", line.c_str());
+
+    uint32_t drops, frameDrops, overflows;
+    transport->getCounters(&drops, &frameDrops, &overflows);
+    TEST_ASSERT_EQUAL(1, overflows);
+}
+
+static void test_many_lines_across_buffer_compaction() {
+    char cmd[16];
+    for (int round = 0; round < 50; round++) {
+        for (int i = 0; i < 20; i++) {
+            snprintf(cmd, sizeof(cmd), "t%03X0\r", (round * 20 + i) & 0x7FF);
+            stream->feed(cmd);
+        }
+        for (int i = 0; i < 20; i++) {
+            snprintf(cmd, sizeof(cmd), "t%03X0", (round * 20 + i) & 0x7FF);
+            TEST_ASSERT_EQUAL_STRING(cmd, nextLine().c_str());
+        }
+    }
+    TEST_ASSERT_TRUE(transport->getRxHighWaterMark() <= SERIAL_RX_RING_SIZE);
+}
+
+// =============================================================================
+// Output staging
+// =============================================================================
+
+static void test_writes_are_staged_until_flush() {
+    transport->writeWithPriority("t1230\r", 6, WritePriority::CAN_RX_FRAME);
+    transport->writeLine("z");
+    TEST_ASSERT_EQUAL(0, stream->output.size());
+    transport->flushBatch();
+    TEST_ASSERT_EQUAL_STRING("z\rt1230\r", stream->output.c_str());   // Response goes first
+}
+
+static void test_response_waits_for_record_boundary() {
+    stream->writeRoom = 8;
+    for (int i = 0; i < 3; i++) {
+        transport->writeWithPriority("t1230\r", 6, WritePriority::CAN_RX_FRAME);
+    }
+    transport->flushBatch();
+    TEST_ASSERT_EQUAL_STRING("t1230\r", stream->output.c_str());     // Whole records only
+
+    transport->writeLine("z");
+    transport->flushBatch();
+    TEST_ASSERT_EQUAL_STRING("t1230\rz\rt1230\r", stream->output.c_str());
+    transport->flushBatch();
+    TEST_ASSERT_EQUAL_STRING("t1230\rz\rt1230\rt1230\r", stream->output.c_str());
+
+    uint16_t resp, frames;
+    transport->getTxLevel(&resp, &frames);
+    TEST_ASSERT_EQUAL(0, resp);
+    TEST_ASSERT_EQUAL(0, frames);
+    TEST_ASSERT_EQUAL(18, transport->getTxHighWaterMark());
+}
+
+static void test_full_response_lane_refuses_without_waiting() {
+    stream->writeRoom = 1;
+    std::string big(SERIAL_TX_RESPONSE_SIZE, 'x');
+    TEST_ASSERT_TRUE(transport->writeWithPriority(big.data(), big.size(),
+                                                  WritePriority::COMMAND_RESPONSE));
+    TEST_ASSERT_EQUAL(0, transport->writeRoom(WritePriority::COMMAND_RESPONSE));
+
+    unsigned long start = millis();
+    TEST_ASSERT_FALSE(transport->writeWithPriority("z\r", 2, WritePriority::COMMAND_RESPONSE));
+    TEST_ASSERT_LESS_THAN(2, millis() - start);
+    TEST_ASSERT_EQUAL(1, transport->writeRoom(WritePriority::COMMAND_RESPONSE));  // One byte drained
+
+    uint32_t drops, frameDrops, overflows;
+    transport->getCounters(&drops, &frameDrops, &overflows);
+    TEST_ASSERT_EQUAL(1, drops);
+}
+
+static void test_partial_drain_keeps_order() {
+    stream->writeRoom = 4;
+    transport->writeRaw("0123456789", 10);
+    transport->flushBatch();
+    TEST_ASSERT_EQUAL_STRING("0123", stream->output.c_str());
+    transport->flushBatch();
+    transport->flushBatch();
+    TEST_ASSERT_EQUAL_STRING("0123456789", stream->output.c_str());
+}
+
+static void test_frames_drop_when_link_is_busy() {
+    stream->writeRoom = 1;
+    const char frame[] = "t1230\r";
+    int accepted = 0;
+    while (transport->writeWithPriority(frame, 6, WritePriority::CAN_RX_FRAME)) {
+        accepted++;
+    }
+    int expected = SERIAL_TX_BATCH_SIZE / 6;
+    if (expected > SERIAL_TX_FRAME_SLOTS) {
+        expected = SERIAL_TX_FRAME_SLOTS;       // Out of record slots first
+    }
+    TEST_ASSERT_EQUAL(expected, accepted);
+    TEST_ASSERT_TRUE(transport->writeRoom(WritePriority::CAN_RX_FRAME) < 6);
+
+    uint32_t drops, frameDrops, overflows;
+    transport->getCounters(&drops, &frameDrops, &overflows);
+    TEST_ASSERT_EQUAL(1, frameDrops);
+
+    transport->resetCounters();
+    transport->getCounters(&drops, &frameDrops, &overflows);
+    TEST_ASSERT_EQUAL(0, frameDrops);
+}
+
+static void test_host_presence_gates_frames() {
+    // Other streams always count as connected
+    TEST_ASSERT_TRUE(transport->isConnected());
+
+    // On Serial, no host (DTR low) leaves no room for RX records
+    SerialTransport usb(Serial);
+    usb.begin(115200);
+    Serial.connected = false;
+    TEST_ASSERT_FALSE(usb.isConnected());
+    TEST_ASSERT_EQUAL(0, usb.writeRoom(WritePriority::CAN_RX_FRAME));
+    TEST_ASSERT_TRUE(usb.writeRoom(WritePriority::COMMAND_RESPONSE) > 0);
+
+    Serial.connected = true;
+    TEST_ASSERT_TRUE(usb.isConnected());
+    TEST_ASSERT_TRUE(usb.writeRoom(WritePriority::CAN_RX_FRAME) > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_lines_split_on_cr_and_lf);
+    RUN_TEST(test_partial_line_waits_for_terminator);
+    RUN_TEST(test_view_is_null_terminated_in_place);
+    RUN_TEST(test_copying_read_line_truncates);
+    RUN_TEST(test_overlong_line_is_discarded);
+    RUN_TEST(test_many_lines_across_buffer_compaction);
+    RUN_TEST(test_writes_are_staged_until_flush);
+    RUN_TEST(test_response_waits_for_record_boundary);
+    RUN_TEST(test_full_response_lane_refuses_without_waiting);
+    RUN_TEST(test_partial_drain_keeps_order);
+    RUN_TEST(test_frames_drop_when_link_is_busy);
+    RUN_TEST(test_host_presence_gates_frames);
+    return UNITY_END();
+}
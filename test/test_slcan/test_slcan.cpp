@@ -0,0 +1,1038 @@
+/**
+ * SLCAN protocol handler tests (native)
+ *
+ * Command parsing, frame formatting and RX forwarding against a mock
+ * CAN backend and transport.
+ */
+
+#include <unity.h>
+#include "SLCAN.h"
+#include "ProtocolDispatcher.h"
+#include "MockCANBackend.h"
+#include "MockTransport.h"
+#include <Arduino.h>
+#include <stdio.h>
+#include <vector>
+
+static MockCANBackend* can;
+static SLCAN* slcan;
+static char response[RESPONSE_BUFFER_SIZE];
+
+void setUp() {
+    can = new MockCANBackend();
+    slcan = new SLCAN(*can);
+}
+
+void tearDown() {
+    delete slcan;
+    delete can;
+}
+
+static const char* command(const char* cmd) {
+    response[0] = '\0';
+    slcan->processCommand(cmd, response, sizeof(response));
+    return response;
+}
+
+static CANFrame makeFrame(uint32_t id, bool extended, uint8_t dlc) {
+    CANFrame f;
+    f.id = id;
+    f.extended = extended;
+    f.dlc = dlc;
+    for (uint8_t i = 0; i < 8; i++) {
+        f.data[i] = (uint8_t)(0x11 * (i + 1));
+    }
+    f.timestamp = 0x12345678;
+    return f;
+}
+
+// =============================================================================
+// Channel state
+// =============================================================================
+
+static void test_open_close() {
+    TEST_ASSERT_EQUAL_STRING("", command("S6"));
+    TEST_ASSERT_EQUAL_STRING("", command("O"));
+    TEST_ASSERT_TRUE(can->isOpen());
+    TEST_ASSERT_EQUAL(SLCANState::Open, slcan->getState());
+    TEST_ASSERT_EQUAL_STRING("\x07", command("O"));     // Already open
+    TEST_ASSERT_EQUAL_STRING("\x07", command("S4"));    // Can't reconfigure while open
+    TEST_ASSERT_EQUAL_STRING("", command("C"));
+    TEST_ASSERT_FALSE(can->isOpen());
+}
+
+static void test_listen_only() {
+    TEST_ASSERT_EQUAL_STRING("", command("L"));
+    TEST_ASSERT_EQUAL(CANMode::ListenOnly, can->getMode());
+    TEST_ASSERT_EQUAL_STRING("\x07", command("t1230"));
+}
+
+static void test_unsupported_bitrate() {
+    TEST_ASSERT_EQUAL_STRING("\x07", command("S0"));
+    TEST_ASSERT_EQUAL_STRING("\x07", command("S9"));
+    TEST_ASSERT_EQUAL_STRING("\x07", command("S"));
+}
+
+// =============================================================================
+// Transmit parsing
+// =============================================================================
+
+static void test_transmit_standard() {
+    command("O");
+    TEST_ASSERT_EQUAL_STRING("z", command("t1232AABB"));
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());
+    const CANFrame& f = can->txFrames[0];
+    TEST_ASSERT_EQUAL_HEX32(0x123, f.id);
+    TEST_ASSERT_FALSE(f.extended);
+    TEST_ASSERT_FALSE(f.rtr);
+    TEST_ASSERT_EQUAL(2, f.dlc);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, f.data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xBB, f.data[1]);
+}
+
+static void test_transmit_extended_and_rtr() {
+    command("O");
+    TEST_ASSERT_EQUAL_STRING("Z", command("T1ABCDEF08"
+                                          "0102030405060708"));
+    TEST_ASSERT_EQUAL_STRING("z", command("r7FF3"));
+    TEST_ASSERT_EQUAL_STRING("Z", command("R000000010"));
+    TEST_ASSERT_EQUAL(3, can->txFrames.size());
+    TEST_ASSERT_EQUAL_HEX32(0x1ABCDEF0, can->txFrames[0].id);
+    TEST_ASSERT_TRUE(can->txFrames[0].extended);
+    TEST_ASSERT_EQUAL_HEX8(0x08, can->txFrames[0].data[7]);
+    TEST_ASSERT_TRUE(can->txFrames[1].rtr);
+    TEST_ASSERT_EQUAL(3, can->txFrames[1].dlc);
+    TEST_ASSERT_TRUE(can->txFrames[2].rtr);
+    TEST_ASSERT_TRUE(can->txFrames[2].extended);
+}
+
+static void test_transmit_lowercase_hex() {
+    command("O");
+    TEST_ASSERT_EQUAL_STRING("z", command("t7ff1ab"));
+    TEST_ASSERT_EQUAL_HEX32(0x7FF, can->txFrames[0].id);
+    TEST_ASSERT_EQUAL_HEX8(0xAB, can->txFrames[0].data[0]);
+}
+
+static void test_transmit_rejects_malformed() {
+    command("O");
+    const char* bad[] = {
+        "t12",          // Short ID
+        "t12G1",        // Bad hex in ID
+        "t8001",        // Standard ID out of range
+        "t1239",        // DLC > 8
+        "t1232AA",      // Missing data byte
+        "t1232AAG0",    // Bad hex in data
+        "T2000000000",  // Extended ID out of range
+        "t123",         // Missing DLC
+    };
+    for (const char* cmd : bad) {
+        TEST_ASSERT_EQUAL_STRING_MESSAGE("\x07", command(cmd), cmd);
+    }
+    TEST_ASSERT_EQUAL(0, can->txFrames.size());
+}
+
+static void test_transmit_needs_open_channel() {
+    TEST_ASSERT_EQUAL_STRING("\x07", command("t1230"));
+    TEST_ASSERT_EQUAL(0, can->txFrames.size());
+}
+
+static void test_transmit_backend_full() {
+    command("O");
+    can->txCapacity = 0;
+    TEST_ASSERT_EQUAL_STRING("\x07", command("t1230"));
+}
+
+static void test_quiet_tx() {
+    command("O");
+    TEST_ASSERT_EQUAL_STRING("", command("q1"));
+    TEST_ASSERT_FALSE(slcan->processCommand("t1230", response, sizeof(response)));
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());
+    TEST_ASSERT_EQUAL_STRING("\x07", command("t12"));   // Errors are still reported
+    command("q0");
+    TEST_ASSERT_EQUAL_STRING("z", command("t1230"));
+}
+
+static void test_batch_transmit() {
+    command("O");
+    TEST_ASSERT_EQUAL_STRING("b03", command("bt1232AABBT123456780r7FF0"));
+    TEST_ASSERT_EQUAL(3, can->txFrames.size());
+    TEST_ASSERT_TRUE(can->txFrames[1].extended);
+    TEST_ASSERT_TRUE(can->txFrames[2].rtr);
+
+    // A malformed frame rejects the whole batch
+    TEST_ASSERT_EQUAL_STRING("\x07", command("bt1230t12"));
+    TEST_ASSERT_EQUAL(3, can->txFrames.size());
+    TEST_ASSERT_EQUAL_STRING("\x07", command("b"));
+}
+
+// =============================================================================
+// Formatting
+// =============================================================================
+
+static void test_format_standard() {
+    char buf[SLCAN_MAX_EXT_FRAME_LEN];
+    size_t len = slcan->formatFrame(makeFrame(0x123, false, 2), buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("t12321122", buf);
+    TEST_ASSERT_EQUAL(9, len);
+}
+
+static void test_format_extended() {
+    char buf[SLCAN_MAX_EXT_FRAME_LEN];
+    slcan->formatFrame(makeFrame(0x1ABCDEF0, true, 8), buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("T1ABCDEF081122334455667788", buf);
+}
+
+static void test_format_rtr_has_no_data() {
+    char buf[SLCAN_MAX_EXT_FRAME_LEN];
+    CANFrame f = makeFrame(0x7FF, false, 4);
+    f.rtr = true;
+    slcan->formatFrame(f, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("r7FF4", buf);
+    f.extended = true;
+    f.id = 0x1;
+    slcan->formatFrame(f, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("R000000014", buf);
+}
+
+static void test_format_timestamps() {
+    char buf[SLCAN_MAX_EXT_FRAME_LEN];
+    CANFrame f = makeFrame(0x123, false, 1);
+
+    command("Z1");  // 16-bit milliseconds
+    slcan->formatFrame(f, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("t123111" "A90B", buf);  // (0x12345678 / 1000) & 0xFFFF
+
+    command("Z2");  // 32-bit microseconds
+    slcan->formatFrame(f, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("t123111" "12345678", buf);
+
+    command("Z0");
+    slcan->formatFrame(f, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("t123111", buf);
+}
+
+static void test_format_tx_echo_prefix() {
+    char buf[SLCAN_MAX_EXT_FRAME_LEN];
+    CANFrame f = makeFrame(0x100, false, 0);
+    f.echo = true;
+    slcan->formatFrame(f, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("et1000", buf);
+}
+
+static void test_format_buffer_too_small() {
+    char buf[8];
+    TEST_ASSERT_EQUAL(0, slcan->formatFrame(makeFrame(0x123, false, 8), buf, sizeof(buf)));
+}
+
+static void test_format_parse_round_trip() {
+    command("O");
+    char buf[SLCAN_MAX_EXT_FRAME_LEN];
+    uint32_t seed = 1;
+    for (int i = 0; i < 2000; i++) {
+        seed = seed * 1103515245UL + 12345UL;
+        CANFrame f = makeFrame(0, (seed >> 8) & 1, (seed >> 9) % 9);
+        f.rtr = (seed >> 13) & 1;
+        f.id = f.extended ? (seed & 0x1FFFFFFF) : ((seed >> 3) & 0x7FF);
+        f.data[0] = (uint8_t)(seed >> 16);
+
+        slcan->formatFrame(f, buf, sizeof(buf));
+        slcan->processCommand(buf, response, sizeof(response));
+
+        const CANFrame& sent = can->txFrames.back();
+        TEST_ASSERT_EQUAL_HEX32(f.id, sent.id);
+        TEST_ASSERT_EQUAL(f.extended, sent.extended);
+        TEST_ASSERT_EQUAL(f.rtr, sent.rtr);
+        TEST_ASSERT_EQUAL(f.dlc, sent.dlc);
+        if (!f.rtr) {
+            TEST_ASSERT_EQUAL_MEMORY(f.data, sent.data, f.dlc);
+        }
+    }
+}
+
+// =============================================================================
+// Status and misc commands
+// =============================================================================
+
+static void test_status_flags() {
+    command("O");
+    can->status.rxFifoFull = true;
+    can->status.busError = true;
+    TEST_ASSERT_EQUAL_STRING("F81", command("F"));
+    TEST_ASSERT_EQUAL_STRING("F00", command("F"));      // Flags clear on read
+}
+
+static void test_tx_echo_command() {
+    TEST_ASSERT_EQUAL_STRING("", command("e1"));
+    TEST_ASSERT_TRUE(can->txEcho);
+    TEST_ASSERT_EQUAL_STRING("", command("e0"));
+    TEST_ASSERT_FALSE(can->txEcho);
+    TEST_ASSERT_EQUAL_STRING("\x07", command("e2"));
+}
+
+static void test_unknown_command() {
+    TEST_ASSERT_EQUAL_STRING("\x07", command("K"));
+}
+
+static void test_routes_match_process_command() {
+    ProtocolDispatcher dispatcher;
+    dispatcher.registerHandler(slcan);
+
+    // Every routed byte is one canHandle() accepts, and vice versa
+    uint16_t handled = 0;
+    char probe[2] = { 0, '\0' };
+    for (unsigned c = 1; c < 256; c++) {
+        probe[0] = (char)c;
+        if (slcan->canHandle(probe)) {
+            handled++;
+        }
+    }
+    TEST_ASSERT_EQUAL(handled, dispatcher.getRouteCount());
+
+    // The routed path gives the same answers as processCommand()
+    const char* cmds[] = { "V", "N", "F", "s", "K", "S9", "t1230", "Z9" };
+    for (const char* cmd : cmds) {
+        char routed[32];
+        char direct[32];
+        bool r = dispatcher.dispatch(cmd, routed, sizeof(routed));
+        bool d = slcan->processCommand(cmd, direct, sizeof(direct));
+        TEST_ASSERT_EQUAL(d, r);
+        TEST_ASSERT_EQUAL_STRING(direct, routed);
+    }
+}
+
+// =============================================================================
+// Loopback and traffic generator
+// =============================================================================
+
+static void test_loopback_open() {
+    TEST_ASSERT_EQUAL_STRING("", command("l"));
+    TEST_ASSERT_EQUAL(CANMode::Loopback, can->getMode());
+    TEST_ASSERT_EQUAL(SLCANState::Loopback, slcan->getState());
+    TEST_ASSERT_EQUAL_STRING("z", command("t1230"));    // Loopback transmits
+    TEST_ASSERT_EQUAL(1, can->rxQueue.size());
+    TEST_ASSERT_EQUAL_STRING("\x07", command("l"));     // Already open
+}
+
+static void test_generator_config_errors() {
+    const char* bad[] = {
+        "gs1001FF9",            // DLC > 8
+        "gs1FF1008",            // first > last
+        "gs1008008",            // Standard ID out of range
+        "gs1001FF",             // Missing DLC
+        "ge000000012000000008", // Extended ID out of range
+        "g1",                   // Channel closed
+        "g2",
+        "g0x",
+    };
+    for (const char* cmd : bad) {
+        TEST_ASSERT_EQUAL_STRING_MESSAGE("\x07", command(cmd), cmd);
+    }
+    command("O");
+    TEST_ASSERT_EQUAL_STRING("\x07", command("g1123"));  // Count must be 8 digits
+}
+
+static void test_generator_fills_tx_queue() {
+    command("O");
+    TEST_ASSERT_EQUAL_STRING("", command("gs1201228"));
+    TEST_ASSERT_EQUAL_STRING("", command("g1"));
+    can->txCapacity = TRAFFIC_GEN_MAX_PER_POLL + 4;
+
+    MockTransport transport;
+    slcan->poll(&transport);
+    TEST_ASSERT_EQUAL(TRAFFIC_GEN_MAX_PER_POLL, can->txFrames.size());
+    slcan->poll(&transport);                             // Queue full after 4 more
+    TEST_ASSERT_EQUAL(TRAFFIC_GEN_MAX_PER_POLL + 4, can->txFrames.size());
+
+    // IDs step through the range and wrap, data is the sequence number
+    TEST_ASSERT_EQUAL_HEX32(0x120, can->txFrames[0].id);
+    TEST_ASSERT_EQUAL_HEX32(0x122, can->txFrames[2].id);
+    TEST_ASSERT_EQUAL_HEX32(0x120, can->txFrames[3].id);
+    TEST_ASSERT_EQUAL(8, can->txFrames[5].dlc);
+    TEST_ASSERT_EQUAL_HEX8(5, can->txFrames[5].data[0]);
+    TEST_ASSERT_EQUAL_HEX8(5, can->txFrames[5].data[4]);
+
+    char expect[32];
+    snprintf(expect, sizeof(expect), "g1%08X00000001", TRAFFIC_GEN_MAX_PER_POLL + 4);
+    TEST_ASSERT_EQUAL_STRING(expect, command("g"));
+
+    uint32_t queued, rejects;
+    slcan->getGeneratorCounters(&queued, &rejects);
+    TEST_ASSERT_EQUAL(TRAFFIC_GEN_MAX_PER_POLL + 4, queued);
+    TEST_ASSERT_EQUAL(1, rejects);
+
+    command("C");                                       // Close stops the generator
+    TEST_ASSERT_EQUAL('0', command("g")[1]);
+}
+
+static void test_generator_count_and_dlc_mix() {
+    command("O");
+    command("ge1000000010000000M");
+    TEST_ASSERT_EQUAL_STRING("", command("g10000000A"));
+
+    MockTransport transport;
+    slcan->poll(&transport);
+    TEST_ASSERT_EQUAL(10, can->txFrames.size());
+    TEST_ASSERT_TRUE(can->txFrames[0].extended);
+    TEST_ASSERT_EQUAL(0, can->txFrames[0].dlc);
+    TEST_ASSERT_EQUAL(8, can->txFrames[8].dlc);
+    TEST_ASSERT_EQUAL(0, can->txFrames[9].dlc);
+    TEST_ASSERT_EQUAL('0', command("g")[1]);            // Done after the count
+}
+
+static void test_loopback_generator_round_trip() {
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+
+    dispatcher.dispatch("l", response, sizeof(response));
+    dispatcher.dispatch("gs7FF7FF0", response, sizeof(response));
+    dispatcher.dispatch("g100000002", response, sizeof(response));
+
+    dispatcher.pollAll(&transport);     // Generate (into the loopback RX queue)
+    dispatcher.pollAll(&transport);     // Forward
+    TEST_ASSERT_EQUAL_STRING("t7FF0\rt7FF0\r", transport.output.c_str());
+}
+
+// =============================================================================
+// RX forwarding through the dispatcher
+// =============================================================================
+
+static void test_poll_forwards_frames() {
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+
+    dispatcher.dispatch("O", response, sizeof(response));
+    can->pushRx(makeFrame(0x123, false, 1));
+    can->pushRx(makeFrame(0x456, false, 0));
+    dispatcher.pollAll(&transport);
+
+    TEST_ASSERT_EQUAL_STRING("t123111\rt4560\r", transport.output.c_str());
+    TEST_ASSERT_TRUE(can->serviceCalls > 0);
+}
+
+static void test_poll_closed_channel_forwards_nothing() {
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+
+    can->pushRx(makeFrame(0x123, false, 1));
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("", transport.output.c_str());
+}
+
+static void test_poll_budget_and_backpressure() {
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+    dispatcher.dispatch("O", response, sizeof(response));
+
+    const int frames = 30;
+    for (int i = 0; i < frames; i++) {
+        can->pushRx(makeFrame(0x100, false, 0));
+    }
+
+    // Spent forward budget: still one frame per poll
+    dispatcher.getFrameBus().setForwardBudget(1);
+    shimAdvanceMicros(10);
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL(6, transport.output.size());      // "t1000\r"
+
+    // No budget limit: everything pending goes out
+    dispatcher.getFrameBus().setForwardBudget(0);
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL(frames * 6, transport.output.size());
+
+    for (int i = 0; i < 5; i++) {
+        can->pushRx(makeFrame(0x100, false, 0));
+    }
+
+    // Link full: the frame stays on the bus and is counted as a drop
+    transport.frameRoom = 0;
+    dispatcher.pollAll(&transport);
+    uint32_t rxOverflows, canRxDrops;
+    slcan->getCounters(&rxOverflows, &canRxDrops);
+    TEST_ASSERT_EQUAL(1, canRxDrops);
+
+    transport.frameRoom = SIZE_MAX;
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL((frames + 5) * 6, transport.output.size());
+}
+
+static void test_poll_holds_frames_until_host_connects() {
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+    dispatcher.dispatch("O", response, sizeof(response));
+
+    // Opened at boot with nobody listening: frames wait, no drops counted
+    transport.connected = false;
+    for (int i = 0; i < 3; i++) {
+        can->pushRx(makeFrame(0x100 + i, false, 0));
+    }
+    dispatcher.pollAll(&transport);
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("", transport.output.c_str());
+    TEST_ASSERT_EQUAL(3, dispatcher.getFrameBus().pending(0));
+    uint32_t rxOverflows, canRxDrops;
+    slcan->getCounters(&rxOverflows, &canRxDrops);
+    TEST_ASSERT_EQUAL(0, canRxDrops);
+
+    // Host connects: the start of the capture comes out in order
+    transport.connected = true;
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("t1000\rt1010\rt1020\r", transport.output.c_str());
+}
+
+static void test_poll_one_frame() {
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+
+    TEST_ASSERT_EQUAL_STRING("\a", command("P"));        // Closed
+    TEST_ASSERT_EQUAL_STRING("", command("X0"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("X2"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("X"));
+    dispatcher.dispatch("O", response, sizeof(response));
+
+    // X0: frames wait on the bus until polled
+    can->pushRx(makeFrame(0x100, false, 1));
+    can->pushRx(makeFrame(0x12345678, true, 2));
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("", transport.output.c_str());
+    TEST_ASSERT_EQUAL(2, dispatcher.getFrameBus().pending(0));
+    TEST_ASSERT_EQUAL_STRING("t100111", command("P"));
+    TEST_ASSERT_EQUAL(1, dispatcher.getFrameBus().pending(0));
+    TEST_ASSERT_EQUAL_STRING("T1234567821122", command("P"));
+    TEST_ASSERT_EQUAL_STRING("", command("P"));         // Nothing pending
+    TEST_ASSERT_EQUAL_STRING("\a", command("P1"));
+
+    // X1: P is refused and pending frames are forwarded again
+    can->pushRx(makeFrame(0x200, false, 0));
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("", command("X1"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("P"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("A"));
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("t2000\r", transport.output.c_str());
+}
+
+static void test_poll_all_in_one_write() {
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+    command("X0");
+    dispatcher.dispatch("O", response, sizeof(response));
+
+    // Nothing pending: just the terminator, and no response line of its own
+    TEST_ASSERT_FALSE(dispatcher.dispatch("A", response, sizeof(response)));
+    TEST_ASSERT_EQUAL_STRING("\a", command("A"));      // Readout running
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("A\r", transport.output.c_str());
+    TEST_ASSERT_EQUAL_STRING("", command("P"));
+
+    // Three frames: one write with every line and the terminator
+    for (int i = 0; i < 3; i++) {
+        can->pushRx(makeFrame(0x100 + i, false, 0));
+    }
+    dispatcher.pollAll(&transport);
+    transport.output.clear();
+    command("A");
+    can->pushRx(makeFrame(0x300, false, 0));        // Arrives after A: kept for later
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("t1000\rt1010\rt1020\rA\r", transport.output.c_str());
+    TEST_ASSERT_EQUAL_STRING("t3000", command("P"));
+}
+
+static void test_poll_all_waits_for_link() {
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+    command("X0");
+    dispatcher.dispatch("O", response, sizeof(response));
+
+    const int count = 40;   // More than one chunk
+    for (int i = 0; i < count; i++) {
+        can->pushRx(makeFrame(0x100 + i, true, 8));
+    }
+    dispatcher.pollAll(&transport);
+    command("A");
+
+    // Link full: nothing is taken off the bus, nothing is lost
+    transport.frameRoom = 0;
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("", transport.output.c_str());
+    TEST_ASSERT_EQUAL(count, dispatcher.getFrameBus().pending(0));
+
+    transport.frameRoom = 200;
+    dispatcher.pollAll(&transport);
+    uint16_t left = dispatcher.getFrameBus().pending(0);
+    TEST_ASSERT_TRUE(left > 0 && left < count);
+    TEST_ASSERT_EQUAL((count - left) * strlen("T0000010081122334455667788\r"), transport.output.size());
+    transport.frameRoom = SIZE_MAX;
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL(0, dispatcher.getFrameBus().pending(0));
+    TEST_ASSERT_EQUAL(0, transport.frameDrops);
+
+    std::string expected;
+    char line[64];
+    for (int i = 0; i < count; i++) {
+        snprintf(line, sizeof(line), "T%08X81122334455667788\r", 0x100 + i);
+        expected += line;
+    }
+    expected += "A\r";
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), transport.output.c_str());
+}
+
+static void test_change_only_command() {
+    TEST_ASSERT_EQUAL_STRING("u000000000000000000000", command("u"));
+    TEST_ASSERT_EQUAL_STRING("", command("u103E8"));
+    TEST_ASSERT_EQUAL_STRING("u103E80000000000000000", command("u"));
+    TEST_ASSERT_EQUAL_STRING("", command("u0"));
+    TEST_ASSERT_EQUAL_STRING("u000000000000000000000", command("u"));
+
+    TEST_ASSERT_EQUAL_STRING("\a", command("u2"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("u01"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("u1100"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("u1XYZW"));
+}
+
+static void test_change_only_suppresses_repeats() {
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+    dispatcher.dispatch("O", response, sizeof(response));
+    dispatcher.dispatch("u1", response, sizeof(response));
+
+    CANFrame changed = makeFrame(0x123, false, 1);
+    changed.data[0] = 0x99;
+    CANFrame shorter = makeFrame(0x123, false, 0);
+    can->pushRx(makeFrame(0x123, false, 1));
+    can->pushRx(makeFrame(0x123, false, 1));        // Repeat: suppressed
+    can->pushRx(changed);
+    can->pushRx(shorter);                           // DLC change counts as a change
+    can->pushRx(makeFrame(0x12345678, true, 2));
+    can->pushRx(makeFrame(0x12345678, true, 2));    // Repeat: suppressed
+    CANFrame rtr = makeFrame(0x123, false, 0);
+    rtr.rtr = true;
+    can->pushRx(rtr);
+    can->pushRx(rtr);                               // Remote frames always pass
+    dispatcher.pollAll(&transport);
+
+    TEST_ASSERT_EQUAL_STRING("t123111\rt123199\rt1230\rT1234567821122\rr1230\rr1230\r",
+                             transport.output.c_str());
+    uint32_t suppressed, untracked;
+    slcan->getChangeFilterCounters(&suppressed, &untracked);
+    TEST_ASSERT_EQUAL(2, suppressed);
+    TEST_ASSERT_EQUAL(0, untracked);
+
+    // Off: every frame is forwarded again
+    transport.output.clear();
+    dispatcher.dispatch("u0", response, sizeof(response));
+    can->pushRx(shorter);
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("t1230\r", transport.output.c_str());
+}
+
+static void test_change_only_keep_alive_and_refused_writes() {
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+    dispatcher.dispatch("O", response, sizeof(response));
+    dispatcher.dispatch("u10064", response, sizeof(response));     // 100 ms keep-alive
+
+    // A frame the transport refuses is not remembered
+    CANFrame f = makeFrame(0x200, false, 1);
+    f.timestamp = 1000;
+    can->pushRx(f);
+    transport.frameRoom = 0;
+    dispatcher.pollAll(&transport);
+    transport.frameRoom = SIZE_MAX;
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("t200111\r", transport.output.c_str());
+
+    // Unchanged: suppressed until 100 ms after the last forwarded copy
+    f.timestamp = 1000 + 99999;
+    can->pushRx(f);
+    f.timestamp = 1000 + 100000;
+    can->pushRx(f);
+    f.timestamp = 1000 + 150000;
+    can->pushRx(f);
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("t200111\rt200111\r", transport.output.c_str());
+
+    // Closing the channel clears the cache
+    transport.output.clear();
+    dispatcher.dispatch("C", response, sizeof(response));
+    dispatcher.dispatch("O", response, sizeof(response));
+    can->pushRx(f);
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("t200111\r", transport.output.c_str());
+}
+
+static void test_change_only_full_cache_forwards() {
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+    dispatcher.dispatch("O", response, sizeof(response));
+    dispatcher.dispatch("u1", response, sizeof(response));
+
+    // Fill every extended slot, then repeat one more ID than fits
+    const uint32_t ids = CHANGE_CACHE_EXT_SLOTS + 1;
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t i = 0; i < ids; i++) {
+            can->pushRx(makeFrame(0x1000 + i * 0x1111, true, 0));
+        }
+        dispatcher.pollAll(&transport);
+    }
+
+    uint32_t suppressed, untracked;
+    slcan->getChangeFilterCounters(&suppressed, &untracked);
+    TEST_ASSERT_EQUAL(CHANGE_CACHE_EXT_SLOTS, suppressed);
+    TEST_ASSERT_EQUAL(2, untracked);
+    TEST_ASSERT_EQUAL((ids + 1) * 11, transport.output.size());   // "T000010000\r"
+
+    slcan->resetCounters();
+    slcan->getChangeFilterCounters(&suppressed, &untracked);
+    TEST_ASSERT_EQUAL(0, suppressed);
+    TEST_ASSERT_EQUAL(0, untracked);
+}
+
+static void test_decimate_command() {
+    // Rules live on the frame bus: needs the dispatcher
+    TEST_ASSERT_EQUAL_STRING("\a", command("d"));
+
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+    TEST_ASSERT_EQUAL_STRING("d0000000000", command("d"));
+    TEST_ASSERT_EQUAL_STRING("", command("d+N03S100"));
+    TEST_ASSERT_EQUAL_STRING("", command("d+H0064E10000000100000FF"));
+    TEST_ASSERT_EQUAL_STRING("", command("d+N02M1800000000FFFF00"));
+    TEST_ASSERT_EQUAL_STRING("d0300000000", command("d"));
+
+    TEST_ASSERT_EQUAL_STRING("\a", command("d+N01S100"));      // 1 in 1 is no decimation
+    TEST_ASSERT_EQUAL_STRING("\a", command("d+X03S100"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("d+N03"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("d+N03S8000"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("d-S200"));
+    TEST_ASSERT_EQUAL_STRING("", command("d-E10000000100000FF"));
+
+    // 1 in 3 of 0x100 reaches the host
+    dispatcher.dispatch("O", response, sizeof(response));
+    for (int i = 0; i < 6; i++) {
+        can->pushRx(makeFrame(0x100, false, 0));
+    }
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("t1000\rt1000\r", transport.output.c_str());
+    TEST_ASSERT_EQUAL_STRING("d0200000004", command("d"));
+
+    TEST_ASSERT_EQUAL_STRING("", command("dC"));
+    TEST_ASSERT_EQUAL_STRING("d0000000004", command("d"));
+}
+
+static void test_overflow_command() {
+    TEST_ASSERT_EQUAL_STRING("\a", command("o"));
+
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+    TEST_ASSERT_EQUAL_STRING("o0000000000000000000", command("o"));
+    TEST_ASSERT_EQUAL_STRING("", command("o2"));
+    TEST_ASSERT_EQUAL_STRING("", command("o+S7DF"));
+    TEST_ASSERT_EQUAL_STRING("", command("o+E18DA00F118DAFFF1"));
+    TEST_ASSERT_EQUAL_STRING("o2020000000000000000", command("o"));
+    TEST_ASSERT_EQUAL(OverflowPolicy::DropOldest, dispatcher.getFrameBus().getOverflowPolicy());
+
+    TEST_ASSERT_EQUAL_STRING("\a", command("o3"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("o10"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("o+"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("o-S123"));
+    TEST_ASSERT_EQUAL_STRING("", command("o-E18DA00F118DAFFF1"));
+
+    // Priority frame overtakes the frames queued ahead of it
+    dispatcher.dispatch("O", response, sizeof(response));
+    can->pushRx(makeFrame(0x100, false, 0));
+    can->pushRx(makeFrame(0x7DF, false, 0));
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("t7DF0\rt1000\r", transport.output.c_str());
+
+    TEST_ASSERT_EQUAL_STRING("", command("oC"));
+    TEST_ASSERT_EQUAL_STRING("", command("o0"));
+    TEST_ASSERT_EQUAL_STRING("o0000000000000000000", command("o"));
+}
+
+// =============================================================================
+// Cyclic transmit table
+// =============================================================================
+
+static void test_capture_command_and_readout() {
+    TEST_ASSERT_EQUAL_STRING("\a", command("G"));
+
+    ProtocolDispatcher dispatcher;
+    MockTransport transport;
+    dispatcher.setFrameSource(can);
+    dispatcher.registerHandler(slcan);
+    TEST_ASSERT_EQUAL_STRING("G000000000", command("G"));
+    TEST_ASSERT_EQUAL_STRING("", command("GW00010001"));
+    TEST_ASSERT_EQUAL_STRING("", command("GTS200"));
+    TEST_ASSERT_EQUAL_STRING("", command("GD00000000000000000000000000000000"));
+    TEST_ASSERT_EQUAL_STRING("", command("GE1"));
+    TEST_ASSERT_EQUAL_STRING("", command("GE0"));
+    TEST_ASSERT_EQUAL_STRING("", command("GT"));
+    TEST_ASSERT_EQUAL_STRING("", command("GTS200"));
+
+    TEST_ASSERT_EQUAL_STRING("\a", command("GW0100"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("GWFFFF0001"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("GTS800"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("GD0011"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("GE2"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("GF"));     // Not armed
+    TEST_ASSERT_EQUAL_STRING("\a", command("GR"));     // Nothing captured
+    TEST_ASSERT_EQUAL_STRING("\a", command("GQ"));
+
+    // Arm, trigger on 0x200: one frame before it, one after
+    dispatcher.dispatch("O", response, sizeof(response));
+    TEST_ASSERT_EQUAL_STRING("", command("GA"));
+    TEST_ASSERT_EQUAL_STRING("G100000000", command("G"));
+    can->pushRx(makeFrame(0x100, false, 0));
+    can->pushRx(makeFrame(0x101, false, 1));
+    can->pushRx(makeFrame(0x200, false, 2));
+    CANFrame echo = makeFrame(0x1ABCDEF0, true, 1);
+    echo.echo = true;
+    can->pushRx(echo);
+    can->pushRx(makeFrame(0x300, false, 0));
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("G300030001", command("G"));
+    transport.output.clear();
+
+    // Readout: header, then every frame with a 28-bit us timestamp;
+    // live lines wait, and a busy link skips nothing
+    TEST_ASSERT_EQUAL_STRING("", command("GR"));
+    can->pushRx(makeFrame(0x400, false, 0));
+    transport.frameRoom = 12;
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("GH00030001\r", transport.output.c_str());
+    transport.frameRoom = SIZE_MAX;
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("GH00030001\r"
+                             "Gt10111102345678\r"
+                             "Gt2002112202345678\r"
+                             "GeT1ABCDEF011102345678\r"
+                             "t4000\r", transport.output.c_str());
+    TEST_ASSERT_EQUAL_STRING("G300030001", command("G"));
+
+    // Re-arming aborts a readout
+    TEST_ASSERT_EQUAL_STRING("", command("GR"));
+    TEST_ASSERT_EQUAL_STRING("", command("GA"));
+    TEST_ASSERT_EQUAL_STRING("", command("GX"));
+    transport.output.clear();
+    dispatcher.pollAll(&transport);
+    TEST_ASSERT_EQUAL_STRING("", transport.output.c_str());
+    TEST_ASSERT_EQUAL_STRING("G000000000", command("G"));
+}
+
+static void test_cyclic_keeps_period_grid() {
+    CyclicTransmitter cyclic;
+    command("O");
+    TEST_ASSERT_TRUE(cyclic.set(makeFrame(0x100, false, 2), 10));
+    TEST_ASSERT_TRUE(cyclic.set(makeFrame(0x200, false, 1), 25));
+
+    // Polled at an uneven rate: sends still land on the 10 / 25 ms grid
+    std::vector<uint32_t> sent100, sent200;
+    for (uint32_t now = 0; now <= 100; now += 3) {
+        size_t before = can->txFrames.size();
+        cyclic.poll(*can, now);
+        for (size_t i = before; i < can->txFrames.size(); i++) {
+            (can->txFrames[i].id == 0x100 ? sent100 : sent200).push_back(now);
+        }
+    }
+    // First send on the first tick, then every period (seen at the next poll)
+    TEST_ASSERT_EQUAL(10, sent100.size());
+    TEST_ASSERT_EQUAL(4, sent200.size());
+    TEST_ASSERT_EQUAL(3, sent100[0]);
+    TEST_ASSERT_EQUAL(12, sent100[1]);      // Due at 11
+    TEST_ASSERT_EQUAL(21, sent100[2]);      // Due at 21, not 22
+    TEST_ASSERT_EQUAL(27, sent200[1]);      // Due at 26
+
+    uint32_t sent, rejects;
+    cyclic.getCounters(&sent, &rejects);
+    TEST_ASSERT_EQUAL(14, sent);
+    TEST_ASSERT_EQUAL(0, rejects);
+}
+
+static void test_cyclic_stall_retry_and_remove() {
+    CyclicTransmitter cyclic;
+    command("O");
+    cyclic.set(makeFrame(0x100, false, 0), 5);
+    cyclic.poll(*can, 1);
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());
+
+    // A 1 s stall sends one frame, not the 200 missed cycles
+    cyclic.poll(*can, 1001);
+    TEST_ASSERT_EQUAL(2, can->txFrames.size());
+    cyclic.poll(*can, 1005);
+    TEST_ASSERT_EQUAL(2, can->txFrames.size());
+    cyclic.poll(*can, 1006);
+    TEST_ASSERT_EQUAL(3, can->txFrames.size());
+
+    // TX queue full: retried on the next tick
+    can->txCapacity = 3;
+    cyclic.poll(*can, 1011);
+    can->txCapacity = SIZE_MAX;
+    cyclic.poll(*can, 1012);
+    TEST_ASSERT_EQUAL(4, can->txFrames.size());
+    uint32_t sent, rejects;
+    cyclic.getCounters(&sent, &rejects);
+    TEST_ASSERT_EQUAL(1, rejects);
+
+    TEST_ASSERT_FALSE(cyclic.remove(0x100, true));
+    TEST_ASSERT_TRUE(cyclic.remove(0x100, false));
+    TEST_ASSERT_EQUAL(0, cyclic.getEntryCount());
+    cyclic.poll(*can, 1100);
+    TEST_ASSERT_EQUAL(4, can->txFrames.size());
+}
+
+static void test_cyclic_counter_checksum_and_update() {
+    CyclicTransmitter cyclic;
+    command("O");
+    CANFrame f = makeFrame(0x321, false, 4);
+    TEST_ASSERT_FALSE(cyclic.setCounter(0x321, false, 0, 4, 3));   // No entry yet
+    cyclic.set(f, 1);
+    TEST_ASSERT_FALSE(cyclic.setCounter(0x321, false, 8, 4, 3));
+    TEST_ASSERT_FALSE(cyclic.setCounter(0x321, false, 2, 4, 2));
+    TEST_ASSERT_TRUE(cyclic.setCounter(0x321, false, 0, 3, 3));
+
+    for (uint32_t now = 1; now <= 4; now++) {
+        cyclic.poll(*can, now);
+    }
+    TEST_ASSERT_EQUAL(4, can->txFrames.size());
+    const uint8_t counters[] = {0, 1, 2, 0};
+    for (int i = 0; i < 4; i++) {
+        const CANFrame& tx = can->txFrames[i];
+        TEST_ASSERT_EQUAL_HEX8(counters[i], tx.data[0]);
+        TEST_ASSERT_EQUAL_HEX8(tx.data[0] ^ tx.data[1] ^ tx.data[2], tx.data[3]);
+    }
+
+    // Payload update keeps the entry's timing and counter
+    f.data[1] = 0xAB;
+    TEST_ASSERT_TRUE(cyclic.update(f));
+    cyclic.poll(*can, 5);
+    TEST_ASSERT_EQUAL(5, can->txFrames.size());
+    TEST_ASSERT_EQUAL_HEX8(1, can->txFrames[4].data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xAB, can->txFrames[4].data[1]);
+
+    CANFrame other = makeFrame(0x322, false, 1);
+    TEST_ASSERT_FALSE(cyclic.update(other));
+}
+
+static void test_cyclic_table_full() {
+    CyclicTransmitter cyclic;
+    for (uint32_t i = 0; i < CYCLIC_TX_MAX_ENTRIES; i++) {
+        TEST_ASSERT_TRUE(cyclic.set(makeFrame(i, false, 0), 100));
+    }
+    TEST_ASSERT_FALSE(cyclic.set(makeFrame(0x7FF, false, 0), 100));
+    TEST_ASSERT_TRUE(cyclic.set(makeFrame(0, false, 8), 50));      // Replace is fine
+    TEST_ASSERT_FALSE(cyclic.set(makeFrame(0, false, 0), 0));
+    TEST_ASSERT_EQUAL(CYCLIC_TX_MAX_ENTRIES, cyclic.getEntryCount());
+    cyclic.clear();
+    TEST_ASSERT_EQUAL(0, cyclic.getEntryCount());
+}
+
+static void test_cyclic_command() {
+    TEST_ASSERT_EQUAL_STRING("", command("c+000At1232AABB"));
+    TEST_ASSERT_EQUAL_STRING("", command("c+0064T123456781FF"));
+    TEST_ASSERT_EQUAL_STRING("", command("c=t1233CCDDEE"));
+    TEST_ASSERT_EQUAL_STRING("", command("c#t1231032"));
+    TEST_ASSERT_EQUAL_STRING("", command("c#T12345678-00-"));
+    TEST_ASSERT_EQUAL_STRING("c020000000000000000", command("c"));
+
+    TEST_ASSERT_EQUAL_STRING("\a", command("c+0000t1230"));         // Zero period
+    TEST_ASSERT_EQUAL_STRING("\a", command("c+000At1232AABBCC"));   // Trailing text
+    TEST_ASSERT_EQUAL_STRING("\a", command("c=t4560"));             // No such entry
+    TEST_ASSERT_EQUAL_STRING("\a", command("c#t1238003"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("c-t456"));
+    TEST_ASSERT_EQUAL_STRING("\a", command("c-t12"));
+    TEST_ASSERT_EQUAL_STRING("", command("c-T12345678"));
+
+    // Sent from poll() while the channel transmits
+    MockTransport transport;
+    slcan->poll(&transport);
+    TEST_ASSERT_EQUAL(0, can->txFrames.size());
+    command("O");
+    shimAdvanceMicros(2000);
+    slcan->poll(&transport);
+    TEST_ASSERT_EQUAL(1, can->txFrames.size());
+    TEST_ASSERT_EQUAL_HEX32(0x123, can->txFrames[0].id);
+    TEST_ASSERT_EQUAL(3, can->txFrames[0].dlc);
+    TEST_ASSERT_EQUAL_HEX8(0xCC, can->txFrames[0].data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, can->txFrames[0].data[1]);                 // Counter
+    TEST_ASSERT_EQUAL_HEX8(0xCC ^ 0x00, can->txFrames[0].data[2]);          // Checksum
+
+    TEST_ASSERT_EQUAL_STRING("", command("cC"));
+    TEST_ASSERT_EQUAL_STRING("c000000000100000000", command("c"));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_open_close);
+    RUN_TEST(test_listen_only);
+    RUN_TEST(test_unsupported_bitrate);
+    RUN_TEST(test_transmit_standard);
+    RUN_TEST(test_transmit_extended_and_rtr);
+    RUN_TEST(test_transmit_lowercase_hex);
+    RUN_TEST(test_transmit_rejects_malformed);
+    RUN_TEST(test_transmit_needs_open_channel);
+    RUN_TEST(test_transmit_backend_full);
+    RUN_TEST(test_quiet_tx);
+    RUN_TEST(test_batch_transmit);
+    RUN_TEST(test_format_standard);
+    RUN_TEST(test_format_extended);
+    RUN_TEST(test_format_rtr_has_no_data);
+    RUN_TEST(test_format_timestamps);
+    RUN_TEST(test_format_tx_echo_prefix);
+    RUN_TEST(test_format_buffer_too_small);
+    RUN_TEST(test_format_parse_round_trip);
+    RUN_TEST(test_status_flags);
+    RUN_TEST(test_tx_echo_command);
+    RUN_TEST(test_unknown_command);
+    RUN_TEST(test_routes_match_process_command);
+    RUN_TEST(test_loopback_open);
+    RUN_TEST(test_generator_config_errors);
+    RUN_TEST(test_generator_fills_tx_queue);
+    RUN_TEST(test_generator_count_and_dlc_mix);
+    RUN_TEST(test_loopback_generator_round_trip);
+    RUN_TEST(test_poll_forwards_frames);
+    RUN_TEST(test_poll_closed_channel_forwards_nothing);
+    RUN_TEST(test_poll_budget_and_backpressure);
+    RUN_TEST(test_poll_holds_frames_until_host_connects);
+    RUN_TEST(test_poll_one_frame);
+    RUN_TEST(test_poll_all_in_one_write);
+    RUN_TEST(test_poll_all_waits_for_link);
+    RUN_TEST(test_change_only_command);
+    RUN_TEST(test_change_only_suppresses_repeats);
+    RUN_TEST(test_change_only_keep_alive_and_refused_writes);
+    RUN_TEST(test_change_only_full_cache_forwards);
+    RUN_TEST(test_decimate_command);
+    RUN_TEST(test_overflow_command);
+    RUN_TEST(test_capture_command_and_readout);
+    RUN_TEST(test_cyclic_keeps_period_grid);
+    RUN_TEST(test_cyclic_stall_retry_and_remove);
+    RUN_TEST(test_cyclic_counter_checksum_and_update);
+    RUN_TEST(test_cyclic_table_full);
+    RUN_TEST(test_cyclic_command);
+    return UNITY_END();
+}
@@ -0,0 +1,111 @@
+/**
+ * TX priority queue and frame ring tests (native)
+ */
+
+#include <unity.h>
+#include "TxPriorityQueue.h"
+#include "FrameRing.h"
+
+void setUp() {}
+void tearDown() {}
+
+static CANFrame frame(uint32_t id, bool extended = false, bool rtr = false) {
+    CANFrame f;
+    f.id = id;
+    f.extended = extended;
+    f.rtr = rtr;
+    return f;
+}
+
+static void test_pops_in_arbitration_order() {
+    TxPriorityQueue<8> q;
+    q.push(frame(0x300), false);
+    q.push(frame(0x100), false);
+    q.push(frame(0x200), false);
+    TEST_ASSERT_EQUAL_HEX32(0x100, q.peek()->id);
+    q.pop();
+    TEST_ASSERT_EQUAL_HEX32(0x200, q.peek()->id);
+    q.pop();
+    TEST_ASSERT_EQUAL_HEX32(0x300, q.peek()->id);
+    q.pop();
+    TEST_ASSERT_NULL(q.peek());
+}
+
+static void test_arbitration_key_rules() {
+    typedef TxPriorityQueue<1> Q;
+    // Standard beats extended with the same base ID
+    TEST_ASSERT_TRUE(Q::arbitrationKey(frame(0x123)) < Q::arbitrationKey(frame(0x123UL << 18, true)));
+    // Data beats remote
+    TEST_ASSERT_TRUE(Q::arbitrationKey(frame(0x123)) < Q::arbitrationKey(frame(0x123, false, true)));
+    // Extended with a lower base ID beats standard
+    TEST_ASSERT_TRUE(Q::arbitrationKey(frame(0x122UL << 18, true)) < Q::arbitrationKey(frame(0x123)));
+}
+
+static void test_equal_ids_keep_push_order() {
+    TxPriorityQueue<8> q;
+    for (uint8_t i = 0; i < 5; i++) {
+        CANFrame f = frame(0x100);
+        f.data[0] = i;
+        q.push(f, false);
+    }
+    for (uint8_t i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(i, q.peek()->data[0]);
+        q.pop();
+    }
+}
+
+static void test_fifo_mode_ignores_ids() {
+    TxPriorityQueue<4> q;
+    q.push(frame(0x700), true);
+    q.push(frame(0x001), true);
+    TEST_ASSERT_EQUAL_HEX32(0x700, q.peek()->id);
+}
+
+static void test_capacity() {
+    TxPriorityQueue<3> q;
+    TEST_ASSERT_TRUE(q.push(frame(1), false));
+    TEST_ASSERT_TRUE(q.push(frame(2), false));
+    TEST_ASSERT_TRUE(q.push(frame(3), false));
+    TEST_ASSERT_TRUE(q.full());
+    TEST_ASSERT_FALSE(q.push(frame(0), false));
+    q.clear();
+    TEST_ASSERT_TRUE(q.empty());
+}
+
+static void test_full_capacity_drains_in_order() {
+    // Past 127 entries the child index no longer fits a byte
+    static TxPriorityQueue<255> q;
+    for (uint32_t i = 0; i < 255; i++) {
+        TEST_ASSERT_TRUE(q.push(frame((i * 97) % 255), false));
+    }
+    TEST_ASSERT_TRUE(q.full());
+    for (uint32_t id = 0; id < 255; id++) {
+        TEST_ASSERT_EQUAL_HEX32(id, q.peek()->id);
+        q.pop();
+    }
+    TEST_ASSERT_TRUE(q.empty());
+}
+
+static void test_frame_ring_wraps() {
+    FrameRing<CANFrame, 4> ring;
+    CANFrame out;
+    for (uint32_t i = 0; i < 10; i++) {
+        TEST_ASSERT_TRUE(ring.push(frame(i)));
+        TEST_ASSERT_EQUAL_HEX32(i, ring.peek()->id);
+        TEST_ASSERT_TRUE(ring.pop(out));
+        TEST_ASSERT_EQUAL_HEX32(i, out.id);
+    }
+    TEST_ASSERT_FALSE(ring.pop(out));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_pops_in_arbitration_order);
+    RUN_TEST(test_arbitration_key_rules);
+    RUN_TEST(test_equal_ids_keep_push_order);
+    RUN_TEST(test_fifo_mode_ignores_ids);
+    RUN_TEST(test_capacity);
+    RUN_TEST(test_full_capacity_drains_in_order);
+    RUN_TEST(test_frame_ring_wraps);
+    return UNITY_END();
+}
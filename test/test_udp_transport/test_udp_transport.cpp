@@ -0,0 +1,186 @@
+/**
+ * UDP transport tests (native)
+ *
+ * Datagram framing, output batching and counters of UdpTransport over a
+ * mock UDP socket, plus one pass of the SLCAN stack on top of it.
+ */
+
+#include <unity.h>
+#include "UdpTransport.h"
+#include "SLCAN.h"
+#include "ProtocolDispatcher.h"
+#include "MockUdp.h"
+#include "MockCANBackend.h"
+#include <string>
+
+static MockUdp* udp;
+static UdpTransport* transport;
+
+void setUp() {
+    udp = new MockUdp();
+    transport = new UdpTransport(*udp);
+    transport->begin(0);
+}
+
+void tearDown() {
+    delete transport;
+    delete udp;
+}
+
+static std::string nextLine() {
+    const char* line;
+    size_t len;
+    if (!transport->readLine(&line, &len)) {
+        return "<none>";
+    }
+    std::string s(line, len);
+    transport->releaseLine();
+    return s;
+}
+
+// =============================================================================
+// Input framing
+// =============================================================================
+
+static void test_datagram_carries_several_lines() {
+    TEST_ASSERT_EQUAL(NET_UDP_PORT, udp->localPort);
+    udp->deliver("V\rt1230\r\nN");
+    TEST_ASSERT_EQUAL_STRING("V", nextLine().c_str());
+    TEST_ASSERT_EQUAL_STRING("t1230", nextLine().c_str());
+    TEST_ASSERT_EQUAL_STRING("N", nextLine().c_str());     // Datagram end ends the line
+    TEST_ASSERT_EQUAL_STRING("<none>", nextLine().c_str());
+    TEST_ASSERT_TRUE(transport->hasPeer());
+}
+
+static void test_oversize_datagram_is_dropped_whole() {
+    udp->deliver(std::string(NET_RX_BUFFER_SIZE + 1, 'x'));
+    udp->deliver("V\r");
+    TEST_ASSERT_EQUAL_STRING("<none>", nextLine().c_str());
+    TEST_ASSERT_EQUAL_STRING("V", nextLine().c_str());
+
+    uint32_t drops, frameDrops, overflows;
+    transport->getCounters(&drops, &frameDrops, &overflows);
+    TEST_ASSERT_EQUAL(1, overflows);
+
+    uint32_t sent, lost, received;
+    transport->getDatagramCounters(&sent, &lost, &received);
+    TEST_ASSERT_EQUAL(2, received);
+}
+
+// =============================================================================
+// Output batching
+// =============================================================================
+
+static void test_responses_lead_the_datagram() {
+    udp->deliver("O\r", IPAddress(192, 168, 1, 20), 5555);
+    nextLine();
+
+    transport->writeWithPriority("t1230\r", 6, WritePriority::CAN_RX_FRAME);
+    transport->writeLine("z");
+    TEST_ASSERT_EQUAL(0, udp->sent.size());
+    transport->flushBatch();
+
+    TEST_ASSERT_EQUAL(1, udp->sent.size());
+    TEST_ASSERT_EQUAL_STRING("z\rt1230\r", udp->sent[0].data.c_str());
+    TEST_ASSERT_TRUE(udp->sent[0].ip == IPAddress(192, 168, 1, 20));
+    TEST_ASSERT_EQUAL(5555, udp->sent[0].port);
+
+    transport->flushBatch();                    // Nothing staged: no empty datagram
+    TEST_ASSERT_EQUAL(1, udp->sent.size());
+}
+
+static void test_no_frames_before_a_host_talks() {
+    TEST_ASSERT_EQUAL(0, transport->writeRoom(WritePriority::CAN_RX_FRAME));
+    TEST_ASSERT_FALSE(transport->writeWithPriority("t1230\r", 6, WritePriority::CAN_RX_FRAME));
+
+    uint32_t drops, frameDrops, overflows;
+    transport->getCounters(&drops, &frameDrops, &overflows);
+    TEST_ASSERT_EQUAL(1, frameDrops);
+}
+
+static void test_full_lane_sends_early() {
+    udp->deliver("O");
+    nextLine();
+
+    const char frame[] = "T123456788112233445566778800FF\r";
+    size_t len = sizeof(frame) - 1;
+    size_t perDatagram = NET_TX_DATAGRAM_SIZE / len;
+    for (size_t i = 0; i <= perDatagram; i++) {
+        TEST_ASSERT_TRUE(transport->writeWithPriority(frame, len, WritePriority::CAN_RX_FRAME));
+    }
+    TEST_ASSERT_EQUAL(1, udp->sent.size());
+    TEST_ASSERT_EQUAL(perDatagram * len, udp->sent[0].data.size());
+
+    transport->flushBatch();
+    TEST_ASSERT_EQUAL(2, udp->sent.size());
+    TEST_ASSERT_EQUAL(len, udp->sent[1].data.size());
+}
+
+static void test_refused_datagram_is_counted() {
+    udp->deliver("O");
+    nextLine();
+    udp->failSend = true;
+    transport->writeLine("z");
+    transport->flushBatch();
+
+    uint32_t sent, lost, received;
+    transport->getDatagramCounters(&sent, &lost, &received);
+    TEST_ASSERT_EQUAL(0, sent);
+    TEST_ASSERT_EQUAL(1, lost);
+
+    uint16_t resp, frames;
+    transport->getTxLevel(&resp, &frames);
+    TEST_ASSERT_EQUAL(0, resp);                 // Not retried
+
+    transport->resetCounters();
+    transport->getDatagramCounters(&sent, &lost, &received);
+    TEST_ASSERT_EQUAL(0, lost);
+    TEST_ASSERT_EQUAL(0, received);
+}
+
+// =============================================================================
+// SLCAN over UDP
+// =============================================================================
+
+static void test_slcan_stack_over_udp() {
+    MockCANBackend can;
+    SLCAN slcan(can);
+    ProtocolDispatcher dispatcher;
+    dispatcher.setFrameSource(&can);
+    dispatcher.registerHandler(&slcan);
+
+    udp->deliver("S6\rO\r");
+    CANFrame f;
+    f.id = 0x123;
+    f.dlc = 1;
+    f.data[0] = 0xAB;
+    can.pushRx(f);
+
+    // One main loop iteration
+    char response[RESPONSE_BUFFER_SIZE];
+    const char* cmd;
+    size_t cmdLen;
+    while (transport->readLine(&cmd, &cmdLen)) {
+        if (dispatcher.dispatch(cmd, response, sizeof(response))) {
+            transport->writeLine(response);
+        }
+        transport->releaseLine();
+    }
+    dispatcher.pollAll(transport);
+    transport->flushBatch();
+
+    TEST_ASSERT_EQUAL(1, udp->sent.size());
+    TEST_ASSERT_EQUAL_STRING("\r\rt1231AB\r", udp->sent[0].data.c_str());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_datagram_carries_several_lines);
+    RUN_TEST(test_oversize_datagram_is_dropped_whole);
+    RUN_TEST(test_responses_lead_the_datagram);
+    RUN_TEST(test_no_frames_before_a_host_talks);
+    RUN_TEST(test_full_lane_sends_early);
+    RUN_TEST(test_refused_datagram_is_counted);
+    RUN_TEST(test_slcan_stack_over_udp);
+    return UNITY_END();
+}